@@ -0,0 +1,514 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "../src/application.hpp"
+#include "../src/utils/vertexwelder/vertexwelder.hpp"
+
+#include "gitcommit.hpp" // Generated on every build, see cmake/gitcommit.cmake
+
+// Fills the scene with a configurable amount of stuff, renders a fixed amount of frames, and writes down how long they
+// took as JSON, so runs can be compared across commits. The scene only depends on the arguments (and the seed), so two
+// runs with the same arguments always render the exact same thing.
+// Usage: Game_Engine_bench [--headless] [--frames F] [--warmup W] [--models N] [--quads M] [--lights L]
+//                          [--marching K] [--glb B] [--seed S] [--occlusion] [--compressed] [--sync-loading]
+//                          [--acmr] [--obj-loading] [--obj-grid G] [--welding] [--output file.json]
+// Run it with and without --sync-loading to compare the time to first frame, with everything loaded up front or not.
+// --acmr, --obj-loading and --welding also measure the mesh optimiser, the OBJ loaders and the vertex welder on the
+// CPU, which have nothing to do with the frame times, so they're opt-in. --obj-grid adds a big generated grid to the
+// OBJ loading, and turns it on.
+namespace {
+    struct BenchSettings {
+        bool headless = false;
+        bool occlusionCulling = false;
+        bool syncLoading = false; // Waits for the whole scene before the first frame, like before the asset loader
+        bool compressedVertices = false; // Only for the spheres, since they're most of the vertices
+        bool acmr = false;
+        bool objLoading = false;
+        bool welding = false;
+        uint32_t frames = 1000;
+        uint32_t warmup = 60; // Not counted, so pipeline creation and the first uploads don't skew anything
+        uint32_t models = 256;
+        uint32_t quads = 64;
+        uint32_t lights = 8; // Only the first MAX_POINT_LIGHTS actually light anything, the rest are just billboards
+        uint32_t marching = 4;
+        uint32_t glb = 16; // Same sphere, but out of a GLB, so that path gets drawn too
+        uint32_t seed = 1337;
+        uint32_t objGrid = 0; // Side of a generated grid OBJ to time the loaders on too, since the spheres are tiny
+        std::string output = "bench.json";
+    };
+
+    // Everything goes in a box in front of the default camera, which looks down +Z
+    glm::vec3 randomPosition(std::mt19937 &rng) {
+        std::uniform_real_distribution<float> xy(-8.0f, 8.0f);
+        std::uniform_real_distribution<float> z(4.0f, 40.0f);
+        return {xy(rng), xy(rng), z(rng)};
+    }
+
+    // Everything but the GLB goes through the loader, like the default scene, so the time to first frame means the same
+    // thing for both, and --sync-loading gets the number from before there was a loader
+    void loadScene(const BenchSettings &settings,
+                   Engine::Device &device,
+                   Engine::AssetLoader &assetLoader,
+                   Engine::Entity::Map &entities) {
+        using namespace Engine;
+
+        std::mt19937 rng{settings.seed};
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        entities.reserve(settings.models + settings.quads + settings.lights + settings.marching + settings.glb);
+
+        // Everything starts out with the placeholders, and gets swapped over on every entity waiting on it at once.
+        // They get looked up again, like in the default scene, in case any of them are gone by then.
+        const auto setModel = [&entities](std::vector<Entity::id_t> ids) {
+            return [&entities, ids = std::move(ids)](const std::shared_ptr<Model> &model) {
+                for (const Entity::id_t id : ids)
+                    if (const auto entity = entities.find(id); entity != entities.end())
+                        entity->second.getModelComponent()->model = model;
+            };
+        };
+        const auto setTexture = [&entities](std::vector<Entity::id_t> ids) {
+            return [&entities, ids = std::move(ids)](const std::shared_ptr<Texture> &texture) {
+                for (const Entity::id_t id : ids)
+                    if (const auto entity = entities.find(id); entity != entities.end())
+                        entity->second.getTextureComponent()->diffuseMap = texture;
+            };
+        };
+
+        // Every instance shares the same geometry, it's the amount of entities we want to stress, not the uploads.
+        // Arguments can get evaluated in any order, so anything random goes in its own variable first.
+        std::vector<Entity::id_t> spheres;
+        for (uint32_t i = 0; i < settings.models; i++) {
+            const glm::vec3 position = randomPosition(rng);
+            const float scale = 0.25f + 0.5f * unit(rng);
+            Entity sphere = Entity::createEntity();
+            sphere.addComponent(std::make_unique<ModelComponent>(assetLoader.getPlaceholderModel()));
+            sphere.addComponent(std::make_unique<TransformComponent>(position, glm::vec3{scale}));
+            spheres.push_back(sphere.getId());
+            entities.emplace(sphere.getId(), std::move(sphere));
+        } assetLoader.loadModel("../res/models/sphere/sphere_smooth.obj",
+                                settings.compressedVertices,
+                                setModel(std::move(spheres)));
+
+        std::vector<Entity::id_t> quads;
+        for (uint32_t i = 0; i < settings.quads; i++) {
+            Entity quad = Entity::createEntity();
+            auto quadModelComponent = std::make_unique<ModelComponent>(assetLoader.getPlaceholderModel());
+            quadModelComponent->occluder = true;
+            quad.addComponent(std::move(quadModelComponent));
+            quad.addComponent(std::make_unique<TextureComponent>(assetLoader.getPlaceholderTexture()));
+            quad.addComponent(std::make_unique<TransformComponent>(randomPosition(rng),
+                                                                   glm::vec3{2.0f},
+                                                                   glm::vec3{-glm::half_pi<float>(), 0.0f, 0.0f}));
+            quads.push_back(quad.getId());
+            entities.emplace(quad.getId(), std::move(quad));
+        }
+        assetLoader.loadModel([&device] {
+            Procedural::Quad q(device, 2);
+            q.generateModel();
+            return q.buildModel();
+        }, setModel(quads));
+        assetLoader.loadTexture("../res/textures/texture.jpg", setTexture(std::move(quads)));
+
+        if (settings.marching > 0) {
+            std::vector<Entity::id_t> surfaces;
+            for (uint32_t i = 0; i < settings.marching; i++) {
+                Entity mcEntity = Entity::createEntity();
+                mcEntity.addComponent(std::make_unique<ModelComponent>(assetLoader.getPlaceholderModel()));
+                mcEntity.addComponent(std::make_unique<TransformComponent>(randomPosition(rng)));
+                surfaces.push_back(mcEntity.getId());
+                entities.emplace(mcEntity.getId(), std::move(mcEntity));
+            }
+            assetLoader.loadModel([&device] {
+                Procedural::MarchingCubes mc(device, 32, Procedural::MarchingCubes::testSurface, 0.0f);
+                mc.generateModel();
+                return mc.buildModel();
+            }, setModel(std::move(surfaces)));
+        }
+
+        // The loader doesn't do GLB files, but they're only ever mapped and uploaded anyway, there's nothing to parse
+        if (settings.glb > 0) {
+            std::vector<std::unique_ptr<Model>> loaded = Model::createModelsFromGlb(
+                device, "../res/models/sphere/sphere_smooth.glb", settings.compressedVertices);
+            const std::vector<std::shared_ptr<Model>> glbModels(std::make_move_iterator(loaded.begin()),
+                                                                std::make_move_iterator(loaded.end()));
+            for (uint32_t i = 0; i < settings.glb; i++) {
+                for (const std::shared_ptr<Model> &glbModel : glbModels) {
+                    Entity glbEntity = Entity::createEntity();
+                    glbEntity.addComponent(std::make_unique<ModelComponent>(glbModel));
+                    glbEntity.addComponent(std::make_unique<TransformComponent>(randomPosition(rng)));
+                    entities.emplace(glbEntity.getId(), std::move(glbEntity));
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < settings.lights; i++) {
+            const float intensity = 0.5f + unit(rng);
+            const glm::vec3 color{unit(rng), unit(rng), unit(rng)}; // Braces do go left to right, though
+            Entity pointLight = Entity::createPointLightEntity(intensity, 0.1f, color);
+            pointLight.getTransformComponent()->position = randomPosition(rng);
+            entities.emplace(pointLight.getId(), std::move(pointLight));
+        }
+    }
+
+    // Anything that didn't come from us (like the device name, or a file name) could have quotes or what not in it
+    std::string escapeJson(const std::string_view string) {
+        std::string escaped;
+        escaped.reserve(string.size());
+        for (const char c : string) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                constexpr char HEX[] = "0123456789abcdef";
+                escaped += "\\u00";
+                escaped += HEX[(c >> 4) & 0xf];
+                escaped += HEX[c & 0xf];
+            } else escaped += c;
+        } return escaped;
+    }
+
+    void writePercentiles(std::ofstream &file, const Engine::FrameStats::Percentiles &percentiles) {
+        file << "{\"min\": " << percentiles.min << ", \"p50\": " << percentiles.p50 << ", \"p90\": " << percentiles.p90
+             << ", \"p95\": " << percentiles.p95 << ", \"p99\": " << percentiles.p99 << ", \"max\": " << percentiles.max
+             << ", \"avg\": " << percentiles.avg << "}";
+    }
+
+    // Only the frames after the warmup
+    template<typename T>
+    std::vector<float> measured(const std::vector<T> &samples, const uint32_t warmup) {
+        std::vector<float> result;
+        if (samples.size() <= warmup) return result;
+        result.reserve(samples.size() - warmup);
+        for (size_t i = warmup; i < samples.size(); i++) result.push_back(static_cast<float>(samples[i]));
+        return result;
+    }
+
+    // How well the mesh optimiser does on the models we ship: straight out of the OBJ, after the meshlets (which is all
+    // we did before it), and after it. Doesn't need the GPU, so it's the same on every device.
+    void writeACMR(std::ofstream &file) {
+        using namespace Engine;
+
+        file << "  \"acmr\": {";
+        const char *separator = "\n";
+        for (const char *name : {"sphere_flat", "sphere_smooth"}) {
+            Model::Builder builder{};
+            builder.loadModel(std::string("../res/models/sphere/") + name + ".obj");
+            builder.generateLODs();
+            const float loaded = builder.computeACMR();
+            builder.buildMeshlets();
+            const float meshlets = builder.computeACMR();
+            builder.optimize();
+            file << separator << "    \"" << name << "\": {\"loaded\": " << loaded << ", \"meshlets\": " << meshlets
+                 << ", \"optimized\": " << builder.computeACMR() << "}";
+            separator = ",\n";
+        } file << "\n  },\n";
+    }
+
+    // Writes a G by G grid of quads, with texture coordinates and a normal, so it welds just like a real mesh would.
+    // The vertices get nudged around a bit, so the quads don't all split along the same diagonal, since that's the
+    // part the two loaders are most likely to disagree on, along with the vertex colors.
+    std::filesystem::path writeGridObj(const uint32_t size, const bool quads = false, const bool colors = false) {
+        const std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                           ("bench_grid_" + std::string(quads ? "quads_" : "") +
+                                            (colors ? "colors_" : "") + std::to_string(size) + ".obj");
+        std::ofstream file(path);
+        if (!file) throw std::runtime_error("Failed to create " + path.string() + "!");
+
+        const auto coordinate = [size](const uint32_t i) { return static_cast<float>(i) / static_cast<float>(size); };
+        for (uint32_t y = 0; y <= size; y++) for (uint32_t x = 0; x <= size; x++) {
+            const float offset = (x + y) % 3 == 0 ? 0.3f / static_cast<float>(size) : 0.0f;
+            const float depth = static_cast<float>((x * 7 + y * 3) % 5) * 0.01f;
+            file << "v " << coordinate(x) + offset << " " << coordinate(y) << " " << depth;
+            if (colors) file << " " << coordinate(x) << " " << coordinate(y) << " 0.5";
+            file << "\nvt " << coordinate(x) << " " << coordinate(y) << "\n";
+        }
+        file << "vn 0 0 1\n";
+        for (uint32_t y = 0; y < size; y++) for (uint32_t x = 0; x < size; x++) {
+            const uint32_t a = y * (size + 1) + x + 1, b = a + 1, c = a + size + 1, d = c + 1; // OBJ counts from 1
+            if (quads) {
+                file << "f " << a << "/" << a << "/1 " << b << "/" << b << "/1 " << d << "/" << d << "/1 "
+                     << c << "/" << c << "/1\n";
+            } else {
+                file << "f " << a << "/" << a << "/1 " << b << "/" << b << "/1 " << d << "/" << d << "/1\n"
+                     << "f " << a << "/" << a << "/1 " << d << "/" << d << "/1 " << c << "/" << c << "/1\n";
+            }
+        } if (!file.flush()) throw std::runtime_error("Failed to write " + path.string() + "!");
+        return path;
+    }
+
+    // Best of a few runs, in milliseconds, so a stray page fault or context switch doesn't count
+    double timeLoad(const std::string &path, const uint32_t threadCount, Engine::Model::Builder &builder) {
+        double best = std::numeric_limits<double>::max();
+        for (uint32_t run = 0; run < 3; run++) {
+            const auto start = std::chrono::steady_clock::now();
+            builder.loadModel(path, threadCount);
+            const std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+            best = std::min(best, time.count());
+        } return best;
+    }
+
+    // The single threaded loader against the multithreaded one, on the spheres, a grid of quads, a grid with vertex
+    // colors, and on a big generated grid if asked. Also checks they actually came up with the same mesh, which is the
+    // whole point of welding them the same way.
+    void writeObjLoading(std::ofstream &file, const BenchSettings &settings) {
+        using namespace Engine;
+
+        std::vector<std::string> paths{"../res/models/sphere/sphere_flat.obj",
+                                       "../res/models/sphere/sphere_smooth.obj"};
+        std::vector<std::filesystem::path> generated{writeGridObj(64, true), writeGridObj(64, false, true)};
+        if (settings.objGrid > 0) generated.push_back(writeGridObj(settings.objGrid));
+        for (const std::filesystem::path &path : generated) paths.push_back(path.string());
+
+        const uint32_t threadCount = std::max(2u, std::thread::hardware_concurrency());
+        file << "  \"objLoading\": {\"threads\": " << threadCount << ", \"models\": {";
+        const char *separator = "\n";
+        for (const std::string &path : paths) {
+            Model::Builder serial{}, parallel{};
+            const double serialTime = timeLoad(path, 1, serial);
+            const double parallelTime = timeLoad(path, threadCount, parallel);
+            const bool same = serial.indices == parallel.indices && serial.vertices == parallel.vertices;
+            file << separator << "    \"" << escapeJson(std::filesystem::path(path).stem().string())
+                 << "\": {\"vertices\": " << serial.vertices.size() << ", \"indices\": " << serial.indices.size()
+                 << ", \"serial\": " << serialTime << ", \"parallel\": " << parallelTime << ", \"identical\": "
+                 << (same ? "true" : "false") << "}";
+            separator = ",\n";
+        } file << "\n  }},\n";
+
+        for (const std::filesystem::path &path : generated) std::filesystem::remove(path);
+    }
+
+    // What every mesh builder used to weld with, so there's something to compare the welder against
+    struct LegacyVertexHash {
+        size_t operator()(const Engine::Model::Vertex &vertex) const noexcept {
+            size_t seed = 0;
+            hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.texCoord);
+            return seed;
+        }
+    };
+
+    // Every corner of a G by G grid of quads, the same as the one writeGridObj writes, but without the round trip
+    std::vector<Engine::Model::Vertex> generateGridCorners(const uint32_t size) {
+        std::vector<Engine::Model::Vertex> corners;
+        corners.reserve(6 * size_t{size} * size);
+        const auto corner = [size](const uint32_t x, const uint32_t y) {
+            const glm::vec2 position = glm::vec2{x, y} / static_cast<float>(size);
+            return Engine::Model::Vertex{{position, 0.0f}, glm::vec3{1.0f}, {0.0f, 0.0f, 1.0f}, position};
+        };
+        for (uint32_t y = 0; y < size; y++) for (uint32_t x = 0; x < size; x++) {
+            for (const Engine::Model::Vertex &vertex : {corner(x, y), corner(x + 1, y), corner(x + 1, y + 1),
+                                                        corner(x, y), corner(x + 1, y + 1), corner(x, y + 1)})
+                corners.push_back(vertex);
+        } return corners;
+    }
+
+    // The old node based map against the open addressing welder, on every corner of the spheres and a big grid.
+    // Best of a few runs, in milliseconds, and how many vertices each ended up with, which should always be the same.
+    void writeWelding(std::ofstream &file) {
+        using namespace Engine;
+
+        std::vector<std::pair<std::string, std::vector<Model::Vertex>>> meshes;
+        for (const char *name : {"sphere_flat", "sphere_smooth"}) {
+            Model::Builder builder{};
+            builder.loadModel(std::string("../res/models/sphere/") + name + ".obj");
+            std::vector<Model::Vertex> corners;
+            corners.reserve(builder.indices.size());
+            for (const uint32_t index : builder.indices) corners.push_back(builder.vertices[index]);
+            meshes.emplace_back(name, std::move(corners));
+        } meshes.emplace_back("grid_512", generateGridCorners(512));
+
+        const auto time = [](const auto &weld) {
+            double best = std::numeric_limits<double>::max();
+            for (uint32_t run = 0; run < 3; run++) {
+                const auto start = std::chrono::steady_clock::now();
+                weld();
+                const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                best = std::min(best, elapsed.count());
+            } return best;
+        };
+
+        file << "  \"welding\": {";
+        const char *separator = "\n";
+        for (const auto &[name, corners] : meshes) {
+            std::vector<Model::Vertex> mapVertices, welderVertices;
+            const double mapTime = time([&] {
+                mapVertices.clear();
+                std::unordered_map<Model::Vertex, uint32_t, LegacyVertexHash> uniqueVertices(corners.size());
+                for (const Model::Vertex &vertex : corners) {
+                    if (!uniqueVertices.contains(vertex)) {
+                        uniqueVertices[vertex] = static_cast<uint32_t>(mapVertices.size());
+                        mapVertices.push_back(vertex);
+                    }
+                }
+            });
+            const double welderTime = time([&] {
+                welderVertices.clear();
+                VertexWelder welder(welderVertices, corners.size());
+                for (const Model::Vertex &vertex : corners) welder.weld(vertex);
+            });
+            file << separator << "    \"" << name << "\": {\"corners\": " << corners.size() << ", \"map\": " << mapTime
+                 << ", \"welder\": " << welderTime << ", \"mapVertices\": " << mapVertices.size()
+                 << ", \"welderVertices\": " << welderVertices.size() << "}";
+            separator = ",\n";
+        } file << "\n  },\n";
+    }
+
+    bool writeReport(const BenchSettings &settings, const Engine::Application &app) {
+        using namespace Engine;
+
+        std::ofstream file(settings.output);
+        if (!file) return false;
+
+        const FrameStats &stats = app.getFrameStats();
+        file << "{\n";
+        file << "  \"commit\": \"" << ENGINE_GIT_COMMIT << "\",\n";
+        file << "  \"device\": \"" << escapeJson(app.getDevice().properties.deviceName) << "\",\n";
+        file << "  \"config\": {\"headless\": " << (settings.headless ? "true" : "false")
+             << ", \"frames\": " << settings.frames << ", \"warmup\": " << settings.warmup
+             << ", \"models\": " << settings.models << ", \"quads\": " << settings.quads
+             << ", \"lights\": " << settings.lights << ", \"marching\": " << settings.marching
+             << ", \"glb\": " << settings.glb
+             << ", \"seed\": " << settings.seed << ", \"occlusion\": " << (settings.occlusionCulling ? "true" : "false")
+             << ", \"compressed\": " << (settings.compressedVertices ? "true" : "false")
+             << ", \"syncLoading\": " << (settings.syncLoading ? "true" : "false")
+             << ", \"acmr\": " << (settings.acmr ? "true" : "false")
+             << ", \"objLoading\": " << (settings.objLoading ? "true" : "false")
+             << ", \"objGrid\": " << settings.objGrid
+             << ", \"welding\": " << (settings.welding ? "true" : "false")
+             << ", \"antiAliasing\": \"" << getAntiAliasingName(app.antiAliasing) << "\"},\n";
+        if (settings.acmr) writeACMR(file);
+        if (settings.objLoading) writeObjLoading(file, settings);
+        if (settings.welding) writeWelding(file);
+        file << "  \"timeToFirstFrame\": " << app.getTimeToFirstFrame() << ",\n";
+        file << "  \"timeToLoaded\": " << app.getTimeToLoaded() << ",\n";
+        file << "  \"measuredFrames\": " << measured(stats.getFrameTimes(), settings.warmup).size() << ",\n";
+
+        file << "  \"frameTime\": ";
+        writePercentiles(file, FrameStats::computePercentiles(measured(stats.getFrameTimes(), settings.warmup)));
+        file << ",\n  \"drawCalls\": ";
+        writePercentiles(file, FrameStats::computePercentiles(measured(stats.getDrawCalls(), settings.warmup)));
+
+        file << ",\n  \"cpuSystems\": {";
+        const char *separator = "\n";
+        for (const FrameStats::System &system : stats.getSystems()) {
+            file << separator << "    \"" << system.name << "\": ";
+            writePercentiles(file, FrameStats::computePercentiles(measured(system.times, settings.warmup)));
+            separator = ",\n";
+        } file << "\n  },\n";
+
+        // These are rolling, so only the last GpuProfiler::HISTORY frames are in here
+        file << "  \"gpuScopes\": {";
+        separator = "\n";
+        for (const GpuProfiler::ScopeStats &scope : app.getGpuProfiler().getStats()) {
+            file << separator << "    \"" << scope.name << "\": {\"depth\": " << scope.depth << ", \"min\": "
+                 << scope.min << ", \"avg\": " << scope.avg << ", \"max\": " << scope.max << ", \"samples\": "
+                 << scope.sampleCount << "}";
+            separator = ",\n";
+        } file << "\n  }\n}\n";
+        return static_cast<bool>(file);
+    }
+
+    bool parseCount(const char *arg, uint32_t &value) {
+        try {
+            value = static_cast<uint32_t>(std::stoul(arg));
+            return true;
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchSettings settings{};
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (std::strcmp(arg, "--headless") == 0) {
+            settings.headless = true;
+            continue;
+        } if (std::strcmp(arg, "--occlusion") == 0) {
+            settings.occlusionCulling = true;
+            continue;
+        } if (std::strcmp(arg, "--compressed") == 0) {
+            settings.compressedVertices = true;
+            continue;
+        } if (std::strcmp(arg, "--sync-loading") == 0) {
+            settings.syncLoading = true;
+            continue;
+        } if (std::strcmp(arg, "--acmr") == 0) {
+            settings.acmr = true;
+            continue;
+        } if (std::strcmp(arg, "--obj-loading") == 0) {
+            settings.objLoading = true;
+            continue;
+        } if (std::strcmp(arg, "--welding") == 0) {
+            settings.welding = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return EXIT_FAILURE;
+        } const char *value = argv[++i];
+
+        bool valid = true;
+        if (std::strcmp(arg, "--output") == 0) settings.output = value;
+        else if (std::strcmp(arg, "--frames") == 0) valid = parseCount(value, settings.frames);
+        else if (std::strcmp(arg, "--warmup") == 0) valid = parseCount(value, settings.warmup);
+        else if (std::strcmp(arg, "--models") == 0) valid = parseCount(value, settings.models);
+        else if (std::strcmp(arg, "--quads") == 0) valid = parseCount(value, settings.quads);
+        else if (std::strcmp(arg, "--lights") == 0) valid = parseCount(value, settings.lights);
+        else if (std::strcmp(arg, "--marching") == 0) valid = parseCount(value, settings.marching);
+        else if (std::strcmp(arg, "--glb") == 0) valid = parseCount(value, settings.glb);
+        else if (std::strcmp(arg, "--seed") == 0) valid = parseCount(value, settings.seed);
+        else if (std::strcmp(arg, "--obj-grid") == 0) {
+            valid = parseCount(value, settings.objGrid);
+            settings.objLoading = true; // There'd be no point to it otherwise
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (!valid) {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (settings.frames == 0) {
+        std::cerr << "Need at least one frame to measure!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        Engine::Application app{{
+            settings.headless,
+            settings.warmup + settings.frames,
+            [&settings](Engine::Device &device, Engine::AssetLoader &assetLoader, Engine::Entity::Map &entities) {
+                loadScene(settings, device, assetLoader, entities);
+            },
+            !settings.syncLoading
+        }};
+        app.occlusionCulling = settings.occlusionCulling;
+        app.run();
+
+        if (!writeReport(settings, app)) {
+            std::cerr << "Failed to write the benchmark results to " << settings.output << std::endl;
+            return EXIT_FAILURE;
+        } std::cout << "Saved the benchmark results to " << settings.output << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    } return EXIT_SUCCESS;
+}
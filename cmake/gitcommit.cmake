@@ -0,0 +1,20 @@
+# Writes the commit we're building into a header, run on every build by the GitCommit target, since the commit can
+# change without CMake ever getting re-run. The header only gets touched when the commit actually changes, so nothing
+# gets rebuilt otherwise.
+# Usage: cmake -DSOURCE_DIR=<repository> -DOUTPUT=<header> -P gitcommit.cmake
+execute_process(COMMAND git rev-parse --short HEAD
+                WORKING_DIRECTORY ${SOURCE_DIR}
+                OUTPUT_VARIABLE ENGINE_GIT_COMMIT
+                OUTPUT_STRIP_TRAILING_WHITESPACE
+                ERROR_QUIET)
+if(NOT ENGINE_GIT_COMMIT)
+    set(ENGINE_GIT_COMMIT "unknown")
+endif()
+
+set(CONTENTS "// Generated by cmake/gitcommit.cmake on every build, don't edit\n#define ENGINE_GIT_COMMIT \"${ENGINE_GIT_COMMIT}\"\n")
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} PREVIOUS)
+endif()
+if(NOT CONTENTS STREQUAL PREVIOUS)
+    file(WRITE ${OUTPUT} "${CONTENTS}")
+endif()
@@ -88,8 +88,8 @@ namespace tinyobj_opt {
 template <typename T, size_t stack_capacity>
 class StackAllocator : public std::allocator<T> {
  public:
-  typedef typename std::allocator<T>::pointer pointer;
-  typedef typename std::allocator<T>::size_type size_type;
+  typedef T *pointer; // std::allocator<T>::pointer is gone since C++20
+  typedef std::size_t size_type;
 
   // Backing store for the allocator. The container owner is responsible for
   // maintaining this for as long as any containers using this allocator are
@@ -156,7 +156,8 @@ class StackAllocator : public std::allocator<T> {
       source_->used_stack_buffer_ = true;
       return source_->stack_buffer();
     } else {
-      return std::allocator<T>::allocate(n, hint);
+      (void)hint; // The hinted overload is gone since C++20 too
+      return std::allocator<T>::allocate(n);
     }
   }
 
@@ -0,0 +1,9 @@
+#version 460
+
+layout (location = 0) out vec2 fragUV;
+
+// A single triangle that covers the whole screen, no vertex buffer needed
+void main() {
+    fragUV = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(fragUV * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,143 @@
+#version 460
+
+// Based on the FXAA 3.11 quality preset, by Timothy Lottes
+
+layout (set = 0, binding = 0) uniform sampler2D sceneTexture;
+
+layout (push_constant) uniform PushConstants {
+    vec2 uvScale; // How much of the scene image we actually rendered to
+    vec2 texelSize;
+} push;
+
+layout (location = 0) in vec2 fragUV;
+
+layout (location = 0) out vec4 outColor;
+
+const float EDGE_THRESHOLD_MIN = 0.0312;
+const float EDGE_THRESHOLD_MAX = 0.125;
+const float SUBPIXEL_QUALITY = 0.75;
+
+const int ITERATIONS = 12;
+const float QUALITY[ITERATIONS] = { 1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 2.0, 2.0, 4.0, 8.0 };
+
+// Make sure we never sample the part of the image we didn't render to this frame
+vec3 sampleScene(vec2 uv) {
+    return textureLod(sceneTexture, clamp(uv, vec2(0.0), push.uvScale - 0.5 * push.texelSize), 0.0).rgb;
+}
+
+float luma(vec3 color) {
+    return sqrt(dot(color, vec3(0.299, 0.587, 0.114))); // Rough gamma correction
+}
+
+float sampleLuma(vec2 uv) {
+    return luma(sampleScene(uv));
+}
+
+void main() {
+    vec2 uv = fragUV * push.uvScale;
+    vec3 colorCenter = sampleScene(uv);
+
+    float lumaCenter = luma(colorCenter);
+    float lumaDown = sampleLuma(uv + vec2(0.0, -push.texelSize.y));
+    float lumaUp = sampleLuma(uv + vec2(0.0, push.texelSize.y));
+    float lumaLeft = sampleLuma(uv + vec2(-push.texelSize.x, 0.0));
+    float lumaRight = sampleLuma(uv + vec2(push.texelSize.x, 0.0));
+
+    float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
+    float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
+    float lumaRange = lumaMax - lumaMin;
+
+    // Not an edge, or too dark to notice
+    if (lumaRange < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD_MAX)) {
+        outColor = vec4(colorCenter, 1.0);
+        return;
+    }
+
+    float lumaDownLeft = sampleLuma(uv - push.texelSize);
+    float lumaUpRight = sampleLuma(uv + push.texelSize);
+    float lumaUpLeft = sampleLuma(uv + vec2(-push.texelSize.x, push.texelSize.y));
+    float lumaDownRight = sampleLuma(uv + vec2(push.texelSize.x, -push.texelSize.y));
+
+    float lumaDownUp = lumaDown + lumaUp;
+    float lumaLeftRight = lumaLeft + lumaRight;
+    float lumaLeftCorners = lumaDownLeft + lumaUpLeft;
+    float lumaDownCorners = lumaDownLeft + lumaDownRight;
+    float lumaRightCorners = lumaDownRight + lumaUpRight;
+    float lumaUpCorners = lumaUpRight + lumaUpLeft;
+
+    // Figure out if the edge is horizontal or vertical
+    float edgeHorizontal = abs(-2.0 * lumaLeft + lumaLeftCorners) +
+                           abs(-2.0 * lumaCenter + lumaDownUp) * 2.0 +
+                           abs(-2.0 * lumaRight + lumaRightCorners);
+    float edgeVertical = abs(-2.0 * lumaUp + lumaUpCorners) +
+                         abs(-2.0 * lumaCenter + lumaLeftRight) * 2.0 +
+                         abs(-2.0 * lumaDown + lumaDownCorners);
+    bool isHorizontal = edgeHorizontal >= edgeVertical;
+
+    // Then which side of the pixel the edge is on
+    float luma1 = isHorizontal ? lumaDown : lumaLeft;
+    float luma2 = isHorizontal ? lumaUp : lumaRight;
+    float gradient1 = luma1 - lumaCenter;
+    float gradient2 = luma2 - lumaCenter;
+    bool is1Steepest = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+
+    float stepLength = isHorizontal ? push.texelSize.y : push.texelSize.x;
+    float lumaLocalAverage;
+    if (is1Steepest) {
+        stepLength = -stepLength;
+        lumaLocalAverage = 0.5 * (luma1 + lumaCenter);
+    } else lumaLocalAverage = 0.5 * (luma2 + lumaCenter);
+
+    // Move half a pixel towards the edge
+    vec2 currentUv = uv;
+    if (isHorizontal) currentUv.y += stepLength * 0.5;
+    else currentUv.x += stepLength * 0.5;
+
+    // Walk along the edge in both directions until we reach its ends
+    vec2 offset = isHorizontal ? vec2(push.texelSize.x, 0.0) : vec2(0.0, push.texelSize.y);
+    vec2 uv1 = currentUv - offset * QUALITY[0];
+    vec2 uv2 = currentUv + offset * QUALITY[0];
+
+    float lumaEnd1 = sampleLuma(uv1) - lumaLocalAverage;
+    float lumaEnd2 = sampleLuma(uv2) - lumaLocalAverage;
+    bool reached1 = abs(lumaEnd1) >= gradientScaled;
+    bool reached2 = abs(lumaEnd2) >= gradientScaled;
+
+    for (int i = 1; i < ITERATIONS && !(reached1 && reached2); i++) {
+        if (!reached1) {
+            uv1 -= offset * QUALITY[i];
+            lumaEnd1 = sampleLuma(uv1) - lumaLocalAverage;
+            reached1 = abs(lumaEnd1) >= gradientScaled;
+        }
+        if (!reached2) {
+            uv2 += offset * QUALITY[i];
+            lumaEnd2 = sampleLuma(uv2) - lumaLocalAverage;
+            reached2 = abs(lumaEnd2) >= gradientScaled;
+        }
+    }
+
+    float distance1 = isHorizontal ? (uv.x - uv1.x) : (uv.y - uv1.y);
+    float distance2 = isHorizontal ? (uv2.x - uv.x) : (uv2.y - uv.y);
+    bool isDirection1 = distance1 < distance2;
+    float distanceFinal = min(distance1, distance2);
+    float edgeThickness = distance1 + distance2;
+
+    // Only blend if the end of the edge we're closest to actually goes the same way as the center
+    bool isLumaCenterSmaller = lumaCenter < lumaLocalAverage;
+    bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+    float finalOffset = correctVariation ? -distanceFinal / edgeThickness + 0.5 : 0.0;
+
+    // Sub-pixel aliasing, for details smaller than a pixel
+    float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaDownUp + lumaLeftRight) + lumaLeftCorners + lumaRightCorners);
+    float subPixelOffset1 = clamp(abs(lumaAverage - lumaCenter) / lumaRange, 0.0, 1.0);
+    float subPixelOffset2 = (-2.0 * subPixelOffset1 + 3.0) * subPixelOffset1 * subPixelOffset1;
+    float subPixelOffsetFinal = subPixelOffset2 * subPixelOffset2 * SUBPIXEL_QUALITY;
+    finalOffset = max(finalOffset, subPixelOffsetFinal);
+
+    vec2 finalUv = uv;
+    if (isHorizontal) finalUv.y += finalOffset * stepLength;
+    else finalUv.x += finalOffset * stepLength;
+
+    outColor = vec4(sampleScene(finalUv), 1.0);
+}
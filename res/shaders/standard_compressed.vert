@@ -0,0 +1,60 @@
+#version 460
+
+struct PointLight {
+    vec4 position;
+    vec4 color;
+};
+
+layout (constant_id = 0) const uint MAX_POINT_LIGHTS = 8;
+
+layout (set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projMatrix;
+    mat4 viewMatrix;
+    mat4 inverseViewMatrix;
+
+    vec4 ambientLightColor;
+
+    PointLight pointLights[MAX_POINT_LIGHTS];
+    uint pointLightCount;
+
+    float ambientStrength;
+    float diffuseStrength;
+    float specularStrength;
+    float shininess;
+
+    bool texturesEnabled;
+} globalUbo;
+
+layout (push_constant) uniform PushConstant {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+} push;
+
+// Model::CompressedVertex, the position's relative to the bounding box, which is already part of the model matrix
+layout (location = 0) in vec4 position;
+layout (location = 1) in vec4 color;
+layout (location = 2) in vec2 octNormal;
+layout (location = 3) in vec2 texCoord;
+
+layout (location = 0) out vec3 fragColor;
+layout (location = 1) out vec3 fragPos;
+layout (location = 2) out vec3 fragNormal;
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+void main() {
+    vec4 worldPos = push.modelMatrix * vec4(position.xyz, 1.0);
+    gl_Position = globalUbo.projMatrix * (globalUbo.viewMatrix * worldPos);
+
+    fragPos = worldPos.xyz;
+    fragNormal = normalize(mat3(push.normalMatrix) * decodeOctahedral(octNormal));
+
+    fragColor = color.rgb;
+
+    // We can ignore the UVs, since they're not used for this render system
+}
\ No newline at end of file
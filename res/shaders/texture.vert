@@ -49,5 +49,7 @@ void main() {
 
     fragColor = color;
 
-    fragTexCoord = vec2(texCoord.x, -texCoord.y);
+    // Ours start at the bottom, like OBJ's, and the images at the top. Models that already start at the top (glTF's)
+    // get flagged in the normal matrix's last column, which is otherwise unused.
+    fragTexCoord = vec2(texCoord.x, push.normalMatrix[3].y != 0.0 ? texCoord.y : -texCoord.y);
 }
\ No newline at end of file
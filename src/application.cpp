@@ -1,7 +1,8 @@
 #include "application.hpp"
 
 namespace Engine {
-    Application::Application() {
+    Application::Application(ApplicationSettings settings) :
+                             headless(settings.headless), frameCount(settings.frameCount) {
         globalPool = DescriptorPool::Builder(device)
                 .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
                 .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
@@ -13,9 +14,18 @@ namespace Engine {
                 .setMaxSets(1024)
                 .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1024)
                 .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1024)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1024)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1024)
                 .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
         for (auto &framePool : framePools) framePool = framePoolBuilder.build();
-        loadEntities();
+
+        clusterCuller = std::make_unique<ClusterCuller>(device, SwapChain::MAX_FRAMES_IN_FLIGHT);
+        occlusionCuller = std::make_unique<OcclusionCuller>(device, SwapChain::MAX_FRAMES_IN_FLIGHT);
+        gpuProfiler = std::make_unique<GpuProfiler>(device, SwapChain::MAX_FRAMES_IN_FLIGHT);
+        assetLoader = std::make_unique<AssetLoader>(device, assetCache);
+        if (settings.loadScene) settings.loadScene(device, *assetLoader, entities);
+        else loadEntities();
+        if (!settings.asyncLoading) assetLoader->waitAll();
     }
     Application::~Application() {
         vkDeviceWaitIdle(device.device()); // Wait for all the resources to be freed before destroying them
@@ -23,13 +33,18 @@ namespace Engine {
         // We need our descriptor pools destroyed before the device is
         globalPool = nullptr;
         framePools.clear();
+        clusterCuller = nullptr;
+        occlusionCuller = nullptr;
+        gpuProfiler = nullptr;
+        assetLoader = nullptr; // Anything still loading would end up in the entities
+        entities.clear(); // Their models and textures have to give their memory back before the allocator's gone
 
         _maindelqueue.flush();
 
         renderer.del();
         device.del();
 
-        destroyImGUI();
+        if (!headless) destroyImGUI();
     }
 
     void Application::run() {
@@ -66,6 +81,9 @@ namespace Engine {
         TextureRenderSystem textureRenderSystem{device,
                                                    renderer.getSwapChainRenderPass(),
                                                    globalSetLayout->getDescriptorSetLayout()};
+        FXAARenderSystem fxaaRenderSystem{device,
+                                          renderer.getUIRenderPass(),
+                                          globalSetLayout->getDescriptorSetLayout()};
 
         Camera camera{};
         camera.setViewTarget(glm::vec3{0.0f, 0.0f, 0.0f}, glm::vec3{0.5f, 0.0f, 1.0f});
@@ -74,28 +92,41 @@ namespace Engine {
         cameraEntity.addComponent(std::make_unique<TransformComponent>(glm::vec3{0.0f, 0.0f, -2.5f}));
         MovementController movementController{};
 
-        initImGUI();
+        // No window means no input and no UI either
+        if (!headless) {
+            initImGUI();
 
-        glfwSetInputMode(window.getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-        if (glfwRawMouseMotionSupported()) glfwSetInputMode(window.getWindow(), GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+            glfwSetInputMode(window.getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+            if (glfwRawMouseMotionSupported()) glfwSetInputMode(window.getWindow(), GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+        }
 
-        bool centered = true;
+        bool centered = !headless;
         float aspectRatio = 0.0f;
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        while (!window.shouldClose()) {
-            glfwPollEvents();
+        uint32_t renderedFrames = 0;
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        auto currentTime = startTime;
+        while (!window.shouldClose() && (frameCount == 0 || renderedFrames < frameCount)) {
+            ZoneScopedN("Frame");
+            frameStats.beginFrame();
+
+            // Waiting here instead of in beginFrame means the input we poll right after is as fresh as it can be
+            if (renderer.lowLatency) renderer.waitForFrame();
+            if (!headless) glfwPollEvents();
 
             auto newTime = std::chrono::high_resolution_clock::now();
             float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
             deltaTime = glm::min(deltaTime, FrameInfo::MAX_DELTA_TIME);
+            if (frameCount != 0) deltaTime = FIXED_DELTA_TIME; // So every run simulates exactly the same thing
             currentTime = newTime;
 
-            if (glfwGetKey(window.getWindow(), GLFW_KEY_ESCAPE) == GLFW_PRESS && centered) {
-                glfwSetInputMode(window.getWindow(), GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-                centered = false;
-            } else if (glfwGetMouseButton(window.getWindow(), GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS && !centered) {
-                glfwSetInputMode(window.getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-                centered = true;
+            if (!headless) {
+                if (glfwGetKey(window.getWindow(), GLFW_KEY_ESCAPE) == GLFW_PRESS && centered) {
+                    glfwSetInputMode(window.getWindow(), GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+                    centered = false;
+                } else if (glfwGetMouseButton(window.getWindow(), GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS && !centered) {
+                    glfwSetInputMode(window.getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+                    centered = true;
+                }
             }
 
             if (aspectRatio != renderer.getAspectRatio()) {
@@ -118,48 +149,173 @@ namespace Engine {
                 }
             }
 
+            // This recreates the swap chain, so it can't happen in the middle of a frame
+            if (antiAliasing != renderer.getAntiAliasing() || occlusionCulling != renderer.isOcclusionCullingEnabled()) {
+                renderer.setAntiAliasing(antiAliasing);
+                renderer.setOcclusionCulling(occlusionCulling);
+                simpleRenderSystem.rebuild(renderer.getSwapChainRenderPass());
+                billboardRenderSystem.rebuild(renderer.getSwapChainRenderPass());
+                textureRenderSystem.rebuild(renderer.getSwapChainRenderPass());
+                fxaaRenderSystem.rebuild(renderer.getUIRenderPass());
+            }
+
+            // Anything that's done gets swapped in now, so its uploads go out with this frame
+            {
+                FrameStats::Timer timer{frameStats, "Asset Loading"};
+                assetLoader->update();
+            }
+
+            uint32_t drawCalls = 0;
             if (auto commandBuffer = renderer.beginFrame()) {
                 uint32_t frameIndex = renderer.getCurrentFrameIndex();
                 framePools[frameIndex]->resetPool();
+                gpuProfiler->beginFrame(commandBuffer, frameIndex);
+                gpuProfiler->beginScope(commandBuffer, "Frame");
+                clusterCuller->beginFrame(frameIndex, camera);
+                occlusionCuller->beginFrame(frameIndex);
+                softwareOcclusionCuller.beginFrame(camera.getProjectionMatrix() * camera.getViewMatrix());
+                if (softwareOcclusionCuller.enabled) {
+                    FrameStats::Timer timer{frameStats, "Software Occlusion"};
+                    for (Entity &ent : std::views::values(entities)) {
+                        if (!ent.hasComponent(MODEL) || !ent.getModelComponent()->occluder) continue;
+                        const Model &model = *ent.getModelComponent()->model;
+                        softwareOcclusionCuller.addOccluder(model.getOccluderVertices(),
+                                                            model.getOccluderIndices(),
+                                                            ent.getTransformComponent()->mat4());
+                    } softwareOcclusionCuller.rasterize();
+                }
                 FrameInfo frameInfo{frameIndex,
                                     deltaTime,
                                     commandBuffer,
+                                    renderer.getTracyContext(),
                                     camera,
                                     globalDescriptorSets[frameIndex],
                                     *framePools[frameIndex],
-                                    entities};
+                                    entities,
+                                    *clusterCuller,
+                                    *occlusionCuller,
+                                    softwareOcclusionCuller,
+                                    renderer.isOcclusionCullingEnabled() ? DrawPhase::Visible : DrawPhase::Single};
 
                 // Update cycle
-                GlobalUbo ubo{};
-                ubo.projectionMatrix = frameInfo.camera.getProjectionMatrix();
-                ubo.viewMatrix = frameInfo.camera.getViewMatrix();
-                ubo.inverseViewMatrix = frameInfo.camera.getInverseViewMatrix();
-
-                ubo.ambientStrength = ambientStrength;
-                ubo.diffuseStrength = diffuseStrength;
-                ubo.specularStrength = specularStrength;
-                ubo.shininess = shininess;
-
-                ubo.texturesEnabled = texturesEnabled;
-
-                billboardRenderSystem.update(frameInfo, ubo);
-                uboBuffers[frameInfo.frameIndex]->writeToBuffer(&ubo);
-                uboBuffers[frameInfo.frameIndex]->flush();
+                {
+                    FrameStats::Timer timer{frameStats, "Update"};
+                    GlobalUbo ubo{};
+                    ubo.projectionMatrix = frameInfo.camera.getProjectionMatrix();
+                    ubo.viewMatrix = frameInfo.camera.getViewMatrix();
+                    ubo.inverseViewMatrix = frameInfo.camera.getInverseViewMatrix();
+
+                    ubo.ambientStrength = ambientStrength;
+                    ubo.diffuseStrength = diffuseStrength;
+                    ubo.specularStrength = specularStrength;
+                    ubo.shininess = shininess;
+
+                    ubo.texturesEnabled = texturesEnabled;
+
+                    billboardRenderSystem.update(frameInfo, ubo);
+                    uboBuffers[frameInfo.frameIndex]->writeToBuffer(&ubo);
+                    uboBuffers[frameInfo.frameIndex]->flush();
+                }
 
                 // Render cycle
-                renderer.beginSwapChainRenderPass(frameInfo.commandBuffer);
+                const bool occlusionCulled = frameInfo.phase == DrawPhase::Visible;
+                if (occlusionCulled) {
+                    GpuProfiler::Scope scope{*gpuProfiler, frameInfo.commandBuffer, "Occlusion Prepare"};
+                    occlusionCuller->prepare(frameInfo, renderer.getSwapChainExtent());
+                }
 
-                // !!! ORDER MATTERS HERE !!!
-                textureRenderSystem.render(frameInfo);
-                simpleRenderSystem.render(frameInfo);
-                billboardRenderSystem.render(frameInfo);
+                {
+                    TracyVkZone(frameInfo.tracyContext, frameInfo.commandBuffer, "Scene Pass");
+                    GpuProfiler::Scope passScope{*gpuProfiler, frameInfo.commandBuffer, "Scene Pass"};
+                    renderer.beginSwapChainRenderPass(frameInfo.commandBuffer);
+
+                    // !!! ORDER MATTERS HERE !!!
+                    // Same-named scopes get added up, so the second occlusion phase counts towards the first one
+                    const auto renderScene = [&] {
+                        {
+                            GpuProfiler::Scope scope{*gpuProfiler, frameInfo.commandBuffer, "Texture"};
+                            FrameStats::Timer timer{frameStats, "Texture"};
+                            textureRenderSystem.render(frameInfo);
+                        } {
+                            GpuProfiler::Scope scope{*gpuProfiler, frameInfo.commandBuffer, "Simple"};
+                            FrameStats::Timer timer{frameStats, "Simple"};
+                            simpleRenderSystem.render(frameInfo);
+                        } {
+                            GpuProfiler::Scope scope{*gpuProfiler, frameInfo.commandBuffer, "Billboard"};
+                            FrameStats::Timer timer{frameStats, "Billboard"};
+                            billboardRenderSystem.render(frameInfo);
+                        }
+                    };
+                    renderScene();
+
+                    // The pyramid gets built out of what we've drawn so far, so the pass has to be split in two
+                    if (occlusionCulled) {
+                        renderer.suspendSwapChainRenderPass(frameInfo.commandBuffer);
+                        {
+                            GpuProfiler::Scope scope{*gpuProfiler, frameInfo.commandBuffer, "Occlusion Cull"};
+                            occlusionCuller->cull(frameInfo, renderer.getDepthImageView(), renderer.getRenderExtent());
+                        } renderer.resumeSwapChainRenderPass(frameInfo.commandBuffer);
+
+                        frameInfo.phase = DrawPhase::Disoccluded;
+                        renderScene();
+                    }
+
+                    renderer.endSwapChainRenderPass(frameInfo.commandBuffer);
+                }
 
-                drawImGUI(frameInfo);
+                // The UI always gets drawn at native resolution, regardless of the scene's scale
+                {
+                    TracyVkZone(frameInfo.tracyContext, frameInfo.commandBuffer, "UI Pass");
+                    GpuProfiler::Scope passScope{*gpuProfiler, frameInfo.commandBuffer, "UI Pass"};
+                    renderer.beginUIRenderPass(frameInfo.commandBuffer);
+                    if (renderer.getAntiAliasing() == AntiAliasing::FXAA) {
+                        GpuProfiler::Scope scope{*gpuProfiler, frameInfo.commandBuffer, "FXAA"};
+                        FrameStats::Timer timer{frameStats, "FXAA"};
+                        fxaaRenderSystem.setInput(renderer.getSceneImageView(),
+                                                  renderer.getRenderExtent(),
+                                                  renderer.getSwapChainExtent());
+                        fxaaRenderSystem.render(frameInfo);
+                    } if (!headless) {
+                        GpuProfiler::Scope scope{*gpuProfiler, frameInfo.commandBuffer, "ImGui"};
+                        FrameStats::Timer timer{frameStats, "ImGui"};
+                        drawImGUI(frameInfo);
+                    } renderer.endUIRenderPass(frameInfo.commandBuffer);
+                }
 
-                renderer.endSwapChainRenderPass(frameInfo.commandBuffer);
-                renderer.endFrame();
+                gpuProfiler->endScope(frameInfo.commandBuffer);
+                gpuProfiler->endFrame(frameInfo.commandBuffer);
+                drawCalls = frameInfo.drawCalls;
+
+                // The renderer forgets about these once the frame ends
+                frameStats.addSystemTime("Frame Wait", renderer.getFrameWaitTime());
+                frameStats.addSystemTime("Acquire", renderer.getAcquireTime());
+                {
+                    FrameStats::Timer timer{frameStats, "Submit"};
+                    renderer.endFrame();
+                } renderedFrames++;
+
+                const float sinceStartup = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                    std::chrono::high_resolution_clock::now() - startupTime).count();
+                if (renderedFrames == 1) {
+                    timeToFirstFrame = sinceStartup;
+                    std::cout << "Time to first frame: " << timeToFirstFrame << " ms ("
+                              << assetLoader->getPendingCount() << " assets still loading)" << std::endl;
+                } if (timeToLoaded == 0.0f && assetLoader->getPendingCount() == 0) {
+                    timeToLoaded = sinceStartup;
+                    std::cout << "Time to loaded: " << timeToLoaded << " ms" << std::endl;
+                }
             }
+            frameStats.endFrame(drawCalls);
+            FrameMark;
         } vkDeviceWaitIdle(device.device()); // Wait for all the resource to be freed before destroying them
+
+        if (frameCount != 0) {
+            const float totalTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                std::chrono::high_resolution_clock::now() - startTime).count();
+            std::cout << "Rendered " << renderedFrames << (headless ? " frames offscreen in " : " frames in ")
+                      << totalTime << " ms ("
+                      << totalTime / static_cast<float>(std::max(renderedFrames, 1u)) << " ms per frame)" << std::endl;
+        }
     }
 
     void Application::initImGUI() {
@@ -212,13 +368,13 @@ namespace Engine {
         init_info.DescriptorPool = imguiPool;
         init_info.MinImageCount = 2;
         init_info.ImageCount = SwapChain::MAX_FRAMES_IN_FLIGHT;
-        init_info.MSAASamples = device.getDesiredSampleCount();
+        init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT; // The UI pass draws straight into the swap chain image
         init_info.CheckVkResultFn = [](VkResult err) {
             if (err != VK_SUCCESS) throw std::runtime_error("ImGUI Vulkan error!");
         };
 
         ImGui_ImplGlfw_InitForVulkan(window.getWindow(), true);
-        ImGui_ImplVulkan_Init(&init_info, renderer.getSwapChainRenderPass());
+        ImGui_ImplVulkan_Init(&init_info, renderer.getUIRenderPass());
 
         VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
         ImGui_ImplVulkan_CreateFontsTexture(commandBuffer);
@@ -255,6 +411,162 @@ namespace Engine {
             ImGui::Checkbox("Enable Texturing", &texturesEnabled);
         }
 
+        if (ImGui::CollapsingHeader("Rendering")) {
+            DynamicResolution &dynamicResolution = renderer.getDynamicResolution();
+            ImGui::BeginDisabled(!dynamicResolution.isSupported() || !renderer.supportsScaling());
+            ImGui::Checkbox("Dynamic Resolution", &dynamicResolution.enabled);
+            ImGui::SliderFloat("Target GPU Time (ms)", &dynamicResolution.targetFrameTime, 4.0f, 33.3f);
+            ImGui::EndDisabled();
+
+            const VkExtent2D renderExtent = renderer.getRenderExtent();
+            ImGui::Text("GPU Time: %.2f ms", static_cast<double>(dynamicResolution.getGpuFrameTime()));
+            ImGui::Text("Scale: %.0f%% (%ux%u)",
+                        static_cast<double>(dynamicResolution.getScale() * 100.0f),
+                        renderExtent.width,
+                        renderExtent.height);
+
+            ImGui::Separator();
+            int framesInFlight = static_cast<int>(renderer.getFramesInFlight());
+            if (ImGui::SliderInt("Frames In Flight",
+                                 &framesInFlight,
+                                 static_cast<int>(SwapChain::MIN_FRAMES_IN_FLIGHT),
+                                 static_cast<int>(SwapChain::MAX_FRAMES_IN_FLIGHT)))
+                renderer.setFramesInFlight(static_cast<uint32_t>(framesInFlight));
+            ImGui::Checkbox("Low Latency", &renderer.lowLatency);
+            ImGui::Text("Frame Wait: %.2f ms (Acquire: %.2f ms)",
+                        static_cast<double>(renderer.getFrameWaitTime()),
+                        static_cast<double>(renderer.getAcquireTime()));
+
+            ImGui::Separator();
+            if (ImGui::BeginCombo("Anti-Aliasing", getAntiAliasingName(antiAliasing))) {
+                for (const AntiAliasing mode : ANTI_ALIASING_MODES) {
+                    if (ImGui::Selectable(getAntiAliasingName(mode), mode == antiAliasing)) antiAliasing = mode;
+                } ImGui::EndCombo();
+            }
+
+            // Actual memory for the current mode, and a rough estimate for the rest, so they can be compared
+            constexpr double MIB = 1024.0 * 1024.0;
+            ImGui::Text("Attachment Memory: %.1f MiB", static_cast<double>(renderer.getAttachmentMemory()) / MIB);
+            for (const AntiAliasing mode : ANTI_ALIASING_MODES) {
+                ImGui::BulletText("%s: ~%.1f MiB",
+                                  getAntiAliasingName(mode),
+                                  static_cast<double>(renderer.estimateAttachmentMemory(mode)) / MIB);
+            }
+
+            ImGui::Separator();
+            ImGui::Checkbox("Cluster Culling", &frameInfo.clusterCuller.enabled);
+            ImGui::Text("Visible Clusters: %u / %u",
+                        frameInfo.clusterCuller.getVisibleClusters(),
+                        frameInfo.clusterCuller.getTestedClusters());
+
+            ImGui::Checkbox("Occlusion Culling", &occlusionCulling);
+            if (renderer.isOcclusionCullingEnabled()) {
+                ImGui::Text("Occluded Instances: %u / %u",
+                            frameInfo.occlusionCuller.getOccludedInstances(),
+                            frameInfo.occlusionCuller.getTestedInstances());
+                ImGui::Text("Disoccluded Instances: %u", frameInfo.occlusionCuller.getDisoccludedInstances());
+            }
+
+            ImGui::Checkbox("Software Occlusion Culling", &frameInfo.softwareOcclusionCuller.enabled);
+            if (frameInfo.softwareOcclusionCuller.enabled) {
+                ImGui::Text("Occluded Objects: %u / %u",
+                            frameInfo.softwareOcclusionCuller.getOccludedObjects(),
+                            frameInfo.softwareOcclusionCuller.getTestedObjects());
+                ImGui::Text("Occluder Triangles: %u", frameInfo.softwareOcclusionCuller.getOccluderTriangles());
+                ImGui::Text("Rasterisation: %.2f ms (%u threads)",
+                            static_cast<double>(frameInfo.softwareOcclusionCuller.getRasterizationTime()),
+                            workerPool.getThreadCount() + 1);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Assets")) {
+            constexpr double MIB = 1024.0 * 1024.0;
+            const AssetCache::Stats stats = assetCache.getStats();
+            ImGui::Text("Cache Hit Rate: %.1f%% (%llu / %llu)",
+                        static_cast<double>(stats.getHitRate()) * 100.0,
+                        static_cast<unsigned long long>(stats.hits),
+                        static_cast<unsigned long long>(stats.hits + stats.misses));
+            ImGui::Text("Resident: %u models, %u textures", stats.models, stats.textures);
+            ImGui::Text("Resident Memory: %.1f MiB", static_cast<double>(stats.residentBytes) / MIB);
+            ImGui::Text("Loading: %u", assetLoader->getPendingCount());
+            ImGui::Text("Time To First Frame: %.1f ms", static_cast<double>(timeToFirstFrame));
+            ImGui::Text("Time To Loaded: %.1f ms", static_cast<double>(timeToLoaded));
+        }
+
+        if (ImGui::CollapsingHeader("GPU Profiler")) {
+            ImGui::BeginDisabled(!gpuProfiler->isSupported());
+            ImGui::Checkbox("Enable Profiler", &gpuProfiler->enabled);
+            ImGui::SameLine();
+            if (ImGui::Button("Export CSV")) {
+                if (gpuProfiler->exportCSV(GPU_PROFILE_PATH))
+                    std::cout << "Saved GPU timings to " << GPU_PROFILE_PATH << std::endl;
+                else std::cerr << "Failed to save GPU timings to " << GPU_PROFILE_PATH << std::endl;
+            } ImGui::EndDisabled();
+
+            // Timings are a few frames old, and over the last GpuProfiler::HISTORY frames
+            if (ImGui::BeginTable("GPU Timings", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+                ImGui::TableSetupColumn("Scope (ms)");
+                ImGui::TableSetupColumn("Min");
+                ImGui::TableSetupColumn("Avg");
+                ImGui::TableSetupColumn("Max");
+                ImGui::TableHeadersRow();
+                for (const GpuProfiler::ScopeStats &scope : gpuProfiler->getStats()) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%*s%s", static_cast<int>(2 * scope.depth), "", scope.name.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", static_cast<double>(scope.min));
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", static_cast<double>(scope.avg));
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", static_cast<double>(scope.max));
+                } ImGui::EndTable();
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Memory")) {
+            constexpr double MIB = 1024.0 * 1024.0;
+            const MemoryAllocator &allocator = device.getAllocator();
+            ImGui::Text("Device Allocations: %u / %u",
+                        allocator.getDeviceAllocationCount(),
+                        device.properties.limits.maxMemoryAllocationCount);
+            ImGui::Text("Uploaded: %.1f MiB", static_cast<double>(device.getUploadService().getUploadedBytes()) / MIB);
+            const GeometryArena::Stats geometry = device.getGeometryArena().getStats();
+            ImGui::Text("Geometry: %.1f / %.1f MiB (%u chunks)",
+                        static_cast<double>(geometry.usedBytes) / MIB,
+                        static_cast<double>(geometry.capacityBytes) / MIB,
+                        geometry.chunkCount);
+
+            // Used includes alignment padding, whatever's left of the reserved memory is free (or fragmented)
+            if (ImGui::BeginTable("Memory Types", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+                ImGui::TableSetupColumn("Type (Heap)");
+                ImGui::TableSetupColumn("Blocks");
+                ImGui::TableSetupColumn("Dedicated");
+                ImGui::TableSetupColumn("Allocations");
+                ImGui::TableSetupColumn("Used / Reserved (MiB)");
+                ImGui::TableHeadersRow();
+                for (const MemoryAllocator::Stats &type : allocator.getStats()) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%u (%u)%s%s",
+                                type.memoryType,
+                                type.heap,
+                                type.flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT ? " Device" : "",
+                                type.flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT ? " Host" : "");
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%u", type.blockCount);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%u", type.dedicatedCount);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%u", type.allocationCount);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.1f / %.1f",
+                                static_cast<double>(type.usedBytes) / MIB,
+                                static_cast<double>(type.reservedBytes) / MIB);
+                } ImGui::EndTable();
+            }
+        }
+
         ImGui::End();
 
         ImGui::Render();
@@ -267,47 +579,91 @@ namespace Engine {
         ImGui::DestroyContext();
     }
 
+    // Everything starts out with the placeholders, and gets swapped over once it's loaded
     void Application::loadEntities() {
-        entities.reserve(6);
+        entities.reserve(7);
+
+        // Entities can go away while their stuff is still loading, so they get looked up again once it's done
+        const auto setModel = [this](const Entity::id_t id) {
+            return [this, id](const std::shared_ptr<Model> &model) {
+                if (const auto entity = entities.find(id); entity != entities.end())
+                    entity->second.getModelComponent()->model = model;
+            };
+        };
+        const auto setTexture = [this](const Entity::id_t id) {
+            return [this, id](const std::shared_ptr<Texture> &texture) {
+                if (const auto entity = entities.find(id); entity != entities.end())
+                    entity->second.getTextureComponent()->diffuseMap = texture;
+            };
+        };
 
-        std::shared_ptr sphereFlatModel = Model::createModelFromFile(device, "../res/models/sphere/sphere_flat.obj");
         Entity sphereFlat = Entity::createEntity();
-        sphereFlat.addComponent(std::make_unique<ModelComponent>(sphereFlatModel));
+        sphereFlat.addComponent(std::make_unique<ModelComponent>(assetLoader->getPlaceholderModel()));
         sphereFlat.addComponent(std::make_unique<TransformComponent>(glm::vec3{2.5f, 0.0f, 5.0f},
                                                                        glm::vec3{0.5f, 0.5f, 0.5f}));
+        assetLoader->loadModel("../res/models/sphere/sphere_flat.obj", false, setModel(sphereFlat.getId()));
         entities.emplace(sphereFlat.getId(), std::move(sphereFlat));
 
-        std::shared_ptr sphereSmoothModel = Model::createModelFromFile(device, "../res/models/sphere/sphere_smooth.obj");
+        // This one uses compressed vertices, so that path always gets some use
         Entity sphereSmooth = Entity::createEntity();
-        sphereSmooth.addComponent(std::make_unique<ModelComponent>(sphereSmoothModel));
+        sphereSmooth.addComponent(std::make_unique<ModelComponent>(assetLoader->getPlaceholderModel()));
         sphereSmooth.addComponent(std::make_unique<TransformComponent>(glm::vec3{-2.5f, 0.0f, 5.0f},
                                                                        glm::vec3{0.5f, 0.5f, 0.5f}));
+        assetLoader->loadModel("../res/models/sphere/sphere_smooth.obj", true, setModel(sphereSmooth.getId()));
         entities.emplace(sphereSmooth.getId(), std::move(sphereSmooth));
 
-        Procedural::Terrain q(device, 2, {0.0f, 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 0.7f, 0.8f});
-        q.generateModel();
-        std::shared_ptr quadModel = q.getModel();
+        // The procedural meshes don't need the device until they're uploaded, so they get made on the loader's threads
         Entity quad = Entity::createEntity();
-        quad.addComponent(std::make_unique<ModelComponent>(quadModel));
-        quad.addComponent(std::make_unique<TextureComponent>(std::make_shared<Texture>(device, "../res/textures/texture.jpg")));
+        auto quadModelComponent = std::make_unique<ModelComponent>(assetLoader->getPlaceholderModel());
+        quadModelComponent->occluder = true;
+        quad.addComponent(std::move(quadModelComponent));
+        quad.addComponent(std::make_unique<TextureComponent>(assetLoader->getPlaceholderTexture()));
         quad.addComponent(std::make_unique<TransformComponent>(glm::vec3{-2.5f, 0.0f, 5.0f},
                                                                 glm::vec3{5.0f, 5.0f, 5.0f}));
+        assetLoader->loadModel([this] {
+            Procedural::Terrain q(device, 2, {0.0f, 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 0.7f, 0.8f});
+            q.generateModel();
+            return q.buildModel();
+        }, setModel(quad.getId()));
+        assetLoader->loadTexture("../res/textures/texture.jpg", setTexture(quad.getId()));
         entities.emplace(quad.getId(), std::move(quad));
 
-        Procedural::Cube c(device, 128);
-        c.generateModel();
-        std::shared_ptr cubeModel = c.getModel();
+        // Same texture, but block compressed, with its mips already in the file, so that path always gets some use too.
+        // GPUs without BC support just keep the placeholder.
+        Entity ktxQuad = Entity::createEntity();
+        ktxQuad.addComponent(std::make_unique<ModelComponent>(assetLoader->getPlaceholderModel()));
+        ktxQuad.addComponent(std::make_unique<TextureComponent>(assetLoader->getPlaceholderTexture()));
+        ktxQuad.addComponent(std::make_unique<TransformComponent>(glm::vec3{0.0f, 2.0f, 5.0f},
+                                                                  glm::vec3{1.0f},
+                                                                  glm::vec3{-glm::half_pi<float>(), 0.0f, 0.0f}));
+        assetLoader->loadModel([this] {
+            Procedural::Quad q(device, 2);
+            q.generateModel();
+            return q.buildModel();
+        }, setModel(ktxQuad.getId()));
+        assetLoader->loadTexture("../res/textures/texture.ktx2", setTexture(ktxQuad.getId()));
+        entities.emplace(ktxQuad.getId(), std::move(ktxQuad));
+
         Entity cube = Entity::createEntity();
-        cube.addComponent(std::make_unique<ModelComponent>(cubeModel));
+        auto cubeModelComponent = std::make_unique<ModelComponent>(assetLoader->getPlaceholderModel());
+        cubeModelComponent->occluder = true;
+        cube.addComponent(std::move(cubeModelComponent));
         cube.addComponent(std::make_unique<TransformComponent>(glm::vec3{-0.5f, -2.0f, 5.0f}));
+        assetLoader->loadModel([this] {
+            Procedural::Cube c(device, 128);
+            c.generateModel();
+            return c.buildModel();
+        }, setModel(cube.getId()));
         entities.emplace(cube.getId(), std::move(cube));
 
-        Procedural::MarchingCubes mc(device, 128, Procedural::MarchingCubes::testSurface, 0.0f);
-        mc.generateModel();
-        std::shared_ptr mcModel = mc.getModel();
         Entity mcEntity = Entity::createEntity();
-        mcEntity.addComponent(std::make_unique<ModelComponent>(mcModel));
+        mcEntity.addComponent(std::make_unique<ModelComponent>(assetLoader->getPlaceholderModel()));
         mcEntity.addComponent(std::make_unique<TransformComponent>(glm::vec3{2.5f, -2.0f, 5.0f}));
+        assetLoader->loadModel([this] {
+            Procedural::MarchingCubes mc(device, 128, Procedural::MarchingCubes::testSurface, 0.0f);
+            mc.generateModel();
+            return mc.buildModel();
+        }, setModel(mcEntity.getId()));
         entities.emplace(mcEntity.getId(), std::move(mcEntity));
 
         Entity pointLight = Entity::createPointLightEntity();
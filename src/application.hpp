@@ -9,6 +9,7 @@
 #include <chrono>
 #include <vector>
 #include <array>
+#include <functional>
 
 // ImGUI
 #include <imgui.h>
@@ -18,12 +19,19 @@
 // Misc utils
 #include "utils/window/window.hpp"
 #include "utils/device/device.hpp"
+#include "utils/uploadservice/uploadservice.hpp"
 #include "utils/entity/entity.hpp"
 #include "utils/renderer/renderer.hpp"
 #include "utils/input/movementcontroller/movementcontroller.hpp"
 #include "utils/descriptors/descriptors.hpp"
 #include "utils/texture/texture.hpp"
 #include "utils/entity/components/texture.hpp"
+#include "utils/workerpool/workerpool.hpp"
+#include "utils/assetcache/assetcache.hpp"
+#include "utils/assetloader/assetloader.hpp"
+#include "utils/softwareocclusion/softwareocclusion.hpp"
+#include "utils/gpuprofiler/gpuprofiler.hpp"
+#include "utils/framestats/framestats.hpp"
 
 // Procedural geometry
 #include "utils/procedural/quad/quad.hpp"
@@ -35,8 +43,17 @@
 #include "rendersystems/simple/simplerendersystem.hpp"
 #include "rendersystems/billboard/billboardrendersystem.hpp"
 #include "rendersystems/texture/texturerendersystem.hpp"
+#include "rendersystems/fxaa/fxaarendersystem.hpp"
 
 namespace Engine {
+    struct ApplicationSettings {
+        bool headless = false; // No window, input or UI, everything gets rendered offscreen
+        uint32_t frameCount = 0; // Stop after this many frames, with a fixed time step, 0 runs until the window closes
+        // Replaces the default scene, if set. Anything it loads through the loader counts towards asyncLoading.
+        std::function<void(Device &, AssetLoader &, Entity::Map &)> loadScene{};
+        bool asyncLoading = true; // Otherwise the first frame waits for everything in the scene to be loaded
+    };
+
     class Application {
     public:
         static constexpr int WIDTH = 800;
@@ -47,6 +64,13 @@ namespace Engine {
         static constexpr float NEAR_PLANE = 0.1f;
         static constexpr float FAR_PLANE = 100.0f;
 
+        // Fixed, so runs with a set frame count are reproducible
+        static constexpr float FIXED_DELTA_TIME = 1.0f / 60.0f;
+        // Frame stats kept when running until the window closes, runs with a set frame count keep all of them
+        static constexpr uint32_t INTERACTIVE_FRAME_STATS = 1024;
+
+        static constexpr const char *GPU_PROFILE_PATH = "gpu_profile.csv"; // Relative to the working directory
+
         // ImGUI control variables
         float ambientStrength = 1.0f;
         float diffuseStrength = 1.0f;
@@ -55,24 +79,52 @@ namespace Engine {
 
         bool texturesEnabled = true;
 
-        Application();
+        AntiAliasing antiAliasing = AntiAliasing::MSAA8x; // Applied at the start of the next frame
+        bool occlusionCulling = false; // Same here
+
+        explicit Application(ApplicationSettings settings = {});
         ~Application();
 
         Application(const Application&) = delete;
         Application& operator=(const Application&) = delete;
 
         void run();
+
+        [[nodiscard]] const FrameStats &getFrameStats() const { return frameStats; }
+        [[nodiscard]] const GpuProfiler &getGpuProfiler() const { return *gpuProfiler; }
+        [[nodiscard]] const Device &getDevice() const { return device; }
+        // From when the application started being constructed to when its first frame got submitted, in milliseconds
+        [[nodiscard]] float getTimeToFirstFrame() const { return timeToFirstFrame; }
+        // Same, but to the first frame with nothing left loading, which is the first one without asyncLoading
+        [[nodiscard]] float getTimeToLoaded() const { return timeToLoaded; }
     private:
         DeletionQueue _maindelqueue;
 
-        Window window{WIDTH, HEIGHT, "Vulkan test window"};
+        const bool headless;
+        const uint32_t frameCount;
+        const std::chrono::high_resolution_clock::time_point startupTime = std::chrono::high_resolution_clock::now();
+        float timeToFirstFrame = 0.0f;
+        float timeToLoaded = 0.0f;
+
+        Window window{WIDTH, HEIGHT, "Vulkan test window", headless};
         Device device{window};
         Renderer renderer{window, device};
         Entity::Map entities;
+        AssetCache assetCache{device};
+        std::unique_ptr<AssetLoader> assetLoader{};
 
         std::unique_ptr<DescriptorPool> globalPool{};
         std::vector<std::unique_ptr<DescriptorPool>> framePools;
 
+        std::unique_ptr<ClusterCuller> clusterCuller{};
+        std::unique_ptr<OcclusionCuller> occlusionCuller{};
+        std::unique_ptr<GpuProfiler> gpuProfiler{};
+
+        WorkerPool workerPool{};
+        SoftwareOcclusionCuller softwareOcclusionCuller{workerPool};
+
+        FrameStats frameStats{frameCount == 0 ? INTERACTIVE_FRAME_STATS : 0u};
+
         // ImGUI
         void initImGUI();
         void drawImGUI(FrameInfo frameInfo);
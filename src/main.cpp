@@ -1,12 +1,40 @@
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
 #include "application.hpp"
 
 // TODO(Dory): Change to a proper naming and file structure convention.
-int main() {
-    Engine::Application app {};
+// Pass --headless [frames] to render a fixed amount of frames offscreen, without opening a window (e.g. on CI), and
+// --sync-loading to wait for the whole scene to load before the first frame, like it used to
+int main(int argc, char **argv) {
+    constexpr uint32_t DEFAULT_HEADLESS_FRAMES = 1000;
+
+    Engine::ApplicationSettings settings{};
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--sync-loading") == 0) {
+            settings.asyncLoading = false;
+            continue;
+        } if (std::strcmp(argv[i], "--headless") != 0) {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        } settings.headless = true;
+        settings.frameCount = DEFAULT_HEADLESS_FRAMES;
+
+        if (i + 1 < argc && argv[i + 1][0] != '-') {
+            try {
+                settings.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } catch (const std::exception &) {
+                std::cerr << "Invalid frame count: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    Engine::Application app {std::move(settings)};
 
     try {
         app.run();
@@ -14,4 +42,4 @@ int main() {
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;
     } return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -7,9 +7,11 @@ namespace Engine {
         float radius = 0.0f;
     };
     void BillboardRenderSystem::update(const FrameInfo &frameInfo, GlobalUbo &ubo) {
+        ZoneScoped;
         Entity::id_t i = 0;
         for (Entity &ent : std::views::values(frameInfo.entities)) {
             if(!ent.hasComponent(POINT_LIGHT)) continue;
+            if (i == MAX_POINT_LIGHTS) break; // The rest still get their billboards, they just don't light anything
 
             ubo.pointLights[i].position = glm::vec4(ent.getTransformComponent()->position, 1.0f);
             ubo.pointLights[i++].color = glm::vec4(ent.getPointLightComponent()->color,
@@ -17,6 +19,11 @@ namespace Engine {
         } ubo.pointLightCount = i;
     }
     void BillboardRenderSystem::render(FrameInfo &frameInfo) {
+        ZoneScoped;
+        TracyVkZone(frameInfo.tracyContext, frameInfo.commandBuffer, "Billboard Render System");
+        // These are see-through, so they have to go after everything else has been drawn
+        if (frameInfo.phase == DrawPhase::Visible) return;
+
         // Sort the objects from back to front, for alpha blending to work correctly
         // TODO(Dory): Implement Order-Independent rendering so that this isn't necessary
         std::map<float, Entity::id_t> sorted;
@@ -55,6 +62,7 @@ namespace Engine {
                                sizeof(PointLightPushConstant),
                                &push);
             vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
+            frameInfo.drawCalls++;
         }
     }
 }
\ No newline at end of file
@@ -18,6 +18,7 @@ namespace Engine {
 
         static void update(const FrameInfo &frameInfo, GlobalUbo &ubo);
         void render(FrameInfo &frameInfo) override;
+        using RenderSystem::rebuild;
         // We don't include the wireframe function here because that wouldn't really be useful anyways
     private:
         constexpr std::string vertPath() override { return "../res/shaders/compiled/billboard.vert.spv"; }
@@ -0,0 +1,127 @@
+#include "fxaarendersystem.hpp"
+
+namespace Engine {
+    struct FXAAPushConstant {
+        glm::vec2 uvScale{};
+        glm::vec2 texelSize{};
+    };
+
+    FXAARenderSystem::FXAARenderSystem(Device &device,
+                                       VkRenderPass renderPass,
+                                       VkDescriptorSetLayout globalSetLayout) :
+                                       RenderSystem(device,
+                                                    renderPass,
+                                                    globalSetLayout) {
+        createSampler();
+        init();
+    }
+    FXAARenderSystem::~FXAARenderSystem() {
+        vkDestroySampler(device.device(), sampler, nullptr);
+    }
+
+    void FXAARenderSystem::setInput(VkImageView sceneImageView, VkExtent2D renderExtent, VkExtent2D imageExtent) {
+        this->sceneImageView = sceneImageView;
+        uvScale = {static_cast<float>(renderExtent.width) / static_cast<float>(imageExtent.width),
+                   static_cast<float>(renderExtent.height) / static_cast<float>(imageExtent.height)};
+        texelSize = {1.0f / static_cast<float>(imageExtent.width),
+                     1.0f / static_cast<float>(imageExtent.height)};
+    }
+
+    void FXAARenderSystem::createSampler() {
+        // Linear filtering takes care of the upscaling, and clamping avoids bleeding from the other side of the image
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.anisotropyEnable = VK_FALSE;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+        samplerInfo.unnormalizedCoordinates = VK_FALSE;
+        samplerInfo.compareEnable = VK_FALSE;
+        samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = 0.0f;
+        samplerInfo.mipLodBias = 0.0f;
+
+        if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the FXAA sampler!");
+    }
+
+    void FXAARenderSystem::createPipelineLayout() {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(FXAAPushConstant);
+
+        renderSystemLayout = DescriptorSetLayout::Builder(device)
+                .addBinding(0,
+                            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                            VK_SHADER_STAGE_FRAGMENT_BIT).build();
+
+        // We don't need the global UBO for this one
+        const std::vector descriptorSetLayouts { renderSystemLayout->getDescriptorSetLayout() };
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the pipeline layout!");
+    }
+
+    void FXAARenderSystem::configurePipeline(PipelineConfigInfo &pipelineConfig) {
+        // The fullscreen triangle is generated in the vertex shader, so there are no vertex buffers, and there's no depth
+        pipelineConfig.bindingDescriptions.clear();
+        pipelineConfig.attributeDescriptions.clear();
+        pipelineConfig.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+        pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        Pipeline::setSampleCount(pipelineConfig, VK_SAMPLE_COUNT_1_BIT); // We draw straight into the swap chain
+    }
+
+    void FXAARenderSystem::render(FrameInfo &frameInfo) {
+        ZoneScoped;
+        TracyVkZone(frameInfo.tracyContext, frameInfo.commandBuffer, "FXAA Render System");
+        assert(sceneImageView != VK_NULL_HANDLE && "Cannot run the FXAA pass without an input image!");
+
+        pipeline->bind(frameInfo.commandBuffer);
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = sampler;
+        imageInfo.imageView = sceneImageView;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkDescriptorSet descriptorSet;
+        DescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
+                .writeImage(0, &imageInfo)
+                .build(descriptorSet);
+
+        vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                pipelineLayout,
+                                0,
+                                1,
+                                &descriptorSet,
+                                0,
+                                nullptr);
+
+        FXAAPushConstant push{};
+        push.uvScale = uvScale;
+        push.texelSize = texelSize;
+
+        vkCmdPushConstants(frameInfo.commandBuffer,
+                           pipelineLayout,
+                           VK_SHADER_STAGE_FRAGMENT_BIT,
+                           0,
+                           sizeof(FXAAPushConstant),
+                           &push);
+        vkCmdDraw(frameInfo.commandBuffer, 3, 1, 0, 0);
+        frameInfo.drawCalls++;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef FXAARENDERSYSTEM_HPP
+#define FXAARENDERSYSTEM_HPP
+
+#include "../rendersystem.hpp"
+
+namespace Engine {
+    // Fullscreen pass that samples the single-sampled scene image, smooths out the edges, and upscales it into the swap
+    // chain image. It has to be used with the UI render pass, since it writes straight into the swap chain.
+    class FXAARenderSystem final : RenderSystem {
+    public:
+        FXAARenderSystem(Device &device,
+                         VkRenderPass renderPass,
+                         VkDescriptorSetLayout globalSetLayout);
+        ~FXAARenderSystem() override;
+
+        // The scene image view changes every frame, and only part of it might have been rendered to
+        void setInput(VkImageView sceneImageView, VkExtent2D renderExtent, VkExtent2D imageExtent);
+        void render(FrameInfo &frameInfo) override;
+    private:
+        constexpr std::string vertPath() override { return "../res/shaders/compiled/fullscreen.vert.spv"; }
+        constexpr std::string fragPath() override { return "../res/shaders/compiled/fxaa.frag.spv"; }
+
+        std::unique_ptr<DescriptorSetLayout> renderSystemLayout;
+        VkSampler sampler = VK_NULL_HANDLE;
+
+        VkImageView sceneImageView = VK_NULL_HANDLE;
+        glm::vec2 uvScale{1.0f};
+        glm::vec2 texelSize{0.0f};
+
+        void createSampler();
+        void createPipelineLayout() override;
+        void configurePipeline(PipelineConfigInfo &pipelineConfig) override;
+    };
+}
+
+#endif
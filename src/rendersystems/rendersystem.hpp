@@ -11,6 +11,8 @@
 #include <array>
 #include <ranges>
 
+#include <tracy/Tracy.hpp>
+
 #include "../utils/device/device.hpp"
 #include "../utils/pipeline/pipeline.hpp"
 #include "../utils/entity/entity.hpp"
@@ -44,20 +46,85 @@ namespace Engine {
             vkDeviceWaitIdle(device.device()); // Wait until the pipeline is no longer on use
             createPipeline();
         }
+        // Needed whenever the render pass changes in an incompatible way, like when changing the sample count
+        void rebuild(VkRenderPass newRenderPass) {
+            vkDeviceWaitIdle(device.device()); // Wait until the pipeline is no longer on use
+            renderPass = newRenderPass;
+            createPipeline();
+        }
     protected:
         Device &device;
         VkRenderPass renderPass;
         VkDescriptorSetLayout globalSetLayout;
 
         std::unique_ptr<Pipeline> pipeline;
+        std::unique_ptr<Pipeline> compressedPipeline; // Only there if compressedVertPath is
         VkPipelineLayout pipelineLayout;
 
         virtual std::string vertPath() = 0;
         virtual std::string fragPath() = 0;
+        // The vertex shader for models with Model::CompressedVertex, the render systems that don't draw models skip it
+        virtual std::string compressedVertPath() { return ""; }
+
+        // Lets each render system tweak the pipeline before it gets created
+        virtual void configurePipeline(PipelineConfigInfo &) {}
 
         bool wireframe = false;
         bool alphaBlending = false;
 
+        // Swaps to the pipeline that matches the model's vertex format, if it isn't the one that's bound already.
+        // Both share the same layout, so the descriptor sets stay bound.
+        void bindPipelineFor(const VkCommandBuffer commandBuffer, const Model &model, bool &compressedBound) const {
+            if (model.isCompressed() == compressedBound) return;
+            assert((!model.isCompressed() || compressedPipeline != nullptr) &&
+                   "This render system can't draw compressed models!");
+            compressedBound = model.isCompressed();
+            (compressedBound ? compressedPipeline : pipeline)->bind(commandBuffer);
+        }
+
+        // Compressed models need their dequantization folded into the model matrix, the normal matrix is fine as is,
+        // other than carrying which way up the texture coordinates are (see PushConstantData)
+        static PushConstantData getPushConstants(Entity &ent, const Model &model) {
+            PushConstantData push{};
+            push.modelMatrix = ent.getTransformComponent()->mat4();
+            if (model.isCompressed()) push.modelMatrix *= model.getDequantizationMatrix();
+            push.normalMatrix = ent.getTransformComponent()->normal();
+            if (model.hasTopLeftTexCoords()) push.normalMatrix[3].y = 1.0f;
+            return push;
+        }
+
+        // Picks the LOD to draw the entity's model with, based on how big it is on screen
+        static uint32_t selectLOD(const FrameInfo &frameInfo, Entity &ent) {
+            ModelComponent *modelComponent = ent.getModelComponent();
+            const TransformComponent *transform = ent.getTransformComponent();
+            const Model &model = *modelComponent->model;
+
+            const glm::vec3 center = transform->mat4() * glm::vec4(model.getBoundingCenter(), 1.0f);
+            const glm::vec3 scale = glm::abs(transform->scale);
+            const float radius = model.getBoundingRadius() * glm::max(scale.x, glm::max(scale.y, scale.z));
+            const float distance = glm::length(center - frameInfo.camera.getPosition());
+
+            // If we're inside the bounds, just go for full detail
+            const float screenSize = distance > radius ?
+                radius * glm::abs(frameInfo.camera.getProjectionMatrix()[1][1]) / distance :
+                std::numeric_limits<float>::max();
+            modelComponent->lod = model.selectLOD(screenSize, modelComponent->lod);
+            return modelComponent->lod;
+        }
+
+        // Tests the entity's bounds against the software occlusion buffer, the occluders themselves never get culled
+        static bool isOccluded(const FrameInfo &frameInfo, Entity &ent) {
+            const ModelComponent *modelComponent = ent.getModelComponent();
+            if (modelComponent->occluder || frameInfo.phase == DrawPhase::Disoccluded) return false;
+
+            const TransformComponent *transform = ent.getTransformComponent();
+            const Model &model = *modelComponent->model;
+            const glm::vec3 center = transform->mat4() * glm::vec4(model.getBoundingCenter(), 1.0f);
+            const glm::vec3 scale = glm::abs(transform->scale);
+            const float radius = model.getBoundingRadius() * glm::max(scale.x, glm::max(scale.y, scale.z));
+            return frameInfo.softwareOcclusionCuller.isOccluded(center, radius);
+        }
+
         virtual void createPipelineLayout() {
             // This is for push constants
             VkPushConstantRange pushConstantRange{};
@@ -88,12 +155,22 @@ namespace Engine {
             if (alphaBlending) Pipeline::enableAlphaBlending(pipelineConfig);
             Pipeline::setSampleCount(pipelineConfig, device.getDesiredSampleCount());
             if (wireframe) Pipeline::enableWireframe(pipelineConfig);
+            configurePipeline(pipelineConfig);
             pipelineConfig.renderPass = renderPass;
             pipelineConfig.pipelineLayout = pipelineLayout;
             pipeline = std::make_unique<Pipeline>(device,
                                                   vertPath(),
                                                   fragPath(),
                                                   pipelineConfig);
+
+            compressedPipeline = nullptr;
+            if (compressedVertPath().empty()) return;
+            pipelineConfig.bindingDescriptions = Model::CompressedVertex::getBindingDescriptions();
+            pipelineConfig.attributeDescriptions = Model::CompressedVertex::getAttributeDescriptions();
+            compressedPipeline = std::make_unique<Pipeline>(device,
+                                                            compressedVertPath(),
+                                                            fragPath(),
+                                                            pipelineConfig);
         }
     };
 }
@@ -2,6 +2,8 @@
 
 namespace Engine {
     void SimpleRenderSystem::render(FrameInfo &frameInfo) {
+        ZoneScoped;
+        TracyVkZone(frameInfo.tracyContext, frameInfo.commandBuffer, "Simple Render System");
         pipeline->bind(frameInfo.commandBuffer);
 
         vkCmdBindDescriptorSets(frameInfo.commandBuffer,
@@ -13,13 +15,17 @@ namespace Engine {
                                 0,
                                 nullptr);
 
+        // Most models share a geometry chunk, so we only rebind when we get to one that doesn't
+        uint32_t boundChunk = GeometryArena::NO_CHUNK;
+        bool compressedBound = false;
         for (Entity &ent : std::views::values(frameInfo.entities)) {
             if (!ent.hasComponent(MODEL) || ent.hasComponent(TEXTURE)) continue;
+            if (isOccluded(frameInfo, ent)) continue;
 
-            PushConstantData push{};
-            push.modelMatrix = ent.getTransformComponent()->mat4();
-            push.normalMatrix = ent.getTransformComponent()->normal();
+            const Model &model = *ent.getModelComponent()->model;
+            bindPipelineFor(frameInfo.commandBuffer, model, compressedBound);
 
+            const PushConstantData push = getPushConstants(ent, model);
             vkCmdPushConstants(frameInfo.commandBuffer,
                                pipelineLayout,
                                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
@@ -27,8 +33,10 @@ namespace Engine {
                                sizeof(PushConstantData),
                                &push);
 
-            ent.getModelComponent()->model->bind(frameInfo.commandBuffer);
-            ent.getModelComponent()->model->draw(frameInfo.commandBuffer);
+            if (model.getGeometryChunk() != boundChunk) {
+                model.bind(frameInfo.commandBuffer);
+                boundChunk = model.getGeometryChunk();
+            } frameInfo.clusterCuller.draw(frameInfo, ent, selectLOD(frameInfo, ent));
         }
     }
 }
\ No newline at end of file
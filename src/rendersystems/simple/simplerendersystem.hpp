@@ -15,9 +15,13 @@ namespace Engine {
 
         void render(FrameInfo &frameInfo) override;
         using RenderSystem::toggleWireframe;
+        using RenderSystem::rebuild;
     private:
         constexpr std::string vertPath() override { return "../res/shaders/compiled/standard.vert.spv"; }
         constexpr std::string fragPath() override { return "../res/shaders/compiled/standard.frag.spv"; }
+        constexpr std::string compressedVertPath() override {
+            return "../res/shaders/compiled/standard_compressed.vert.spv";
+        }
     };
 }
 
@@ -30,6 +30,8 @@ namespace Engine {
     }
 
     void TextureRenderSystem::render(FrameInfo &frameInfo) {
+        ZoneScoped;
+        TracyVkZone(frameInfo.tracyContext, frameInfo.commandBuffer, "Texture Render System");
         pipeline->bind(frameInfo.commandBuffer);
 
         vkCmdBindDescriptorSets(frameInfo.commandBuffer,
@@ -41,8 +43,12 @@ namespace Engine {
                                 0,
                                 nullptr);
 
+        // Same as with the simple render system, the geometry only gets bound again when the chunk changes
+        uint32_t boundChunk = GeometryArena::NO_CHUNK;
+        bool compressedBound = false;
         for (Entity &ent : std::views::values(frameInfo.entities)) {
             if (!ent.hasComponent(MODEL) || !ent.hasComponent(TEXTURE)) continue;
+            if (isOccluded(frameInfo, ent)) continue;
 
             VkDescriptorSet descriptorSet;
             auto imageInfo = ent.getTextureComponent()->diffuseMap->getDescriptorImageInfo();
@@ -59,10 +65,10 @@ namespace Engine {
                                     0,
                                     nullptr);
 
-            PushConstantData push{};
-            push.modelMatrix = ent.getTransformComponent()->mat4();
-            push.normalMatrix = ent.getTransformComponent()->normal();
+            const Model &model = *ent.getModelComponent()->model;
+            bindPipelineFor(frameInfo.commandBuffer, model, compressedBound);
 
+            const PushConstantData push = getPushConstants(ent, model);
             vkCmdPushConstants(frameInfo.commandBuffer,
                                pipelineLayout,
                                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
@@ -70,8 +76,10 @@ namespace Engine {
                                sizeof(PushConstantData),
                                &push);
 
-            ent.getModelComponent()->model->bind(frameInfo.commandBuffer);
-            ent.getModelComponent()->model->draw(frameInfo.commandBuffer);
+            if (model.getGeometryChunk() != boundChunk) {
+                model.bind(frameInfo.commandBuffer);
+                boundChunk = model.getGeometryChunk();
+            } frameInfo.clusterCuller.draw(frameInfo, ent, selectLOD(frameInfo, ent));
         }
     }
 }
\ No newline at end of file
@@ -15,9 +15,13 @@ namespace Engine {
 
         void render(FrameInfo &frameInfo) override;
         using RenderSystem::toggleWireframe;
+        using RenderSystem::rebuild;
     private:
         constexpr std::string vertPath() override { return "../res/shaders/compiled/texture.vert.spv"; }
         constexpr std::string fragPath() override { return "../res/shaders/compiled/texture.frag.spv"; }
+        constexpr std::string compressedVertPath() override {
+            return "../res/shaders/compiled/texture_compressed.vert.spv";
+        }
 
         std::unique_ptr<DescriptorSetLayout> renderSystemLayout;
 
@@ -0,0 +1,48 @@
+#ifndef ANTIALIASING_HPP
+#define ANTIALIASING_HPP
+
+#include <array>
+
+#include <vulkan/vulkan.h>
+
+namespace Engine {
+    // MSAA resolves the scene in the render pass itself, while FXAA renders it single-sampled and then smooths the edges
+    // out in a fullscreen pass, which is way cheaper in both memory and bandwidth, at the cost of some blurriness
+    enum class AntiAliasing {
+        None,
+        MSAA2x,
+        MSAA4x,
+        MSAA8x,
+        FXAA
+    };
+
+    constexpr std::array<AntiAliasing, 5> ANTI_ALIASING_MODES = {
+        AntiAliasing::None,
+        AntiAliasing::MSAA2x,
+        AntiAliasing::MSAA4x,
+        AntiAliasing::MSAA8x,
+        AntiAliasing::FXAA
+    };
+
+    constexpr const char* getAntiAliasingName(AntiAliasing mode) {
+        switch (mode) {
+            case AntiAliasing::None: return "None";
+            case AntiAliasing::MSAA2x: return "MSAA 2x";
+            case AntiAliasing::MSAA4x: return "MSAA 4x";
+            case AntiAliasing::MSAA8x: return "MSAA 8x";
+            case AntiAliasing::FXAA: return "FXAA";
+        } return "Unknown";
+    }
+
+    constexpr VkSampleCountFlagBits getAntiAliasingSampleCount(AntiAliasing mode) {
+        switch (mode) {
+            case AntiAliasing::MSAA2x: return VK_SAMPLE_COUNT_2_BIT;
+            case AntiAliasing::MSAA4x: return VK_SAMPLE_COUNT_4_BIT;
+            case AntiAliasing::MSAA8x: return VK_SAMPLE_COUNT_8_BIT;
+            case AntiAliasing::None:
+            case AntiAliasing::FXAA: return VK_SAMPLE_COUNT_1_BIT;
+        } return VK_SAMPLE_COUNT_1_BIT;
+    }
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include "assetcache.hpp"
+
+#include <filesystem>
+
+namespace Engine {
+    std::shared_ptr<Model> AssetCache::getModel(const std::string &path, const bool compressed) {
+        ZoneScoped;
+        const std::string key = getModelKey(path, compressed);
+        if (std::shared_ptr<Model> model = find(state->models, key)) return model;
+        return add(state->models, key, Model::createModelFromFile(device, path, compressed));
+    }
+
+    std::shared_ptr<Texture> AssetCache::getTexture(const std::string &path) {
+        ZoneScoped;
+        const std::string key = normalise(path);
+        if (std::shared_ptr<Texture> texture = find(state->textures, key)) return texture;
+        return add(state->textures, key, std::make_unique<Texture>(device, path.c_str()));
+    }
+
+    std::shared_ptr<Model> AssetCache::findModel(const std::string &path, const bool compressed) {
+        return find(state->models, getModelKey(path, compressed));
+    }
+
+    std::shared_ptr<Texture> AssetCache::findTexture(const std::string &path) {
+        return find(state->textures, normalise(path));
+    }
+
+    std::shared_ptr<Model> AssetCache::addModel(const std::string &path,
+                                                const bool compressed,
+                                                std::unique_ptr<Model> model) {
+        return add(state->models, getModelKey(path, compressed), std::move(model));
+    }
+
+    std::shared_ptr<Texture> AssetCache::addTexture(const std::string &path, std::unique_ptr<Texture> texture) {
+        return add(state->textures, normalise(path), std::move(texture));
+    }
+
+    AssetCache::Stats AssetCache::getStats() const {
+        std::scoped_lock lock(state->mutex);
+        return {state->hits,
+                state->misses,
+                static_cast<uint32_t>(state->models.size()),
+                static_cast<uint32_t>(state->textures.size()),
+                state->residentBytes};
+    }
+
+    template<typename T>
+    std::shared_ptr<T> AssetCache::find(std::unordered_map<std::string, std::weak_ptr<T>> &assets,
+                                        const std::string &key) {
+        std::scoped_lock lock(state->mutex);
+        if (const auto found = assets.find(key); found != assets.end()) {
+            if (std::shared_ptr<T> asset = found->second.lock()) {
+                state->hits++;
+                return asset;
+            }
+        } state->misses++;
+        return nullptr;
+    }
+
+    // Nothing's locked while loading, so someone else might have added the same thing in the meantime
+    template<typename T>
+    std::shared_ptr<T> AssetCache::add(std::unordered_map<std::string, std::weak_ptr<T>> &assets,
+                                       const std::string &key,
+                                       std::unique_ptr<T> loaded) {
+        const VkDeviceSize bytes = loaded->getMemorySize();
+
+        std::scoped_lock lock(state->mutex);
+        std::weak_ptr<T> &entry = assets[key];
+        if (std::shared_ptr<T> asset = entry.lock()) return asset; // Someone else got there first, so ours goes away
+
+        // The handle's the one that knows when the asset's gone, so it's the one that takes it out of the cache.
+        // Another one might have taken its place by then, which is still alive, so that one stays.
+        std::shared_ptr<T> asset(loaded.release(), [state = state, &assets, key, bytes](T *asset) {
+            delete asset;
+            std::scoped_lock lock(state->mutex);
+            state->residentBytes -= bytes;
+            if (const auto found = assets.find(key); found != assets.end() && found->second.expired())
+                assets.erase(found);
+        });
+        state->residentBytes += bytes;
+        entry = asset;
+        return asset;
+    }
+
+    // A NUL can't be in a path, so nothing else can end up with the same key
+    std::string AssetCache::getModelKey(const std::string &path, const bool compressed) {
+        std::string key = normalise(path);
+        key += '\0';
+        key += compressed ? "compressed" : "uncompressed";
+        return key;
+    }
+
+    // Absolute, and without any "..", "." or symlinks, so it's the same however the path was written
+    std::string AssetCache::normalise(const std::string &path) {
+        // Made absolute first, since relative paths that don't exist would stay relative, and miss the ones that do
+        std::error_code error;
+        const std::filesystem::path absolute = std::filesystem::absolute(path, error);
+        if (error) return std::filesystem::path(path).lexically_normal().generic_string();
+        const std::filesystem::path canonical = std::filesystem::weakly_canonical(absolute, error);
+        return (error ? absolute.lexically_normal() : canonical).generic_string();
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef ASSETCACHE_HPP
+#define ASSETCACHE_HPP
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+#include "../device/device.hpp"
+#include "../model/model.hpp"
+#include "../texture/texture.hpp"
+
+namespace Engine {
+    // Hands out shared models and textures, so everything that uses the same file (with the same options) gets the same
+    // one, instead of parsing it again and getting a second copy on the GPU. Paths are normalised first, so different
+    // ways of writing the same one still hit.
+    // The cache only keeps weak references, so an asset still gets freed as soon as the last handle to it goes away,
+    // just like it would without the cache, and the next one to ask for it loads it again.
+    // Only findModel and findTexture are safe to call from other threads (AssetLoader's workers use them), everything
+    // else has to happen on the main thread, and that includes dropping the last handle to an asset, since freeing it
+    // goes through the geometry arena and the upload service, which aren't thread safe. Whatever the workers find gets
+    // handed back to the main thread along with the rest of the load, so theirs is never the last handle.
+    // Nothing's locked while loading, so the same file can get loaded twice (say, once in the background), but only
+    // the first one to be added gets kept.
+    class AssetCache {
+    public:
+        struct Stats {
+            uint64_t hits;
+            uint64_t misses;
+            uint32_t models; // Only the ones with handles still around
+            uint32_t textures;
+            VkDeviceSize residentBytes; // What those take up on the GPU
+
+            [[nodiscard]] float getHitRate() const {
+                const uint64_t requests = hits + misses;
+                return requests == 0 ? 0.0f : static_cast<float>(hits) / static_cast<float>(requests);
+            }
+        };
+
+        explicit AssetCache(Device &device) : device(device) {}
+
+        AssetCache(const AssetCache &) = delete;
+        AssetCache& operator=(const AssetCache &) = delete;
+
+        // Same as Model::createModelFromFile, which is what loads it if it isn't here yet
+        [[nodiscard]] std::shared_ptr<Model> getModel(const std::string &path, bool compressed = false);
+        [[nodiscard]] std::shared_ptr<Texture> getTexture(const std::string &path);
+
+        // For anything loaded some other way (like in the background): find counts as a hit or a miss, and add hands
+        // back the one that's already here instead, if there is one
+        [[nodiscard]] std::shared_ptr<Model> findModel(const std::string &path, bool compressed = false);
+        [[nodiscard]] std::shared_ptr<Texture> findTexture(const std::string &path);
+        std::shared_ptr<Model> addModel(const std::string &path, bool compressed, std::unique_ptr<Model> model);
+        std::shared_ptr<Texture> addTexture(const std::string &path, std::unique_ptr<Texture> texture);
+
+        [[nodiscard]] Stats getStats() const;
+    private:
+        // Everything the handles need to take themselves out once they're gone, which might be after the cache is
+        struct State {
+            std::mutex mutex;
+            std::unordered_map<std::string, std::weak_ptr<Model>> models;
+            std::unordered_map<std::string, std::weak_ptr<Texture>> textures;
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            VkDeviceSize residentBytes = 0;
+        };
+
+        Device &device;
+        std::shared_ptr<State> state = std::make_shared<State>();
+
+        template<typename T>
+        std::shared_ptr<T> find(std::unordered_map<std::string, std::weak_ptr<T>> &assets, const std::string &key);
+        template<typename T>
+        std::shared_ptr<T> add(std::unordered_map<std::string, std::weak_ptr<T>> &assets,
+                               const std::string &key,
+                               std::unique_ptr<T> loaded);
+        [[nodiscard]] static std::string getModelKey(const std::string &path, bool compressed);
+        [[nodiscard]] static std::string normalise(const std::string &path);
+    };
+}
+
+#endif
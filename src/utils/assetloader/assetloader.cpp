@@ -0,0 +1,83 @@
+#include "assetloader.hpp"
+
+#include <iostream>
+
+#include "../procedural/cube/cube.hpp"
+
+namespace Engine {
+    AssetLoader::AssetLoader(Device &device, AssetCache &assetCache, const uint32_t threadCount) :
+                             device(device), assetCache(assetCache), workerPool(threadCount) {
+        ZoneScoped;
+        // Small enough that they don't need to be loaded in the background themselves
+        Procedural::Cube cube(device, 1);
+        cube.generateModel();
+        placeholderModel = cube.getModel();
+
+        constexpr uint8_t pixels[2 * 2 * 4] = {128, 128, 128, 255, 128, 128, 128, 255,
+                                               128, 128, 128, 255, 128, 128, 128, 255}; // Just grey
+        placeholderTexture = std::make_shared<Texture>(device, 2, 2, pixels);
+    }
+    AssetLoader::~AssetLoader() {
+        for (std::future<Finish> &prepared : pending) prepared.wait();
+    }
+
+    AssetLoader::Future<Model> AssetLoader::loadModel(const std::string &path,
+                                                      const bool compressed,
+                                                      OnReady<Model> onReady) {
+        return load<Model>([this, path, compressed]() -> std::move_only_function<std::shared_ptr<Model>()> {
+            if (std::shared_ptr<Model> model = assetCache.findModel(path, compressed))
+                return [model = std::move(model)] { return model; };
+            return [this, path, compressed, prepared = Model::prepareModelFromFile(path, compressed)]() mutable {
+                return assetCache.addModel(path, compressed, prepared(device));
+            };
+        }, std::move(onReady));
+    }
+
+    AssetLoader::Future<Texture> AssetLoader::loadTexture(const std::string &path, OnReady<Texture> onReady) {
+        return load<Texture>([this, path]() -> std::move_only_function<std::shared_ptr<Texture>()> {
+            if (std::shared_ptr<Texture> texture = assetCache.findTexture(path))
+                return [texture = std::move(texture)] { return texture; };
+            return [this, path, prepared = Texture::prepareTextureFromFile(path)]() mutable {
+                return assetCache.addTexture(path, prepared(device));
+            };
+        }, std::move(onReady));
+    }
+
+    AssetLoader::Future<Model> AssetLoader::loadModel(std::move_only_function<Model::Builder()> build,
+                                                      OnReady<Model> onReady) {
+        using Create = std::move_only_function<std::shared_ptr<Model>()>;
+        return load<Model>([this, build = std::move(build)]() mutable -> Create {
+            return [this, builder = build()] { return std::make_shared<Model>(device, builder); };
+        }, std::move(onReady));
+    }
+
+    void AssetLoader::update() {
+        ZoneScoped;
+        // Taken out first, since the callbacks might want to load something else
+        std::vector<std::future<Finish>> ready;
+        for (size_t i = 0; i < pending.size();) {
+            if (pending[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                i++;
+                continue;
+            } ready.push_back(std::move(pending[i]));
+            pending[i] = std::move(pending.back());
+            pending.pop_back();
+        }
+
+        for (std::future<Finish> &prepared : ready) {
+            try {
+                prepared.get()();
+            } catch (const std::exception &e) {
+                std::cerr << "Failed to load an asset: " << e.what() << std::endl;
+            }
+        }
+    }
+
+    void AssetLoader::waitAll() {
+        ZoneScoped;
+        while (!pending.empty()) {
+            for (std::future<Finish> &prepared : pending) prepared.wait();
+            update();
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include <memory>
+#include <future>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <algorithm>
+#include <exception>
+#include <functional>
+
+#include "../device/device.hpp"
+#include "../model/model.hpp"
+#include "../texture/texture.hpp"
+#include "../assetcache/assetcache.hpp"
+#include "../workerpool/workerpool.hpp"
+
+namespace Engine {
+    // Loads models and textures in the background, so nothing has to wait for them before it can start drawing.
+    // Everything that doesn't need the GPU (parsing, generating, LODs, meshlets, decoding) happens on the loader's own
+    // threads, and what's left gets created on the main thread in update(), which hands the uploads to the upload
+    // service, so they go out with the next frame. Until then, whatever's waiting on them can use the placeholders.
+    // Apart from the getters, none of it is thread safe, it's all meant to be used from the main thread.
+    class AssetLoader {
+    public:
+        template<typename T>
+        using Future = std::shared_future<std::shared_ptr<T>>;
+        // Gets called from update() with the asset, right after it's created, and never if it fails to load
+        template<typename T>
+        using OnReady = std::move_only_function<void(const std::shared_ptr<T> &)>;
+
+        // Leave a couple of threads for the main one and the shared pool, since loading isn't in a hurry
+        explicit AssetLoader(Device &device,
+                             AssetCache &assetCache,
+                             uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency() / 2));
+        // Waits for whatever is still loading, but doesn't create any of it
+        ~AssetLoader();
+
+        AssetLoader(const AssetLoader &) = delete;
+        AssetLoader& operator=(const AssetLoader &) = delete;
+
+        // Same as AssetCache::getModel and getTexture, so anything already in the cache is ready on the next update
+        Future<Model> loadModel(const std::string &path, bool compressed = false, OnReady<Model> onReady = {});
+        Future<Texture> loadTexture(const std::string &path, OnReady<Texture> onReady = {});
+        // For procedural meshes, which don't go through the cache, build gets called on a worker thread
+        Future<Model> loadModel(std::move_only_function<Model::Builder()> build, OnReady<Model> onReady = {});
+
+        // Creates everything that's done loading, call it once per frame, before it gets recorded
+        void update();
+        // Blocks until everything's loaded, and creates it
+        void waitAll();
+
+        [[nodiscard]] uint32_t getPendingCount() const { return static_cast<uint32_t>(pending.size()); }
+        [[nodiscard]] const std::shared_ptr<Model> &getPlaceholderModel() const { return placeholderModel; }
+        [[nodiscard]] const std::shared_ptr<Texture> &getPlaceholderTexture() const { return placeholderTexture; }
+    private:
+        // What's left to do on the main thread, once the worker's done
+        using Finish = std::move_only_function<void()>;
+
+        Device &device;
+        AssetCache &assetCache;
+
+        std::shared_ptr<Model> placeholderModel;
+        std::shared_ptr<Texture> placeholderTexture;
+
+        std::vector<std::future<Finish>> pending;
+        WorkerPool workerPool; // Last, so it's gone before anything its tasks might still be using
+
+        // prepare runs on a worker, and returns what creates the asset on the main thread
+        template<typename T, typename Prepare>
+        Future<T> load(Prepare &&prepare, OnReady<T> onReady);
+    };
+
+    template<typename T, typename Prepare>
+    AssetLoader::Future<T> AssetLoader::load(Prepare &&prepare, OnReady<T> onReady) {
+        auto promise = std::make_shared<std::promise<std::shared_ptr<T>>>();
+        Future<T> future = promise->get_future().share();
+
+        pending.push_back(workerPool.submit([prepare = std::forward<Prepare>(prepare),
+                                             promise,
+                                             onReady = std::move(onReady)]() mutable -> Finish {
+            // Anything that goes wrong gets passed on to the main thread, so it only has to look in one place
+            std::move_only_function<std::shared_ptr<T>()> create;
+            try {
+                create = prepare();
+            } catch (...) {
+                return [promise, error = std::current_exception()] {
+                    promise->set_exception(error);
+                    std::rethrow_exception(error);
+                };
+            }
+
+            return [create = std::move(create), promise, onReady = std::move(onReady)]() mutable {
+                std::shared_ptr<T> asset;
+                try {
+                    asset = create();
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                    throw;
+                } promise->set_value(asset);
+                if (onReady) onReady(asset);
+            };
+        }));
+        return future;
+    }
+}
+
+#endif
@@ -41,33 +41,34 @@ namespace Engine {
     Buffer::~Buffer() {
         unmap();
         vkDestroyBuffer(device.device(), buffer, nullptr);
-        vkFreeMemory(device.device(), memory, nullptr);
+        device.getAllocator().free(memory);
     }
 
     /**
     * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
     *
+    * @note Host visible memory is always mapped by the allocator, so this only hands out a pointer into it
+    *
     * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
     * buffer range.
     * @param offset (Optional) Byte offset from beginning
     *
-    * @return VkResult of the buffer mapping call
+    * @return VK_SUCCESS, or VK_ERROR_MEMORY_MAP_FAILED if the memory isn't host visible
     */
-    VkResult Buffer::map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(device.device(), memory, offset, size, 0, &mapped);
+    VkResult Buffer::map([[maybe_unused]] VkDeviceSize size, VkDeviceSize offset) {
+        assert(buffer && memory.memory && "Called map on buffer before create");
+        if (!memory.mapped) return VK_ERROR_MEMORY_MAP_FAILED;
+        mapped = static_cast<char*>(memory.mapped) + offset;
+        return VK_SUCCESS;
     }
 
     /**
     * Unmap a mapped memory range
     *
-    * @note Does not return a result as vkUnmapMemory can't fail
+    * @note The memory itself stays mapped until it's freed, since other buffers might be using it
     */
     void Buffer::unmap() {
-        if (mapped) {
-            vkUnmapMemory(device.device(), memory);
-            mapped = nullptr;
-        }
+        mapped = nullptr;
     }
 
     /**
@@ -104,9 +105,9 @@ namespace Engine {
     VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset) {
         VkMappedMemoryRange mappedRange = {};
         mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        mappedRange.memory = memory.memory;
+        mappedRange.offset = memory.offset + offset; // We only own part of the memory
+        mappedRange.size = size == VK_WHOLE_SIZE ? memory.size - offset : size;
         return vkFlushMappedMemoryRanges(device.device(), 1, &mappedRange);
     }
 
@@ -124,9 +125,9 @@ namespace Engine {
     VkResult Buffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
         VkMappedMemoryRange mappedRange = {};
         mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        mappedRange.memory = memory.memory;
+        mappedRange.offset = memory.offset + offset;
+        mappedRange.size = size == VK_WHOLE_SIZE ? memory.size - offset : size;
         return vkInvalidateMappedMemoryRanges(device.device(), 1, &mappedRange);
     }
 
@@ -48,7 +48,7 @@ namespace Engine {
         Device& device;
         void* mapped = nullptr;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        MemoryAllocator::Allocation memory{};
 
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
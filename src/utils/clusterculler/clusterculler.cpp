@@ -0,0 +1,186 @@
+#include "clusterculler.hpp"
+
+#include "../frameinfo/frameinfo.hpp"
+
+namespace Engine {
+    namespace {
+        glm::vec3 getScale(const glm::mat4 &modelMatrix) {
+            return {glm::length(glm::vec3(modelMatrix[0])),
+                    glm::length(glm::vec3(modelMatrix[1])),
+                    glm::length(glm::vec3(modelMatrix[2]))};
+        }
+    }
+
+    ClusterCuller::ClusterCuller(Device &device, const uint32_t framesInFlight) : device(device),
+                                                                                 commandBuffers(framesInFlight),
+                                                                                 wantedCommands(framesInFlight, 0) {
+        for (auto &commandBuffer : commandBuffers) commandBuffer = createCommandBuffer(INITIAL_COMMAND_CAPACITY);
+    }
+
+    void ClusterCuller::beginFrame(const uint32_t frameIndex, const Camera &camera) {
+        this->frameIndex = frameIndex;
+
+        // Whoever used this frame's slot before us is done, so nobody's using its buffer, and we can swap it for a bigger one
+        const uint32_t capacity = commandBuffers[frameIndex]->getInstanceCount();
+        if (wantedCommands[frameIndex] > capacity)
+            commandBuffers[frameIndex] = createCommandBuffer(std::max(wantedCommands[frameIndex], 2 * capacity));
+
+        wantedCommands[frameIndex] = 0;
+        commandCount = 0;
+        secondPhaseDraws.clear();
+        testedClusters = 0;
+        visibleClusters = 0;
+
+        // See "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix", by Gribb and Hartmann
+        // glm is column major, so we have to go through the rows by hand
+        const glm::mat4 clip = camera.getProjectionMatrix() * camera.getViewMatrix();
+        const glm::vec4 row0{clip[0][0], clip[1][0], clip[2][0], clip[3][0]};
+        const glm::vec4 row1{clip[0][1], clip[1][1], clip[2][1], clip[3][1]};
+        const glm::vec4 row2{clip[0][2], clip[1][2], clip[2][2], clip[3][2]};
+        const glm::vec4 row3{clip[0][3], clip[1][3], clip[2][3], clip[3][3]};
+        frustumPlanes = {
+            row3 + row0, // Left
+            row3 - row0, // Right
+            row3 + row1, // Top or bottom, depending on how the projection flips Y
+            row3 - row1,
+            row2, // Near, since depth goes from 0 to 1
+            row3 - row2 // Far
+        };
+        for (glm::vec4 &plane : frustumPlanes) plane /= glm::length(glm::vec3(plane));
+
+        cameraPosition = camera.getPosition();
+    }
+
+    void ClusterCuller::draw(FrameInfo &frameInfo, Entity &ent, const uint32_t lod) {
+        const Model &model = *ent.getModelComponent()->model;
+        const VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+        // The second phase only draws what we set up on the first one, everything else has been drawn already
+        if (frameInfo.phase == DrawPhase::Disoccluded) {
+            if (const auto draws = secondPhaseDraws.find(ent.getId()); draws != secondPhaseDraws.end())
+                frameInfo.drawCalls += drawIndirect(commandBuffer, draws->second);
+            return;
+        }
+
+        // Without an index buffer there aren't any meshlets, and nothing to point the indirect draws at
+        if (!model.isIndexed()) {
+            model.draw(commandBuffer, lod);
+            frameInfo.drawCalls++;
+            return;
+        }
+
+        const TransformComponent *transform = ent.getTransformComponent();
+        const glm::mat4 modelMatrix = transform->mat4();
+        cullClusters(model, lod, modelMatrix, transform->normal());
+        const auto count = static_cast<uint32_t>(scratch.size());
+        if (count == 0) return;
+
+        // If we run out of space, just draw them directly, the buffer will be bigger next time we get to this frame
+        const bool occlusionCulled = frameInfo.phase == DrawPhase::Visible;
+        wantedCommands[frameIndex] += occlusionCulled ? 2 * count : count;
+        Buffer &buffer = *commandBuffers[frameIndex];
+        if (commandCount + count > buffer.getInstanceCount()) {
+            for (const VkDrawIndexedIndirectCommand &command : scratch)
+                vkCmdDrawIndexed(commandBuffer, command.indexCount, 1, command.firstIndex, command.vertexOffset, 0);
+            frameInfo.drawCalls += count;
+            return;
+        }
+
+        auto *commands = static_cast<VkDrawIndexedIndirectCommand*>(buffer.getMappedMemory());
+        const DrawRange firstPhase{commandCount, count};
+        std::ranges::copy(scratch, commands + commandCount);
+        commandCount += count;
+
+        // The occlusion culling pass decides which of these get drawn on each phase, so we need a second copy for the
+        // second one. If it's got no space left for us, we just always get drawn on the first phase.
+        if (occlusionCulled && commandCount + count <= buffer.getInstanceCount()) {
+            const glm::vec3 scale = getScale(modelMatrix);
+            const glm::vec3 center = modelMatrix * glm::vec4(model.getBoundingCenter(), 1.0f);
+            const float radius = model.getBoundingRadius() * glm::max(scale.x, glm::max(scale.y, scale.z));
+
+            const DrawRange secondPhase{commandCount, count};
+            if (frameInfo.occlusionCuller.addInstance(ent.getId(),
+                                                      center,
+                                                      radius,
+                                                      firstPhase.firstCommand,
+                                                      secondPhase.firstCommand,
+                                                      count)) {
+                std::ranges::copy(scratch, commands + commandCount);
+                commandCount += count;
+                secondPhaseDraws[ent.getId()] = secondPhase;
+            }
+        } frameInfo.drawCalls += drawIndirect(commandBuffer, firstPhase);
+    }
+
+    std::unique_ptr<Buffer> ClusterCuller::createCommandBuffer(const uint32_t capacity) const {
+        auto buffer = std::make_unique<Buffer>(device,
+                                               sizeof(VkDrawIndexedIndirectCommand),
+                                               capacity,
+                                               VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        buffer->map();
+        return buffer;
+    }
+
+    void ClusterCuller::cullClusters(const Model &model,
+                                     const uint32_t lod,
+                                     const glm::mat4 &modelMatrix,
+                                     const glm::mat3 &normalMatrix) {
+        scratch.clear();
+        const Model::LOD &range = model.getLOD(lod);
+        // Everything in the model is relative to where it starts in the geometry arena
+        const uint32_t firstIndex = model.getFirstIndex();
+        const int32_t vertexOffset = model.getVertexOffset();
+        if (!enabled || !model.hasMeshlets() || range.meshletCount == 0) {
+            scratch.push_back({range.indexCount, 1, firstIndex + range.firstIndex, vertexOffset, 0});
+            return;
+        }
+
+        // Spheres get scaled by the biggest axis, but cones only stay cones if the scale is uniform
+        const glm::vec3 scale = getScale(modelMatrix);
+        const float maxScale = glm::max(scale.x, glm::max(scale.y, scale.z));
+        const float minScale = glm::min(scale.x, glm::min(scale.y, scale.z));
+        const bool canCullCones = maxScale - minScale <= 1e-3f * maxScale;
+
+        const std::vector<Model::Meshlet> &meshlets = model.getMeshlets();
+        for (uint32_t i = range.firstMeshlet; i < range.firstMeshlet + range.meshletCount; i++) {
+            const Model::Meshlet &meshlet = meshlets[i];
+            const glm::vec3 center = modelMatrix * glm::vec4(meshlet.center, 1.0f);
+            const float radius = meshlet.radius * maxScale;
+            if (!isVisible(center, radius)) continue;
+
+            // The whole cluster faces away from us if the camera is outside of its cone (on the back side)
+            // See https://zeux.io/2023/04/28/triangle-backface-culling/ for a nice write up on this
+            if (canCullCones && meshlet.coneCutoff < 1.0f) {
+                const glm::vec3 axis = glm::normalize(normalMatrix * meshlet.coneAxis);
+                const glm::vec3 view = center - cameraPosition;
+                if (glm::dot(view, axis) >= meshlet.coneCutoff * glm::length(view) + radius) continue;
+            }
+
+            // Neighbouring clusters are next to each other in the index buffer, so we just extend the last draw
+            visibleClusters++;
+            const uint32_t meshletFirstIndex = firstIndex + meshlet.firstIndex;
+            if (!scratch.empty() && scratch.back().firstIndex + scratch.back().indexCount == meshletFirstIndex) {
+                scratch.back().indexCount += meshlet.indexCount;
+            } else scratch.push_back({meshlet.indexCount, 1, meshletFirstIndex, vertexOffset, 0});
+        } testedClusters += range.meshletCount;
+    }
+
+    uint32_t ClusterCuller::drawIndirect(const VkCommandBuffer commandBuffer, const DrawRange range) const {
+        constexpr auto stride = static_cast<uint32_t>(sizeof(VkDrawIndexedIndirectCommand));
+        const VkBuffer buffer = commandBuffers[frameIndex]->getBuffer();
+        if (device.supportsMultiDrawIndirect()) {
+            vkCmdDrawIndexedIndirect(commandBuffer, buffer, VkDeviceSize{range.firstCommand} * stride, range.commandCount, stride);
+            return 1;
+        } for (uint32_t i = 0; i < range.commandCount; i++)
+            vkCmdDrawIndexedIndirect(commandBuffer, buffer, VkDeviceSize{range.firstCommand + i} * stride, 1, stride);
+        return range.commandCount;
+    }
+
+    bool ClusterCuller::isVisible(const glm::vec3 center, const float radius) const {
+        for (const glm::vec4 &plane : frustumPlanes)
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+        return true;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef CLUSTERCULLER_HPP
+#define CLUSTERCULLER_HPP
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include <vulkan/vulkan.h>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "../device/device.hpp"
+#include "../buffer/buffer.hpp"
+#include "../camera/camera.hpp"
+#include "../model/model.hpp"
+#include "../entity/entity.hpp"
+
+namespace Engine {
+    struct FrameInfo;
+
+    // Culls the meshlets of each model against the view frustum and their normal cones, and draws whatever survives
+    // with indirect draws. The commands get written straight into a host visible buffer, one per frame in flight.
+    // Mesh shaders would let us do this on the GPU instead, but not every device has them, so this is the fallback.
+    class ClusterCuller {
+    public:
+        static constexpr uint32_t INITIAL_COMMAND_CAPACITY = 16384;
+
+        bool enabled = true;
+
+        ClusterCuller(Device &device, uint32_t framesInFlight);
+
+        ClusterCuller(const ClusterCuller &) = delete;
+        ClusterCuller& operator=(const ClusterCuller &) = delete;
+
+        // Has to be called once per frame, before any draws, after the renderer has started the frame
+        void beginFrame(uint32_t frameIndex, const Camera &camera);
+
+        // Expects the entity's model (or anything else in its geometry chunk) to be bound already
+        void draw(FrameInfo &frameInfo, Entity &ent, uint32_t lod);
+
+        // Where this frame's commands live, the occlusion culling pass edits them on the GPU
+        [[nodiscard]] VkBuffer getCommandBuffer() const { return commandBuffers[frameIndex]->getBuffer(); }
+
+        [[nodiscard]] uint32_t getTestedClusters() const { return testedClusters; }
+        [[nodiscard]] uint32_t getVisibleClusters() const { return visibleClusters; }
+    private:
+        struct DrawRange {
+            uint32_t firstCommand;
+            uint32_t commandCount;
+        };
+
+        Device &device;
+
+        std::vector<std::unique_ptr<Buffer>> commandBuffers; // One per frame in flight
+        // How many commands each frame would have needed, so we can grow the buffer once nothing's using it anymore
+        std::vector<uint32_t> wantedCommands;
+        uint32_t frameIndex = 0;
+        uint32_t commandCount = 0; // Written so far this frame
+
+        std::vector<VkDrawIndexedIndirectCommand> scratch; // The current draw, before it goes in the buffer
+        std::unordered_map<Entity::id_t, DrawRange> secondPhaseDraws;
+
+        std::array<glm::vec4, 6> frustumPlanes{};
+        glm::vec3 cameraPosition{0.0f};
+
+        uint32_t testedClusters = 0;
+        uint32_t visibleClusters = 0;
+
+        [[nodiscard]] std::unique_ptr<Buffer> createCommandBuffer(uint32_t capacity) const;
+        void cullClusters(const Model &model, uint32_t lod, const glm::mat4 &modelMatrix, const glm::mat3 &normalMatrix);
+        uint32_t drawIndirect(VkCommandBuffer commandBuffer, DrawRange range) const; // Returns the draw calls recorded
+        [[nodiscard]] bool isVisible(glm::vec3 center, float radius) const;
+    };
+}
+
+#endif
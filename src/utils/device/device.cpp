@@ -1,5 +1,7 @@
 #include "device.hpp"
 #include "../../application.hpp"
+#include "../uploadservice/uploadservice.hpp"
+#include "../geometryarena/geometryarena.hpp"
 
 namespace Engine {
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
@@ -34,19 +36,27 @@ namespace Engine {
 
     // class member functions
     Device::Device(Window &window) : window{window} {
+        if (isHeadless()) deviceExtensions.clear();
         createInstance();
         setupDebugMessenger();
         createSurface();
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        allocator = std::make_unique<MemoryAllocator>(*this);
+        uploadService = std::make_unique<UploadService>(*this);
+        geometryArena = std::make_unique<GeometryArena>(*this);
     }
+    Device::~Device() { del(); }
 
     void Device::del() {
+        uploadService.reset(); // Waits for anything still uploading
+        geometryArena.reset();
         _delqueue.flush();
+        allocator.reset();
         vkDestroyCommandPool(_device, _commandPool, nullptr);
         vkDestroyDevice(_device, nullptr);
-        vkDestroySurfaceKHR(_instance, _surface, nullptr);
+        if (_surface != VK_NULL_HANDLE) vkDestroySurfaceKHR(_instance, _surface, nullptr);
         if (enableValidationLayers) DestroyDebugUtilsMessengerEXT(_instance, debugMessenger, nullptr);
         vkDestroyInstance(_instance, nullptr);
     }
@@ -113,13 +123,16 @@ namespace Engine {
         _physicalDevice = best->second;
         vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
         std::cout << "Found device: " << properties.deviceName << " with suitability score " << best->first << std::endl;
+        if (supportsMeshShaders()) std::cout << "Mesh shaders: supported, but we only draw indirectly for now" << std::endl;
     }
 
     void Device::createLogicalDevice() {
         QueueFamilyIndices indices = findQueueFamilies(_physicalDevice);
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily,
+                                                  indices.presentFamily,
+                                                  indices.transferFamily};
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -131,12 +144,24 @@ namespace Engine {
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
         deviceFeatures.fillModeNonSolid = VK_TRUE; // Enable wireframe mode support
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect; // Optional, we can loop over the draws
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC; // Only needed for KTX2 textures
+        enabledFeatures = deviceFeatures;
+
+        // Frame pacing is built around a timeline semaphore, which is core since 1.2 (we check for it when rating)
+        VkPhysicalDeviceVulkan12Features vulkan12Features{};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12Features.timelineSemaphore = VK_TRUE;
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &vulkan12Features;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -157,6 +182,7 @@ namespace Engine {
 
         vkGetDeviceQueue(_device, indices.graphicsFamily, 0, &_graphicsQueue);
         vkGetDeviceQueue(_device, indices.presentFamily, 0, &_presentQueue);
+        vkGetDeviceQueue(_device, indices.transferFamily, 0, &_transferQueue);
     }
 
     void Device::createCommandPool() {
@@ -176,8 +202,8 @@ namespace Engine {
         QueueFamilyIndices indices = findQueueFamilies(device);
 
         bool extensionsSupported = checkDeviceExtensionSupport(device);
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
+        bool swapChainAdequate = isHeadless(); // Nothing to present to, so anything goes
+        if (extensionsSupported && !isHeadless()) {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !(swapChainSupport.formats.empty() ||
                                   swapChainSupport.presentModes.empty());
@@ -187,10 +213,21 @@ namespace Engine {
         vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
         vkGetPhysicalDeviceProperties(device, &properties);
 
+        // Anything older than 1.2 doesn't know about the features struct, so it can't have timeline semaphores either
+        VkPhysicalDeviceVulkan12Features vulkan12Features{};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        if (properties.apiVersion >= VK_API_VERSION_1_2) {
+            VkPhysicalDeviceFeatures2 features2{};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features2.pNext = &vulkan12Features;
+            vkGetPhysicalDeviceFeatures2(device, &features2);
+        }
+
         if (!indices.isComplete() ||
             !extensionsSupported ||
             !swapChainAdequate ||
-            !supportedFeatures.samplerAnisotropy) return 0;
+            !supportedFeatures.samplerAnisotropy ||
+            !vulkan12Features.timelineSemaphore) return 0;
 
         switch (properties.deviceType) {
             case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score += 500; break;
@@ -259,10 +296,11 @@ namespace Engine {
         } return false;
     }
 
-    std::vector<const char*> Device::getRequiredExtensions() {
+    std::vector<const char*> Device::getRequiredExtensions() const {
+        // GLFW isn't even initialised when headless, and we don't need any surface extensions anyway
         uint32_t glfwExtensionCount = 0;
-        const char **glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        const char **glfwExtensions = nullptr;
+        if (!isHeadless()) glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
         std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
         if (enableValidationLayers) extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         return extensions;
@@ -306,12 +344,16 @@ namespace Engine {
     }
 
     uint32_t Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+        if (const auto memoryType = tryFindMemoryType(typeFilter, properties)) return *memoryType;
+        throw std::runtime_error("Failed to find any suitable memory type!");
+    }
+    std::optional<uint32_t> Device::tryFindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
         VkPhysicalDeviceMemoryProperties memProperties;
         vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memProperties);
         for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
             if ((typeFilter & (1 << i)) &&
                 (memProperties.memoryTypes[i].propertyFlags & properties) == properties) return i;
-        throw std::runtime_error("Failed to find any suitable memory type!");
+        return std::nullopt;
     }
 
     QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) const {
@@ -334,12 +376,25 @@ namespace Engine {
                 indices.graphicsFamilyHasValue = true;
             }
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
+            if (isHeadless()) presentSupport = indices.graphicsFamilyHasValue; // The "present" queue is just the graphics one
+            else vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
             if (presentSupport) {
                 indices.presentFamily = i;
                 indices.presentFamilyHasValue = true;
             } if (indices.isComplete()) break;
             i++;
+        }
+
+        // Families that can only do transfers are usually the GPU's copy engines, which run alongside everything else
+        indices.transferFamily = indices.graphicsFamily;
+        for (uint32_t j = 0; j < queueFamilyCount; j++) {
+            const VkQueueFlags flags = queueFamilies[j].queueFlags;
+            if (queueFamilies[j].queueCount > 0 &&
+                (flags & VK_QUEUE_TRANSFER_BIT) &&
+                !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+                indices.transferFamily = j;
+                break;
+            }
         } return indices;
     }
 
@@ -376,6 +431,28 @@ namespace Engine {
         } throw std::runtime_error("Failed to find any supported formats!");
     }
 
+    bool Device::supportsTimestamps() const {
+        if (properties.limits.timestampComputeAndGraphics) return true;
+
+        // Otherwise, we have to check if the graphics queue specifically supports them
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &queueFamilyCount, queueFamilies.data());
+        return queueFamilies[findPhysicalQueueFamilies().graphicsFamily].timestampValidBits > 0;
+    }
+
+    bool Device::supportsMeshShaders() const {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+        return std::ranges::any_of(availableExtensions, [](const VkExtensionProperties &extension) {
+            return std::strcmp(extension.extensionName, VK_EXT_MESH_SHADER_EXTENSION_NAME) == 0;
+        });
+    }
+
     VkSampleCountFlagBits Device::getMaxUsableSampleCount() {
         VkSampleCountFlags counts = properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
         // Anything about 8x is overkill, and isn't usually supported by consumer GPUs
@@ -392,7 +469,7 @@ namespace Engine {
                               VkBufferUsageFlags usage,
                               VkMemoryPropertyFlags properties,
                               VkBuffer &buffer,
-                              VkDeviceMemory &bufferMemory) {
+                              MemoryAllocator::Allocation &bufferMemory) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
@@ -401,18 +478,7 @@ namespace Engine {
 
         if (vkCreateBuffer(_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
             throw std::runtime_error("Failed to create the buffer!");
-
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(_device, buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(_device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-            throw std::runtime_error("Failed to allocate the buffer memory!");
-        vkBindBufferMemory(_device, buffer, bufferMemory, 0);
+        bufferMemory = allocator->allocateForBuffer(buffer, properties);
     }
 
     VkCommandBuffer Device::beginSingleTimeCommands() {
@@ -487,23 +553,10 @@ namespace Engine {
     void Device::createImageWithInfo(const VkImageCreateInfo &imageInfo,
                                      VkMemoryPropertyFlags properties,
                                      VkImage &image,
-                                     VkDeviceMemory &imageMemory) {
+                                     MemoryAllocator::Allocation &imageMemory) {
         if (vkCreateImage(_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
             throw std::runtime_error("Failed to create the image!");
-
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(_device, image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(_device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-            throw std::runtime_error("Failed to allocate the image memory!");
-
-        if (vkBindImageMemory(_device, image, imageMemory, 0) != VK_SUCCESS)
-            throw std::runtime_error("Failed to bind the image memory!");
+        imageMemory = allocator->allocateForImage(image, properties, imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
     }
 
     void Device::transitionImageLayout(VkImage image,
@@ -1,8 +1,6 @@
 #ifndef GAME_ENGINE_DEVICE_HPP
 #define GAME_ENGINE_DEVICE_HPP
 
-#define DESIRED_SAMPLE_COUNT VK_SAMPLE_COUNT_8_BIT
-
 #include <vector>
 #include <cstring>
 #include <iostream>
@@ -10,12 +8,18 @@
 #include <set>
 #include <unordered_set>
 #include <unordered_map>
+#include <optional>
+#include <memory>
 #include <vulkan/vulkan.h>
 
 #include "../window/window.hpp"
 #include "../utils.hpp"
+#include "../memoryallocator/memoryallocator.hpp"
 
 namespace Engine {
+    class UploadService;
+    class GeometryArena;
+
     struct SwapChainSupportDetails {
         VkSurfaceCapabilitiesKHR capabilities;
         std::vector<VkSurfaceFormatKHR> formats;
@@ -25,6 +29,7 @@ namespace Engine {
     struct QueueFamilyIndices {
         uint32_t graphicsFamily;
         uint32_t presentFamily;
+        uint32_t transferFamily; // Same as the graphics one, unless there's a family just for transfers
 
         bool graphicsFamilyHasValue = false;
         bool presentFamilyHasValue = false;
@@ -42,9 +47,9 @@ namespace Engine {
         VkPhysicalDeviceProperties properties;
 
         explicit Device(Window &window);
-        ~Device() { del(); }
+        ~Device();
 
-        Device(const Device &) = default;
+        Device(const Device &) = delete;
         Device& operator=(const Device &) = delete;
         Device(Device &&) = delete;
         Device& operator=(Device &&) = delete;
@@ -58,6 +63,15 @@ namespace Engine {
         [[nodiscard]] VkSurfaceKHR surface() const { return _surface; }
         [[nodiscard]] VkQueue graphicsQueue() const { return _graphicsQueue; }
         [[nodiscard]] VkQueue presentQueue() const { return _presentQueue; }
+        [[nodiscard]] VkQueue transferQueue() const { return _transferQueue; }
+        // Where all the buffer and image memory comes from
+        [[nodiscard]] MemoryAllocator &getAllocator() const { return *allocator; }
+        // Batches buffer and image uploads, and gets them done without stalling on each one
+        [[nodiscard]] UploadService &getUploadService() const { return *uploadService; }
+        // Where every model's vertices and indices go
+        [[nodiscard]] GeometryArena &getGeometryArena() const { return *geometryArena; }
+        // No surface and nothing to present to, the swap chain renders into images of its own instead
+        [[nodiscard]] bool isHeadless() const { return window.isHeadless(); }
 
         [[nodiscard]] VkFormatProperties getFormatProperties(VkFormat format) const {
             VkFormatProperties formatProperties;
@@ -67,6 +81,8 @@ namespace Engine {
 
         [[nodiscard]] SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(_physicalDevice); }
         [[nodiscard]] uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+        // Same as above, but doesn't throw, for when we have a fallback (like with lazily allocated memory)
+        [[nodiscard]] std::optional<uint32_t> tryFindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
         [[nodiscard]] QueueFamilyIndices findPhysicalQueueFamilies() const {
             return findQueueFamilies(_physicalDevice);
         }
@@ -74,17 +90,27 @@ namespace Engine {
                                                    VkImageTiling tiling,
                                                    VkFormatFeatureFlags features);
 
+        [[nodiscard]] bool supportsTimestamps() const;
+        [[nodiscard]] bool supportsMultiDrawIndirect() const { return enabledFeatures.multiDrawIndirect == VK_TRUE; }
+        [[nodiscard]] bool supportsTextureCompressionBC() const {
+            return enabledFeatures.textureCompressionBC == VK_TRUE;
+        }
+        // Only tells us whether the extension is there, we don't enable it (yet)
+        [[nodiscard]] bool supportsMeshShaders() const;
+
         [[nodiscard]] VkSampleCountFlagBits getMaxUsableSampleCount();
         [[nodiscard]] VkSampleCountFlagBits getDesiredSampleCount() {
-            return std::min(DESIRED_SAMPLE_COUNT, getMaxUsableSampleCount());
+            return std::min(desiredSampleCount, getMaxUsableSampleCount());
         }
+        // The swap chain and every pipeline that renders to it have to be recreated after changing this!
+        void setDesiredSampleCount(VkSampleCountFlagBits sampleCount) { desiredSampleCount = sampleCount; }
 
         // Buffer Helper Functions
         void createBuffer(VkDeviceSize size,
                           VkBufferUsageFlags usage,
                           VkMemoryPropertyFlags properties,
                           VkBuffer &buffer,
-                          VkDeviceMemory &bufferMemory);
+                          MemoryAllocator::Allocation &bufferMemory);
         [[nodiscard]] VkCommandBuffer beginSingleTimeCommands();
         void endSingleTimeCommands(VkCommandBuffer commandBuffer);
         void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -93,7 +119,7 @@ namespace Engine {
         void createImageWithInfo(const VkImageCreateInfo &imageInfo,
                                  VkMemoryPropertyFlags properties,
                                  VkImage &image,
-                                 VkDeviceMemory &imageMemory);
+                                 MemoryAllocator::Allocation &imageMemory);
 
         void transitionImageLayout(VkImage image,
                                    VkFormat format,
@@ -105,12 +131,15 @@ namespace Engine {
         const std::vector<const char*> validationLayers = {
                 "VK_LAYER_KHRONOS_validation"
         };
-        const std::vector<const char*> deviceExtensions = {
+        std::vector<const char*> deviceExtensions = { // Emptied when headless, since we don't need to present
                 VK_KHR_SWAPCHAIN_EXTENSION_NAME
         };
 
         DeletionQueue _delqueue;
 
+        VkSampleCountFlagBits desiredSampleCount = VK_SAMPLE_COUNT_8_BIT;
+        VkPhysicalDeviceFeatures enabledFeatures{};
+
         VkDebugUtilsMessengerEXT debugMessenger;
         Window &window;
 
@@ -118,20 +147,25 @@ namespace Engine {
         VkInstance _instance;
         VkDevice _device;
         VkPhysicalDevice _physicalDevice = nullptr;
-        VkSurfaceKHR _surface;
+        VkSurfaceKHR _surface = VK_NULL_HANDLE;
         VkQueue _graphicsQueue;
         VkQueue _presentQueue;
+        VkQueue _transferQueue;
+
+        std::unique_ptr<MemoryAllocator> allocator;
+        std::unique_ptr<UploadService> uploadService;
+        std::unique_ptr<GeometryArena> geometryArena;
 
         void createInstance();
         void setupDebugMessenger();
-        void createSurface() { window.createWindowSurface(_instance, &_surface); }
+        void createSurface() { if (!isHeadless()) window.createWindowSurface(_instance, &_surface); }
         void pickPhysicalDevice();
         void createLogicalDevice();
         void createCommandPool();
 
         // helper functions
         uint32_t rateDeviceSuitability(VkPhysicalDevice device);
-        static std::vector<const char*> getRequiredExtensions() ;
+        [[nodiscard]] std::vector<const char*> getRequiredExtensions() const;
         bool checkValidationLayerSupport();
         QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) const;
         static void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
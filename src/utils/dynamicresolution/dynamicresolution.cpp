@@ -0,0 +1,75 @@
+#include "dynamicresolution.hpp"
+
+namespace Engine {
+    DynamicResolution::DynamicResolution(Device &device, uint32_t framesInFlight) :
+                                         device(device), hasResults(framesInFlight, false) {
+        if (!device.supportsTimestamps()) {
+            std::cerr << "Timestamp queries are not supported, dynamic resolution won't be available" << std::endl;
+            return;
+        }
+
+        timestampPeriod = device.properties.limits.timestampPeriod;
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = 2 * framesInFlight; // Start and end of each frame
+
+        if (vkCreateQueryPool(device.device(), &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the timestamp query pool!");
+    }
+    DynamicResolution::~DynamicResolution() {
+        if (queryPool != VK_NULL_HANDLE) vkDestroyQueryPool(device.device(), queryPool, nullptr);
+    }
+
+    void DynamicResolution::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+        if (!isSupported()) return;
+        const uint32_t firstQuery = 2 * frameIndex;
+
+        // By the time we get here, the renderer has waited for this frame's slot to be free, so the results should be ready
+        if (hasResults[frameIndex]) {
+            uint64_t timestamps[2];
+            if (vkGetQueryPoolResults(device.device(),
+                                      queryPool,
+                                      firstQuery,
+                                      2,
+                                      sizeof(timestamps),
+                                      timestamps,
+                                      sizeof(uint64_t),
+                                      VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+                const double ticks = static_cast<double>(timestamps[1] - timestamps[0]);
+                gpuFrameTime = static_cast<float>(ticks * static_cast<double>(timestampPeriod) * 1e-6);
+                updateScale();
+            }
+        }
+
+        vkCmdResetQueryPool(commandBuffer, queryPool, firstQuery, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, firstQuery);
+        hasResults[frameIndex] = false;
+    }
+    void DynamicResolution::endFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+        if (!isSupported()) return;
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 2 * frameIndex + 1);
+        hasResults[frameIndex] = true;
+    }
+
+    VkExtent2D DynamicResolution::scaleExtent(VkExtent2D extent) const {
+        const float currentScale = getScale();
+        return {
+            std::max(1u, static_cast<uint32_t>(std::round(static_cast<float>(extent.width) * currentScale))),
+            std::max(1u, static_cast<uint32_t>(std::round(static_cast<float>(extent.height) * currentScale)))
+        };
+    }
+
+    void DynamicResolution::updateScale() {
+        if (!enabled || gpuFrameTime <= 0.0f) return;
+
+        // The GPU cost is roughly proportional to the amount of pixels we shade, so we scale each axis by the square root
+        const float headroom = targetFrameTime / gpuFrameTime;
+        if (std::abs(1.0f - headroom) < 0.05f) return; // Small dead zone, so we don't keep bouncing around the target
+
+        // The timings we get are a few frames old, so we only move part of the way there each frame to avoid oscillating
+        const float desiredScale = scale * std::sqrt(headroom);
+        scale = std::clamp(scale + (desiredScale - scale) * 0.2f, MIN_SCALE, MAX_SCALE);
+    }
+}
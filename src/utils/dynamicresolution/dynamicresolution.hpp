@@ -0,0 +1,51 @@
+#ifndef DYNAMICRESOLUTION_HPP
+#define DYNAMICRESOLUTION_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <vulkan/vulkan.h>
+
+#include "../device/device.hpp"
+
+namespace Engine {
+    // Scales the resolution the scene gets rendered at, so that the GPU frame time stays around a target.
+    // The GPU time is measured with two timestamp queries per frame in flight, which we only read back once the renderer
+    // has waited for that frame's slot to be free, so we never stall the CPU waiting for them.
+    class DynamicResolution {
+    public:
+        static constexpr float MIN_SCALE = 0.5f;
+        static constexpr float MAX_SCALE = 1.0f;
+
+        bool enabled = false;
+        float targetFrameTime = 16.6f; // In milliseconds
+
+        DynamicResolution(Device &device, uint32_t framesInFlight);
+        ~DynamicResolution();
+
+        DynamicResolution(const DynamicResolution &) = delete;
+        DynamicResolution& operator=(const DynamicResolution &) = delete;
+
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+        void endFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+        [[nodiscard]] bool isSupported() const { return queryPool != VK_NULL_HANDLE; }
+        [[nodiscard]] float getScale() const { return enabled ? scale : MAX_SCALE; }
+        [[nodiscard]] float getGpuFrameTime() const { return gpuFrameTime; }
+        [[nodiscard]] VkExtent2D scaleExtent(VkExtent2D extent) const;
+    private:
+        Device &device;
+
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        std::vector<bool> hasResults;
+        float timestampPeriod = 1.0f; // Nanoseconds per tick
+
+        float scale = MAX_SCALE;
+        float gpuFrameTime = 0.0f;
+
+        void updateScale();
+    };
+}
+
+#endif
@@ -7,6 +7,8 @@ namespace Engine {
     class ModelComponent final : public Component {
     public:
         std::shared_ptr<Model> model;
+        uint32_t lod = 0; // The one we used last frame, so we can apply some hysteresis when switching
+        bool occluder = false; // Gets rasterised for the software occlusion culling, so it should be big and simple
 
         explicit ModelComponent(const std::shared_ptr<Model> &model) : model(model) {}
         [[nodiscard]] ComponentType getComponentType() const override { return MODEL; }
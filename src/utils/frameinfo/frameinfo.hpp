@@ -5,10 +5,14 @@
 #define MAX_POINT_LIGHTS 8
 
 #include <vulkan/vulkan.h>
+#include <tracy/TracyVulkan.hpp>
 
 #include "../camera/camera.hpp"
 #include "../descriptors/descriptors.hpp"
 #include "../entity/entity.hpp"
+#include "../clusterculler/clusterculler.hpp"
+#include "../occlusionculler/occlusionculler.hpp"
+#include "../softwareocclusion/softwareocclusion.hpp"
 
 // Alignment requirements need to be met correctly in all buffers, else, weird, un-debuggable errors will occur almost surely
 // (See https://registry.khronos.org/vulkan/specs/1.3-extensions/html/chap15.html#interfaces-resources-layout)
@@ -39,19 +43,34 @@ namespace Engine {
 
     struct PushConstantData {
         glm::mat4 modelMatrix{1.0f}; // 64 bytes
+        // Only the top left 3x3 is the normal matrix, so [3].y flags models with top left texture coordinates, which
+        // keeps everything within the 128 bytes every device has to support
         glm::mat4 normalMatrix{1.0f}; // 64 bytes
     };
 
+    // With occlusion culling, the scene gets drawn in two phases (see OcclusionCuller), otherwise it's all done in one go
+    enum class DrawPhase {
+        Single,
+        Visible, // Whatever was visible last frame
+        Disoccluded // Whatever wasn't drawn on the first phase, but turned out to be visible
+    };
+
     struct FrameInfo {
         static constexpr float MAX_DELTA_TIME = 0.03333333f; // 30 FPS
 
         uint32_t frameIndex = 0;
         float frameTime = 0.0f;
         VkCommandBuffer commandBuffer{};
+        TracyVkCtx tracyContext{}; // For GPU zones on the command buffer, null when Tracy isn't enabled
         Camera &camera;
         VkDescriptorSet globalDescriptorSet{};
         DescriptorPool &frameDescriptorPool;  // Descriptor pool, cleared each frame
         Entity::Map &entities;
+        ClusterCuller &clusterCuller;
+        OcclusionCuller &occlusionCuller;
+        SoftwareOcclusionCuller &softwareOcclusionCuller;
+        DrawPhase phase = DrawPhase::Single;
+        uint32_t drawCalls = 0; // Every draw command recorded this frame, an indirect one counts once
     };
 }
 
@@ -0,0 +1,60 @@
+#include "framestats.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <string_view>
+
+namespace Engine {
+    void FrameStats::beginFrame() {
+        frameStart = std::chrono::high_resolution_clock::now();
+        frameStarted = true;
+
+        // Every system gets a sample for every frame, so they all line up with the frame times
+        for (System &system : systems) system.times.push_back(0.0f);
+    }
+    void FrameStats::endFrame(const uint32_t drawCalls) {
+        assert(frameStarted && "Cannot end a frame that hasn't begun!");
+        frameTimes.push_back(std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - frameStart).count());
+        this->drawCalls.push_back(drawCalls);
+        frameStarted = false;
+
+        // Dropping the older half in one go keeps them in order, without moving everything over on every frame
+        if (maxFrames == 0 || frameTimes.size() < size_t{2} * maxFrames) return;
+        const auto dropped = static_cast<std::ptrdiff_t>(frameTimes.size() - maxFrames);
+        frameTimes.erase(frameTimes.begin(), frameTimes.begin() + dropped);
+        this->drawCalls.erase(this->drawCalls.begin(), this->drawCalls.begin() + dropped);
+        for (System &system : systems) system.times.erase(system.times.begin(), system.times.begin() + dropped);
+    }
+
+    void FrameStats::addSystemTime(const char *name, const float time) {
+        if (!frameStarted) return;
+
+        auto it = std::ranges::find(systems, std::string_view(name), &System::name);
+        if (it == systems.end()) { // Wasn't there for the frames before this one
+            systems.push_back({name, std::vector<float>(frameTimes.size() + 1, 0.0f)});
+            it = systems.end() - 1;
+        } it->times.back() += time;
+    }
+
+    FrameStats::Percentiles FrameStats::computePercentiles(std::vector<float> samples) {
+        if (samples.empty()) return {};
+        std::ranges::sort(samples);
+
+        const auto rank = [&](const float percentile) {
+            const auto index = static_cast<size_t>(std::ceil(percentile * static_cast<float>(samples.size())));
+            return samples[std::clamp<size_t>(index, 1, samples.size()) - 1];
+        };
+
+        double total = 0.0; // Floats start losing precision pretty quickly over a long run
+        for (const float sample : samples) total += static_cast<double>(sample);
+        return {samples.front(),
+                rank(0.50f),
+                rank(0.90f),
+                rank(0.95f),
+                rank(0.99f),
+                samples.back(),
+                static_cast<float>(total / static_cast<double>(samples.size()))};
+    }
+}
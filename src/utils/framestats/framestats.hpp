@@ -0,0 +1,80 @@
+#ifndef FRAMESTATS_HPP
+#define FRAMESTATS_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace Engine {
+    // Keeps every frame's CPU time, draw calls and how long each system took.
+    // Unlike the GPU profiler, nothing has to get rolled over, so a benchmark can look at the whole run once it's done,
+    // but anything that runs for as long as someone leaves it open should set a limit, so it doesn't grow forever.
+    // Systems that are timed more than once in a frame get added together, same as with the GPU profiler.
+    class FrameStats {
+    public:
+        struct Percentiles {
+            float min = 0.0f; // All in milliseconds
+            float p50 = 0.0f;
+            float p90 = 0.0f;
+            float p95 = 0.0f;
+            float p99 = 0.0f;
+            float max = 0.0f;
+            float avg = 0.0f;
+        };
+
+        struct System {
+            std::string name;
+            std::vector<float> times; // One per frame, 0 on frames it didn't run
+        };
+
+        // 0 keeps every frame, anything else keeps at least that many of the latest ones, and at most twice that
+        explicit FrameStats(uint32_t maxFrames = 0) : maxFrames(maxFrames) {}
+
+        FrameStats(const FrameStats &) = delete;
+        FrameStats& operator=(const FrameStats &) = delete;
+
+        void beginFrame();
+        void endFrame(uint32_t drawCalls);
+
+        // The name has to be a string literal, same as with the GPU profiler
+        void addSystemTime(const char *name, float time);
+
+        [[nodiscard]] uint32_t getFrameCount() const { return static_cast<uint32_t>(frameTimes.size()); }
+        [[nodiscard]] const std::vector<float> &getFrameTimes() const { return frameTimes; }
+        [[nodiscard]] const std::vector<uint32_t> &getDrawCalls() const { return drawCalls; }
+        [[nodiscard]] const std::vector<System> &getSystems() const { return systems; }
+
+        // Nearest rank, on a copy, since it has to be sorted
+        [[nodiscard]] static Percentiles computePercentiles(std::vector<float> samples);
+
+        // Adds the time between its construction and destruction to a system
+        class Timer {
+        public:
+            Timer(FrameStats &stats, const char *name) :
+                  stats(stats), name(name), start(std::chrono::high_resolution_clock::now()) {}
+            ~Timer() {
+                stats.addSystemTime(name, std::chrono::duration<float, std::chrono::milliseconds::period>(
+                    std::chrono::high_resolution_clock::now() - start).count());
+            }
+
+            Timer(const Timer &) = delete;
+            Timer& operator=(const Timer &) = delete;
+        private:
+            FrameStats &stats;
+            const char *name;
+            std::chrono::high_resolution_clock::time_point start;
+        };
+    private:
+        uint32_t maxFrames;
+
+        std::vector<float> frameTimes;
+        std::vector<uint32_t> drawCalls;
+        std::vector<System> systems;
+
+        std::chrono::high_resolution_clock::time_point frameStart{};
+        bool frameStarted = false;
+    };
+}
+
+#endif
@@ -0,0 +1,154 @@
+#include "geometryarena.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "../swapchain/swapchain.hpp"
+#include "../uploadservice/uploadservice.hpp"
+
+namespace Engine {
+    GeometryArena::RangeAllocator::RangeAllocator(const uint32_t capacity) : capacity(capacity) {
+        if (capacity > 0) freeRanges[0] = capacity;
+    }
+
+    bool GeometryArena::RangeAllocator::allocate(const uint32_t count, uint32_t &first) {
+        const auto it = std::ranges::find_if(freeRanges, [count](const auto &range) { return range.second >= count; });
+        if (it == freeRanges.end()) return false;
+
+        first = it->first;
+        if (const uint32_t left = it->second - count; left > 0) freeRanges[first + count] = left;
+        freeRanges.erase(it);
+        used += count;
+        return true;
+    }
+
+    void GeometryArena::RangeAllocator::free(uint32_t first, uint32_t count) {
+        used -= count;
+
+        // Merge with the ranges on either side, if they're free too
+        if (const auto next = freeRanges.find(first + count); next != freeRanges.end()) {
+            count += next->second;
+            freeRanges.erase(next);
+        } if (auto prev = freeRanges.lower_bound(first); prev != freeRanges.begin()) {
+            --prev;
+            if (prev->first + prev->second == first) {
+                prev->second += count;
+                return;
+            }
+        } freeRanges[first] = count;
+    }
+
+    GeometryArena::Range GeometryArena::allocate(const void *vertices,
+                                                 const uint32_t vertexSize,
+                                                 const uint32_t vertexCount,
+                                                 const uint32_t *indices,
+                                                 const uint32_t indexCount) {
+        ZoneScoped;
+        assert(vertexCount > 0 && "Cannot allocate geometry without any vertices!");
+
+        const VkIndexType indexType = vertexCount < MAX_SHORT_INDEX_VERTICES ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        Range range{NO_CHUNK, 0, vertexCount, 0, indexCount};
+        for (uint32_t i = 0; i < chunks.size() && range.chunk == NO_CHUNK; i++) {
+            Chunk &chunk = chunks[i];
+            if (chunk.vertexSize != vertexSize || chunk.indexType != indexType) continue;
+            if (!chunk.vertices.allocate(vertexCount, range.firstVertex)) continue;
+            if (indexCount > 0 && !chunk.indices.allocate(indexCount, range.firstIndex)) {
+                chunk.vertices.free(range.firstVertex, vertexCount);
+                continue;
+            } range.chunk = i;
+        }
+
+        if (range.chunk == NO_CHUNK) { // Anything too big for a regular chunk gets one that's just big enough
+            Chunk &chunk = createChunk(vertexSize,
+                                       indexType,
+                                       std::max(vertexCount, CHUNK_VERTICES),
+                                       std::max(indexCount, CHUNK_INDICES));
+            range.chunk = static_cast<uint32_t>(chunks.size() - 1);
+            [[maybe_unused]] bool allocated = chunk.vertices.allocate(vertexCount, range.firstVertex);
+            if (indexCount > 0) allocated = chunk.indices.allocate(indexCount, range.firstIndex) && allocated;
+            assert(allocated && "A new chunk should always have enough space!");
+        }
+
+        const Chunk &chunk = chunks[range.chunk];
+        UploadService &uploadService = device.getUploadService();
+        uploadService.uploadBuffer(chunk.vertexBuffer->getBuffer(),
+                                   vertices,
+                                   VkDeviceSize{vertexCount} * vertexSize,
+                                   VkDeviceSize{range.firstVertex} * vertexSize);
+        if (indexCount == 0) return range;
+
+        std::vector<uint16_t> shortIndices;
+        const void *indexData = indices;
+        if (indexType == VK_INDEX_TYPE_UINT16) {
+            shortIndices.resize(indexCount);
+            for (uint32_t i = 0; i < indexCount; i++) shortIndices[i] = static_cast<uint16_t>(indices[i]);
+            indexData = shortIndices.data();
+        } // The upload service copies it to the staging ring right away, so this doesn't have to outlive the call
+
+        const VkDeviceSize indexSize = getIndexSize(indexType);
+        uploadService.uploadBuffer(chunk.indexBuffer->getBuffer(),
+                                   indexData,
+                                   VkDeviceSize{indexCount} * indexSize,
+                                   VkDeviceSize{range.firstIndex} * indexSize);
+        return range;
+    }
+
+    void GeometryArena::free(const Range &range) {
+        if (range.chunk == NO_CHUNK) return;
+        pendingFrees.push_back({range, currentFrame + SwapChain::MAX_FRAMES_IN_FLIGHT + 1});
+    }
+
+    void GeometryArena::beginFrame(const uint64_t frame) {
+        currentFrame = frame;
+        std::erase_if(pendingFrees, [this](const PendingFree &pending) {
+            if (pending.releaseFrame > currentFrame) return false;
+            release(pending.range);
+            return true;
+        });
+    }
+
+    void GeometryArena::bind(const VkCommandBuffer commandBuffer, const uint32_t chunk) const {
+        assert(chunk < chunks.size() && "Invalid geometry chunk!");
+        const VkBuffer buffers[] = { chunks[chunk].vertexBuffer->getBuffer() };
+        constexpr VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, chunks[chunk].indexBuffer->getBuffer(), 0, chunks[chunk].indexType);
+    }
+
+    GeometryArena::Stats GeometryArena::getStats() const {
+        Stats stats{static_cast<uint32_t>(chunks.size()), 0, 0};
+        for (const Chunk &chunk : chunks) {
+            stats.usedBytes += VkDeviceSize{chunk.vertices.getUsed()} * chunk.vertexSize +
+                               VkDeviceSize{chunk.indices.getUsed()} * getIndexSize(chunk.indexType);
+            stats.capacityBytes += VkDeviceSize{chunk.vertices.getCapacity()} * chunk.vertexSize +
+                                   VkDeviceSize{chunk.indices.getCapacity()} * getIndexSize(chunk.indexType);
+        } return stats;
+    }
+
+    GeometryArena::Chunk &GeometryArena::createChunk(const uint32_t vertexSize,
+                                                     const VkIndexType indexType,
+                                                     const uint32_t vertexCapacity,
+                                                     const uint32_t indexCapacity) {
+        chunks.push_back({vertexSize,
+                          indexType,
+                          std::make_unique<Buffer>(device,
+                                                   vertexSize,
+                                                   vertexCapacity,
+                                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+                          std::make_unique<Buffer>(device,
+                                                   getIndexSize(indexType),
+                                                   indexCapacity,
+                                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+                          RangeAllocator(vertexCapacity),
+                          RangeAllocator(indexCapacity)});
+        return chunks.back();
+    }
+
+    void GeometryArena::release(const Range &range) {
+        Chunk &chunk = chunks[range.chunk];
+        chunk.vertices.free(range.firstVertex, range.vertexCount);
+        if (range.indexCount > 0) chunk.indices.free(range.firstIndex, range.indexCount);
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef GEOMETRYARENA_HPP
+#define GEOMETRYARENA_HPP
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "../device/device.hpp"
+#include "../buffer/buffer.hpp"
+
+namespace Engine {
+    // Every model's vertices and indices live in a few big shared buffers, instead of a pair of buffers per model, so a
+    // pass only has to bind them once, and each draw points at its own range with firstIndex and vertexOffset.
+    // Once a chunk fills up, we just start another one (a bigger one, if a single model doesn't fit in the default
+    // size), so draws only have to rebind when they get to a model that lives in a different chunk.
+    // Each chunk only holds one vertex layout and one index type, since vertexOffset and firstIndex count elements,
+    // not bytes. Models with fewer than 65536 vertices get 16 bit indices, which halves their index memory and traffic.
+    // Freed ranges only get reused after MAX_FRAMES_IN_FLIGHT frames, since the frames in flight might still read them.
+    class GeometryArena {
+    public:
+        static constexpr uint32_t CHUNK_VERTICES = 1 << 20;
+        static constexpr uint32_t CHUNK_INDICES = 1 << 22;
+        static constexpr uint32_t NO_CHUNK = UINT32_MAX;
+        static constexpr uint32_t MAX_SHORT_INDEX_VERTICES = 1 << 16; // 0xFFFF is left out, it's the restart index
+
+        struct Range {
+            uint32_t chunk = NO_CHUNK;
+            uint32_t firstVertex = 0;
+            uint32_t vertexCount = 0;
+            uint32_t firstIndex = 0;
+            uint32_t indexCount = 0;
+        };
+
+        struct Stats {
+            uint32_t chunkCount;
+            VkDeviceSize usedBytes; // Vertices and indices together
+            VkDeviceSize capacityBytes;
+        };
+
+        explicit GeometryArena(Device &device) : device(device) {}
+
+        GeometryArena(const GeometryArena &) = delete;
+        GeometryArena& operator=(const GeometryArena &) = delete;
+
+        // Goes through the upload service, so it's ready by the next frame. Models without indices just pass none.
+        // Indices are relative to the model's own vertices, and get narrowed to 16 bits here whenever they fit.
+        [[nodiscard]] Range allocate(const void *vertices,
+                                     uint32_t vertexSize,
+                                     uint32_t vertexCount,
+                                     const uint32_t *indices,
+                                     uint32_t indexCount);
+        void free(const Range &range);
+
+        // Has to be called with the frame that's about to start, after the renderer has waited for the oldest one in flight
+        void beginFrame(uint64_t frame);
+
+        void bind(VkCommandBuffer commandBuffer, uint32_t chunk) const;
+
+        [[nodiscard]] Stats getStats() const;
+    private:
+        // First fit over the free ranges, sorted by where they start, so neighbours are easy to merge
+        class RangeAllocator {
+        public:
+            explicit RangeAllocator(uint32_t capacity);
+
+            bool allocate(uint32_t count, uint32_t &first);
+            void free(uint32_t first, uint32_t count);
+
+            [[nodiscard]] uint32_t getCapacity() const { return capacity; }
+            [[nodiscard]] uint32_t getUsed() const { return used; }
+        private:
+            std::map<uint32_t, uint32_t> freeRanges; // First element, element count
+            uint32_t capacity;
+            uint32_t used = 0;
+        };
+
+        struct Chunk {
+            uint32_t vertexSize;
+            VkIndexType indexType;
+            std::unique_ptr<Buffer> vertexBuffer;
+            std::unique_ptr<Buffer> indexBuffer;
+            RangeAllocator vertices;
+            RangeAllocator indices;
+        };
+
+        struct PendingFree {
+            Range range;
+            uint64_t releaseFrame; // Nothing before it can be using the range anymore
+        };
+
+        Device &device;
+
+        std::vector<Chunk> chunks;
+        std::vector<PendingFree> pendingFrees;
+        uint64_t currentFrame = 0;
+
+        Chunk &createChunk(uint32_t vertexSize, VkIndexType indexType, uint32_t vertexCapacity, uint32_t indexCapacity);
+        [[nodiscard]] static VkDeviceSize getIndexSize(VkIndexType indexType) {
+            return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
+        void release(const Range &range);
+    };
+}
+
+#endif
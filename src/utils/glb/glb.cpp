@@ -0,0 +1,267 @@
+#include "glb.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <iostream>
+#include <stdexcept>
+
+namespace Engine {
+    namespace {
+        constexpr uint32_t MAGIC = 0x46546c67; // "glTF"
+        constexpr uint32_t VERSION = 2;
+        constexpr uint32_t CHUNK_JSON = 0x4e4f534a;
+        constexpr uint32_t CHUNK_BIN = 0x004e4942;
+
+        constexpr uint32_t TYPE_BYTE = 5120;
+        constexpr uint32_t TYPE_UNSIGNED_BYTE = 5121;
+        constexpr uint32_t TYPE_SHORT = 5122;
+        constexpr uint32_t TYPE_UNSIGNED_SHORT = 5123;
+        constexpr uint32_t TYPE_UNSIGNED_INT = 5125;
+        constexpr uint32_t TYPE_FLOAT = 5126;
+
+        constexpr uint32_t MODE_TRIANGLES = 4;
+
+        uint32_t getComponentSize(const uint32_t componentType) {
+            switch (componentType) {
+                case TYPE_BYTE: case TYPE_UNSIGNED_BYTE: return 1;
+                case TYPE_SHORT: case TYPE_UNSIGNED_SHORT: return 2;
+                case TYPE_UNSIGNED_INT: case TYPE_FLOAT: return 4;
+                default: return 0;
+            }
+        }
+
+        uint32_t getComponentCount(const std::string &type) {
+            if (type == "SCALAR") return 1;
+            if (type == "VEC2") return 2;
+            if (type == "VEC3") return 3;
+            if (type == "VEC4") return 4;
+            return 0; // We don't need matrices for anything
+        }
+
+        template<typename T>
+        T read(const std::byte *data) {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        }
+    }
+
+    GlbFile::GlbFile(const std::filesystem::path &path) : path(path), file(path) {
+        ZoneScoped;
+        if (!file.isOpen()) throw std::runtime_error("Failed to open " + path.string() + "!");
+
+        // 12 byte header, then the JSON chunk, then (optionally) the BIN one, each with an 8 byte header of its own
+        const std::byte *data = file.getData();
+        if (file.getSize() < 20) fail("too small to be a GLB file");
+        if (read<uint32_t>(data) != MAGIC) fail("not a GLB file");
+        if (read<uint32_t>(data + 4) != VERSION) fail("only glTF 2.0 is supported");
+        const uint64_t length = read<uint32_t>(data + 8);
+        if (length > file.getSize()) fail("truncated file");
+
+        const uint64_t jsonLength = read<uint32_t>(data + 12);
+        if (read<uint32_t>(data + 16) != CHUNK_JSON) fail("the first chunk has to be the JSON one");
+        if (20 + jsonLength > length) fail("truncated JSON chunk");
+        json = Json::parse({reinterpret_cast<const char *>(data + 20), static_cast<size_t>(jsonLength)});
+
+        // Chunks are padded to 4 bytes, so the BIN chunk is always 4 byte aligned too
+        if (const uint64_t binHeader = 20 + ((jsonLength + 3) & ~uint64_t{3}); binHeader + 8 <= length) {
+            const uint64_t binLength = read<uint32_t>(data + binHeader);
+            if (read<uint32_t>(data + binHeader + 4) != CHUNK_BIN) fail("the second chunk has to be the BIN one");
+            if (binHeader + 8 + binLength > length) fail("truncated BIN chunk");
+            bin = {data + binHeader + 8, static_cast<size_t>(binLength)};
+        }
+
+        const Json &meshes = json["meshes"];
+        for (size_t mesh = 0; mesh < meshes.size(); mesh++) {
+            const std::string &meshName = meshes[mesh]["name"].getString();
+            const Json &meshPrimitives = meshes[mesh]["primitives"];
+            for (size_t primitive = 0; primitive < meshPrimitives.size(); primitive++) {
+                loadPrimitive(meshPrimitives[primitive],
+                              (meshName.empty() ? std::to_string(mesh) : meshName) + "/" + std::to_string(primitive));
+            }
+        }
+    }
+
+    void GlbFile::fail(const std::string &reason) const {
+        throw std::runtime_error("Failed to load " + path.string() + ", " + reason + "!");
+    }
+
+    uint32_t GlbFile::getIndex(const Json &value, const char *what) const {
+        const double number = value.getNumber(-1.0);
+        if (number < 0.0 || number > static_cast<double>(UINT32_MAX) || number != std::floor(number))
+            fail(std::string("invalid ") + what);
+        return static_cast<uint32_t>(number);
+    }
+
+    GlbFile::Accessor GlbFile::getAccessor(const uint32_t index) const {
+        const Json &accessor = json["accessors"][index];
+        if (!accessor.isObject()) fail("missing accessor " + std::to_string(index));
+        if (accessor.contains("sparse")) fail("sparse accessors aren't supported");
+        if (!accessor.contains("bufferView")) fail("accessors without a buffer view aren't supported");
+
+        Accessor result{};
+        result.bufferView = getIndex(accessor["bufferView"], "buffer view");
+        result.count = getIndex(accessor["count"], "accessor count");
+        result.componentType = getIndex(accessor["componentType"], "component type");
+        result.componentCount = getComponentCount(accessor["type"].getString());
+        result.normalized = accessor["normalized"].getBool();
+        const uint32_t componentSize = getComponentSize(result.componentType);
+        if (result.count == 0 || componentSize == 0 || result.componentCount == 0)
+            fail("unsupported accessor " + std::to_string(index));
+
+        const Json &view = json["bufferViews"][result.bufferView];
+        if (!view.isObject()) fail("missing buffer view " + std::to_string(result.bufferView));
+        // The BIN chunk is always the first buffer, and the only one we can get at
+        const uint32_t buffer = getIndex(view["buffer"], "buffer");
+        if (buffer != 0 || json["buffers"][0u].contains("uri")) fail("only self contained GLB files are supported");
+
+        // Offsets default to 0, and the stride to tightly packed
+        const uint64_t viewOffset = view.contains("byteOffset") ? getIndex(view["byteOffset"], "view offset") : 0;
+        const uint64_t viewLength = getIndex(view["byteLength"], "view length");
+        if (viewOffset + viewLength > bin.size())
+            fail("buffer view " + std::to_string(result.bufferView) + " is out of bounds");
+
+        const uint64_t offset = accessor.contains("byteOffset") ? getIndex(accessor["byteOffset"], "offset") : 0;
+        const uint32_t elementSize = componentSize * result.componentCount;
+        result.stride = view.contains("byteStride") ? getIndex(view["byteStride"], "view stride") : elementSize;
+        if (result.stride < elementSize ||
+            result.stride % componentSize != 0 ||
+            (viewOffset + offset) % componentSize != 0) fail("misaligned accessor " + std::to_string(index));
+        if (offset + uint64_t{result.stride} * (result.count - 1) + elementSize > viewLength)
+            fail("accessor " + std::to_string(index) + " is out of bounds");
+
+        result.data = bin.data() + viewOffset + offset;
+        return result;
+    }
+
+    void GlbFile::loadPrimitive(const Json &primitive, const std::string &name) {
+        if (primitive.contains("mode") && getIndex(primitive["mode"], "primitive mode") != MODE_TRIANGLES) {
+            std::cerr << "Skipping " << name << " in " << path.string() << ", it isn't made of triangles" << std::endl;
+            return;
+        }
+
+        const Json &attributes = primitive["attributes"];
+        if (!attributes.contains("POSITION")) fail(name + " has no positions");
+        const Accessor position = getAccessor(getIndex(attributes["POSITION"], "position accessor"));
+        if (position.componentType != TYPE_FLOAT || position.componentCount != 3) fail(name + " has invalid positions");
+        if (position.count < 3) fail(name + " has less than 3 vertices");
+
+        // Anything the engine can't take straight away gets converted to floats
+        const auto getAttribute = [&](const char *attribute, const uint32_t minCount, const uint32_t maxCount) {
+            std::optional<Accessor> accessor;
+            if (!attributes.contains(attribute)) return accessor;
+            accessor = getAccessor(getIndex(attributes[attribute], "attribute accessor"));
+            if (accessor->count != position.count) fail(name + " has a different amount of each attribute");
+            if (accessor->componentCount < minCount || accessor->componentCount > maxCount ||
+                (accessor->componentType != TYPE_FLOAT && !(accessor->normalized &&
+                                                           (accessor->componentType == TYPE_UNSIGNED_BYTE ||
+                                                            accessor->componentType == TYPE_UNSIGNED_SHORT))))
+                fail(name + " has an unsupported " + attribute);
+            return accessor;
+        };
+        const std::optional<Accessor> color = getAttribute("COLOR_0", 3, 4);
+        const std::optional<Accessor> normal = getAttribute("NORMAL", 3, 3);
+        const std::optional<Accessor> texCoord = getAttribute("TEXCOORD_0", 2, 2);
+        if (normal && normal->componentType != TYPE_FLOAT) fail(name + " has an unsupported NORMAL");
+
+        Primitive result{};
+        result.name = name;
+        // The texture coordinates stay the way glTF has them, starting at the top, Model::View knows to flip them back
+        if (const Model::Vertex *mapped = findMappedVertices(position,
+                                                             color ? &*color : nullptr,
+                                                             normal ? &*normal : nullptr,
+                                                             texCoord ? &*texCoord : nullptr)) {
+            result.vertices = {mapped, position.count};
+            result.mappedVertices = true;
+        } else {
+            const auto readComponent = [](const Accessor &accessor, const uint32_t element, const uint32_t component) {
+                const std::byte *data = accessor.data + size_t{element} * accessor.stride;
+                switch (accessor.componentType) {
+                    case TYPE_UNSIGNED_BYTE: return static_cast<float>(read<uint8_t>(data + component)) / 255.0f;
+                    case TYPE_UNSIGNED_SHORT:
+                        return static_cast<float>(read<uint16_t>(data + 2 * component)) / 65535.0f;
+                    default: return read<float>(data + 4 * component);
+                }
+            };
+            const auto readVector = [&readComponent]<glm::length_t L>(const Accessor &accessor,
+                                                                       const uint32_t element,
+                                                                       glm::vec<L, float> &value) {
+                for (glm::length_t i = 0; i < L; i++)
+                    value[i] = readComponent(accessor, element, static_cast<uint32_t>(i));
+            };
+
+            std::vector<Model::Vertex> &vertices = convertedVertices.emplace_back(position.count);
+            for (uint32_t i = 0; i < position.count; i++) {
+                Model::Vertex &vertex = vertices[i];
+                vertex.color = glm::vec3{1.0f}; // Same as the OBJ loader, when there are no colors
+                readVector(position, i, vertex.position);
+                if (color) readVector(*color, i, vertex.color); // Alpha gets dropped, there's nowhere to put it
+                if (normal) readVector(*normal, i, vertex.normal);
+                if (texCoord) readVector(*texCoord, i, vertex.texCoord);
+            } result.vertices = vertices;
+        }
+
+        if (!primitive.contains("indices")) {
+            if (position.count % 3 != 0) fail(name + " doesn't have a whole number of triangles");
+            primitives.push_back(std::move(result));
+            return;
+        }
+
+        const Accessor indices = getAccessor(getIndex(primitive["indices"], "index accessor"));
+        if (indices.componentCount != 1 || (indices.componentType != TYPE_UNSIGNED_BYTE &&
+                                            indices.componentType != TYPE_UNSIGNED_SHORT &&
+                                            indices.componentType != TYPE_UNSIGNED_INT))
+            fail(name + " has invalid indices");
+        if (indices.count < 3 || indices.count % 3 != 0) fail(name + " doesn't have a whole number of triangles");
+
+        const auto readIndex = [&indices](const uint32_t i) -> uint32_t {
+            const std::byte *data = indices.data + size_t{i} * indices.stride;
+            switch (indices.componentType) {
+                case TYPE_UNSIGNED_BYTE: return read<uint8_t>(data);
+                case TYPE_UNSIGNED_SHORT: return read<uint16_t>(data);
+                default: return read<uint32_t>(data);
+            }
+        };
+        // Checked either way, a bad index would have the GPU reading whatever's next to the vertices
+        for (uint32_t i = 0; i < indices.count; i++)
+            if (readIndex(i) >= position.count) fail(name + " has an index out of bounds");
+
+        if (indices.componentType == TYPE_UNSIGNED_INT && indices.stride == sizeof(uint32_t) &&
+            reinterpret_cast<uintptr_t>(indices.data) % alignof(uint32_t) == 0) {
+            result.indices = {reinterpret_cast<const uint32_t *>(indices.data), indices.count};
+            result.mappedIndices = true;
+        } else {
+            std::vector<uint32_t> &converted = convertedIndices.emplace_back(indices.count);
+            for (uint32_t i = 0; i < indices.count; i++) converted[i] = readIndex(i);
+            result.indices = converted;
+        } primitives.push_back(std::move(result));
+    }
+
+    const Model::Vertex *GlbFile::findMappedVertices(const Accessor &position,
+                                                      const Accessor *color,
+                                                      const Accessor *normal,
+                                                      const Accessor *texCoord) const {
+        if (color == nullptr || normal == nullptr || texCoord == nullptr) return nullptr;
+
+        // All four interleaved in the same buffer view, in the same order and with the same types as ours
+        static_assert(offsetof(Model::Vertex, position) == 0, "The vertices are assumed to start at their positions");
+        const auto base = static_cast<size_t>(position.data - bin.data());
+        const auto matches = [&](const Accessor &accessor, const size_t offset, const uint32_t components) {
+            return static_cast<size_t>(accessor.data - bin.data()) == base + offset &&
+                   accessor.bufferView == position.bufferView &&
+                   accessor.componentType == TYPE_FLOAT &&
+                   accessor.componentCount == components &&
+                   accessor.stride == sizeof(Model::Vertex);
+        };
+        if (!matches(position, offsetof(Model::Vertex, position), 3) ||
+            !matches(*color, offsetof(Model::Vertex, color), 3) ||
+            !matches(*normal, offsetof(Model::Vertex, normal), 3) ||
+            !matches(*texCoord, offsetof(Model::Vertex, texCoord), 2)) return nullptr;
+
+        // The whole of every vertex has to be in there, not just the parts the accessors go through
+        if (base + size_t{position.count} * sizeof(Model::Vertex) > bin.size()) return nullptr;
+        if (reinterpret_cast<uintptr_t>(bin.data() + base) % alignof(Model::Vertex) != 0) return nullptr;
+        return reinterpret_cast<const Model::Vertex *>(bin.data() + base);
+    }
+}
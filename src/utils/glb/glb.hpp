@@ -0,0 +1,77 @@
+#ifndef GLB_HPP
+#define GLB_HPP
+
+#include <span>
+#include <deque>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "../json/json.hpp"
+#include "../model/model.hpp"
+#include "../mappedfile/mappedfile.hpp"
+
+namespace Engine {
+    // A binary glTF 2.0 file, memory mapped, with every triangle primitive of every mesh checked and ready to become a
+    // Model. Primitives whose buffer views already have the same layout as Model::Vertex (or 32 bit indices) point
+    // straight into the mapping, and anything else gets converted into vectors of its own. glTF's texture coordinates
+    // are upside down compared to ours, but that gets flipped at draw time, so it doesn't stop anything being mapped.
+    // Only self contained files, so everything has to be in the BIN chunk. Node transforms, materials and anything
+    // that isn't a triangle list are ignored, and the primitives get uploaded as they are, without LODs or meshlets.
+    class GlbFile {
+    public:
+        struct Primitive {
+            std::string name; // The mesh's name (or index), with the primitive's index after it
+            std::span<const Model::Vertex> vertices;
+            std::span<const uint32_t> indices; // Empty if it isn't indexed
+            // Whether either of the above point into the file, for the stats
+            bool mappedVertices = false;
+            bool mappedIndices = false;
+
+            [[nodiscard]] Model::View getView(const bool compressed = false) const {
+                return {vertices, indices, {}, {}, compressed, true};
+            }
+        };
+
+        // Throws if the file can't be read, or anything in it doesn't add up
+        explicit GlbFile(const std::filesystem::path &path);
+
+        GlbFile(const GlbFile &) = delete;
+        GlbFile& operator=(const GlbFile &) = delete;
+
+        [[nodiscard]] const std::vector<Primitive> &getPrimitives() const { return primitives; }
+    private:
+        // Where an accessor's elements actually are, after checking they're all inside the BIN chunk
+        struct Accessor {
+            const std::byte *data;
+            uint32_t count;
+            uint32_t stride;
+            uint32_t componentType;
+            uint32_t componentCount;
+            bool normalized;
+            uint32_t bufferView;
+        };
+
+        std::filesystem::path path;
+        MappedFile file;
+        Json json;
+        std::span<const std::byte> bin;
+
+        std::vector<Primitive> primitives;
+        // The converted ones, which the primitives point into. Deques, so they never move once they're in.
+        std::deque<std::vector<Model::Vertex>> convertedVertices;
+        std::deque<std::vector<uint32_t>> convertedIndices;
+
+        [[noreturn]] void fail(const std::string &reason) const;
+        [[nodiscard]] uint32_t getIndex(const Json &value, const char *what) const;
+        [[nodiscard]] Accessor getAccessor(uint32_t index) const;
+        void loadPrimitive(const Json &primitive, const std::string &name);
+        // Null if the attributes aren't laid out exactly like Model::Vertex, one after the other
+        [[nodiscard]] const Model::Vertex *findMappedVertices(const Accessor &position,
+                                                               const Accessor *color,
+                                                               const Accessor *normal,
+                                                               const Accessor *texCoord) const;
+    };
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include "gpuprofiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <span>
+#include <string_view>
+
+namespace Engine {
+    GpuProfiler::GpuProfiler(Device &device, const uint32_t framesInFlight) : device(device), frames(framesInFlight) {
+        if (!device.supportsTimestamps()) {
+            std::cerr << "Timestamp queries are not supported, the GPU profiler won't be available" << std::endl;
+            return;
+        }
+
+        timestampPeriod = device.properties.limits.timestampPeriod;
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device.physicalDevice(), &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device.physicalDevice(), &queueFamilyCount, queueFamilies.data());
+        const uint32_t validBits = queueFamilies[device.findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+        if (validBits > 0 && validBits < 64) timestampMask = (1ull << validBits) - 1;
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = 2 * MAX_SCOPES * framesInFlight; // Start and end of each scope
+
+        if (vkCreateQueryPool(device.device(), &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the profiler query pool!");
+
+        for (FrameQueries &frame : frames) frame.scopes.reserve(MAX_SCOPES);
+        openScopes.reserve(MAX_SCOPES);
+    }
+    GpuProfiler::~GpuProfiler() {
+        if (queryPool != VK_NULL_HANDLE) vkDestroyQueryPool(device.device(), queryPool, nullptr);
+    }
+
+    void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, const uint32_t frameIndex) {
+        assert(frameIndex < frames.size() && "Frame index out of range!");
+        currentFrame = frameIndex;
+        frameStarted = isSupported() && enabled;
+        if (!isSupported()) return;
+
+        // Same as with dynamic resolution, this slot has already been waited on, so the results should be there
+        if (frames[frameIndex].hasResults) readResults(frameIndex);
+        frames[frameIndex].scopes.clear();
+        frames[frameIndex].hasResults = false;
+        openScopes.clear();
+
+        if (frameStarted) vkCmdResetQueryPool(commandBuffer, queryPool, 2 * MAX_SCOPES * frameIndex, 2 * MAX_SCOPES);
+    }
+    void GpuProfiler::endFrame(VkCommandBuffer commandBuffer) {
+        if (!frameStarted) return;
+        assert(openScopes.empty() && "Every GPU profiler scope has to be closed before the end of the frame!");
+        frames[currentFrame].hasResults = !frames[currentFrame].scopes.empty();
+        frameStarted = false;
+    }
+
+    void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char *name) {
+        if (!frameStarted) return;
+
+        std::vector<RecordedScope> &scopes = frames[currentFrame].scopes;
+        if (scopes.size() == MAX_SCOPES) { // Still have to keep track of it, so endScope closes the right one
+            openScopes.push_back(MAX_SCOPES);
+            return;
+        }
+
+        const auto scope = static_cast<uint32_t>(scopes.size());
+        scopes.push_back({name, static_cast<uint32_t>(openScopes.size())});
+        openScopes.push_back(scope);
+        vkCmdWriteTimestamp(commandBuffer,
+                            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                            queryPool,
+                            2 * (MAX_SCOPES * currentFrame + scope));
+    }
+    void GpuProfiler::endScope(VkCommandBuffer commandBuffer) {
+        if (!frameStarted) return;
+        assert(!openScopes.empty() && "Cannot end a GPU profiler scope that hasn't begun!");
+
+        const uint32_t scope = openScopes.back();
+        openScopes.pop_back();
+        if (scope == MAX_SCOPES) return;
+        vkCmdWriteTimestamp(commandBuffer,
+                            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                            queryPool,
+                            2 * (MAX_SCOPES * currentFrame + scope) + 1);
+    }
+
+    bool GpuProfiler::exportCSV(const std::string &path) const {
+        std::ofstream file(path);
+        if (!file) return false;
+
+        file << "scope,depth,last_ms,min_ms,avg_ms,max_ms,samples\n";
+        for (const ScopeStats &scope : stats) {
+            file << scope.name << ',' << scope.depth << ',' << scope.last << ',' << scope.min << ',' << scope.avg << ','
+                 << scope.max << ',' << scope.sampleCount << '\n';
+        } return static_cast<bool>(file);
+    }
+
+    void GpuProfiler::readResults(const uint32_t frameIndex) {
+        const std::vector<RecordedScope> &scopes = frames[frameIndex].scopes;
+        std::array<uint64_t, 2 * MAX_SCOPES> timestamps{};
+        if (vkGetQueryPoolResults(device.device(),
+                                  queryPool,
+                                  2 * MAX_SCOPES * frameIndex,
+                                  2 * static_cast<uint32_t>(scopes.size()),
+                                  sizeof(timestamps),
+                                  timestamps.data(),
+                                  sizeof(uint64_t),
+                                  VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) return; // Better to miss a frame than to wait
+
+        // Add up everything with the same name first, so each scope gets a single sample per frame
+        std::vector<std::pair<const RecordedScope *, float>> frameTimes;
+        frameTimes.reserve(scopes.size());
+        for (size_t i = 0; i < scopes.size(); i++) {
+            const uint64_t ticks = (timestamps[2 * i + 1] - timestamps[2 * i]) & timestampMask;
+            const auto time = static_cast<float>(static_cast<double>(ticks) *
+                                                 static_cast<double>(timestampPeriod) * 1e-6);
+
+            auto it = std::ranges::find_if(frameTimes, [&](const auto &frameTime) {
+                return std::string_view(frameTime.first->name) == scopes[i].name;
+            });
+            if (it == frameTimes.end()) frameTimes.emplace_back(&scopes[i], time);
+            else it->second += time;
+        }
+
+        // New scopes go right after whatever came before them this frame, so the nesting still reads right
+        size_t insertAt = 0;
+        for (const auto &[scope, time] : frameTimes) {
+            auto it = std::ranges::find(stats, std::string_view(scope->name), &ScopeStats::name);
+            if (it == stats.end()) {
+                it = stats.insert(stats.begin() + static_cast<std::ptrdiff_t>(std::min(insertAt, stats.size())),
+                                  ScopeStats{scope->name, scope->depth});
+            } insertAt = static_cast<size_t>(it - stats.begin()) + 1;
+            addSample(*it, time);
+        }
+    }
+
+    void GpuProfiler::addSample(ScopeStats &scope, const float time) {
+        scope.last = time;
+        scope.samples[scope.nextSample] = time;
+        scope.nextSample = (scope.nextSample + 1) % HISTORY;
+        scope.sampleCount = std::min(scope.sampleCount + 1, HISTORY);
+
+        const auto samples = std::span(scope.samples).first(scope.sampleCount);
+        const auto [min, max] = std::ranges::minmax(samples);
+        scope.min = min;
+        scope.max = max;
+        float total = 0.0f;
+        for (const float sample : samples) total += sample;
+        scope.avg = total / static_cast<float>(scope.sampleCount);
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef GPUPROFILER_HPP
+#define GPUPROFILER_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "../device/device.hpp"
+
+namespace Engine {
+    // Measures how long the GPU spends on each part of the frame, with a pair of timestamps around each scope.
+    // Scopes can be nested, and each frame in flight gets its own queries, which we only read back once the renderer
+    // has waited for that frame's slot to be free again, so we never stall the CPU waiting for them.
+    // Scopes with the same name get added together, so a render system drawn twice in one frame shows up once.
+    class GpuProfiler {
+    public:
+        static constexpr uint32_t MAX_SCOPES = 32; // Per frame, anything past this doesn't get measured
+        static constexpr uint32_t HISTORY = 128; // Frames the rolling stats are taken over
+
+        struct ScopeStats {
+            std::string name;
+            uint32_t depth = 0; // How many scopes this one is nested in
+            float last = 0.0f; // All in milliseconds
+            float min = 0.0f;
+            float avg = 0.0f;
+            float max = 0.0f;
+            uint32_t sampleCount = 0;
+            std::array<float, HISTORY> samples{};
+            uint32_t nextSample = 0;
+        };
+
+        bool enabled = true;
+
+        GpuProfiler(Device &device, uint32_t framesInFlight);
+        ~GpuProfiler();
+
+        GpuProfiler(const GpuProfiler &) = delete;
+        GpuProfiler& operator=(const GpuProfiler &) = delete;
+
+        // Both of these have to be recorded outside of any render pass, since they reset the queries
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+        void endFrame(VkCommandBuffer commandBuffer);
+
+        // The name has to outlive the frame, so string literals only, please
+        void beginScope(VkCommandBuffer commandBuffer, const char *name);
+        void endScope(VkCommandBuffer commandBuffer);
+
+        // Returns false if the file couldn't be written
+        [[nodiscard]] bool exportCSV(const std::string &path) const;
+
+        [[nodiscard]] bool isSupported() const { return queryPool != VK_NULL_HANDLE; }
+        // In the order they were first seen, which is also the order they nest in
+        [[nodiscard]] const std::vector<ScopeStats> &getStats() const { return stats; }
+
+        // Ends the scope once it goes out of scope (heh), so we can't forget about it
+        class Scope {
+        public:
+            Scope(GpuProfiler &profiler, VkCommandBuffer commandBuffer, const char *name) :
+                  profiler(profiler), commandBuffer(commandBuffer) { profiler.beginScope(commandBuffer, name); }
+            ~Scope() { profiler.endScope(commandBuffer); }
+
+            Scope(const Scope &) = delete;
+            Scope& operator=(const Scope &) = delete;
+        private:
+            GpuProfiler &profiler;
+            VkCommandBuffer commandBuffer;
+        };
+    private:
+        struct RecordedScope {
+            const char *name;
+            uint32_t depth;
+        };
+
+        struct FrameQueries {
+            std::vector<RecordedScope> scopes; // Scope i uses queries 2 * i and 2 * i + 1
+            bool hasResults = false;
+        };
+
+        Device &device;
+
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        float timestampPeriod = 1.0f; // Nanoseconds per tick
+        uint64_t timestampMask = ~0ull; // Not every queue gives us all 64 bits
+
+        std::vector<FrameQueries> frames;
+        uint32_t currentFrame = 0;
+        bool frameStarted = false;
+        std::vector<uint32_t> openScopes; // Indices into the current frame's scopes, MAX_SCOPES if it didn't fit
+
+        std::vector<ScopeStats> stats;
+
+        void readResults(uint32_t frameIndex);
+        static void addSample(ScopeStats &scope, float time);
+    };
+}
+
+#endif
@@ -2,6 +2,8 @@
 
 #include "image.hpp"
 
+#include <cassert>
+
 namespace Engine {
     Image::Image(Device &device,
                  uint32_t width,
@@ -10,7 +12,8 @@ namespace Engine {
                  VkFormat format,
                  VkImageTiling tiling,
                  VkImageUsageFlags usage,
-                 VkMemoryPropertyFlags properties) :
+                 VkMemoryPropertyFlags properties,
+                 uint32_t mipLevels) :
                  device(device),
                  width(width),
                  height(height),
@@ -18,16 +21,31 @@ namespace Engine {
                  format(format),
                  tiling(tiling),
                  usage(usage),
-                 properties(properties) {
+                 properties(properties),
+                 mipLevels(mipLevels) {
         // This doesn't seem to be neccesary, but I'm leaving it here for now, as to avoid any weird errors.
-        mipLevels = numSamples == VK_SAMPLE_COUNT_1_BIT ? static_cast<uint32_t>(std::floor(std::log2(std::max(width, height))) + 1) : 1;
+        if (this->mipLevels == 0)
+            this->mipLevels = numSamples == VK_SAMPLE_COUNT_1_BIT ? static_cast<uint32_t>(std::floor(std::log2(std::max(width, height))) + 1) : 1;
         createImage();
     }
 
     void Image::del() {
-        if (imageView != nullptr) vkDestroyImageView(device.device(), imageView, nullptr);
-        vkDestroyImage(device.device(), image, nullptr);
-        vkFreeMemory(device.device(), imageMemory, nullptr);
+        // This can get called both explicitly and by the destructor, so make sure we only free everything once
+        if (imageView != VK_NULL_HANDLE) vkDestroyImageView(device.device(), imageView, nullptr);
+        if (image != VK_NULL_HANDLE) vkDestroyImage(device.device(), image, nullptr);
+        device.getAllocator().free(imageMemory); // Does nothing if it's already been freed
+        imageView = VK_NULL_HANDLE;
+        image = VK_NULL_HANDLE;
+    }
+
+    VkDeviceSize Image::getMemorySize() const {
+        if (!lazilyAllocated || imageMemory.memory == VK_NULL_HANDLE) return memorySize;
+
+        // Lazily allocated memory might never actually get backed, so ask the driver how much it really committed
+        // (the allocator always gives these a dedicated allocation, so it's all ours)
+        VkDeviceSize committed = 0;
+        vkGetDeviceMemoryCommitment(device.device(), imageMemory.memory, &committed);
+        return committed;
     }
 
     void Image::createImage () {
@@ -52,16 +70,17 @@ namespace Engine {
 
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(device.device(), image, &memRequirements);
+        memorySize = memRequirements.size;
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = device.findMemoryType(memRequirements.memoryTypeBits, properties);
+        std::optional<uint32_t> memoryType = device.tryFindMemoryType(memRequirements.memoryTypeBits, properties);
+        if (!memoryType && (properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+            // Lazily allocated memory is pretty much only a thing on tiled (mobile) GPUs, so fall back to regular memory
+            properties &= ~static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+            memoryType = device.tryFindMemoryType(memRequirements.memoryTypeBits, properties);
+        } if (!memoryType) throw std::runtime_error("Failed to find any suitable memory type for the image!");
+        lazilyAllocated = (properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
 
-        if (vkAllocateMemory(device.device(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-            throw std::runtime_error("Failed to allocate the image memory!");
-
-        vkBindImageMemory(device.device(), image, imageMemory, 0);
+        imageMemory = device.getAllocator().allocateForImage(image, properties, tiling == VK_IMAGE_TILING_LINEAR);
     }
 
     void Image::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout) {
@@ -110,9 +129,12 @@ namespace Engine {
 
     void Image::copyBufferToImage(VkBuffer buffer) {
         VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-
+        recordCopyFromBuffer(commandBuffer, buffer);
+        device.endSingleTimeCommands(commandBuffer);
+    }
+    void Image::recordCopyFromBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) const {
         VkBufferImageCopy region{};
-        region.bufferOffset = 0;
+        region.bufferOffset = offset;
         region.bufferRowLength = 0;
         region.bufferImageHeight = 0;
 
@@ -134,20 +156,52 @@ namespace Engine {
                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                1,
                                &region);
+    }
 
-        device.endSingleTimeCommands(commandBuffer);
+    void Image::recordCopyMipsFromBuffer(VkCommandBuffer commandBuffer,
+                                         VkBuffer buffer,
+                                         std::span<const VkDeviceSize> mipOffsets) const {
+        assert(mipOffsets.size() == mipLevels && "Every mip level needs to be in the buffer!");
+        std::vector<VkBufferImageCopy> regions(mipLevels);
+        for (uint32_t level = 0; level < mipLevels; level++) {
+            VkBufferImageCopy &region = regions[level];
+            region.bufferOffset = mipOffsets[level];
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+
+            // Compressed mips smaller than a block still use their real size, since they're at the edge of the image
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {std::max(1u, width >> level), std::max(1u, height >> level), 1};
+        }
+
+        vkCmdCopyBufferToImage(commandBuffer,
+                               buffer,
+                               image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               mipLevels,
+                               regions.data());
     }
 
-    // Based on https://vulkan-tutorial.com/Generating_Mipmaps
-    // TODO(Dory): Make this work with pre-generated textures.
     void Image::generateMipmaps () {
-        // Check if image format supports linear blitting
-        VkFormatProperties formatProperties;
-        formatProperties = device.getFormatProperties(format);
-        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
-            throw std::runtime_error("Texture image format does not support linear blitting!");
-
         VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        recordGenerateMipmaps(commandBuffer);
+        device.endSingleTimeCommands(commandBuffer);
+    }
+    // Based on https://vulkan-tutorial.com/Generating_Mipmaps
+    // Pre-generated mips (like the ones in KTX2 files) skip this, and go through recordCopyMipsFromBuffer instead
+    void Image::recordGenerateMipmaps(VkCommandBuffer commandBuffer) const {
+        // Check if image format supports linear blitting, from and to itself
+        constexpr VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                                                      VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                                      VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        const VkFormatProperties formatProperties = device.getFormatProperties(format);
+        if ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures)
+            throw std::runtime_error("Texture image format does not support linear blitting!");
 
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -221,8 +275,6 @@ namespace Engine {
                              0, nullptr,
                              0, nullptr,
                              1, &barrier);
-
-        device.endSingleTimeCommands(commandBuffer);
     }
 
     VkImageView Image::createImageView(VkImageAspectFlags aspectFlags) {
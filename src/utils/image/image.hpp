@@ -3,6 +3,7 @@
 
 #include <stb_image.h>
 
+#include <span>
 #include <stdexcept>
 #include <cstdint>
 #include <memory>
@@ -23,7 +24,8 @@ namespace Engine {
               VkFormat format,
               VkImageTiling tiling,
               VkImageUsageFlags usage,
-              VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+              VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+              uint32_t mipLevels = 0); // 0 means a full mip chain for single-sampled images
         ~Image() { del(); }
 
         Image(const Image &) = delete;
@@ -31,20 +33,33 @@ namespace Engine {
         Image(Image &&) = delete;
         Image& operator=(Image &&) = delete;
 
+        [[nodiscard]] VkImage getImage() const { return image; }
+        [[nodiscard]] VkFormat getFormat() const { return format; }
+        [[nodiscard]] uint32_t getWidth() const { return width; }
+        [[nodiscard]] uint32_t getHeight() const { return height; }
         [[nodiscard]] uint32_t getMipLevels() const { return mipLevels; }
+        [[nodiscard]] VkDeviceSize getMemorySize() const;
 
         void del();
 
         void transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
         void copyBufferToImage(VkBuffer buffer);
         void generateMipmaps();
+        // Same as the two above, but recorded into a command buffer of our own, instead of waiting for them right away
+        void recordCopyFromBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset = 0) const;
+        void recordGenerateMipmaps(VkCommandBuffer commandBuffer) const;
+        // For mips that were generated ahead of time instead, each one mipOffsets[level] bytes into the buffer, tightly
+        // packed, all in a single copy
+        void recordCopyMipsFromBuffer(VkCommandBuffer commandBuffer,
+                                      VkBuffer buffer,
+                                      std::span<const VkDeviceSize> mipOffsets) const;
         VkImageView createImageView(VkImageAspectFlags aspectFlags);
     private:
         Device &device;
 
-        VkImage image;
-        VkImageView imageView = nullptr;
-        VkDeviceMemory imageMemory;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView imageView = VK_NULL_HANDLE;
+        MemoryAllocator::Allocation imageMemory{};
 
         uint32_t width;
         uint32_t height;
@@ -56,6 +71,8 @@ namespace Engine {
         VkMemoryPropertyFlags properties;
 
         uint32_t mipLevels;
+        VkDeviceSize memorySize = 0; // What the driver actually asked us for, not just width * height * texel size
+        bool lazilyAllocated = false;
 
         void createImage();
     };
@@ -0,0 +1,211 @@
+#include "inflater.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Engine {
+    namespace {
+        constexpr uint32_t LENGTH_CODES = 286;
+        constexpr uint32_t DISTANCE_CODES = 30;
+        constexpr uint32_t END_OF_BLOCK = 256;
+
+        constexpr std::array<uint16_t, 29> LENGTH_BASES{3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        constexpr std::array<uint8_t, 29> LENGTH_EXTRA_BITS{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        constexpr std::array<uint16_t, 30> DISTANCE_BASES{1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                                          257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                                          8193, 12289, 16385, 24577};
+        constexpr std::array<uint8_t, 30> DISTANCE_EXTRA_BITS{0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                                              7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        // The order the lengths of the code length code come in, most likely to be used first
+        constexpr std::array<uint8_t, 19> CODE_LENGTH_ORDER{16, 17, 18, 0, 8, 7, 9, 6, 10, 5,
+                                                            11, 4, 12, 3, 13, 2, 14, 1, 15};
+    }
+
+    Inflater::Inflater(const std::byte *data, const size_t size) : data(data), size(size), window(WINDOW_SIZE) {}
+
+    size_t Inflater::read(char *out, const size_t count) {
+        size_t produced = 0;
+        const auto put = [&](const char c) {
+            out[produced++] = c;
+            window[windowPosition] = c;
+            windowPosition = (windowPosition + 1) & (WINDOW_SIZE - 1);
+            total++;
+        };
+
+        while (produced < count) {
+            if (matchLength > 0) {
+                // Matches can overlap what they're writing, so this has to go a byte at a time
+                for (; matchLength > 0 && produced < count; matchLength--)
+                    put(window[(windowPosition - matchDistance) & (WINDOW_SIZE - 1)]);
+            } else if (block == Block::STORED) {
+                for (; storedRemaining > 0 && produced < count; storedRemaining--) put(static_cast<char>(bits(8)));
+                if (storedRemaining == 0) block = Block::NONE;
+            } else if (block == Block::HUFFMAN) {
+                const uint32_t symbol = decode(lengthCodes);
+                if (symbol < END_OF_BLOCK) {
+                    put(static_cast<char>(symbol));
+                    continue;
+                } if (symbol == END_OF_BLOCK) {
+                    block = Block::NONE;
+                    continue;
+                } if (symbol >= LENGTH_CODES) throw std::runtime_error("Failed to inflate, invalid length!");
+
+                const uint32_t length = symbol - END_OF_BLOCK - 1;
+                matchLength = LENGTH_BASES[length] + bits(LENGTH_EXTRA_BITS[length]);
+                const uint32_t distance = decode(distanceCodes);
+                if (distance >= DISTANCE_CODES) throw std::runtime_error("Failed to inflate, invalid distance!");
+                matchDistance = DISTANCE_BASES[distance] + bits(DISTANCE_EXTRA_BITS[distance]);
+                if (matchDistance > total)
+                    throw std::runtime_error("Failed to inflate, a match points before the start!");
+            } else if (lastBlock) break;
+            else beginBlock();
+        } return produced;
+    }
+
+    // Everything but the Huffman codes comes least significant bit first
+    uint32_t Inflater::bits(const uint32_t count) {
+        while (bitCount < count) {
+            if (offset == size) throw std::runtime_error("Failed to inflate, the data ends too soon!");
+            bitBuffer |= static_cast<uint32_t>(data[offset++]) << bitCount;
+            bitCount += 8;
+        }
+
+        const uint32_t value = bitBuffer & ((1u << count) - 1);
+        bitBuffer >>= count;
+        bitCount -= count;
+        return value;
+    }
+
+    uint32_t Inflater::decode(const Huffman &huffman) {
+        // Running out of data here is fine, as long as the code is short enough that it didn't need any more of it
+        while (bitCount <= 24 && offset < size) {
+            bitBuffer |= static_cast<uint32_t>(data[offset++]) << bitCount;
+            bitCount += 8;
+        }
+        if (const uint16_t entry = huffman.fast[bitBuffer & ((1u << FAST_BITS) - 1)];
+            entry != 0 && entry >> FAST_BITS <= bitCount) {
+            bitBuffer >>= entry >> FAST_BITS;
+            bitCount -= entry >> FAST_BITS;
+            return entry & ((1u << FAST_BITS) - 1);
+        }
+
+        // Codes of each length are consecutive, so once the code is less than the last one of its length, that's it
+        uint32_t code = 0;
+        uint32_t first = 0;
+        uint32_t index = 0;
+        for (uint32_t length = 1; length <= MAX_BITS; length++) {
+            code |= bits(1);
+            const uint32_t count = huffman.counts[length];
+            if (code - first < count) return huffman.symbols[index + code - first];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        } throw std::runtime_error("Failed to inflate, invalid Huffman code!");
+    }
+
+    void Inflater::beginBlock() {
+        lastBlock = bits(1) != 0;
+        switch (bits(2)) {
+            case 0: {
+                bits(bitCount % 8); // Stored blocks start on a byte
+                const uint32_t length = bits(16);
+                if (bits(16) != (~length & 0xffff)) throw std::runtime_error("Failed to inflate, broken stored block!");
+                storedRemaining = length;
+                block = Block::STORED;
+                break;
+            } case 1: {
+                std::array<uint8_t, 288> lengths{};
+                std::fill(lengths.begin(), lengths.begin() + 144, 8);
+                std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+                std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+                std::fill(lengths.begin() + 280, lengths.end(), 8);
+                lengthCodes.build(lengths.data(), static_cast<uint32_t>(lengths.size()));
+                std::fill(lengths.begin(), lengths.begin() + DISTANCE_CODES, 5);
+                distanceCodes.build(lengths.data(), DISTANCE_CODES);
+                block = Block::HUFFMAN;
+                break;
+            } case 2:
+                readDynamicCodes();
+                block = Block::HUFFMAN;
+                break;
+            default:
+                throw std::runtime_error("Failed to inflate, invalid block type!");
+        }
+    }
+
+    // The lengths of both codes, which are Huffman coded themselves, with a few codes for runs of the same length
+    void Inflater::readDynamicCodes() {
+        const uint32_t lengthCount = bits(5) + 257;
+        const uint32_t distanceCount = bits(5) + 1;
+        const uint32_t codeLengthCount = bits(4) + 4;
+        if (lengthCount > LENGTH_CODES || distanceCount > DISTANCE_CODES)
+            throw std::runtime_error("Failed to inflate, too many codes!");
+
+        std::array<uint8_t, CODE_LENGTH_ORDER.size()> codeLengthLengths{};
+        for (uint32_t i = 0; i < codeLengthCount; i++)
+            codeLengthLengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(bits(3));
+        Huffman codeLengthCodes;
+        codeLengthCodes.build(codeLengthLengths.data(), static_cast<uint32_t>(codeLengthLengths.size()));
+
+        std::array<uint8_t, LENGTH_CODES + DISTANCE_CODES> lengths{};
+        for (uint32_t i = 0; i < lengthCount + distanceCount;) {
+            const uint32_t symbol = decode(codeLengthCodes);
+            if (symbol < 16) {
+                lengths[i++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+
+            uint8_t length = 0;
+            uint32_t repeat;
+            if (symbol == 16) {
+                if (i == 0) throw std::runtime_error("Failed to inflate, a repeat with nothing to repeat!");
+                length = lengths[i - 1];
+                repeat = 3 + bits(2);
+            } else if (symbol == 17) repeat = 3 + bits(3);
+            else repeat = 11 + bits(7);
+            if (i + repeat > lengthCount + distanceCount)
+                throw std::runtime_error("Failed to inflate, too many lengths!");
+            for (; repeat > 0; repeat--) lengths[i++] = length;
+        } if (lengths[END_OF_BLOCK] == 0) throw std::runtime_error("Failed to inflate, a block can't end!");
+
+        lengthCodes.build(lengths.data(), lengthCount);
+        distanceCodes.build(lengths.data() + lengthCount, distanceCount);
+    }
+
+    void Inflater::Huffman::build(const uint8_t *lengths, const uint32_t count) {
+        counts.fill(0);
+        fast.fill(0);
+        for (uint32_t symbol = 0; symbol < count; symbol++) counts[lengths[symbol]]++;
+        counts[0] = 0;
+
+        // Codes that don't get used are fine (it's common for distances), but there can't be more than fit
+        int32_t left = 1;
+        for (uint32_t length = 1; length <= MAX_BITS; length++) {
+            left = (left << 1) - counts[length];
+            if (left < 0) throw std::runtime_error("Failed to inflate, too many Huffman codes!");
+        }
+
+        // The symbols sorted by length, and then by symbol, which is also the order their codes go in
+        std::array<uint16_t, MAX_BITS + 2> offsets{};
+        std::array<uint32_t, MAX_BITS + 1> nextCodes{};
+        for (uint32_t length = 1; length <= MAX_BITS; length++) {
+            offsets[length + 1] = static_cast<uint16_t>(offsets[length] + counts[length]);
+            nextCodes[length] = (nextCodes[length - 1] + counts[length - 1]) << 1;
+        }
+        for (uint32_t symbol = 0; symbol < count; symbol++) {
+            const uint32_t length = lengths[symbol];
+            if (length == 0) continue;
+            symbols[offsets[length]++] = static_cast<uint16_t>(symbol);
+            if (length > FAST_BITS) continue;
+
+            // The bits come out backwards, so the table's indexed by the reversed code, with anything after it
+            const uint32_t code = nextCodes[length]++;
+            uint32_t reversed = 0;
+            for (uint32_t bit = 0; bit < length; bit++) reversed |= (code >> bit & 1) << (length - 1 - bit);
+            for (uint32_t i = reversed; i < fast.size(); i += 1u << length)
+                fast[i] = static_cast<uint16_t>(length << FAST_BITS | symbol);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef INFLATER_HPP
+#define INFLATER_HPP
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace Engine {
+    // Raw DEFLATE (no zlib header), inflated into whatever buffer it's handed a piece at a time, so unlike stb's, the
+    // whole thing never has to be in memory at once. It only keeps the last 32K it produced, since that's as far back
+    // as a match can point. Throws if the data's broken.
+    class Inflater {
+    public:
+        // The data has to stay alive for as long as this does
+        Inflater(const std::byte *data, size_t size);
+
+        // Fills as much of out as it can, returning how much that was, which is only ever less than count at the end
+        size_t read(char *out, size_t count);
+    private:
+        static constexpr uint32_t WINDOW_SIZE = 32 * 1024;
+        static constexpr uint32_t MAX_BITS = 15;
+        static constexpr uint32_t FAST_BITS = 9;
+
+        // Canonical Huffman codes. Anything up to FAST_BITS long comes straight out of a table, the rest get decoded a
+        // bit at a time, like zlib's puff does.
+        struct Huffman {
+            std::array<uint16_t, 1 << FAST_BITS> fast{}; // Length << FAST_BITS | symbol, 0 if it's longer than that
+            std::array<uint16_t, MAX_BITS + 1> counts{};
+            std::array<uint16_t, 288> symbols{};
+
+            void build(const uint8_t *lengths, uint32_t count);
+        };
+
+        enum class Block { NONE, STORED, HUFFMAN };
+
+        const std::byte *data;
+        size_t size;
+        size_t offset = 0;
+        uint32_t bitBuffer = 0;
+        uint32_t bitCount = 0;
+
+        std::vector<char> window;
+        uint32_t windowPosition = 0;
+        uint64_t total = 0; // Matches can't point before the start
+
+        Block block = Block::NONE;
+        bool lastBlock = false;
+        uint32_t storedRemaining = 0;
+        // A match that didn't fit in the last read
+        uint32_t matchLength = 0;
+        uint32_t matchDistance = 0;
+        Huffman lengthCodes;
+        Huffman distanceCodes;
+
+        uint32_t bits(uint32_t count);
+        uint32_t decode(const Huffman &huffman);
+        void beginBlock();
+        void readDynamicCodes();
+    };
+}
+
+#endif
@@ -0,0 +1,202 @@
+#include "json.hpp"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace Engine {
+    namespace {
+        const Json NULL_JSON{};
+    }
+
+    // Plain recursive descent, straight over the text
+    class JsonParser {
+    public:
+        explicit JsonParser(const std::string_view text) : text(text) {}
+
+        Json parseDocument() {
+            Json value = parseValue(0);
+            skipWhitespace();
+            if (position != text.size()) fail("unexpected data after the end");
+            return value;
+        }
+    private:
+        std::string_view text;
+        size_t position = 0;
+
+        [[noreturn]] void fail(const std::string &reason) const {
+            throw std::runtime_error("Failed to parse JSON at " + std::to_string(position) + ", " + reason + "!");
+        }
+
+        void skipWhitespace() {
+            while (position < text.size()) {
+                const char c = text[position];
+                if (c != ' ' && c != '\t' && c != '\n' && c != '\r') return;
+                position++;
+            }
+        }
+
+        [[nodiscard]] char peek() const { return position < text.size() ? text[position] : '\0'; }
+
+        void expect(const char c) {
+            if (peek() != c) fail(std::string("expected '") + c + "'");
+            position++;
+        }
+
+        bool consume(const std::string_view word) {
+            if (text.substr(position, word.size()) != word) return false;
+            position += word.size();
+            return true;
+        }
+
+        Json parseValue(const uint32_t depth) {
+            if (depth > Json::MAX_DEPTH) fail("nested too deep");
+            skipWhitespace();
+
+            Json value{};
+            switch (peek()) {
+                case '{': parseObject(value, depth); break;
+                case '[': parseArray(value, depth); break;
+                case '"':
+                    value.type = Json::Type::String;
+                    value.string = parseString();
+                    break;
+                case 't': case 'f':
+                    value.type = Json::Type::Bool;
+                    value.boolean = consume("true");
+                    if (!value.boolean && !consume("false")) fail("invalid literal");
+                    break;
+                case 'n':
+                    if (!consume("null")) fail("invalid literal");
+                    break;
+                default:
+                    value.type = Json::Type::Number;
+                    value.number = parseNumber();
+            } return value;
+        }
+
+        void parseObject(Json &value, const uint32_t depth) {
+            value.type = Json::Type::Object;
+            expect('{');
+            skipWhitespace();
+            if (peek() == '}') {
+                position++;
+                return;
+            }
+
+            while (true) {
+                skipWhitespace();
+                value.keys.push_back(parseString());
+                skipWhitespace();
+                expect(':');
+                value.values.push_back(parseValue(depth + 1));
+                skipWhitespace();
+                if (peek() == '}') break;
+                expect(',');
+            } position++;
+        }
+
+        void parseArray(Json &value, const uint32_t depth) {
+            value.type = Json::Type::Array;
+            expect('[');
+            skipWhitespace();
+            if (peek() == ']') {
+                position++;
+                return;
+            }
+
+            while (true) {
+                value.values.push_back(parseValue(depth + 1));
+                skipWhitespace();
+                if (peek() == ']') break;
+                expect(',');
+            } position++;
+        }
+
+        double parseNumber() {
+            // from_chars doesn't take a leading plus, and neither does JSON, so that one's fine as is
+            double number = 0.0;
+            const char *begin = text.data() + position;
+            const auto [end, error] = std::from_chars(begin, text.data() + text.size(), number);
+            if (error != std::errc{} || end == begin) fail("invalid number");
+            position += static_cast<size_t>(end - begin);
+            return number;
+        }
+
+        uint32_t parseHex4() {
+            if (position + 4 > text.size()) fail("truncated escape");
+            uint32_t code = 0;
+            const auto [end, error] = std::from_chars(text.data() + position, text.data() + position + 4, code, 16);
+            if (error != std::errc{} || end != text.data() + position + 4) fail("invalid escape");
+            position += 4;
+            return code;
+        }
+
+        static void appendUtf8(std::string &string, const uint32_t code) {
+            if (code < 0x80) string += static_cast<char>(code);
+            else if (code < 0x800) {
+                string += static_cast<char>(0xc0 | code >> 6);
+                string += static_cast<char>(0x80 | (code & 0x3f));
+            } else if (code < 0x10000) {
+                string += static_cast<char>(0xe0 | code >> 12);
+                string += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                string += static_cast<char>(0x80 | (code & 0x3f));
+            } else {
+                string += static_cast<char>(0xf0 | code >> 18);
+                string += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+                string += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                string += static_cast<char>(0x80 | (code & 0x3f));
+            }
+        }
+
+        std::string parseString() {
+            expect('"');
+            std::string string;
+            while (true) {
+                if (position >= text.size()) fail("unterminated string");
+                const char c = text[position++];
+                if (c == '"') return string;
+                if (c != '\\') {
+                    string += c;
+                    continue;
+                }
+
+                if (position >= text.size()) fail("unterminated string");
+                switch (const char escaped = text[position++]) {
+                    case '"': case '\\': case '/': string += escaped; break;
+                    case 'b': string += '\b'; break;
+                    case 'f': string += '\f'; break;
+                    case 'n': string += '\n'; break;
+                    case 'r': string += '\r'; break;
+                    case 't': string += '\t'; break;
+                    case 'u': {
+                        uint32_t code = parseHex4();
+                        // Anything outside the basic plane comes as a surrogate pair
+                        if (code >= 0xd800 && code < 0xdc00 && consume("\\u")) {
+                            const uint32_t low = parseHex4();
+                            if (low < 0xdc00 || low >= 0xe000) fail("invalid surrogate pair");
+                            code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                        } appendUtf8(string, code);
+                        break;
+                    }
+                    default: fail("invalid escape");
+                }
+            }
+        }
+    };
+
+    Json Json::parse(const std::string_view text) { return JsonParser(text).parseDocument(); }
+
+    const Json &Json::operator[](const size_t index) const {
+        return type == Type::Array && index < values.size() ? values[index] : NULL_JSON;
+    }
+
+    const Json &Json::operator[](const std::string_view key) const {
+        for (size_t i = 0; i < keys.size(); i++) if (keys[i] == key) return values[i];
+        return NULL_JSON;
+    }
+
+    bool Json::contains(const std::string_view key) const {
+        for (const std::string &k : keys) if (k == key) return true;
+        return false;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef JSON_HPP
+#define JSON_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace Engine {
+    // Just enough JSON to read the files we import (glTF for now), not meant for writing any.
+    // Everything's kept as a tree of values, and looking up anything that isn't there gives back a null value instead
+    // of throwing, so optional fields don't need checking twice.
+    class Json {
+    public:
+        enum class Type { Null, Bool, Number, String, Array, Object };
+
+        // Throws if it isn't valid JSON, or it's nested deeper than MAX_DEPTH
+        [[nodiscard]] static Json parse(std::string_view text);
+        static constexpr uint32_t MAX_DEPTH = 128;
+
+        [[nodiscard]] Type getType() const { return type; }
+        [[nodiscard]] bool isNull() const { return type == Type::Null; }
+        [[nodiscard]] bool isNumber() const { return type == Type::Number; }
+        [[nodiscard]] bool isString() const { return type == Type::String; }
+        [[nodiscard]] bool isArray() const { return type == Type::Array; }
+        [[nodiscard]] bool isObject() const { return type == Type::Object; }
+
+        [[nodiscard]] bool getBool(const bool fallback = false) const {
+            return type == Type::Bool ? boolean : fallback;
+        }
+        [[nodiscard]] double getNumber(const double fallback = 0.0) const {
+            return type == Type::Number ? number : fallback;
+        }
+        [[nodiscard]] const std::string &getString() const { return string; } // Empty for anything but strings
+
+        // Elements of an array, or members of an object, nothing for anything else
+        [[nodiscard]] size_t size() const { return values.size(); }
+        [[nodiscard]] const Json &operator[](size_t index) const;
+        [[nodiscard]] const Json &operator[](std::string_view key) const;
+        [[nodiscard]] bool contains(std::string_view key) const;
+        [[nodiscard]] const std::vector<Json> &getValues() const { return values; }
+        // Only for objects, in the same order as the values
+        [[nodiscard]] const std::vector<std::string> &getKeys() const { return keys; }
+    private:
+        friend class JsonParser;
+
+        Type type = Type::Null;
+        bool boolean = false;
+        double number = 0.0;
+        std::string string;
+        std::vector<std::string> keys; // Only for objects
+        std::vector<Json> values;
+    };
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "ktx2.hpp"
+
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include <tracy/Tracy.hpp>
+
+namespace Engine {
+    namespace {
+        constexpr uint8_t IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+        constexpr size_t HEADER_SIZE = 80; // Identifier, header and index
+        constexpr size_t LEVEL_SIZE = 24; // Offset, length, and uncompressed length, all 64 bits
+
+        // Bytes per 4x4 block, or 0 if it's not one we take
+        uint32_t getBlockSize(const VkFormat format) {
+            switch (format) {
+                case VK_FORMAT_BC1_RGB_UNORM_BLOCK: case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: return 8;
+                case VK_FORMAT_BC3_UNORM_BLOCK: case VK_FORMAT_BC3_SRGB_BLOCK:
+                case VK_FORMAT_BC5_UNORM_BLOCK: case VK_FORMAT_BC5_SNORM_BLOCK:
+                case VK_FORMAT_BC7_UNORM_BLOCK: case VK_FORMAT_BC7_SRGB_BLOCK: return 16;
+                default: return 0;
+            }
+        }
+
+        template<typename T>
+        T read(const std::byte *data) {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        }
+    }
+
+    Ktx2File::Ktx2File(const std::filesystem::path &path) : path(path), file(path) {
+        ZoneScoped;
+        if (!file.isOpen()) throw std::runtime_error("Failed to open " + path.string() + "!");
+
+        const std::byte *bytes = file.getData();
+        if (file.getSize() < HEADER_SIZE) fail("too small to be a KTX2 file");
+        if (std::memcmp(bytes, IDENTIFIER, sizeof(IDENTIFIER)) != 0) fail("not a KTX2 file");
+
+        format = static_cast<VkFormat>(read<uint32_t>(bytes + 12));
+        const uint32_t typeSize = read<uint32_t>(bytes + 16);
+        width = read<uint32_t>(bytes + 20);
+        height = read<uint32_t>(bytes + 24);
+        const uint32_t depth = read<uint32_t>(bytes + 28);
+        const uint32_t layerCount = read<uint32_t>(bytes + 32);
+        const uint32_t faceCount = read<uint32_t>(bytes + 36);
+        // 0 means the mips are supposed to be generated on load, which we can't do for compressed formats
+        const uint32_t levelCount = std::max(1u, read<uint32_t>(bytes + 40));
+        const uint32_t supercompression = read<uint32_t>(bytes + 44);
+
+        if (supercompression != 0) fail("supercompressed files (like Basis Universal ones) aren't supported");
+        const uint32_t blockSize = getBlockSize(format);
+        if (blockSize == 0 || typeSize != 1) fail("only BC1, BC3, BC5 and BC7 textures are supported");
+        if (width == 0 || height == 0 || depth != 0 || layerCount > 1 || faceCount != 1)
+            fail("only 2D textures are supported");
+        if (levelCount > static_cast<uint32_t>(std::bit_width(std::max(width, height))))
+            fail("it has more mip levels than it could have");
+        if (file.getSize() < HEADER_SIZE + levelCount * LEVEL_SIZE) fail("truncated level index");
+
+        // The file has them smallest first, with some padding in between, but they only ever get copied all at once
+        std::vector<uint64_t> offsets(levelCount);
+        uint64_t begin = UINT64_MAX;
+        uint64_t end = 0;
+        for (uint32_t level = 0; level < levelCount; level++) {
+            const std::byte *entry = bytes + HEADER_SIZE + level * LEVEL_SIZE;
+            const uint64_t offset = read<uint64_t>(entry);
+            const uint64_t length = read<uint64_t>(entry + 8);
+
+            const uint64_t blocksWide = (std::max(1u, width >> level) + 3) / 4;
+            const uint64_t blocksHigh = (std::max(1u, height >> level) + 3) / 4;
+            if (length != blocksWide * blocksHigh * blockSize)
+                fail("mip level " + std::to_string(level) + " isn't the size it should be");
+            if (offset > file.getSize() || length > file.getSize() - offset)
+                fail("mip level " + std::to_string(level) + " is outside of the file");
+            // Copies need their source aligned to the block size, and the file's meant to guarantee that anyway
+            if (offset % blockSize != 0) fail("mip level " + std::to_string(level) + " isn't aligned");
+
+            offsets[level] = offset;
+            begin = std::min(begin, offset);
+            end = std::max(end, offset + length);
+        }
+
+        data = {bytes + begin, static_cast<size_t>(end - begin)};
+        mipOffsets.reserve(levelCount);
+        for (const uint64_t offset : offsets) mipOffsets.push_back(offset - begin);
+    }
+
+    bool Ktx2File::isKtx2(const std::filesystem::path &path) {
+        std::string extension = path.extension().string();
+        std::ranges::transform(extension, extension.begin(), [](const unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+        return extension == ".ktx2";
+    }
+
+    void Ktx2File::fail(const std::string &reason) const {
+        throw std::runtime_error("Failed to load " + path.string() + ", " + reason + "!");
+    }
+}
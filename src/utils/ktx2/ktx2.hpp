@@ -0,0 +1,50 @@
+#ifndef KTX2_HPP
+#define KTX2_HPP
+
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+#include <vulkan/vulkan.h>
+
+#include "../mappedfile/mappedfile.hpp"
+
+namespace Engine {
+    // A KTX2 texture, memory mapped, with every mip level checked, so they can all be copied straight out of the file.
+    // Only block compressed formats the GPU can sample as they are (BC1, BC3, BC5 and BC7), without any
+    // supercompression (so no Basis Universal), and only plain 2D textures, no arrays, cube maps or 3D ones.
+    class Ktx2File {
+    public:
+        // Throws if the file can't be read, or anything in it doesn't add up
+        explicit Ktx2File(const std::filesystem::path &path);
+
+        Ktx2File(const Ktx2File &) = delete;
+        Ktx2File& operator=(const Ktx2File &) = delete;
+
+        [[nodiscard]] VkFormat getFormat() const { return format; }
+        [[nodiscard]] uint32_t getWidth() const { return width; }
+        [[nodiscard]] uint32_t getHeight() const { return height; }
+        [[nodiscard]] uint32_t getMipLevels() const { return static_cast<uint32_t>(mipOffsets.size()); }
+        // Every mip level, along with whatever padding the file has between them, in one go
+        [[nodiscard]] std::span<const std::byte> getData() const { return data; }
+        // Where each mip level (largest first) starts in the above, always a multiple of the block size
+        [[nodiscard]] const std::vector<VkDeviceSize> &getMipOffsets() const { return mipOffsets; }
+
+        [[nodiscard]] static bool isKtx2(const std::filesystem::path &path);
+    private:
+        std::filesystem::path path;
+        MappedFile file;
+
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::span<const std::byte> data;
+        std::vector<VkDeviceSize> mipOffsets;
+
+        [[noreturn]] void fail(const std::string &reason) const;
+    };
+}
+
+#endif
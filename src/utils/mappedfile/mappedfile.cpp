@@ -0,0 +1,62 @@
+#include "mappedfile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Engine {
+    MappedFile::MappedFile(const std::filesystem::path &path) {
+#ifdef _WIN32
+        const HANDLE file = CreateFileW(path.c_str(),
+                                        GENERIC_READ,
+                                        FILE_SHARE_READ,
+                                        nullptr,
+                                        OPEN_EXISTING,
+                                        FILE_ATTRIBUTE_NORMAL,
+                                        nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+            CloseHandle(file);
+            return;
+        }
+
+        const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) return;
+        data = static_cast<const std::byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping); // The view keeps it alive
+        if (data != nullptr) size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0) return;
+        struct stat info{};
+        if (fstat(file, &info) != 0 || info.st_size <= 0) {
+            close(file);
+            return;
+        }
+
+        void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file); // The mapping keeps it alive
+        if (mapping == MAP_FAILED) return;
+        data = static_cast<const std::byte *>(mapping);
+        size = static_cast<size_t>(info.st_size);
+#endif
+    }
+
+    MappedFile::~MappedFile() {
+        if (data == nullptr) return;
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<std::byte *>(data), size);
+#endif
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <filesystem>
+#include <cstddef>
+
+namespace Engine {
+    // A whole file, mapped read only for as long as this is alive, so big files can be read without copying them first.
+    // Doesn't throw, since a missing file is often fine (like with caches), so check isOpen.
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::filesystem::path &path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile& operator=(const MappedFile &) = delete;
+
+        [[nodiscard]] bool isOpen() const { return data != nullptr; }
+        [[nodiscard]] const std::byte *getData() const { return data; }
+        [[nodiscard]] size_t getSize() const { return size; }
+    private:
+        const std::byte *data = nullptr;
+        size_t size = 0;
+    };
+}
+
+#endif
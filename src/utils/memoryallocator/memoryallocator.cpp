@@ -0,0 +1,392 @@
+#include "memoryallocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "../device/device.hpp"
+
+namespace Engine {
+    static VkDeviceSize alignUp(const VkDeviceSize value, const VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    MemoryAllocator::MemoryAllocator(Device &device) : device(device) {
+        vkGetPhysicalDeviceMemoryProperties(device.physicalDevice(), &memoryProperties);
+    }
+    MemoryAllocator::~MemoryAllocator() {
+        // Anything still allocated from these at this point was leaked anyway
+        for (const Pool &pool : pools) {
+            for (const std::unique_ptr<Block> &block : pool.blocks)
+                vkFreeMemory(device.device(), block->memory, nullptr);
+        }
+    }
+
+    MemoryAllocator::Allocation MemoryAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties) {
+        VkBufferMemoryRequirementsInfo2 info{};
+        info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+        info.buffer = buffer;
+
+        VkMemoryDedicatedRequirements dedicatedRequirements{};
+        dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+        VkMemoryRequirements2 requirements{};
+        requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        requirements.pNext = &dedicatedRequirements;
+        vkGetBufferMemoryRequirements2(device.device(), &info, &requirements);
+
+        Allocation allocation = allocate(requirements.memoryRequirements,
+                                         properties,
+                                         true,
+                                         dedicatedRequirements.prefersDedicatedAllocation ||
+                                         dedicatedRequirements.requiresDedicatedAllocation,
+                                         buffer,
+                                         VK_NULL_HANDLE);
+        if (vkBindBufferMemory(device.device(), buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            free(allocation);
+            throw std::runtime_error("Failed to bind the buffer memory!");
+        } return allocation;
+    }
+
+    MemoryAllocator::Allocation MemoryAllocator::allocateForImage(VkImage image,
+                                                                  VkMemoryPropertyFlags properties,
+                                                                  const bool linear) {
+        VkImageMemoryRequirementsInfo2 info{};
+        info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+        info.image = image;
+
+        VkMemoryDedicatedRequirements dedicatedRequirements{};
+        dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+        VkMemoryRequirements2 requirements{};
+        requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        requirements.pNext = &dedicatedRequirements;
+        vkGetImageMemoryRequirements2(device.device(), &info, &requirements);
+
+        Allocation allocation = allocate(requirements.memoryRequirements,
+                                         properties,
+                                         linear,
+                                         dedicatedRequirements.prefersDedicatedAllocation ||
+                                         dedicatedRequirements.requiresDedicatedAllocation,
+                                         VK_NULL_HANDLE,
+                                         image);
+        if (vkBindImageMemory(device.device(), image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            free(allocation);
+            throw std::runtime_error("Failed to bind the image memory!");
+        } return allocation;
+    }
+
+    void MemoryAllocator::free(Allocation &allocation) {
+        if (allocation.memory == VK_NULL_HANDLE) return;
+
+        std::lock_guard lock(mutex);
+        if (allocation.isDedicated()) {
+            vkFreeMemory(device.device(), allocation.memory, nullptr);
+            dedicated[allocation.memoryType].count--;
+            dedicated[allocation.memoryType].bytes -= allocation.size;
+        } else {
+            Block &block = *allocation.block;
+            freeNode(block, allocation.node);
+
+            // Keep one empty block around, so something that keeps getting created and destroyed doesn't thrash
+            Pool &pool = pools[allocation.pool];
+            if (block.allocationCount == 0 && std::ranges::count_if(pool.blocks, [](const auto &other) {
+                return other->allocationCount == 0;
+            }) > 1) destroyBlock(pool, &block);
+        } allocation = {};
+    }
+
+    std::vector<MemoryAllocator::Stats> MemoryAllocator::getStats() const {
+        std::lock_guard lock(mutex);
+        std::vector<Stats> stats;
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            Stats type{i,
+                       memoryProperties.memoryTypes[i].heapIndex,
+                       memoryProperties.memoryTypes[i].propertyFlags,
+                       0,
+                       dedicated[i].count,
+                       dedicated[i].count,
+                       dedicated[i].bytes,
+                       dedicated[i].bytes};
+            for (uint32_t pool = 2 * i; pool < 2 * i + 2; pool++) {
+                for (const std::unique_ptr<Block> &block : pools[pool].blocks) {
+                    type.blockCount++;
+                    type.allocationCount += block->allocationCount;
+                    type.reservedBytes += block->size;
+                    type.usedBytes += block->used;
+                }
+            } if (type.reservedBytes > 0) stats.push_back(type);
+        } return stats;
+    }
+
+    uint32_t MemoryAllocator::getDeviceAllocationCount() const {
+        std::lock_guard lock(mutex);
+        uint32_t count = 0;
+        for (const Pool &pool : pools) count += static_cast<uint32_t>(pool.blocks.size());
+        for (const DedicatedCounters &counters : dedicated) count += counters.count;
+        return count;
+    }
+
+    MemoryAllocator::Allocation MemoryAllocator::allocate(const VkMemoryRequirements &requirements,
+                                                          const VkMemoryPropertyFlags properties,
+                                                          const bool linear,
+                                                          const bool preferDedicated,
+                                                          VkBuffer dedicatedBuffer,
+                                                          VkImage dedicatedImage) {
+        const uint32_t memoryType = device.findMemoryType(requirements.memoryTypeBits, properties);
+        const VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+
+        VkDeviceSize size = std::max(requirements.size, GRANULARITY);
+        VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+        if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+            // Flushes have to line up with nonCoherentAtomSize, so make sure no one else shares an atom with us
+            const VkDeviceSize atomSize = device.properties.limits.nonCoherentAtomSize;
+            alignment = std::max(alignment, atomSize);
+            size = alignUp(size, atomSize);
+        }
+
+        std::lock_guard lock(mutex);
+        // Lazily allocated memory only makes sense on its own, since we ask the driver how much of it got committed.
+        // Dedicated allocations have to be exactly the size the resource asked for, and since nothing else lives in
+        // them, flushing all of it is always fine, even if it isn't a whole number of atoms.
+        if (preferDedicated || (flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) ||
+            size >= std::min(DEDICATED_THRESHOLD, getBlockSize(memoryType) / 2))
+            return allocateDedicated(memoryType, requirements.size, dedicatedBuffer, dedicatedImage);
+
+        const uint32_t poolIndex = 2 * memoryType + (linear ? 0 : 1);
+        Pool &pool = pools[poolIndex];
+        Allocation allocation{};
+        allocation.memoryType = memoryType;
+        allocation.pool = poolIndex;
+        bool allocated = std::ranges::any_of(pool.blocks, [&](const std::unique_ptr<Block> &block) {
+            return tryAllocate(*block, size, alignment, allocation);
+        });
+        if (!allocated) allocated = tryAllocate(createBlock(pool, memoryType), size, alignment, allocation);
+        assert(allocated && "A new block should always have enough space!");
+        return allocation;
+    }
+
+    MemoryAllocator::Allocation MemoryAllocator::allocateDedicated(const uint32_t memoryType,
+                                                                   const VkDeviceSize size,
+                                                                   VkBuffer buffer,
+                                                                   VkImage image) {
+        VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+        dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+        dedicatedInfo.buffer = buffer;
+        dedicatedInfo.image = image;
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = &dedicatedInfo;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        Allocation allocation{};
+        if (vkAllocateMemory(device.device(), &allocInfo, nullptr, &allocation.memory) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate dedicated memory!");
+        allocation.size = size;
+        allocation.memoryType = memoryType;
+
+        if ((memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+            vkMapMemory(device.device(), allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped) != VK_SUCCESS) {
+            vkFreeMemory(device.device(), allocation.memory, nullptr);
+            throw std::runtime_error("Failed to map dedicated memory!");
+        }
+
+        dedicated[memoryType].count++;
+        dedicated[memoryType].bytes += size;
+        return allocation;
+    }
+
+    VkDeviceSize MemoryAllocator::getBlockSize(const uint32_t memoryType) const {
+        // Small heaps (like the 256 MiB of host visible VRAM without resizable BAR) shouldn't go in just a few blocks
+        const uint32_t heap = memoryProperties.memoryTypes[memoryType].heapIndex;
+        const VkDeviceSize heapSize = memoryProperties.memoryHeaps[heap].size;
+        return std::min(BLOCK_SIZE, std::bit_floor(heapSize / 8));
+    }
+
+    MemoryAllocator::Block &MemoryAllocator::createBlock(Pool &pool, const uint32_t memoryType) {
+        auto block = std::make_unique<Block>();
+        block->size = getBlockSize(memoryType);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block->size;
+        allocInfo.memoryTypeIndex = memoryType;
+        if (vkAllocateMemory(device.device(), &allocInfo, nullptr, &block->memory) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate a memory block!");
+
+        if ((memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+            vkMapMemory(device.device(), block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+            vkFreeMemory(device.device(), block->memory, nullptr);
+            throw std::runtime_error("Failed to map a memory block!");
+        }
+
+        // Starts out as a single free node spanning the whole thing
+        for (auto &lists : block->freeLists) lists.fill(NONE);
+        const uint32_t node = createNode(*block);
+        block->nodes[node].size = block->size;
+        insertFree(*block, node);
+
+        pool.blocks.push_back(std::move(block));
+        return *pool.blocks.back();
+    }
+
+    void MemoryAllocator::destroyBlock(Pool &pool, const Block *block) {
+        vkFreeMemory(device.device(), block->memory, nullptr); // Unmaps it too
+        std::erase_if(pool.blocks, [block](const std::unique_ptr<Block> &other) { return other.get() == block; });
+    }
+
+    void MemoryAllocator::mapping(const VkDeviceSize size, uint32_t &firstLevel, uint32_t &secondLevel) {
+        if (size < SMALL_SIZE) {
+            firstLevel = 0;
+            secondLevel = static_cast<uint32_t>(size / GRANULARITY);
+            return;
+        }
+
+        const auto log2 = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        firstLevel = log2 - SMALL_LOG2 + 1;
+        secondLevel = static_cast<uint32_t>(size >> (log2 - SL_LOG2)) & (SL_COUNT - 1);
+    }
+
+    uint32_t MemoryAllocator::findFree(const Block &block, VkDeviceSize size) {
+        // Round up to the start of the next list, so anything in the one we find is big enough
+        if (size < SMALL_SIZE) size += GRANULARITY - 1;
+        else size += (VkDeviceSize{1} << (std::bit_width(size) - 1 - SL_LOG2)) - 1;
+
+        uint32_t firstLevel, secondLevel;
+        mapping(size, firstLevel, secondLevel);
+        if (firstLevel >= FL_COUNT) return NONE;
+
+        uint32_t secondLevelMap = block.secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+        if (secondLevelMap == 0) { // Nothing in this size class, so go up to the next one that has something
+            const uint32_t firstLevelMap = firstLevel + 1 < FL_COUNT ?
+                                           block.firstLevelBitmap & (~0u << (firstLevel + 1)) : 0;
+            if (firstLevelMap == 0) return NONE;
+            firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+            secondLevelMap = block.secondLevelBitmaps[firstLevel];
+        } secondLevel = static_cast<uint32_t>(std::countr_zero(secondLevelMap));
+        return block.freeLists[firstLevel][secondLevel];
+    }
+
+    void MemoryAllocator::insertFree(Block &block, const uint32_t node) {
+        uint32_t firstLevel, secondLevel;
+        mapping(block.nodes[node].size, firstLevel, secondLevel);
+
+        uint32_t &head = block.freeLists[firstLevel][secondLevel];
+        block.nodes[node].free = true;
+        block.nodes[node].prevFree = NONE;
+        block.nodes[node].nextFree = head;
+        if (head != NONE) block.nodes[head].prevFree = node;
+        head = node;
+
+        block.firstLevelBitmap |= 1u << firstLevel;
+        block.secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+    }
+
+    void MemoryAllocator::removeFree(Block &block, const uint32_t node) {
+        uint32_t firstLevel, secondLevel;
+        mapping(block.nodes[node].size, firstLevel, secondLevel);
+
+        const Node &current = block.nodes[node];
+        if (current.prevFree != NONE) block.nodes[current.prevFree].nextFree = current.nextFree;
+        else block.freeLists[firstLevel][secondLevel] = current.nextFree;
+        if (current.nextFree != NONE) block.nodes[current.nextFree].prevFree = current.prevFree;
+        block.nodes[node].free = false;
+
+        if (block.freeLists[firstLevel][secondLevel] == NONE) {
+            block.secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+            if (block.secondLevelBitmaps[firstLevel] == 0) block.firstLevelBitmap &= ~(1u << firstLevel);
+        }
+    }
+
+    uint32_t MemoryAllocator::createNode(Block &block) {
+        if (block.unusedNodes.empty()) {
+            block.nodes.emplace_back();
+            return static_cast<uint32_t>(block.nodes.size() - 1);
+        }
+
+        const uint32_t node = block.unusedNodes.back();
+        block.unusedNodes.pop_back();
+        block.nodes[node] = {};
+        return node;
+    }
+
+    void MemoryAllocator::releaseNode(Block &block, const uint32_t node) {
+        block.unusedNodes.push_back(node);
+    }
+
+    bool MemoryAllocator::tryAllocate(Block &block,
+                                      const VkDeviceSize size,
+                                      const VkDeviceSize alignment,
+                                      Allocation &allocation) {
+        // Asking for enough extra to align it means we never have to look at more than one node
+        const uint32_t node = findFree(block, size + alignment - 1);
+        if (node == NONE) return false;
+        removeFree(block, node);
+
+        // The padding in front goes back as a node of its own, the node before it is never free, so no merging needed
+        const VkDeviceSize padding = alignUp(block.nodes[node].offset, alignment) - block.nodes[node].offset;
+        if (padding > 0) {
+            const uint32_t front = createNode(block); // Might move the nodes, so no references until we're done
+            block.nodes[front].offset = block.nodes[node].offset;
+            block.nodes[front].size = padding;
+            block.nodes[front].prevPhysical = block.nodes[node].prevPhysical;
+            block.nodes[front].nextPhysical = node;
+            if (const uint32_t before = block.nodes[node].prevPhysical; before != NONE)
+                block.nodes[before].nextPhysical = front;
+            block.nodes[node].prevPhysical = front;
+            block.nodes[node].offset += padding;
+            block.nodes[node].size -= padding;
+            insertFree(block, front);
+        }
+
+        // Same with whatever's left at the end, as long as it's big enough to be useful
+        if (block.nodes[node].size - size >= GRANULARITY) {
+            const uint32_t back = createNode(block);
+            block.nodes[back].offset = block.nodes[node].offset + size;
+            block.nodes[back].size = block.nodes[node].size - size;
+            block.nodes[back].prevPhysical = node;
+            block.nodes[back].nextPhysical = block.nodes[node].nextPhysical;
+            if (const uint32_t after = block.nodes[node].nextPhysical; after != NONE)
+                block.nodes[after].prevPhysical = back;
+            block.nodes[node].nextPhysical = back;
+            block.nodes[node].size = size;
+            insertFree(block, back);
+        }
+
+        const Node &allocated = block.nodes[node];
+        block.used += allocated.size;
+        block.allocationCount++;
+
+        allocation.memory = block.memory;
+        allocation.offset = allocated.offset;
+        allocation.size = size;
+        allocation.mapped = block.mapped ? static_cast<uint8_t*>(block.mapped) + allocated.offset : nullptr;
+        allocation.block = &block;
+        allocation.node = node;
+        return true;
+    }
+
+    void MemoryAllocator::freeNode(Block &block, uint32_t node) {
+        assert(!block.nodes[node].free && "Cannot free memory that's already free!");
+        block.used -= block.nodes[node].size;
+        block.allocationCount--;
+
+        // Merge with whichever neighbours are free, so there's never two free nodes next to each other
+        if (const uint32_t next = block.nodes[node].nextPhysical; next != NONE && block.nodes[next].free) {
+            removeFree(block, next);
+            block.nodes[node].size += block.nodes[next].size;
+            block.nodes[node].nextPhysical = block.nodes[next].nextPhysical;
+            if (const uint32_t after = block.nodes[next].nextPhysical; after != NONE)
+                block.nodes[after].prevPhysical = node;
+            releaseNode(block, next);
+        } if (const uint32_t prev = block.nodes[node].prevPhysical; prev != NONE && block.nodes[prev].free) {
+            removeFree(block, prev);
+            block.nodes[prev].size += block.nodes[node].size;
+            block.nodes[prev].nextPhysical = block.nodes[node].nextPhysical;
+            if (const uint32_t after = block.nodes[node].nextPhysical; after != NONE)
+                block.nodes[after].prevPhysical = prev;
+            releaseNode(block, node);
+            node = prev;
+        } insertFree(block, node);
+    }
+}
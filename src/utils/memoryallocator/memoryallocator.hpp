@@ -0,0 +1,147 @@
+#ifndef MEMORYALLOCATOR_HPP
+#define MEMORYALLOCATOR_HPP
+
+#include <array>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+namespace Engine {
+    class Device;
+
+    // Hands out pieces of a few big blocks of device memory, instead of calling vkAllocateMemory for every resource,
+    // which is slow, and runs into maxMemoryAllocationCount (which can be as low as 4096) pretty quickly.
+    // Every memory type gets two pools of blocks, one for buffers (and linear images) and one for optimal images, so
+    // we never have to care about bufferImageGranularity. Each block is managed with TLSF, which finds a good fit in
+    // constant time and merges free neighbours right away, so fragmentation stays pretty low.
+    // Anything big enough (or that the driver would rather have on its own) gets a dedicated allocation instead.
+    // Host visible memory stays mapped for as long as it's alive, since a block can't be mapped more than once.
+    // Everything goes through a single mutex, so resources can be created from any thread.
+    class MemoryAllocator {
+        struct Block;
+    public:
+        static constexpr VkDeviceSize BLOCK_SIZE = 64 * 1024 * 1024; // Smaller on tiny heaps
+        static constexpr VkDeviceSize DEDICATED_THRESHOLD = BLOCK_SIZE / 4; // Would waste too much of a block otherwise
+
+        struct Allocation {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize offset = 0;
+            VkDeviceSize size = 0;
+            void *mapped = nullptr; // Already offset, only set for host visible memory
+            uint32_t memoryType = 0;
+
+            [[nodiscard]] bool isDedicated() const { return memory != VK_NULL_HANDLE && block == nullptr; }
+        private:
+            friend class MemoryAllocator;
+            Block *block = nullptr;
+            uint32_t pool = 0;
+            uint32_t node = 0;
+        };
+
+        struct Stats {
+            uint32_t memoryType;
+            uint32_t heap;
+            VkMemoryPropertyFlags flags;
+            uint32_t blockCount;
+            uint32_t dedicatedCount;
+            uint32_t allocationCount; // Dedicated ones included
+            VkDeviceSize reservedBytes; // Everything we got from the driver
+            VkDeviceSize usedBytes; // What's actually handed out, alignment padding included
+        };
+
+        explicit MemoryAllocator(Device &device);
+        ~MemoryAllocator();
+
+        MemoryAllocator(const MemoryAllocator &) = delete;
+        MemoryAllocator& operator=(const MemoryAllocator &) = delete;
+
+        // These bind the memory too
+        [[nodiscard]] Allocation allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties);
+        [[nodiscard]] Allocation allocateForImage(VkImage image, VkMemoryPropertyFlags properties, bool linear = false);
+        // Resets the allocation, so freeing it twice does nothing
+        void free(Allocation &allocation);
+
+        // Only the memory types that have something allocated
+        [[nodiscard]] std::vector<Stats> getStats() const;
+        // Blocks and dedicated allocations, the number that counts towards maxMemoryAllocationCount
+        [[nodiscard]] uint32_t getDeviceAllocationCount() const;
+    private:
+        // Sizes up to SMALL_SIZE get linear lists, the ones above get SL_COUNT lists per power of two
+        static constexpr uint32_t SL_LOG2 = 4;
+        static constexpr uint32_t SL_COUNT = 1 << SL_LOG2;
+        static constexpr uint32_t SMALL_LOG2 = 8;
+        static constexpr VkDeviceSize SMALL_SIZE = VkDeviceSize{1} << SMALL_LOG2;
+        static constexpr VkDeviceSize GRANULARITY = SMALL_SIZE / SL_COUNT; // Nothing smaller than this gets split off
+        static constexpr uint32_t FL_COUNT = static_cast<uint32_t>(std::bit_width(BLOCK_SIZE)) - SMALL_LOG2 + 1;
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        // A range of a block, either free or handed out, nodes that are next to each other are never both free
+        struct Node {
+            VkDeviceSize offset = 0;
+            VkDeviceSize size = 0;
+            uint32_t prevPhysical = NONE;
+            uint32_t nextPhysical = NONE;
+            uint32_t prevFree = NONE; // Only used while free
+            uint32_t nextFree = NONE;
+            bool free = true;
+        };
+
+        struct Block {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            void *mapped = nullptr;
+            VkDeviceSize size = 0;
+            VkDeviceSize used = 0;
+            uint32_t allocationCount = 0;
+
+            std::vector<Node> nodes;
+            std::vector<uint32_t> unusedNodes; // Indices into the above, so nodes never have to move
+            uint32_t firstLevelBitmap = 0;
+            std::array<uint32_t, FL_COUNT> secondLevelBitmaps{};
+            std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> freeLists{};
+        };
+
+        // One pool for linear resources and one for optimal images, per memory type
+        struct Pool {
+            std::vector<std::unique_ptr<Block>> blocks;
+        };
+
+        struct DedicatedCounters {
+            uint32_t count = 0;
+            VkDeviceSize bytes = 0;
+        };
+
+        Device &device;
+        VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+        mutable std::mutex mutex;
+        std::array<Pool, 2 * VK_MAX_MEMORY_TYPES> pools;
+        std::array<DedicatedCounters, VK_MAX_MEMORY_TYPES> dedicated{};
+
+        Allocation allocate(const VkMemoryRequirements &requirements,
+                            VkMemoryPropertyFlags properties,
+                            bool linear,
+                            bool preferDedicated,
+                            VkBuffer dedicatedBuffer,
+                            VkImage dedicatedImage);
+        Allocation allocateDedicated(uint32_t memoryType, VkDeviceSize size, VkBuffer buffer, VkImage image);
+        [[nodiscard]] VkDeviceSize getBlockSize(uint32_t memoryType) const;
+        Block &createBlock(Pool &pool, uint32_t memoryType);
+        void destroyBlock(Pool &pool, const Block *block);
+
+        // TLSF, all of these assume the mutex is already locked
+        static void mapping(VkDeviceSize size, uint32_t &firstLevel, uint32_t &secondLevel);
+        static uint32_t findFree(const Block &block, VkDeviceSize size);
+        static void insertFree(Block &block, uint32_t node);
+        static void removeFree(Block &block, uint32_t node);
+        static uint32_t createNode(Block &block);
+        static void releaseNode(Block &block, uint32_t node);
+        static bool tryAllocate(Block &block, VkDeviceSize size, VkDeviceSize alignment, Allocation &allocation);
+        static void freeNode(Block &block, uint32_t node);
+    };
+}
+
+#endif
@@ -0,0 +1,197 @@
+#include "meshcache.hpp"
+
+#include <cstddef>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <vector>
+#include <functional>
+
+namespace Engine {
+    namespace {
+        constexpr uint32_t MAGIC = 0x4d454756; // "VGEM", backwards since it's little endian
+
+        uint64_t alignBlob(const uint64_t offset) {
+            return (offset + MeshCache::BLOB_ALIGNMENT - 1) & ~(MeshCache::BLOB_ALIGNMENT - 1);
+        }
+    }
+
+    Model::View MeshCache::Mapping::getView(const bool compressed) const {
+        const Header &header = getHeader();
+        return {getBlob<Model::Vertex>(header.vertexOffset, header.vertexCount),
+                getBlob<uint32_t>(header.indexOffset, header.indexCount),
+                getBlob<Model::LOD>(header.lodOffset, header.lodCount),
+                getBlob<Model::Meshlet>(header.meshletOffset, header.meshletCount),
+                compressed};
+    }
+
+    std::unique_ptr<MeshCache::Mapping> MeshCache::load(const std::filesystem::path &source) const {
+        ZoneScoped;
+        std::error_code error;
+        const uint64_t sourceSize = std::filesystem::file_size(source, error);
+        if (error) return nullptr;
+        const int64_t sourceTime = std::filesystem::last_write_time(source, error).time_since_epoch().count();
+        if (error) return nullptr;
+
+        const std::filesystem::path entry = getEntryPath(source);
+        std::unique_ptr<Mapping> mapping(new Mapping(entry));
+        if (!mapping->file.isOpen() || mapping->file.getSize() < sizeof(Header) || !isValid(*mapping)) return nullptr;
+
+        const Header &header = mapping->getHeader();
+        if (header.sourceSize != sourceSize) return nullptr;
+        if (header.sourceTime == sourceTime) return mapping;
+
+        // Same size but a different time, so the contents get the final say
+        uint64_t sourceHash = 0;
+        if (!hashFile(source, sourceHash) || sourceHash != header.sourceHash) return nullptr;
+
+        // They're the same, so we update the time, so we don't have to hash it again next time
+        std::fstream file(entry, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(offsetof(Header, sourceTime));
+        file.write(reinterpret_cast<const char *>(&sourceTime), sizeof(sourceTime));
+        return mapping;
+    }
+
+    bool MeshCache::store(const std::filesystem::path &source, const Model::Builder &builder) const {
+        ZoneScoped;
+        Header header{};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.vertexSize = sizeof(Model::Vertex);
+        header.lodSize = sizeof(Model::LOD);
+        header.meshletSize = sizeof(Model::Meshlet);
+        header.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+        header.indexCount = static_cast<uint32_t>(builder.indices.size());
+        header.lodCount = static_cast<uint32_t>(builder.lods.size());
+        header.meshletCount = static_cast<uint32_t>(builder.meshlets.size());
+
+        std::error_code error;
+        header.sourceSize = std::filesystem::file_size(source, error);
+        if (error) return false;
+        header.sourceTime = std::filesystem::last_write_time(source, error).time_since_epoch().count();
+        if (error || !hashFile(source, header.sourceHash)) return false;
+
+        if (!builder.vertices.empty()) {
+            header.minBounds = builder.vertices[0].position;
+            header.maxBounds = builder.vertices[0].position;
+            for (const Model::Vertex &vertex : builder.vertices) {
+                header.minBounds = glm::min(header.minBounds, vertex.position);
+                header.maxBounds = glm::max(header.maxBounds, vertex.position);
+            }
+        }
+
+        header.vertexOffset = alignBlob(sizeof(Header));
+        header.indexOffset = alignBlob(header.vertexOffset + builder.vertices.size() * sizeof(Model::Vertex));
+        header.lodOffset = alignBlob(header.indexOffset + builder.indices.size() * sizeof(uint32_t));
+        header.meshletOffset = alignBlob(header.lodOffset + builder.lods.size() * sizeof(Model::LOD));
+
+        std::filesystem::create_directories(directory, error);
+        if (error) return false;
+
+        // Written next to the entry, and then renamed over it, so nothing ever maps a half written file. Every writer
+        // gets a name of its own, since two threads (or two runs) storing the same file at once would otherwise write
+        // into the same temporary, and whoever renames it first might hand out the other one's half.
+        const std::filesystem::path entry = getEntryPath(source);
+        std::stringstream suffix;
+        suffix << '.' << std::hex << std::hash<std::thread::id>{}(std::this_thread::get_id())
+               << '.' << std::random_device{}() << ".tmp";
+        std::filesystem::path temporary = entry;
+        temporary += suffix.str();
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file) return false;
+
+            const auto writeBlob = [&file](const uint64_t offset, const void *data, const size_t size) {
+                static constexpr char padding[BLOB_ALIGNMENT]{};
+                file.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+                file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+            };
+            writeBlob(0, &header, sizeof(Header));
+            writeBlob(header.vertexOffset, builder.vertices.data(), builder.vertices.size() * sizeof(Model::Vertex));
+            writeBlob(header.indexOffset, builder.indices.data(), builder.indices.size() * sizeof(uint32_t));
+            writeBlob(header.lodOffset, builder.lods.data(), builder.lods.size() * sizeof(Model::LOD));
+            writeBlob(header.meshletOffset, builder.meshlets.data(), builder.meshlets.size() * sizeof(Model::Meshlet));
+            if (!file.flush()) {
+                file.close();
+                std::filesystem::remove(temporary, error);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(temporary, entry, error);
+        if (!error) return true;
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+
+    std::filesystem::path MeshCache::getEntryPath(const std::filesystem::path &source) const {
+        std::error_code error;
+        std::filesystem::path absolute = std::filesystem::weakly_canonical(source, error);
+        if (error) absolute = source;
+        const std::string key = absolute.generic_string();
+
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << hash(key.data(), key.size()) << ".mesh";
+        return directory / name.str();
+    }
+
+    bool MeshCache::isValid(const Mapping &mapping) {
+        const Header &header = mapping.getHeader();
+        const size_t fileSize = mapping.file.getSize();
+        if (header.magic != MAGIC || header.version != VERSION) return false;
+        if (header.vertexSize != sizeof(Model::Vertex) ||
+            header.lodSize != sizeof(Model::LOD) ||
+            header.meshletSize != sizeof(Model::Meshlet)) return false;
+        if (header.vertexCount < 3) return false;
+
+        // Every blob has to actually be in the file, in case it got cut short somehow
+        const auto fits = [fileSize](const uint64_t offset, const uint64_t count, const uint64_t size) {
+            return offset % BLOB_ALIGNMENT == 0 && offset <= fileSize && count * size <= fileSize - offset;
+        };
+        if (!fits(header.vertexOffset, header.vertexCount, sizeof(Model::Vertex)) ||
+            !fits(header.indexOffset, header.indexCount, sizeof(uint32_t)) ||
+            !fits(header.lodOffset, header.lodCount, sizeof(Model::LOD)) ||
+            !fits(header.meshletOffset, header.meshletCount, sizeof(Model::Meshlet))) return false;
+
+        // And everything that points into something else has to stay inside of it. Going through every index isn't
+        // free, but it's still nothing next to parsing the source again.
+        const auto inside = [](const uint32_t first, const uint32_t count, const uint32_t total) {
+            return uint64_t{first} + count <= total;
+        };
+        const auto indices = mapping.getBlob<uint32_t>(header.indexOffset, header.indexCount);
+        if (std::ranges::any_of(indices, [&header](const uint32_t index) { return index >= header.vertexCount; }))
+            return false;
+        if (header.lodCount > Model::MAX_LODS) return false;
+        for (const Model::LOD &lod : mapping.getBlob<Model::LOD>(header.lodOffset, header.lodCount)) {
+            if (!inside(lod.firstIndex, lod.indexCount, header.indexCount) ||
+                !inside(lod.firstMeshlet, lod.meshletCount, header.meshletCount)) return false;
+        }
+        const auto meshlets = mapping.getBlob<Model::Meshlet>(header.meshletOffset, header.meshletCount);
+        for (const Model::Meshlet &meshlet : meshlets) {
+            if (!inside(meshlet.firstIndex, meshlet.indexCount, header.indexCount)) return false;
+        } return true;
+    }
+
+    uint64_t MeshCache::hash(const void *data, const size_t size, uint64_t seed) {
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; i++) {
+            seed ^= bytes[i];
+            seed *= 0x100000001b3;
+        } return seed;
+    }
+
+    bool MeshCache::hashFile(const std::filesystem::path &path, uint64_t &result) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+
+        std::vector<char> buffer(1 << 20);
+        result = hash(nullptr, 0);
+        while (file) {
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            result = hash(buffer.data(), static_cast<size_t>(file.gcount()), result);
+        } return file.eof() && !file.bad();
+    }
+}
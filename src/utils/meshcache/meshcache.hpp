@@ -0,0 +1,87 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include <memory>
+#include <filesystem>
+#include <cstdint>
+
+#include "../model/model.hpp"
+#include "../mappedfile/mappedfile.hpp"
+
+namespace Engine {
+    // Keeps the finished Model::Builder (LODs, meshlets and optimisation included) of every model file we load around on
+    // disk, so the next time we only have to map it, instead of parsing the file and doing all the work again.
+    // Entries are named after the source path, and only used if the source is still the same size, and either has the
+    // same modification time, or the same contents (so just touching it, or checking it out again, doesn't count).
+    // Everything's laid out just like it is in memory, each blob aligned to BLOB_ALIGNMENT, so the mapping can go
+    // straight to the upload service. Only caches can read their own files, it's not meant to be portable.
+    class MeshCache {
+        struct Header;
+    public:
+        // Has to go up whenever the file layout, or anything the builder does to the meshes, changes
+        static constexpr uint32_t VERSION = 1;
+        static constexpr uint64_t BLOB_ALIGNMENT = 64;
+
+        // A cached mesh, which stays mapped for as long as this is alive
+        class Mapping {
+        public:
+            [[nodiscard]] Model::View getView(bool compressed = false) const;
+        private:
+            friend class MeshCache;
+            MappedFile file;
+
+            explicit Mapping(const std::filesystem::path &path) : file(path) {}
+            [[nodiscard]] const Header &getHeader() const { return *reinterpret_cast<const Header *>(file.getData()); }
+
+            template<typename T>
+            [[nodiscard]] std::span<const T> getBlob(uint64_t offset, uint32_t count) const {
+                return {reinterpret_cast<const T *>(file.getData() + offset), count};
+            }
+        };
+
+        explicit MeshCache(std::filesystem::path directory = "cache/meshes") : directory(std::move(directory)) {}
+
+        // Nothing if there's no entry for the source, or it's out of date
+        [[nodiscard]] std::unique_ptr<Mapping> load(const std::filesystem::path &source) const;
+        // Doesn't throw, since the model's still perfectly usable without it, so it just returns whether it worked
+        bool store(const std::filesystem::path &source, const Model::Builder &builder) const;
+    private:
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            // So a change to any of these without bumping the version doesn't go unnoticed
+            uint32_t vertexSize;
+            uint32_t lodSize;
+            uint32_t meshletSize;
+
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            uint32_t lodCount;
+            uint32_t meshletCount;
+            uint32_t padding;
+
+            uint64_t sourceSize;
+            int64_t sourceTime;
+            uint64_t sourceHash;
+
+            glm::vec3 minBounds;
+            glm::vec3 maxBounds;
+
+            uint64_t vertexOffset;
+            uint64_t indexOffset;
+            uint64_t lodOffset;
+            uint64_t meshletOffset;
+        };
+
+        std::filesystem::path directory;
+
+        [[nodiscard]] std::filesystem::path getEntryPath(const std::filesystem::path &source) const;
+        // Anything that got cut short, or is just plain wrong, so nothing ever reads or draws past the end of something
+        [[nodiscard]] static bool isValid(const Mapping &mapping);
+        // FNV-1a, which is plenty for telling files apart, and fast enough to not matter next to the parsing
+        [[nodiscard]] static uint64_t hash(const void *data, size_t size, uint64_t seed = 0xcbf29ce484222325);
+        [[nodiscard]] static bool hashFile(const std::filesystem::path &path, uint64_t &hash);
+    };
+}
+
+#endif
@@ -0,0 +1,454 @@
+#include <cctype>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <ranges>
+#include <charconv>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include "model.hpp"
+#include "../inflater/inflater.hpp"
+#include "../mappedfile/mappedfile.hpp"
+#include "../vertexwelder/vertexwelder.hpp"
+#include "../workerpool/workerpool.hpp"
+
+namespace Engine {
+    namespace {
+        constexpr uint32_t BATCH_VERTICES = 384 * 1024;
+        constexpr size_t XML_CHUNK_SIZE = 64 * 1024;
+        constexpr uint32_t MAX_COMPONENT_DEPTH = 32; // Components can point at each other, so this stops any loops
+
+        // Just enough of the zip format to find a file in the central directory, and get at its data
+        constexpr uint32_t END_OF_DIRECTORY_SIGNATURE = 0x06054b50;
+        constexpr uint32_t DIRECTORY_ENTRY_SIGNATURE = 0x02014b50;
+        constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+        constexpr size_t END_OF_DIRECTORY_SIZE = 22;
+        constexpr size_t DIRECTORY_ENTRY_SIZE = 46;
+        constexpr size_t LOCAL_HEADER_SIZE = 30;
+        constexpr uint16_t METHOD_STORED = 0;
+        constexpr uint16_t METHOD_DEFLATED = 8;
+
+        struct ZipEntry {
+            std::string_view name;
+            uint16_t flags;
+            uint16_t method;
+            uint32_t compressedSize;
+            uint32_t uncompressedSize;
+            uint32_t localHeaderOffset;
+        };
+
+        // The zip's little endian, like everything we run on
+        template<typename T>
+        T read(const std::byte *data) {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        }
+
+        // Part names in a 3MF package don't care about case, or a leading slash
+        bool samePart(std::string_view a, std::string_view b) {
+            if (a.starts_with('/')) a.remove_prefix(1);
+            if (b.starts_with('/')) b.remove_prefix(1);
+            return std::ranges::equal(a, b, [](const unsigned char x, const unsigned char y) {
+                return std::tolower(x) == std::tolower(y);
+            });
+        }
+
+        // Goes over the tags one by one, and doesn't care about anything in between them, which is all 3MF needs.
+        // The text comes in from the source a chunk at a time, and only the tag it's on gets kept around.
+        class XmlScanner {
+        public:
+            struct Tag {
+                std::string_view name; // Without the namespace prefix, if it has one
+                std::string_view attributes;
+                bool closing;
+                bool selfClosing;
+            };
+
+            // Writes the next bit of the text into the buffer, returning how much that was, and 0 once it's all gone
+            using Source = std::function<size_t(char *, size_t)>;
+
+            explicit XmlScanner(Source source) : source(std::move(source)) {}
+
+            // False once there are no tags left. The tag's only good until the next call.
+            bool next(Tag &tag) {
+                while (true) {
+                    size_t found;
+                    while ((found = text.find('<', position)) == std::string::npos) {
+                        position = text.size();
+                        if (!refill()) return false;
+                    } position = found;
+
+                    // Enough of it to tell what sort of tag it is, unless the text ends first
+                    while (text.size() - position < 9 && refill()) {}
+                    const std::string_view rest = std::string_view(text).substr(position);
+                    if (rest.starts_with("<?")) skipPast("?>");
+                    else if (rest.starts_with("<!--")) skipPast("-->");
+                    else if (rest.starts_with("<![CDATA[")) skipPast("]]>");
+                    else if (rest.starts_with("<!")) skipPast(">");
+                    else break;
+                }
+
+                // Attribute values can have a '>' in them, so this has to look out for quotes. It goes by how far
+                // it's got from the '<', since refilling moves that to the start.
+                char quote = '\0';
+                size_t length = 1;
+                for (;; length++) {
+                    if (position + length == text.size() && !refill())
+                        throw std::runtime_error("Failed to parse XML, unterminated tag!");
+                    const char c = text[position + length];
+                    if (quote != '\0') {
+                        if (c == quote) quote = '\0';
+                    } else if (c == '"' || c == '\'') quote = c;
+                    else if (c == '>') break;
+                }
+
+                std::string_view content = std::string_view(text).substr(position + 1, length - 1);
+                position += length + 1;
+                tag.closing = content.starts_with('/');
+                if (tag.closing) content.remove_prefix(1);
+                tag.selfClosing = content.ends_with('/');
+                if (tag.selfClosing) content.remove_suffix(1);
+
+                const size_t nameEnd = std::min(content.find_first_of(" \t\r\n"), content.size());
+                tag.name = content.substr(0, nameEnd);
+                if (const size_t colon = tag.name.find(':'); colon != std::string_view::npos)
+                    tag.name.remove_prefix(colon + 1);
+                tag.attributes = content.substr(nameEnd);
+                return true;
+            }
+
+            // Empty if it isn't there. Entities aren't decoded, since we only ever read numbers and paths.
+            [[nodiscard]] static std::string_view getAttribute(std::string_view attributes,
+                                                               const std::string_view name) {
+                while (true) {
+                    const size_t nameBegin = attributes.find_first_not_of(" \t\r\n");
+                    if (nameBegin == std::string_view::npos) return {};
+                    attributes.remove_prefix(nameBegin);
+
+                    const size_t equals = attributes.find('=');
+                    if (equals == std::string_view::npos) return {};
+                    std::string_view attribute = attributes.substr(0, equals);
+                    attribute = attribute.substr(0, std::min(attribute.find_first_of(" \t\r\n"), attribute.size()));
+
+                    const size_t valueBegin = attributes.find_first_of("\"'", equals);
+                    if (valueBegin == std::string_view::npos) return {};
+                    const size_t valueEnd = attributes.find(attributes[valueBegin], valueBegin + 1);
+                    if (valueEnd == std::string_view::npos) return {};
+                    if (attribute == name) return attributes.substr(valueBegin + 1, valueEnd - valueBegin - 1);
+                    attributes.remove_prefix(valueEnd + 1);
+                }
+            }
+        private:
+            Source source;
+            std::string text;
+            size_t position = 0;
+
+            // Throws away everything before the position, and adds the next chunk. False if there wasn't one.
+            bool refill() {
+                text.erase(0, position);
+                position = 0;
+                const size_t kept = text.size();
+                text.resize(kept + XML_CHUNK_SIZE);
+                text.resize(kept + source(text.data() + kept, XML_CHUNK_SIZE));
+                return text.size() > kept;
+            }
+
+            void skipPast(const std::string_view end) {
+                while (true) {
+                    const size_t found = text.find(end, position);
+                    if (found != std::string::npos) {
+                        position = found + end.size();
+                        return;
+                    }
+                    // The end could be split between this chunk and the next one
+                    position = std::max(position, text.size() - std::min(text.size(), end.size() - 1));
+                    if (!refill()) {
+                        position = text.size();
+                        return;
+                    }
+                }
+            }
+        };
+
+        // from_chars doesn't take a leading plus, but 3MF numbers can have one
+        template<typename T>
+        bool parseNumber(std::string_view text, T &value) {
+            if (text.starts_with('+')) text.remove_prefix(1);
+            const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            return error == std::errc{} && end == text.data() + text.size() && !text.empty();
+        }
+
+        struct Component {
+            uint32_t objectId;
+            glm::mat4 transform;
+        };
+    }
+
+    // The package is a zip, with the mesh as XML in one of the files inside. That file gets read twice, a chunk at a
+    // time (inflating it on the way, if it's compressed): once for the build, which comes after every object and says
+    // where they go, and then again for the objects, whose vertices go straight to the welder, a batch at a time. So
+    // apart from the mesh it ends up with, it only ever holds on to a chunk of XML, a batch, and the components.
+    void Model::Builder::load3mf(const std::string &path, const uint32_t threadCount) {
+        ZoneScoped;
+        const MappedFile file(path);
+        if (!file.isOpen()) throw std::runtime_error("Failed to open " + path + "!");
+        const auto fail = [&path](const std::string &reason) {
+            throw std::runtime_error("Failed to load " + path + ", " + reason + "!");
+        };
+
+        const std::byte *data = file.getData();
+        const size_t size = file.getSize();
+        if (size < END_OF_DIRECTORY_SIZE) fail("it's too small to be a zip");
+
+        // The end of the central directory comes last, but there can be a comment of up to 64K after it
+        size_t endOfDirectory = size - END_OF_DIRECTORY_SIZE;
+        const size_t lowest = size > END_OF_DIRECTORY_SIZE + 0xffff ? size - END_OF_DIRECTORY_SIZE - 0xffff : 0;
+        while (read<uint32_t>(data + endOfDirectory) != END_OF_DIRECTORY_SIGNATURE) {
+            if (endOfDirectory == lowest) fail("it isn't a zip");
+            endOfDirectory--;
+        }
+
+        const auto entryCount = read<uint16_t>(data + endOfDirectory + 10);
+        const auto directorySize = read<uint32_t>(data + endOfDirectory + 12);
+        const auto directoryOffset = read<uint32_t>(data + endOfDirectory + 16);
+        if (entryCount == 0xffff || directoryOffset == 0xffffffff) fail("ZIP64 isn't supported");
+        if (size_t{directoryOffset} + directorySize > endOfDirectory) fail("the zip's central directory is broken");
+
+        std::vector<ZipEntry> entries;
+        entries.reserve(entryCount);
+        for (size_t offset = directoryOffset; entries.size() < entryCount;) {
+            if (offset + DIRECTORY_ENTRY_SIZE > endOfDirectory ||
+                read<uint32_t>(data + offset) != DIRECTORY_ENTRY_SIGNATURE)
+                fail("the zip's central directory is broken");
+            const auto nameLength = read<uint16_t>(data + offset + 28);
+            const auto extraLength = read<uint16_t>(data + offset + 30);
+            const auto commentLength = read<uint16_t>(data + offset + 32);
+            if (offset + DIRECTORY_ENTRY_SIZE + nameLength > endOfDirectory)
+                fail("the zip's central directory is broken");
+            entries.push_back({
+                {reinterpret_cast<const char *>(data + offset + DIRECTORY_ENTRY_SIZE), nameLength},
+                read<uint16_t>(data + offset + 8),
+                read<uint16_t>(data + offset + 10),
+                read<uint32_t>(data + offset + 20),
+                read<uint32_t>(data + offset + 24),
+                read<uint32_t>(data + offset + 42)
+            });
+            offset += DIRECTORY_ENTRY_SIZE + nameLength + extraLength + commentLength;
+        }
+
+        // Stored files get copied out of the mapping a chunk at a time, and deflated ones get inflated the same way
+        const auto open = [&](const ZipEntry &entry) -> XmlScanner::Source {
+            const std::string name(entry.name);
+            if (entry.flags & 1) fail("encrypted zips aren't supported");
+            if (entry.compressedSize == 0xffffffff || entry.uncompressedSize == 0xffffffff ||
+                entry.localHeaderOffset == 0xffffffff)
+                fail("ZIP64 isn't supported");
+
+            const size_t header = entry.localHeaderOffset;
+            if (header + LOCAL_HEADER_SIZE > size || read<uint32_t>(data + header) != LOCAL_HEADER_SIGNATURE)
+                fail("the zip's local header for " + name + " is broken");
+            const size_t begin = header + LOCAL_HEADER_SIZE +
+                                 read<uint16_t>(data + header + 26) + read<uint16_t>(data + header + 28);
+            if (begin + entry.compressedSize > size) fail(name + " goes past the end of the zip");
+
+            if (entry.method == METHOD_STORED) {
+                if (entry.compressedSize != entry.uncompressedSize) fail(name + " is broken");
+                return [stored = data + begin, left = size_t{entry.uncompressedSize}](char *out, size_t count) mutable {
+                    count = std::min(count, left);
+                    std::memcpy(out, stored, count);
+                    stored += count;
+                    left -= count;
+                    return count;
+                };
+            } if (entry.method != METHOD_DEFLATED) fail(name + " uses an unsupported compression method");
+
+            // Shared, since std::function has to be able to copy it
+            const auto inflater = std::make_shared<Inflater>(data + begin, entry.compressedSize);
+            return [&fail, inflater, name, left = size_t{entry.uncompressedSize}](char *out, size_t count) mutable {
+                size_t inflated = 0;
+                try {
+                    inflated = inflater->read(out, count);
+                } catch (const std::runtime_error &) {
+                    fail("failed to inflate " + name);
+                }
+                // The directory says how big it is, so anything else means it's broken
+                if (inflated > left || (inflated == 0 && left > 0)) fail("failed to inflate " + name);
+                left -= inflated;
+                return inflated;
+            };
+        };
+
+        // The package's relationships say where the model is, which is almost always 3D/3dmodel.model
+        std::string modelPart = "3D/3dmodel.model";
+        for (const ZipEntry &entry : entries) {
+            if (!samePart(entry.name, "_rels/.rels")) continue;
+            XmlScanner scanner(open(entry));
+            XmlScanner::Tag tag{};
+            while (scanner.next(tag)) {
+                if (tag.closing || tag.name != "Relationship" ||
+                    !XmlScanner::getAttribute(tag.attributes, "Type").ends_with("/3dmodel"))
+                    continue;
+                // A copy, since the tag goes away with the scanner
+                modelPart = XmlScanner::getAttribute(tag.attributes, "Target");
+                break;
+            }
+        }
+
+        const ZipEntry *modelEntry = nullptr;
+        for (const ZipEntry &entry : entries) if (samePart(entry.name, modelPart)) modelEntry = &entry;
+        if (modelEntry == nullptr) fail("it has no 3D model in it");
+
+        const auto parseTransform = [&](const std::string_view text) {
+            // Twelve numbers, a 4x3 matrix that multiplies row vectors, so each row of it is one of our columns
+            glm::mat4 transform{1.0f};
+            if (text.empty()) return transform;
+            size_t begin = 0;
+            for (uint32_t i = 0; i < 12; i++) {
+                begin = text.find_first_not_of(" \t\r\n", begin);
+                const size_t end = std::min(text.find_first_of(" \t\r\n", begin), text.size());
+                if (begin == std::string_view::npos || !parseNumber(text.substr(begin, end - begin),
+                                                                    transform[static_cast<int>(i / 3)]
+                                                                             [static_cast<int>(i % 3)]))
+                    fail("invalid transform");
+                begin = end;
+            } return transform;
+        };
+        const auto parseId = [&](const std::string_view text) {
+            uint32_t id = 0;
+            if (!parseNumber(text, id)) fail("invalid object id");
+            return id;
+        };
+
+        // Every object's components, empty if it doesn't have any, so this is also which objects there are
+        std::unordered_map<uint32_t, std::vector<Component>> objects;
+        std::vector<uint32_t> objectIds; // In the order they come in
+        std::vector<Component> items; // The build, which is what actually gets loaded
+        {
+            ZoneScopedN("Read 3MF build");
+            XmlScanner scanner(open(*modelEntry));
+            XmlScanner::Tag tag{};
+            std::vector<Component> *components = nullptr;
+            while (scanner.next(tag)) {
+                if (tag.name == "object") {
+                    components = nullptr;
+                    if (tag.closing || tag.selfClosing) continue;
+                    // Objects are only ever added, so the map never moves the one we're pointing at
+                    const uint32_t id = parseId(XmlScanner::getAttribute(tag.attributes, "id"));
+                    const auto [object, added] = objects.try_emplace(id);
+                    if (added) objectIds.push_back(id);
+                    components = &object->second;
+                } else if (tag.closing) continue;
+                else if (tag.name == "item") {
+                    items.push_back({parseId(XmlScanner::getAttribute(tag.attributes, "objectid")),
+                                     parseTransform(XmlScanner::getAttribute(tag.attributes, "transform"))});
+                } else if (tag.name == "component" && components != nullptr) {
+                    components->push_back({parseId(XmlScanner::getAttribute(tag.attributes, "objectid")),
+                                           parseTransform(XmlScanner::getAttribute(tag.attributes, "transform"))});
+                }
+            }
+        }
+
+        // The build's required, but anything without one might as well show everything it has
+        if (items.empty()) for (const uint32_t id : objectIds) items.push_back({id, glm::mat4{1.0f}});
+
+        // Every transform each object gets placed with, components included
+        std::unordered_map<uint32_t, std::vector<glm::mat4>> placements;
+        std::function<void(uint32_t, const glm::mat4 &, uint32_t)> place;
+        place = [&](const uint32_t id, const glm::mat4 &transform, const uint32_t depth) {
+            if (depth > MAX_COMPONENT_DEPTH) fail("its components are nested too deep");
+            const auto found = objects.find(id);
+            if (found == objects.end()) fail("object " + std::to_string(id) + " doesn't exist");
+            placements[id].push_back(transform);
+            for (const Component &component : found->second)
+                place(component.objectId, transform * component.transform, depth + 1);
+        };
+        for (const Component &item : items) place(item.objectId, item.transform, 0);
+
+        vertices.clear();
+        indices.clear();
+
+        WorkerPool pool(std::max(2u, threadCount) - 1); // Our own, since the shared one might be the one running this
+        ParallelVertexWelder welder(pool, threadCount, weldEpsilon);
+        std::vector<Vertex> batch;
+        batch.reserve(BATCH_VERTICES);
+        // Where each vertex of every placed object ended up, since the triangles keep pointing at those until the end
+        std::vector<uint32_t> welded;
+        {
+            ZoneScopedN("Weld 3MF objects");
+            XmlScanner scanner(open(*modelEntry));
+            XmlScanner::Tag tag{};
+
+            // The triangles are already indexed, so only the vertices get welded, on their position alone. Every
+            // placement of the object we're in gets its own copy of each vertex, one after the other, so vertex v of
+            // placement p is at base + v * placements + p.
+            uint32_t id = 0;
+            const std::vector<glm::mat4> *transforms = nullptr; // Null if it isn't placed anywhere
+            size_t base = 0;
+            uint32_t vertexCount = 0;
+            uint64_t referenced = 0; // One past the highest vertex a triangle used, since they could come first
+            const auto finishObject = [&] {
+                if (transforms != nullptr && referenced > vertexCount)
+                    fail("object " + std::to_string(id) + " has a triangle with a vertex that doesn't exist");
+                transforms = nullptr;
+            };
+
+            while (scanner.next(tag)) {
+                if (tag.name == "object") {
+                    finishObject();
+                    if (tag.closing || tag.selfClosing) continue;
+                    id = parseId(XmlScanner::getAttribute(tag.attributes, "id"));
+                    const auto found = placements.find(id);
+                    if (found == placements.end()) continue;
+                    transforms = &found->second;
+                    base = welded.size() + batch.size();
+                    vertexCount = 0;
+                    referenced = 0;
+                } else if (tag.closing || transforms == nullptr) continue;
+                else if (tag.name == "vertex") {
+                    glm::vec3 position;
+                    if (!parseNumber(XmlScanner::getAttribute(tag.attributes, "x"), position.x) ||
+                        !parseNumber(XmlScanner::getAttribute(tag.attributes, "y"), position.y) ||
+                        !parseNumber(XmlScanner::getAttribute(tag.attributes, "z"), position.z))
+                        fail("invalid vertex");
+                    if (base + (size_t{vertexCount} + 1) * transforms->size() > std::numeric_limits<uint32_t>::max())
+                        fail("it's too big");
+                    vertexCount++;
+
+                    for (const glm::mat4 &transform : *transforms) {
+                        batch.push_back({glm::vec3(transform * glm::vec4(position, 1.0f)),
+                                         glm::vec3{1.0f}, glm::vec3{0.0f}, glm::vec2{0.0f}});
+                        if (batch.size() == batch.capacity()) {
+                            welder.weld(batch, welded);
+                            batch.clear();
+                        }
+                    }
+                } else if (tag.name == "triangle") {
+                    std::array<uint32_t, 3> triangle{};
+                    uint32_t *index = triangle.data();
+                    for (const std::string_view name : {"v1", "v2", "v3"}) {
+                        if (!parseNumber(XmlScanner::getAttribute(tag.attributes, name), *index))
+                            fail("invalid triangle");
+                        referenced = std::max(referenced, uint64_t{*index++} + 1);
+                    }
+                    if (indices.size() + 3 * transforms->size() > std::numeric_limits<uint32_t>::max())
+                        fail("it's too big");
+
+                    // Anything out of bounds fails once the object's done, before these ever get used
+                    const size_t placementCount = transforms->size();
+                    for (size_t placement = 0; placement < placementCount; placement++)
+                        for (const uint32_t index : triangle)
+                            indices.push_back(static_cast<uint32_t>(base + index * placementCount + placement));
+                }
+            } finishObject();
+        }
+
+        welder.weld(batch, welded);
+        welder.finish(vertices, welded);
+        for (uint32_t &index : indices) index = welded[index];
+        computeSmoothNormals(pool);
+    }
+}
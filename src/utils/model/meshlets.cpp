@@ -0,0 +1,147 @@
+#include <limits>
+#include <algorithm>
+
+#include "model.hpp"
+
+namespace Engine {
+    namespace {
+        constexpr uint32_t NO_TRIANGLE = std::numeric_limits<uint32_t>::max();
+
+        // Bounding sphere plus a cone that contains the normals of every triangle, so we can tell when the whole
+        // meshlet is facing away from the camera
+        void computeMeshletBounds(Model::Meshlet &meshlet,
+                                  const std::vector<Model::Vertex> &vertices,
+                                  const std::vector<uint32_t> &meshletIndices,
+                                  const std::vector<uint32_t> &meshletVertices) {
+            glm::vec3 minBounds = vertices[meshletVertices[0]].position;
+            glm::vec3 maxBounds = minBounds;
+            for (const uint32_t vertex : meshletVertices) {
+                minBounds = glm::min(minBounds, vertices[vertex].position);
+                maxBounds = glm::max(maxBounds, vertices[vertex].position);
+            }
+
+            meshlet.center = (minBounds + maxBounds) * 0.5f;
+            meshlet.radius = 0.0f;
+            for (const uint32_t vertex : meshletVertices)
+                meshlet.radius = std::max(meshlet.radius, glm::length(vertices[vertex].position - meshlet.center));
+
+            std::vector<glm::vec3> normals;
+            normals.reserve(meshletIndices.size() / 3);
+            glm::vec3 axis{0.0f};
+            for (size_t i = 0; i < meshletIndices.size(); i += 3) {
+                const Model::Vertex &v0 = vertices[meshletIndices[i]];
+                const Model::Vertex &v1 = vertices[meshletIndices[i + 1]];
+                const Model::Vertex &v2 = vertices[meshletIndices[i + 2]];
+
+                glm::vec3 normal = glm::cross(v1.position - v0.position, v2.position - v0.position);
+                const float length = glm::length(normal);
+                if (length <= 0.0f) continue; // Degenerate triangles can't be seen anyway
+
+                // Not every mesh agrees on the winding order, so we trust the vertex normals on which side is the front
+                normal /= length;
+                if (glm::dot(normal, v0.normal + v1.normal + v2.normal) < 0.0f) normal = -normal;
+                normals.push_back(normal);
+                axis += normal;
+            }
+
+            // If we can't tell where it's facing, just never cull it
+            meshlet.coneAxis = glm::vec3{0.0f, 0.0f, 1.0f};
+            meshlet.coneCutoff = 1.0f;
+            if (normals.empty() || glm::length(axis) < 1e-6f) return;
+            axis = glm::normalize(axis);
+
+            float minDot = 1.0f;
+            for (const glm::vec3 &normal : normals) minDot = std::min(minDot, glm::dot(axis, normal));
+
+            // Cones wider than a hemisphere (or close to it) would almost never get culled, so don't even bother
+            meshlet.coneAxis = axis;
+            if (minDot > 0.1f) meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+
+    void Model::Builder::buildMeshlets() {
+        ZoneScoped;
+        meshlets.clear();
+        if (indices.empty()) return; // Everything's a triangle list, so we need an index buffer to make clusters
+        if (lods.empty()) lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f, 0, 0});
+
+        // The meshlet each vertex currently belongs to, so we can check for that without a set
+        std::vector<uint32_t> vertexMeshlet(vertices.size(), std::numeric_limits<uint32_t>::max());
+
+        for (LOD &lod : lods) {
+            lod.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+            const uint32_t triangleCount = lod.indexCount / 3;
+            const uint32_t *triangles = indices.data() + lod.firstIndex;
+
+            // Triangles around each vertex, so we can grow the meshlets through their neighbours. Stored flat, the
+            // triangles of vertex v go from vertexTriangles[triangleOffsets[v]] to vertexTriangles[triangleOffsets[v + 1]]
+            std::vector<uint32_t> triangleOffsets(vertices.size() + 1, 0);
+            for (uint32_t i = 0; i < 3 * triangleCount; i++) triangleOffsets[triangles[i] + 1]++;
+            for (size_t i = 1; i < triangleOffsets.size(); i++) triangleOffsets[i] += triangleOffsets[i - 1];
+            std::vector<uint32_t> vertexTriangles(triangleOffsets.back());
+            std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (uint32_t i = 0; i < 3 * triangleCount; i++) vertexTriangles[fill[triangles[i]]++] = i / 3;
+
+            std::vector<bool> emitted(triangleCount, false);
+            std::vector<uint32_t> reordered;
+            reordered.reserve(lod.indexCount);
+
+            std::vector<uint32_t> meshletIndices;
+            std::vector<uint32_t> meshletVertices;
+            uint32_t seed = 0;
+            while (true) {
+                // Every meshlet starts from the first triangle nobody has taken yet
+                while (seed < triangleCount && emitted[seed]) seed++;
+                if (seed == triangleCount) break;
+
+                const auto meshletId = static_cast<uint32_t>(meshlets.size());
+                meshletIndices.clear();
+                meshletVertices.clear();
+
+                uint32_t triangle = seed;
+                while (triangle != NO_TRIANGLE) {
+                    emitted[triangle] = true;
+                    for (uint32_t i = 0; i < 3; i++) {
+                        const uint32_t vertex = triangles[3 * triangle + i];
+                        meshletIndices.push_back(vertex);
+                        if (vertexMeshlet[vertex] == meshletId) continue;
+                        vertexMeshlet[vertex] = meshletId;
+                        meshletVertices.push_back(vertex);
+                    }
+                    if (meshletIndices.size() == 3 * MAX_MESHLET_TRIANGLES) break;
+
+                    // Grow through the neighbour that adds the fewest new vertices, which keeps the meshlets compact
+                    triangle = NO_TRIANGLE;
+                    uint32_t bestNewVertices = 3;
+                    for (const uint32_t vertex : meshletVertices) {
+                        for (uint32_t j = triangleOffsets[vertex]; j < triangleOffsets[vertex + 1]; j++) {
+                            const uint32_t candidate = vertexTriangles[j];
+                            if (emitted[candidate]) continue;
+
+                            uint32_t newVertices = 0;
+                            for (uint32_t k = 0; k < 3; k++)
+                                newVertices += vertexMeshlet[triangles[3 * candidate + k]] != meshletId ? 1 : 0;
+                            if (meshletVertices.size() + newVertices > MAX_MESHLET_VERTICES) continue;
+                            if (newVertices >= bestNewVertices) continue;
+
+                            triangle = candidate;
+                            bestNewVertices = newVertices;
+                            if (newVertices == 0) break;
+                        } if (bestNewVertices == 0) break;
+                    }
+                }
+
+                Meshlet meshlet{};
+                meshlet.firstIndex = lod.firstIndex + static_cast<uint32_t>(reordered.size());
+                meshlet.indexCount = static_cast<uint32_t>(meshletIndices.size());
+                meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+                computeMeshletBounds(meshlet, vertices, meshletIndices, meshletVertices);
+                meshlets.push_back(meshlet);
+                reordered.insert(reordered.end(), meshletIndices.begin(), meshletIndices.end());
+            }
+
+            std::ranges::copy(reordered, indices.begin() + lod.firstIndex);
+            lod.meshletCount = static_cast<uint32_t>(meshlets.size()) - lod.firstMeshlet;
+        }
+    }
+}
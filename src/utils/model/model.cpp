@@ -1,25 +1,68 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 // #define TINYOBJLOADER_USE_MAPBOX_EARCUT
 
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <filesystem>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
 #include "model.hpp"
+#include "simplifier.hpp"
+#include "../glb/glb.hpp"
+#include "../meshcache/meshcache.hpp"
+#include "../vertexwelder/vertexwelder.hpp"
+#include "../uploadservice/uploadservice.hpp"
 
-template<>
-struct std::hash<Engine::Model::Vertex> {
-    size_t operator()(Engine::Model::Vertex const &vertex) const noexcept {
-        size_t seed = 0;
-        hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.texCoord);
-        return seed;
+namespace Engine {
+    namespace {
+        // Folds the lower hemisphere over the upper one, so a unit vector fits in two numbers in [-1, 1]
+        glm::i16vec2 encodeOctahedral(const glm::vec3 &normal) {
+            const float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+            if (sum == 0.0f) return glm::i16vec2{0};
+
+            glm::vec2 encoded = glm::vec2(normal) / sum;
+            if (normal.z < 0.0f) {
+                const glm::vec2 sign{encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f};
+                encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * sign;
+            } return glm::i16vec2(glm::round(glm::clamp(encoded, -1.0f, 1.0f) * 32767.0f));
+        }
     }
-};
 
-namespace Engine {
-    Model::Model(const Device &device, const Model::Builder &builder) : device(device) {
-        createVertexBuffer(builder.vertices);
-        createIndexBuffer(builder.indices);
+    Model::Model(Device &device, const View &view) : device(device),
+                                                     compressed(view.compressed),
+                                                     topLeftTexCoords(view.topLeftTexCoords),
+                                                     lods(view.lods.begin(), view.lods.end()),
+                                                     meshlets(view.meshlets.begin(), view.meshlets.end()) {
+        ZoneScoped;
+        computeBounds(view.vertices);
+        createGeometry(view);
+
+        // Models without any LODs just get the whole thing as the only one
+        if (lods.empty()) lods.push_back({0, isIndexed() ? geometry.indexCount : geometry.vertexCount, 0.0f, 0, 0});
+        createOccluderMesh(view);
     }
-    Model::~Model() = default;
+    Model::~Model() { device.getGeometryArena().free(geometry); }
+
+    void Model::Builder::loadModel(const std::string &path, const uint32_t threadCount) {
+        ZoneScoped;
+        std::string extension = std::filesystem::path(path).extension().string();
+        std::ranges::transform(extension, extension.begin(), [](const unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+        if (extension == ".stl") {
+            loadStl(path, threadCount);
+            return;
+        } if (extension == ".3mf") {
+            load3mf(path, threadCount);
+            return;
+        } if (threadCount > 1 && loadModelParallel(path, threadCount)) return;
 
-    void Model::Builder::loadModel(const std::string &path) {
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
         std::vector<tinyobj::material_t> materials;
@@ -34,7 +77,7 @@ namespace Engine {
         vertices.reserve(attrib.vertices.size());
         indices.reserve(attrib.vertices.size());
 
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+        VertexWelder welder(vertices, attrib.vertices.size() / 3);
         for (const tinyobj::shape_t &shape : shapes) {
             for (const auto &[vertex_index, normal_index, texcoord_index] : shape.mesh.indices) {
                 Vertex vertex{};
@@ -70,85 +113,198 @@ namespace Engine {
                     };
                 }
 
-                if (!uniqueVertices.contains(vertex)) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                } indices.push_back(uniqueVertices[vertex]);
+                indices.push_back(welder.weld(vertex));
             }
         }
     }
 
-    std::unique_ptr<Model> Model::createModelFromFile(Device &device, const std::string &path) {
+    void Model::Builder::generateLODs(const uint32_t maxLODs, const float reduction) {
+        ZoneScoped;
+        assert(maxLODs > 0 && maxLODs <= MAX_LODS && "Invalid LOD count!");
+        assert(reduction > 0.0f && reduction < 1.0f && "The reduction must be between 0 and 1!");
+
+        // Throw away any previous LODs, so we start from the full mesh
+        if (!lods.empty()) indices.resize(lods[0].indexCount);
+        lods.clear();
+        meshlets.clear();
+        lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f, 0, 0});
+        if (indices.empty()) return; // We need an index buffer to share the vertices between LODs
+
+        MeshSimplifier simplifier(vertices, indices);
+        size_t targetIndexCount = indices.size();
+        for (uint32_t i = 1; i < maxLODs; i++) {
+            targetIndexCount = static_cast<size_t>(static_cast<float>(targetIndexCount) * reduction) / 3 * 3;
+            std::vector<uint32_t> lodIndices = simplifier.simplify(targetIndexCount);
+
+            // If we can't get meaningfully simpler than the previous one, there's no point on going further
+            if (lodIndices.empty() ||
+                static_cast<float>(lodIndices.size()) > 0.9f * static_cast<float>(lods.back().indexCount)) break;
+
+            lods.push_back({static_cast<uint32_t>(indices.size()),
+                            static_cast<uint32_t>(lodIndices.size()),
+                            simplifier.getError(),
+                            0,
+                            0});
+            indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+        }
+    }
+
+    std::unique_ptr<Model> Model::createModelFromFile(Device &device, const std::string &path, const bool compressed) {
+        return prepareModelFromFile(path, compressed)(device);
+    }
+
+    Model::Prepared Model::prepareModelFromFile(const std::string &path, const bool compressed) {
+        ZoneScoped;
+        ZoneText(path.c_str(), path.size());
+        const MeshCache cache{};
+        if (std::unique_ptr<MeshCache::Mapping> mapping = cache.load(path)) {
+            return [mapping = std::move(mapping), compressed](Device &device) {
+                return std::make_unique<Model>(device, mapping->getView(compressed));
+            };
+        }
+
+        std::error_code error;
+        const bool parallel = std::filesystem::file_size(path, error) >= PARALLEL_LOAD_SIZE && !error;
         Builder builder{};
-        builder.loadModel(path);
-        return std::make_unique<Model>(device, builder);
-    }
-
-    void Model::createVertexBuffer(const std::vector<Vertex> &vertices) {
-        vertexCount = static_cast<uint32_t>(vertices.size());
-        assert(vertexCount >= 3 && "Vertex count must be of at least 3!");
-
-        uint32_t vertexSize = sizeof(vertices[0]);
-
-        // For more information on staging buffers, see https://vulkan-tutorial.com/Vertex_buffers/Staging_buffer
-        Buffer stagingBuffer{
-            device,
-            vertexSize,
-            vertexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        };
-
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)vertices.data());
-
-        vertexBuffer = std::make_unique<Buffer>(
-            device,
-            vertexSize,
-            vertexCount,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        device.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), vertexSize * vertexCount);
-    }
-
-    void Model::createIndexBuffer(const std::vector<uint32_t> &indices) {
-        indexCount = static_cast<uint32_t>(indices.size());
-        hasIndexBuffer = indexCount > 0;
-        if (!hasIndexBuffer) return;
-        assert(indexCount >= 3 && "Index count must be of at least 3!");
-
-        uint32_t indexSize = sizeof(indices[0]);
-
-        // For more information on staging buffers, see https://vulkan-tutorial.com/Vertex_buffers/Staging_buffer
-        Buffer stagingBuffer{
-                device,
-                indexSize,
-                indexCount,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        };
-
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)indices.data());
-
-        indexBuffer = std::make_unique<Buffer>(
-                device,
-                indexSize,
-                indexCount,
-                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        device.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), indexSize * indexCount);
+        builder.compressed = compressed;
+        builder.loadModel(path, parallel ? std::max(1u, std::thread::hardware_concurrency()) : 1);
+        builder.generateLODs();
+        builder.buildMeshlets();
+        builder.optimize();
+        if (!cache.store(path, builder)) std::cerr << "Failed to cache " << path << std::endl;
+        return [builder = std::move(builder)](Device &device) { return std::make_unique<Model>(device, builder); };
+    }
+
+    std::vector<std::unique_ptr<Model>> Model::createModelsFromGlb(Device &device,
+                                                                   const std::string &path,
+                                                                   const bool compressed) {
+        ZoneScoped;
+        ZoneText(path.c_str(), path.size());
+        // The upload service copies everything to staging right away, so the file only has to stay mapped until then
+        const GlbFile file(path);
+        std::vector<std::unique_ptr<Model>> models;
+        models.reserve(file.getPrimitives().size());
+        for (const GlbFile::Primitive &primitive : file.getPrimitives())
+            models.push_back(std::make_unique<Model>(device, primitive.getView(compressed)));
+        return models;
+    }
+
+    void Model::computeBounds(const std::span<const Vertex> vertices) {
+        if (vertices.empty()) return;
+
+        // Not the tightest sphere, but close enough, and way simpler
+        glm::vec3 minBounds = vertices[0].position;
+        glm::vec3 maxBounds = vertices[0].position;
+        for (const Vertex &vertex : vertices) {
+            minBounds = glm::min(minBounds, vertex.position);
+            maxBounds = glm::max(maxBounds, vertex.position);
+        }
+
+        boundingCenter = (minBounds + maxBounds) * 0.5f;
+        boundingRadius = 0.0f;
+        for (const Vertex &vertex : vertices)
+            boundingRadius = std::max(boundingRadius, glm::length(vertex.position - boundingCenter));
+    }
+
+    void Model::createOccluderMesh(const View &view) {
+        if (!isIndexed()) return;
+
+        // The coarsest LOD is more than enough to occlude things with, and it keeps the rasteriser's job small
+        const LOD &coarsest = lods.back();
+        std::vector<uint32_t> remap(view.vertices.size(), std::numeric_limits<uint32_t>::max());
+        occluderIndices.reserve(coarsest.indexCount);
+        for (uint32_t i = coarsest.firstIndex; i < coarsest.firstIndex + coarsest.indexCount; i++) {
+            const uint32_t vertex = view.indices[i];
+            if (remap[vertex] == std::numeric_limits<uint32_t>::max()) {
+                remap[vertex] = static_cast<uint32_t>(occluderVertices.size());
+                occluderVertices.push_back(view.vertices[vertex].position);
+            } occluderIndices.push_back(remap[vertex]);
+        }
+    }
+
+    // Neither of these wait for the copies, the upload service makes sure they're done before the next frame uses them
+    void Model::createGeometry(const View &view) {
+        assert(view.vertices.size() >= 3 && "Vertex count must be of at least 3!");
+        assert((view.indices.empty() || view.indices.size() >= 3) && "Index count must be of at least 3!");
+        if (compressed) {
+            createCompressedGeometry(view);
+            return;
+        }
+
+        geometry = device.getGeometryArena().allocate(view.vertices.data(),
+                                                      static_cast<uint32_t>(sizeof(Vertex)),
+                                                      static_cast<uint32_t>(view.vertices.size()),
+                                                      view.indices.data(),
+                                                      static_cast<uint32_t>(view.indices.size()));
+    }
+
+    void Model::createCompressedGeometry(const View &view) {
+        ZoneScoped;
+        glm::vec3 minBounds = view.vertices[0].position;
+        glm::vec3 maxBounds = view.vertices[0].position;
+        for (const Vertex &vertex : view.vertices) {
+            minBounds = glm::min(minBounds, vertex.position);
+            maxBounds = glm::max(maxBounds, vertex.position);
+        }
+
+        // Flat models just get every vertex at the minimum on that axis, instead of dividing by zero
+        const glm::vec3 extent = maxBounds - minBounds;
+        glm::vec3 invExtent{0.0f};
+        for (glm::length_t i = 0; i < 3; i++) if (extent[i] > 0.0f) invExtent[i] = 1.0f / extent[i];
+        dequantizationMatrix = glm::scale(glm::translate(glm::mat4{1.0f}, minBounds), extent);
+
+        std::vector<CompressedVertex> vertices(view.vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const Vertex &vertex = view.vertices[i];
+            const glm::vec3 position = glm::clamp((vertex.position - minBounds) * invExtent, 0.0f, 1.0f);
+            vertices[i].position = glm::u16vec4(glm::round(glm::vec4(position, 0.0f) * 65535.0f));
+            vertices[i].normal = encodeOctahedral(vertex.normal);
+            vertices[i].color = glm::u8vec4(glm::round(glm::clamp(glm::vec4(vertex.color, 1.0f), 0.0f, 1.0f) * 255.0f));
+            vertices[i].texCoord = {glm::packHalf1x16(vertex.texCoord.x), glm::packHalf1x16(vertex.texCoord.y)};
+        }
+
+        geometry = device.getGeometryArena().allocate(vertices.data(),
+                                                      static_cast<uint32_t>(sizeof(CompressedVertex)),
+                                                      static_cast<uint32_t>(vertices.size()),
+                                                      view.indices.data(),
+                                                      static_cast<uint32_t>(view.indices.size()));
     }
 
     void Model::bind(const VkCommandBuffer commandBuffer) const {
-        const VkBuffer buffers[] = { vertexBuffer->getBuffer() };
-        constexpr VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-        if (hasIndexBuffer) vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+        device.getGeometryArena().bind(commandBuffer, geometry.chunk);
     }
-    void Model::draw(const VkCommandBuffer commandBuffer) const {
-        if (hasIndexBuffer) vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
-        else vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    void Model::draw(const VkCommandBuffer commandBuffer, const uint32_t lod) const {
+        assert(lod < lods.size() && "Invalid LOD!");
+        if (isIndexed()) {
+            vkCmdDrawIndexed(commandBuffer,
+                             lods[lod].indexCount,
+                             1,
+                             geometry.firstIndex + lods[lod].firstIndex,
+                             getVertexOffset(),
+                             0);
+        } else vkCmdDraw(commandBuffer, geometry.vertexCount, 1, geometry.firstVertex, 0);
+    }
+
+    // The arena narrows the indices the same way, so this is exactly what the model's ranges take up
+    VkDeviceSize Model::getMemorySize() const {
+        const VkDeviceSize vertexSize = compressed ? sizeof(CompressedVertex) : sizeof(Vertex);
+        const VkDeviceSize indexSize = geometry.vertexCount < GeometryArena::MAX_SHORT_INDEX_VERTICES ? 2 : 4;
+        return vertexSize * geometry.vertexCount + indexSize * geometry.indexCount;
+    }
+
+    uint32_t Model::selectLOD(const float screenSize, uint32_t currentLOD) const {
+        // Pick the simplest LOD whose error would still be smaller than the budget once projected
+        uint32_t lod = 0;
+        for (uint32_t i = static_cast<uint32_t>(lods.size()) - 1; i > 0; i--) {
+            if (lods[i].error * screenSize > MAX_SCREEN_ERROR) continue;
+            lod = i;
+            break;
+        }
+
+        // Going to a finer LOD happens right away, but for a coarser one we want to be comfortably within the budget
+        currentLOD = std::min(currentLOD, static_cast<uint32_t>(lods.size()) - 1);
+        while (lod > currentLOD && lods[lod].error * screenSize > MAX_SCREEN_ERROR * (1.0f - LOD_HYSTERESIS)) lod--;
+        return lod;
     }
 
     std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindingDescriptions() {
@@ -193,4 +349,24 @@ namespace Engine {
         */
         return attributeDescriptions;
     }
-}
\ No newline at end of file
+
+    std::vector<VkVertexInputBindingDescription> Model::CompressedVertex::getBindingDescriptions() {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = sizeof(CompressedVertex);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescriptions;
+    }
+    // All of these have to support VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT, so no need to check for them
+    std::vector<VkVertexInputAttributeDescription> Model::CompressedVertex::getAttributeDescriptions() {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+        attributeDescriptions.push_back({0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(CompressedVertex, position)});
+        attributeDescriptions.push_back({1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompressedVertex, color)});
+        attributeDescriptions.push_back({2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompressedVertex, normal)});
+        attributeDescriptions.push_back({3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompressedVertex, texCoord)});
+
+        return attributeDescriptions;
+    }
+}
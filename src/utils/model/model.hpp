@@ -2,24 +2,29 @@
 #define MODEL_HPP
 
 #include <memory>
+#include <functional>
+#include <span>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 #include "../../../libs/tinyobjloader/tiny_obj_loader.h"
+#include <tracy/Tracy.hpp>
 
 #include "../utils.hpp"
 #include "../device/device.hpp"
 #include "../buffer/buffer.hpp"
-
-// TODO(Dory): Add support for importing .stl and .3mf files
-// This are the ones I care about, rest can be added later
+#include "../geometryarena/geometryarena.hpp"
 
 // TODO(Dory): Add support for tangents and bitangents
 namespace Engine {
+    class WorkerPool;
+
     class Model {
     public:
         struct Vertex {
@@ -39,41 +44,196 @@ namespace Engine {
             }
         };
 
+        // Same thing, squeezed into 20 bytes instead of 44. The position is relative to the model's bounding box, which
+        // gets folded into the model matrix (see getDequantizationMatrix), and the normal is octahedral encoded.
+        struct CompressedVertex {
+            glm::u16vec4 position; // unorm16, the last one's just padding // 8 bytes
+            glm::i16vec2 normal; // snorm16 // 4 bytes
+            glm::u8vec4 color; // unorm8, alpha is always 1 // 4 bytes
+            glm::u16vec2 texCoord; // Half floats // 4 bytes
+
+            static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+            static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+        };
+
+        // A small cluster of triangles, which can be culled on its own. Laid out so it can go in a storage buffer as is.
+        struct Meshlet {
+            glm::vec3 center; // 12 bytes
+            float radius; // 4 bytes
+            glm::vec3 coneAxis; // 12 bytes
+            float coneCutoff; // Sine of the cone's half angle, 1 means it can't be backface culled // 4 bytes
+            uint32_t firstIndex; // 4 bytes
+            uint32_t indexCount; // 4 bytes
+            uint32_t vertexCount; // 4 bytes
+            uint32_t padding; // 4 bytes
+        };
+
+        // A range of the index buffer, all LODs share the same vertex buffer
+        struct LOD {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            float error; // How far the surface might be from the original, relative to the bounding radius of the model
+            uint32_t firstMeshlet;
+            uint32_t meshletCount;
+        };
+
+        static constexpr uint32_t MAX_LODS = 5;
+        // How much error we're willing to put up with, relative to the screen height (about a pixel at 1080p)
+        static constexpr float MAX_SCREEN_ERROR = 0.002f;
+        // How far under the error budget a coarser LOD has to be before we switch to it, to avoid popping back and forth
+        static constexpr float LOD_HYSTERESIS = 0.25f;
+
+        // Same limits mesh shaders usually go for, so the meshlets can be fed straight to them
+        static constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+        static constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+        // The FIFO post-transform cache the optimiser plans for, small enough that bigger caches get most of the benefit
+        static constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+        // A finished mesh, without owning any of it, so models can come straight out of a memory mapped mesh cache
+        struct View {
+            std::span<const Vertex> vertices;
+            std::span<const uint32_t> indices;
+            std::span<const LOD> lods;
+            std::span<const Meshlet> meshlets;
+            bool compressed = false;
+            // glTF's texture coordinates start at the top instead of the bottom, they get flipped back at draw time, so
+            // the vertices can still come straight out of the file
+            bool topLeftTexCoords = false;
+        };
+
         struct Builder {
             std::vector<Vertex> vertices{};
-            std::vector<uint32_t> indices{};
+            std::vector<uint32_t> indices{}; // All the LODs, one after the other
+            std::vector<LOD> lods{};
+            std::vector<Meshlet> meshlets{}; // All the LODs, one after the other
+            bool compressed = false; // Uploads CompressedVertex instead, the render systems pick the right pipeline
+            // Only for STL and 3MF, positions this close (on every axis) get welded too, 0 only welds exact matches
+            float weldEpsilon = 0.0f;
+            // Only for STL and 3MF, triangles meeting at more than this (in radians) don't smooth each other's normals.
+            // 40 degrees keeps the edges of boxes and such sharp, while still smoothing out tessellated curves. Pi or
+            // more smooths across every edge, which is a lot cheaper too.
+            float creaseAngle = glm::radians(40.0f);
 
             Builder() = default;
             Builder(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) :
             vertices(vertices), indices(indices) {}
-            ~Builder() = default;
 
-            void loadModel(const std::string &path);
+            // Picks the format from the extension: binary .stl, .3mf, or anything else is .obj.
+            // For OBJ files, more than one thread goes through the multithreaded parser instead, and welds the vertices
+            // in parallel too, which ends up with the exact same vertices and indices, just a lot faster on big files.
+            // That parser doesn't read vertex colors, or split polygons with more than 4 sides the same way, so files
+            // with either of those still go through the single threaded one.
+            // STL and 3MF files always get welded in parallel, a batch at a time, so the vertices come out grouped by
+            // which thread welded them, which optimize sorts out. Neither has colors or UVs, so those are white and 0.
+            // They get welded on position alone, and then get smooth normals (split at creaseAngle), since neither
+            // has any of its own worth keeping.
+            void loadModel(const std::string &path, uint32_t threadCount = 1);
+            // Each LOD tries to have reduction times the triangles of the previous one
+            void generateLODs(uint32_t maxLODs = MAX_LODS, float reduction = 0.5f);
+            // Splits each LOD into meshlets, reordering its indices so each meshlet is a contiguous range.
+            // Has to be called after generateLODs, since that throws the meshlets away.
+            void buildMeshlets();
+            // Reorders the triangles of each LOD for the vertex cache and then for overdraw, and the vertices in the order
+            // they're first used. Has to be called after buildMeshlets, since that reorders the triangles too, so this
+            // only reorders the triangles within each meshlet, and then the meshlets themselves.
+            void optimize();
+
+            // Average cache misses per triangle, with a FIFO cache of VERTEX_CACHE_SIZE. 0.5 is about as good as it gets.
+            [[nodiscard]] float computeACMR(uint32_t lod = 0) const;
+
+            [[nodiscard]] View view() const { return {vertices, indices, lods, meshlets, compressed}; }
+        private:
+            // False, without touching anything, if it can't come up with the same mesh the single threaded one would
+            bool loadModelParallel(const std::string &path, uint32_t threadCount);
+            void loadStl(const std::string &path, uint32_t threadCount);
+            void load3mf(const std::string &path, uint32_t threadCount);
+            // Area weighted, from every triangle sharing the vertex, and any vertex with triangles on both sides of a
+            // crease gets split, one for each side
+            void computeSmoothNormals(WorkerPool &pool);
         };
 
-        Model(const Device &device, const Builder &builder);
+        Model(Device &device, const Builder &builder) : Model(device, builder.view()) {}
+        Model(Device &device, const View &view);
         ~Model();
 
         Model(const Model&) = delete;
         Model& operator=(const Model&) = delete;
 
-        [[nodiscard]] static std::unique_ptr<Model> createModelFromFile(Device &device, const std::string &path);
-
+        // Files smaller than this aren't worth spinning up threads to load
+        static constexpr uintmax_t PARALLEL_LOAD_SIZE = 4 * 1024 * 1024;
+
+        // What's left of loading a model once everything that doesn't need the GPU is done, which is just creating it
+        using Prepared = std::move_only_function<std::unique_ptr<Model>(Device &device)>;
+
+        [[nodiscard]] static std::unique_ptr<Model> createModelFromFile(Device &device,
+                                                                        const std::string &path,
+                                                                        bool compressed = false);
+        // All of createModelFromFile but the upload (parsing, LODs, meshlets and the mesh cache), so it's safe to call
+        // from any thread, as long as what it returns gets called on the main one
+        [[nodiscard]] static Prepared prepareModelFromFile(const std::string &path, bool compressed = false);
+        // One model per triangle primitive, in the order they're in the file. Anything that's already laid out like ours
+        // gets uploaded straight from the mapped file, and since nothing flushes in between, they all go in the same
+        // upload batch.
+        [[nodiscard]] static std::vector<std::unique_ptr<Model>> createModelsFromGlb(Device &device,
+                                                                                     const std::string &path,
+                                                                                     bool compressed = false);
+
+        // Binds the whole geometry chunk, so any other model in the same one can be drawn without binding it again
         void bind(VkCommandBuffer commandBuffer) const;
-        void draw(VkCommandBuffer commandBuffer) const;
+        void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0) const;
+
+        // screenSize is the projected bounding radius, relative to half the screen height
+        [[nodiscard]] uint32_t selectLOD(float screenSize, uint32_t currentLOD) const;
+        [[nodiscard]] uint32_t getLODCount() const { return static_cast<uint32_t>(lods.size()); }
+        [[nodiscard]] const LOD &getLOD(uint32_t lod) const { return lods[lod]; }
+
+        [[nodiscard]] bool isIndexed() const { return geometry.indexCount > 0; }
+        [[nodiscard]] bool isCompressed() const { return compressed; }
+        [[nodiscard]] bool hasTopLeftTexCoords() const { return topLeftTexCoords; }
+        // Takes the compressed positions from [0, 1] back to model space, has to be applied after the model matrix
+        [[nodiscard]] const glm::mat4 &getDequantizationMatrix() const { return dequantizationMatrix; }
+        // LODs and meshlets are relative to the model, these are where it actually lives in the geometry arena
+        [[nodiscard]] uint32_t getGeometryChunk() const { return geometry.chunk; }
+        [[nodiscard]] uint32_t getFirstIndex() const { return geometry.firstIndex; }
+        [[nodiscard]] int32_t getVertexOffset() const { return static_cast<int32_t>(geometry.firstVertex); }
+        [[nodiscard]] bool hasMeshlets() const { return !meshlets.empty(); }
+        [[nodiscard]] const std::vector<Meshlet> &getMeshlets() const { return meshlets; }
+
+        // Positions of the coarsest LOD, for the software occlusion culler
+        [[nodiscard]] const std::vector<glm::vec3> &getOccluderVertices() const { return occluderVertices; }
+        [[nodiscard]] const std::vector<uint32_t> &getOccluderIndices() const { return occluderIndices; }
+
+        [[nodiscard]] glm::vec3 getBoundingCenter() const { return boundingCenter; }
+        [[nodiscard]] float getBoundingRadius() const { return boundingRadius; }
+
+        // Vertices and indices, on the GPU
+        [[nodiscard]] VkDeviceSize getMemorySize() const;
     private:
-        Device device;
+        Device &device;
+
+        GeometryArena::Range geometry{};
+        bool compressed;
+        bool topLeftTexCoords;
+        glm::mat4 dequantizationMatrix{1.0f};
+
+        std::vector<LOD> lods;
+
+        // Only on the CPU, since that's where the culling happens for now. They can go on the GPU along with whatever
+        // mesh shader ends up reading them.
+        std::vector<Meshlet> meshlets;
 
-        std::unique_ptr<Buffer> vertexBuffer;
-        uint32_t vertexCount;
+        std::vector<glm::vec3> occluderVertices;
+        std::vector<uint32_t> occluderIndices;
 
-        bool hasIndexBuffer = false;
-        std::unique_ptr<Buffer> indexBuffer;
-        uint32_t indexCount;
+        glm::vec3 boundingCenter{0.0f};
+        float boundingRadius = 0.0f;
 
-        void createVertexBuffer(const std::vector<Vertex> &vertices);
-        void createIndexBuffer(const std::vector<uint32_t> &indices);
+        void computeBounds(std::span<const Vertex> vertices);
+        void createOccluderMesh(const View &view);
+        void createGeometry(const View &view);
+        void createCompressedGeometry(const View &view);
     };
 }
 
-#endif
\ No newline at end of file
+#endif
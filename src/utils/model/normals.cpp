@@ -0,0 +1,100 @@
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+#include "model.hpp"
+#include "../workerpool/workerpool.hpp"
+
+namespace Engine {
+    namespace {
+        constexpr uint32_t CHUNK_SIZE = 4096;
+
+        glm::vec3 normalizeOrZero(const glm::vec3 &vector) {
+            const float length = glm::length(vector);
+            return length > 0.0f ? vector / length : glm::vec3{0.0f};
+        }
+    }
+
+    // The cross product of two edges is already twice the triangle's area long, so adding those up weights everything
+    // by area for free. With a crease angle, each corner only adds up the triangles around its vertex that are close
+    // enough to its own, and the corners of a vertex that ended up with different normals get a vertex each.
+    void Model::Builder::computeSmoothNormals(WorkerPool &pool) {
+        ZoneScoped;
+        const auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        const auto vertexCount = static_cast<uint32_t>(vertices.size());
+
+        std::vector<glm::vec3> faceNormals(triangleCount);
+        pool.parallelFor(triangleCount, CHUNK_SIZE, [&](const uint32_t begin, const uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                const glm::vec3 &a = vertices[indices[3 * size_t{i}]].position;
+                const glm::vec3 &b = vertices[indices[3 * size_t{i} + 1]].position;
+                const glm::vec3 &c = vertices[indices[3 * size_t{i} + 2]].position;
+                faceNormals[i] = glm::cross(b - a, c - a);
+            }
+        });
+
+        // Every corner of each vertex, one vertex after the other, in the order they're in the indices
+        std::vector<uint32_t> starts(size_t{vertexCount} + 1, 0);
+        for (const uint32_t index : indices) starts[index + 1]++;
+        std::partial_sum(starts.begin(), starts.end(), starts.begin());
+        std::vector<uint32_t> corners(indices.size());
+        {
+            std::vector<uint32_t> next(starts.begin(), starts.end() - 1);
+            for (uint32_t corner = 0; corner < indices.size(); corner++) corners[next[indices[corner]]++] = corner;
+        }
+
+        if (creaseAngle >= glm::pi<float>()) {
+            pool.parallelFor(vertexCount, CHUNK_SIZE, [&](const uint32_t begin, const uint32_t end) {
+                for (uint32_t vertex = begin; vertex < end; vertex++) {
+                    glm::vec3 sum{0.0f};
+                    for (uint32_t i = starts[vertex]; i < starts[vertex + 1]; i++) sum += faceNormals[corners[i] / 3];
+                    vertices[vertex].normal = normalizeOrZero(sum);
+                }
+            });
+            return;
+        }
+
+        // Compared against every other triangle's normal without normalising it, so it's scaled by its length instead
+        const float cosine = std::cos(creaseAngle);
+        std::vector<glm::vec3> cornerNormals(indices.size());
+        pool.parallelFor(vertexCount, CHUNK_SIZE, [&](const uint32_t begin, const uint32_t end) {
+            for (uint32_t vertex = begin; vertex < end; vertex++) {
+                for (uint32_t i = starts[vertex]; i < starts[vertex + 1]; i++) {
+                    // A triangle without any area doesn't have a side, so it just takes all of them
+                    const glm::vec3 own = normalizeOrZero(faceNormals[corners[i] / 3]);
+                    const bool all = own == glm::vec3{0.0f};
+                    glm::vec3 sum{0.0f};
+                    for (uint32_t j = starts[vertex]; j < starts[vertex + 1]; j++) {
+                        const glm::vec3 &other = faceNormals[corners[j] / 3];
+                        if (all || glm::dot(other, own) >= cosine * glm::length(other)) sum += other;
+                    } cornerNormals[corners[i]] = normalizeOrZero(sum);
+                }
+            }
+        });
+
+        // The first normal a vertex sees keeps the vertex, and there are only ever a few per vertex to look through
+        std::vector<std::pair<glm::vec3, uint32_t>> seen;
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+            seen.clear();
+            for (uint32_t i = starts[vertex]; i < starts[vertex + 1]; i++) {
+                const uint32_t corner = corners[i];
+                const glm::vec3 &normal = cornerNormals[corner];
+                const auto found = std::ranges::find(seen, normal, &std::pair<glm::vec3, uint32_t>::first);
+                if (found != seen.end()) {
+                    indices[corner] = found->second;
+                    continue;
+                } if (seen.empty()) {
+                    vertices[vertex].normal = normal;
+                    seen.emplace_back(normal, vertex);
+                    continue;
+                }
+
+                Vertex split = vertices[vertex];
+                split.normal = normal;
+                indices[corner] = static_cast<uint32_t>(vertices.size());
+                seen.emplace_back(normal, indices[corner]);
+                vertices.push_back(split);
+            }
+        }
+    }
+}
@@ -0,0 +1,229 @@
+#define TINYOBJ_LOADER_OPT_IMPLEMENTATION
+#include "../../../libs/tinyobjloader/experimental/tinyobj_loader_opt.h"
+
+#include <atomic>
+
+#include "model.hpp"
+#include "../mappedfile/mappedfile.hpp"
+#include "../vertexwelder/vertexwelder.hpp"
+#include "../workerpool/workerpool.hpp"
+
+namespace Engine {
+    namespace {
+        // Small enough that every thread gets a few chunks, so one slow chunk doesn't hold everyone up
+        constexpr uint32_t CHUNKS_PER_THREAD = 4;
+        constexpr uint32_t MIN_CHUNK_SIZE = 4096;
+        constexpr size_t MIN_SCAN_SIZE = 1 << 20; // Bytes of the file each thread looks for vertex colors in
+
+        bool isSpace(const char c) { return c == ' ' || c == '\t'; }
+
+        // The parallel parser skips vertex colors, which tinyobj only reads when there are 6 numbers after the v
+        bool hasVertexColors(const MappedFile &file, WorkerPool &pool) {
+            const auto *data = reinterpret_cast<const char *>(file.getData());
+            const size_t size = file.getSize();
+            const size_t threadCount = pool.getThreadCount() + 1;
+            const size_t scanSize = std::max(MIN_SCAN_SIZE, size / (threadCount * CHUNKS_PER_THREAD));
+            const auto chunkCount = static_cast<uint32_t>((size + scanSize - 1) / scanSize);
+
+            // Each chunk checks the lines that start in it, even if they end in the next one
+            std::atomic<bool> found = false;
+            pool.parallelFor(chunkCount, 1, [&](const uint32_t chunk, uint32_t) {
+                size_t i = chunk * scanSize;
+                const size_t end = std::min(size, i + scanSize);
+                if (i > 0) while (i < end && data[i - 1] != '\n') i++;
+                while (i < end && !found.load(std::memory_order_relaxed)) {
+                    while (i < size && isSpace(data[i])) i++;
+                    if (i + 1 < size && data[i] == 'v' && isSpace(data[i + 1])) {
+                        uint32_t numbers = 0;
+                        for (i++; i < size && data[i] != '\n' && data[i] != '\r';) {
+                            if (isSpace(data[i])) {
+                                i++;
+                                continue;
+                            } const char c = data[i];
+                            if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.') numbers++;
+                            while (i < size && !isSpace(data[i]) && data[i] != '\n' && data[i] != '\r') i++;
+                        } if (numbers >= 6) found = true;
+                    } while (i < size && data[i++] != '\n') {}
+                }
+            });
+            return found;
+        }
+    }
+
+    // Polygons get split into triangles the same way tinyobj does, quads along their shorter diagonal, and anything
+    // with more sides than that goes back to tinyobj, along with files that have vertex colors, so both loaders always
+    // end up with the same triangles. Welding them then works in three steps, all in parallel:
+    //  1. Every corner of every triangle gets its vertex built and hashed
+    //  2. Each thread welds the corners whose hash lands in its partition, so no vertex can end up in two of them,
+    //     and every corner finds the first corner it's the same as
+    //  3. The vertices get numbered in the order of their first corner, which is the same order the single threaded
+    //     path gives them, and every corner gets the number of its first one
+    bool Model::Builder::loadModelParallel(const std::string &path, const uint32_t threadCount) {
+        ZoneScoped;
+        const MappedFile file(path);
+        if (!file.isOpen()) throw std::runtime_error("Failed to open " + path + "!");
+
+        WorkerPool pool(std::max(2u, threadCount) - 1); // Our own, since the shared one might be the one running this
+        if (hasVertexColors(file, pool)) return false;
+
+        tinyobj_opt::attrib_t attrib;
+        std::vector<tinyobj_opt::shape_t> shapes;
+        std::vector<tinyobj_opt::material_t> materials;
+        tinyobj_opt::LoadOption option;
+        option.req_num_threads = static_cast<int>(threadCount);
+        option.triangulate = false; // It only knows how to fan them out
+        if (!tinyobj_opt::parseObj(&attrib,
+                                   &shapes,
+                                   &materials,
+                                   reinterpret_cast<const char *>(file.getData()),
+                                   file.getSize(),
+                                   option))
+            throw std::runtime_error("Failed to parse " + path + "!");
+
+        // Where each face starts, and where its triangles go, tinyobj skips anything with less than 3 corners too
+        const size_t faceCount = attrib.face_num_verts.size();
+        std::vector<uint32_t> faceStarts(faceCount + 1), triangleStarts(faceCount + 1);
+        for (size_t face = 0; face < faceCount; face++) {
+            const auto sides = static_cast<uint32_t>(attrib.face_num_verts[face]);
+            if (sides > 4) return false;
+            faceStarts[face + 1] = faceStarts[face] + sides;
+            triangleStarts[face + 1] = triangleStarts[face] + (sides < 3 ? 0 : 3 * (sides - 2));
+        } if (faceStarts[faceCount] != attrib.indices.size()) return false;
+
+        const uint32_t cornerCount = triangleStarts[faceCount];
+        const uint32_t chunkSize = std::max(MIN_CHUNK_SIZE,
+                                            (cornerCount + threadCount * CHUNKS_PER_THREAD - 1) /
+                                            (threadCount * CHUNKS_PER_THREAD));
+        const uint32_t chunkCount = (cornerCount + chunkSize - 1) / chunkSize;
+
+        std::vector<tinyobj_opt::index_t> cornerIndices(cornerCount);
+        std::atomic<bool> invalid = false;
+        const auto positionCount = static_cast<int>(attrib.vertices.size() / 3);
+        pool.parallelFor(static_cast<uint32_t>(faceCount), chunkSize, [&](const uint32_t begin, const uint32_t end) {
+            for (uint32_t face = begin; face < end; face++) {
+                const tinyobj_opt::index_t *polygon = &attrib.indices[faceStarts[face]];
+                tinyobj_opt::index_t *triangles = &cornerIndices[triangleStarts[face]];
+                const uint32_t sides = faceStarts[face + 1] - faceStarts[face];
+                if (sides == 3) {
+                    std::copy_n(polygon, 3, triangles);
+                    continue;
+                } if (sides < 3) continue;
+
+                // Exactly like tinyobj does it, down to the float math, so they always pick the same one
+                const float *position[4];
+                for (uint32_t k = 0; k < 4; k++) {
+                    if (polygon[k].vertex_index < 0 || polygon[k].vertex_index >= positionCount) {
+                        invalid = true; // tinyobj drops these with a warning, so that's what gets to deal with it
+                        return;
+                    } position[k] = &attrib.vertices[3 * static_cast<size_t>(polygon[k].vertex_index)];
+                }
+                const float e02x = position[2][0] - position[0][0];
+                const float e02y = position[2][1] - position[0][1];
+                const float e02z = position[2][2] - position[0][2];
+                const float e13x = position[3][0] - position[1][0];
+                const float e13y = position[3][1] - position[1][1];
+                const float e13z = position[3][2] - position[1][2];
+                const float length02 = e02x * e02x + e02y * e02y + e02z * e02z;
+                const float length13 = e13x * e13x + e13y * e13y + e13z * e13z;
+                static constexpr uint32_t SPLIT02[6] = {0, 1, 2, 0, 2, 3};
+                static constexpr uint32_t SPLIT13[6] = {0, 1, 3, 1, 2, 3};
+                const uint32_t *split = length02 < length13 ? SPLIT02 : SPLIT13;
+                for (uint32_t k = 0; k < 6; k++) triangles[k] = polygon[split[k]];
+            }
+        }); if (invalid) return false;
+
+        vertices.clear();
+        indices.clear();
+        if (cornerCount == 0) return true;
+
+        std::vector<Vertex> corners(cornerCount);
+        std::vector<uint64_t> hashes(cornerCount);
+        pool.parallelFor(cornerCount, chunkSize, [&](const uint32_t begin, const uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                const tinyobj_opt::index_t &index = cornerIndices[i];
+                Vertex &vertex = corners[i];
+                vertex = {};
+                if (index.vertex_index >= 0) {
+                    const float *position = &attrib.vertices[3 * static_cast<size_t>(index.vertex_index)];
+                    vertex.position = {position[0], position[1], position[2]};
+                    vertex.color = glm::vec3{1.0f}; // Same as tinyobj gives us when there are no colors
+                } if (index.normal_index >= 0) {
+                    const float *normal = &attrib.normals[3 * static_cast<size_t>(index.normal_index)];
+                    vertex.normal = {normal[0], normal[1], normal[2]};
+                } if (index.texcoord_index >= 0) {
+                    const float *texCoord = &attrib.texcoords[2 * static_cast<size_t>(index.texcoord_index)];
+                    vertex.texCoord = {texCoord[0], texCoord[1]};
+                } hashes[i] = VertexWelder::hash(vertex);
+            }
+        });
+
+        // Each chunk counts its corners per partition, so they can all scatter them without stepping on each other,
+        // and every partition ends up with its corners in order
+        const uint32_t partitionCount = threadCount;
+        std::vector<uint32_t> offsets(size_t{chunkCount} * partitionCount, 0);
+        pool.parallelFor(chunkCount, 1, [&](const uint32_t chunk, uint32_t) {
+            const uint32_t end = std::min(cornerCount, (chunk + 1) * chunkSize);
+            for (uint32_t i = chunk * chunkSize; i < end; i++)
+                offsets[size_t{chunk} * partitionCount + VertexWelder::getPartition(hashes[i], partitionCount)]++;
+        });
+
+        std::vector<uint32_t> partitionStarts(partitionCount + 1, 0);
+        uint32_t total = 0;
+        for (uint32_t partition = 0; partition < partitionCount; partition++) {
+            partitionStarts[partition] = total;
+            for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+                const uint32_t count = offsets[size_t{chunk} * partitionCount + partition];
+                offsets[size_t{chunk} * partitionCount + partition] = total;
+                total += count;
+            }
+        } partitionStarts[partitionCount] = total;
+
+        std::vector<uint32_t> partitioned(cornerCount);
+        pool.parallelFor(chunkCount, 1, [&](const uint32_t chunk, uint32_t) {
+            const uint32_t end = std::min(cornerCount, (chunk + 1) * chunkSize);
+            for (uint32_t i = chunk * chunkSize; i < end; i++) {
+                const uint32_t partition = VertexWelder::getPartition(hashes[i], partitionCount);
+                partitioned[offsets[size_t{chunk} * partitionCount + partition]++] = i;
+            }
+        });
+
+        std::vector<uint32_t> firstCorner(cornerCount);
+        pool.parallelFor(partitionCount, 1, [&](const uint32_t partition, uint32_t) {
+            // The welder numbers the vertices in the order it first sees them, so their first corners just go in order
+            std::vector<Vertex> unique;
+            std::vector<uint32_t> firstCorners;
+            VertexWelder welder(unique, partitionStarts[partition + 1] - partitionStarts[partition]);
+            for (uint32_t i = partitionStarts[partition]; i < partitionStarts[partition + 1]; i++) {
+                const uint32_t corner = partitioned[i];
+                const uint32_t vertex = welder.weld(corners[corner]);
+                if (vertex == firstCorners.size()) firstCorners.push_back(corner);
+                firstCorner[corner] = firstCorners[vertex];
+            }
+        });
+
+        std::vector<uint32_t> chunkVertices(chunkCount + 1, 0);
+        pool.parallelFor(chunkCount, 1, [&](const uint32_t chunk, uint32_t) {
+            const uint32_t end = std::min(cornerCount, (chunk + 1) * chunkSize);
+            for (uint32_t i = chunk * chunkSize; i < end; i++) chunkVertices[chunk + 1] += firstCorner[i] == i ? 1 : 0;
+        });
+        for (uint32_t chunk = 0; chunk < chunkCount; chunk++) chunkVertices[chunk + 1] += chunkVertices[chunk];
+
+        // The first corners get their vertex's number, which every other corner then just looks up
+        std::vector<uint32_t> vertexIds(cornerCount);
+        vertices.resize(chunkVertices[chunkCount]);
+        pool.parallelFor(chunkCount, 1, [&](const uint32_t chunk, uint32_t) {
+            const uint32_t end = std::min(cornerCount, (chunk + 1) * chunkSize);
+            uint32_t vertex = chunkVertices[chunk];
+            for (uint32_t i = chunk * chunkSize; i < end; i++) {
+                if (firstCorner[i] != i) continue;
+                vertexIds[i] = vertex;
+                vertices[vertex++] = corners[i];
+            }
+        });
+
+        indices.resize(cornerCount);
+        pool.parallelFor(cornerCount, chunkSize, [&](const uint32_t begin, const uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) indices[i] = vertexIds[firstCorner[i]];
+        }); return true;
+    }
+}
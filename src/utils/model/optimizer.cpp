@@ -0,0 +1,278 @@
+#include <limits>
+#include <cassert>
+#include <numeric>
+#include <algorithm>
+
+#include "model.hpp"
+
+// See "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", by Sander, Nehab and Barczak, for both the
+// vertex cache (Tipsify) and the overdraw parts.
+namespace Engine {
+    namespace {
+        constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+        // How much worse than the whole cluster's ACMR we let the smaller clusters get, for the overdraw sort
+        constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+        // Every vertex remembers when it got in, and a FIFO cache only ever holds the last VERTEX_CACHE_SIZE of them,
+        // so there's no need to keep the actual queue around
+        class CacheSimulator {
+        public:
+            explicit CacheSimulator(const size_t vertexCount) : insertedAt(vertexCount, 0) {}
+
+            uint32_t access(const uint32_t *triangle) {
+                uint32_t misses = 0;
+                for (uint32_t i = 0; i < 3; i++) {
+                    if (time - insertedAt[triangle[i]] <= Model::VERTEX_CACHE_SIZE) continue;
+                    insertedAt[triangle[i]] = time++;
+                    misses++;
+                } return misses;
+            }
+            void flush() { time += Model::VERTEX_CACHE_SIZE + 1; }
+        private:
+            std::vector<uint32_t> insertedAt;
+            uint32_t time = Model::VERTEX_CACHE_SIZE + 1;
+        };
+
+        // Tipsify, which fans around one vertex at a time, and picks the next one out of the ones that are still in the
+        // cache (or will get there soon), so it runs in linear time. Works on a compacted copy of the vertices, since
+        // it gets called for every meshlet, and going through every vertex of the model each time would add up fast.
+        class VertexCacheOptimizer {
+        public:
+            explicit VertexCacheOptimizer(const size_t vertexCount) : localVertex(vertexCount, NO_VERTEX) {}
+
+            void optimize(uint32_t *indices, const size_t indexCount) {
+                if (indexCount < 6) return;
+                const size_t triangleCount = indexCount / 3;
+
+                globalVertex.clear();
+                triangles.resize(indexCount);
+                for (size_t i = 0; i < indexCount; i++) {
+                    if (localVertex[indices[i]] == NO_VERTEX) {
+                        localVertex[indices[i]] = static_cast<uint32_t>(globalVertex.size());
+                        globalVertex.push_back(indices[i]);
+                    } triangles[i] = localVertex[indices[i]];
+                } for (const uint32_t vertex : globalVertex) localVertex[vertex] = NO_VERTEX;
+                const auto vertexCount = static_cast<uint32_t>(globalVertex.size());
+
+                // Same flat layout as the meshlets use, the triangles of v go from triangleOffsets[v] to [v + 1]
+                triangleOffsets.assign(vertexCount + 1, 0);
+                for (size_t i = 0; i < indexCount; i++) triangleOffsets[triangles[i] + 1]++;
+                for (uint32_t i = 1; i <= vertexCount; i++) triangleOffsets[i] += triangleOffsets[i - 1];
+                vertexTriangles.resize(triangleOffsets.back());
+                liveTriangles.assign(vertexCount, 0);
+                for (size_t i = 0; i < indexCount; i++)
+                    vertexTriangles[triangleOffsets[triangles[i]] + liveTriangles[triangles[i]]++] =
+                        static_cast<uint32_t>(i / 3);
+
+                cachedAt.assign(vertexCount, 0);
+                uint32_t time = Model::VERTEX_CACHE_SIZE + 1;
+                emitted.assign(triangleCount, false);
+                deadEnds.clear();
+                size_t written = 0;
+
+                uint32_t fanning = 0;
+                uint32_t cursor = 1;
+                while (fanning != NO_VERTEX) {
+                    candidates.clear();
+                    for (uint32_t i = triangleOffsets[fanning]; i < triangleOffsets[fanning + 1]; i++) {
+                        const uint32_t triangle = vertexTriangles[i];
+                        if (emitted[triangle]) continue;
+                        emitted[triangle] = true;
+
+                        for (uint32_t j = 0; j < 3; j++) {
+                            const uint32_t vertex = triangles[3 * triangle + j];
+                            indices[written++] = globalVertex[vertex];
+                            deadEnds.push_back(vertex);
+                            candidates.push_back(vertex);
+                            liveTriangles[vertex]--;
+                            if (time - cachedAt[vertex] > Model::VERTEX_CACHE_SIZE) cachedAt[vertex] = time++;
+                        }
+                    }
+
+                    // The oldest vertex that'll still be in the cache once we're done fanning around it
+                    fanning = NO_VERTEX;
+                    uint32_t bestPriority = 0;
+                    for (const uint32_t vertex : candidates) {
+                        if (liveTriangles[vertex] == 0) continue;
+                        const uint32_t age = time - cachedAt[vertex];
+                        if (age + 2 * liveTriangles[vertex] > Model::VERTEX_CACHE_SIZE || age <= bestPriority) continue;
+                        fanning = vertex;
+                        bestPriority = age;
+                    } if (fanning != NO_VERTEX) continue;
+
+                    // Dead end, so go back to the most recent vertex that still has something left, or just any vertex
+                    while (!deadEnds.empty() && fanning == NO_VERTEX) {
+                        if (liveTriangles[deadEnds.back()] > 0) fanning = deadEnds.back();
+                        deadEnds.pop_back();
+                    } for (; cursor < vertexCount && fanning == NO_VERTEX; cursor++)
+                        if (liveTriangles[cursor] > 0) fanning = cursor;
+                }
+                assert(written == 3 * triangleCount && "Tipsify should emit every triangle exactly once!");
+            }
+        private:
+            std::vector<uint32_t> localVertex; // Always NO_VERTEX between calls
+            std::vector<uint32_t> globalVertex;
+            std::vector<uint32_t> triangles;
+            std::vector<uint32_t> triangleOffsets;
+            std::vector<uint32_t> vertexTriangles;
+            std::vector<uint32_t> liveTriangles;
+            std::vector<uint32_t> cachedAt;
+            std::vector<bool> emitted;
+            std::vector<uint32_t> deadEnds;
+            std::vector<uint32_t> candidates;
+        };
+
+        // Splits the triangles wherever the cache starts over anyway (all three vertices miss), and then splits those
+        // again wherever they get close enough to their own ACMR, so sorting them barely costs us any cache hits.
+        // Returns the first triangle of each cluster, plus the triangle count at the end.
+        std::vector<uint32_t> findClusters(const uint32_t *indices, const uint32_t triangleCount, const size_t vertexCount) {
+            CacheSimulator cache(vertexCount);
+            std::vector<uint32_t> hardBoundaries;
+            for (uint32_t i = 0; i < triangleCount; i++)
+                if (cache.access(indices + 3 * i) == 3) hardBoundaries.push_back(i);
+            hardBoundaries.push_back(triangleCount);
+
+            std::vector<uint32_t> boundaries;
+            for (size_t i = 0; i + 1 < hardBoundaries.size(); i++) {
+                const uint32_t start = hardBoundaries[i];
+                const uint32_t end = hardBoundaries[i + 1];
+
+                cache.flush();
+                uint32_t misses = 0;
+                for (uint32_t j = start; j < end; j++) misses += cache.access(indices + 3 * j);
+                const float threshold = OVERDRAW_THRESHOLD * static_cast<float>(misses) / static_cast<float>(end - start);
+
+                boundaries.push_back(start);
+                cache.flush();
+                uint32_t runningMisses = 0;
+                uint32_t runningTriangles = 0;
+                for (uint32_t j = start; j < end; j++) {
+                    runningMisses += cache.access(indices + 3 * j);
+                    runningTriangles++;
+                    if (static_cast<float>(runningMisses) > threshold * static_cast<float>(runningTriangles)) continue;
+                    if (j + 1 == end) break;
+                    boundaries.push_back(j + 1);
+                    cache.flush();
+                    runningMisses = 0;
+                    runningTriangles = 0;
+                }
+
+                // Whatever's left at the end never got to the threshold, so it goes back with the cluster before it
+                if (runningTriangles > 0 && boundaries.back() != start &&
+                    static_cast<float>(runningMisses) > threshold * static_cast<float>(runningTriangles))
+                    boundaries.pop_back();
+            } boundaries.push_back(triangleCount);
+            return boundaries;
+        }
+
+        // Clusters on the outside, facing away from the center, are the most likely to hide the others, so they go first
+        std::vector<uint32_t> sortClustersForOverdraw(const std::vector<Model::Vertex> &vertices,
+                                                      const uint32_t *indices,
+                                                      const std::vector<uint32_t> &boundaries) {
+            const size_t clusterCount = boundaries.size() - 1;
+            std::vector<glm::vec3> centroids(clusterCount, glm::vec3{0.0f});
+            std::vector<glm::vec3> normals(clusterCount, glm::vec3{0.0f});
+            std::vector<float> areas(clusterCount, 0.0f);
+            glm::vec3 meshCentroid{0.0f};
+            float meshArea = 0.0f;
+            for (size_t i = 0; i < clusterCount; i++) {
+                for (uint32_t j = boundaries[i]; j < boundaries[i + 1]; j++) {
+                    const Model::Vertex &v0 = vertices[indices[3 * j]];
+                    const Model::Vertex &v1 = vertices[indices[3 * j + 1]];
+                    const Model::Vertex &v2 = vertices[indices[3 * j + 2]];
+
+                    // Same as with the meshlets, the vertex normals decide which side is the front
+                    glm::vec3 normal = glm::cross(v1.position - v0.position, v2.position - v0.position);
+                    if (glm::dot(normal, v0.normal + v1.normal + v2.normal) < 0.0f) normal = -normal;
+                    const float area = glm::length(normal);
+                    centroids[i] += (v0.position + v1.position + v2.position) * (area / 3.0f);
+                    normals[i] += normal;
+                    areas[i] += area;
+                }
+
+                meshCentroid += centroids[i];
+                meshArea += areas[i];
+                if (areas[i] > 0.0f) centroids[i] /= areas[i];
+            } if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+            std::vector<float> keys(clusterCount, 0.0f);
+            for (size_t i = 0; i < clusterCount; i++) {
+                const float length = glm::length(normals[i]);
+                if (length > 0.0f) keys[i] = glm::dot(centroids[i] - meshCentroid, normals[i] / length);
+            }
+
+            std::vector<uint32_t> order(clusterCount);
+            std::iota(order.begin(), order.end(), 0);
+            std::ranges::stable_sort(order, [&keys](const uint32_t a, const uint32_t b) { return keys[a] > keys[b]; });
+            return order;
+        }
+    }
+
+    void Model::Builder::optimize() {
+        ZoneScoped;
+        if (indices.empty()) return;
+        if (lods.empty()) lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f, 0, 0});
+
+        VertexCacheOptimizer cacheOptimizer(vertices.size());
+        std::vector<uint32_t> reordered;
+        for (const LOD &lod : lods) {
+            uint32_t *lodIndices = indices.data() + lod.firstIndex;
+            reordered.clear();
+            reordered.reserve(lod.indexCount);
+
+            if (lod.meshletCount > 0) {
+                // Meshlets have to stay contiguous, so the cache gets optimised within each one, and they get sorted
+                for (uint32_t i = lod.firstMeshlet; i < lod.firstMeshlet + lod.meshletCount; i++)
+                    cacheOptimizer.optimize(indices.data() + meshlets[i].firstIndex, meshlets[i].indexCount);
+
+                std::vector<uint32_t> boundaries;
+                for (uint32_t i = lod.firstMeshlet; i < lod.firstMeshlet + lod.meshletCount; i++)
+                    boundaries.push_back((meshlets[i].firstIndex - lod.firstIndex) / 3);
+                boundaries.push_back(lod.indexCount / 3);
+
+                std::vector<Meshlet> sorted;
+                sorted.reserve(lod.meshletCount);
+                for (const uint32_t cluster : sortClustersForOverdraw(vertices, lodIndices, boundaries)) {
+                    Meshlet meshlet = meshlets[lod.firstMeshlet + cluster];
+                    const uint32_t *meshletIndices = indices.data() + meshlet.firstIndex;
+                    reordered.insert(reordered.end(), meshletIndices, meshletIndices + meshlet.indexCount);
+                    meshlet.firstIndex = lod.firstIndex + static_cast<uint32_t>(reordered.size()) - meshlet.indexCount;
+                    sorted.push_back(meshlet);
+                } std::ranges::copy(sorted, meshlets.begin() + lod.firstMeshlet);
+            } else {
+                cacheOptimizer.optimize(lodIndices, lod.indexCount);
+                const std::vector<uint32_t> boundaries = findClusters(lodIndices, lod.indexCount / 3, vertices.size());
+                for (const uint32_t cluster : sortClustersForOverdraw(vertices, lodIndices, boundaries))
+                    reordered.insert(reordered.end(),
+                                     lodIndices + 3 * boundaries[cluster],
+                                     lodIndices + 3 * boundaries[cluster + 1]);
+            } std::ranges::copy(reordered, lodIndices);
+        }
+
+        // Finally, the vertices go in the order they're first used, so fetching them goes through memory in order too.
+        // Every LOD only uses vertices from the full one, so they mostly get that order for free.
+        std::vector<uint32_t> remap(vertices.size(), NO_VERTEX);
+        uint32_t next = 0;
+        for (uint32_t &index : indices) {
+            if (remap[index] == NO_VERTEX) remap[index] = next++;
+            index = remap[index];
+        }
+
+        std::vector<Vertex> fetchOrder(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            if (remap[i] == NO_VERTEX) remap[i] = next++; // Unused ones just go at the end
+            fetchOrder[remap[i]] = vertices[i];
+        } vertices = std::move(fetchOrder);
+    }
+
+    float Model::Builder::computeACMR(const uint32_t lod) const {
+        const uint32_t firstIndex = lods.empty() ? 0 : lods[lod].firstIndex;
+        const uint32_t indexCount = lods.empty() ? static_cast<uint32_t>(indices.size()) : lods[lod].indexCount;
+        if (indexCount < 3) return 0.0f;
+
+        CacheSimulator cache(vertices.size());
+        uint32_t misses = 0;
+        for (uint32_t i = firstIndex; i < firstIndex + indexCount; i += 3) misses += cache.access(indices.data() + i);
+        return static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+    }
+}
@@ -0,0 +1,333 @@
+#include "simplifier.hpp"
+
+namespace Engine {
+    MeshSimplifier::Quadric::Quadric(const glm::dvec3 normal, const double distance, const double weight) :
+    a00(weight * normal.x * normal.x), a01(weight * normal.x * normal.y), a02(weight * normal.x * normal.z),
+    a11(weight * normal.y * normal.y), a12(weight * normal.y * normal.z), a22(weight * normal.z * normal.z),
+    b0(weight * distance * normal.x), b1(weight * distance * normal.y), b2(weight * distance * normal.z),
+    c(weight * distance * distance) {}
+
+    MeshSimplifier::Quadric& MeshSimplifier::Quadric::operator+=(const Quadric &other) {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02;
+        a11 += other.a11; a12 += other.a12; a22 += other.a22;
+        b0 += other.b0; b1 += other.b1; b2 += other.b2;
+        c += other.c;
+        return *this;
+    }
+
+    // p^T * A * p + 2 * b^T * p + c, which is the sum of the squared distances to all the planes
+    double MeshSimplifier::Quadric::evaluate(const glm::dvec3 point) const {
+        const double x = point.x, y = point.y, z = point.z;
+        return a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z +
+               a11 * y * y + 2.0 * a12 * y * z +
+               a22 * z * z +
+               2.0 * (b0 * x + b1 * y + b2 * z) + c;
+    }
+
+    MeshSimplifier::MeshSimplifier(const std::vector<Model::Vertex> &vertices,
+                                   const std::vector<uint32_t> &indices,
+                                   const AttributeWeights weights) :
+                                   vertices(vertices),
+                                   weights(weights),
+                                   triangles(indices),
+                                   removed(indices.size() / 3, false),
+                                   liveTriangles(indices.size() / 3) {
+        assert(indices.size() % 3 == 0 && "The mesh must be made out of triangles!");
+
+        // Weld together every vertex with the same position
+        std::unordered_map<glm::vec3, uint32_t> uniquePositions(vertices.size());
+        positionIndex.resize(vertices.size());
+        glm::dvec3 minBounds{std::numeric_limits<double>::max()};
+        glm::dvec3 maxBounds{std::numeric_limits<double>::lowest()};
+        for (size_t i = 0; i < vertices.size(); i++) {
+            auto [it, inserted] = uniquePositions.try_emplace(vertices[i].position,
+                                                              static_cast<uint32_t>(positions.size()));
+            if (inserted) {
+                positions.emplace_back(vertices[i].position);
+                minBounds = glm::min(minBounds, positions.back());
+                maxBounds = glm::max(maxBounds, positions.back());
+            } positionIndex[i] = it->second;
+        }
+
+        const glm::dvec3 center = (minBounds + maxBounds) * 0.5;
+        double radius = 0.0;
+        for (const glm::dvec3 &position : positions) radius = std::max(radius, glm::length(position - center));
+        if (radius <= 0.0) radius = 1.0;
+        for (glm::dvec3 &position : positions) position = (position - center) / radius;
+
+        positionTriangles.resize(positions.size());
+        for (size_t t = 0; t < removed.size(); t++) {
+            const uint32_t p0 = positionIndex[triangles[3 * t]];
+            const uint32_t p1 = positionIndex[triangles[3 * t + 1]];
+            const uint32_t p2 = positionIndex[triangles[3 * t + 2]];
+
+            // Already degenerate, so we might as well get rid of it now
+            if (p0 == p1 || p1 == p2 || p2 == p0) {
+                removed[t] = true;
+                liveTriangles--;
+                continue;
+            }
+
+            positionTriangles[p0].push_back(static_cast<uint32_t>(t));
+            positionTriangles[p1].push_back(static_cast<uint32_t>(t));
+            positionTriangles[p2].push_back(static_cast<uint32_t>(t));
+        }
+
+        computeQuadrics();
+        lockBorders();
+        positionErrors.assign(positions.size(), 0.0);
+    }
+
+    std::vector<uint32_t> MeshSimplifier::simplify(const size_t targetIndexCount) {
+        const size_t targetTriangles = targetIndexCount / 3;
+        std::vector<Collapse> collapses;
+        while (liveTriangles > targetTriangles) {
+            for (auto &list : positionTriangles) std::erase_if(list, [this](uint32_t t) { return removed[t]; });
+
+            collapses.clear();
+            for (size_t t = 0; t < removed.size(); t++) {
+                if (removed[t]) continue;
+                for (size_t k = 0; k < 3; k++) {
+                    const uint32_t a = positionIndex[triangles[3 * t + k]];
+                    const uint32_t b = positionIndex[triangles[3 * t + (k + 1) % 3]];
+                    if (a > b) continue; // The neighbouring triangle has it the other way around, so we only add it once
+
+                    // Try both directions, and keep the cheapest one
+                    Collapse best{a, b, std::numeric_limits<double>::max()};
+                    if (!locked[a]) best.cost = collapseCost(a, b);
+                    if (!locked[b]) {
+                        if (const double cost = collapseCost(b, a); cost < best.cost) best = {b, a, cost};
+                    } if (best.cost != std::numeric_limits<double>::max()) collapses.push_back(best);
+                }
+            } if (collapses.empty()) break;
+
+            std::ranges::sort(collapses, {}, &Collapse::cost);
+
+            // Each collapse gets rid of two triangles. Costs only get recomputed between passes, so we only do part of
+            // the work on each one, to keep the error spread out evenly over the mesh.
+            const size_t maxCollapses = std::max<size_t>(1, (liveTriangles - targetTriangles) / 4);
+            std::vector<bool> touched(positions.size(), false);
+            size_t collapsed = 0;
+            for (const auto &[from, to, cost] : collapses) {
+                if (collapsed >= maxCollapses || liveTriangles <= targetTriangles) break;
+                if (touched[from] || touched[to]) continue;
+                if (!collapse(from, to)) continue;
+                touched[from] = touched[to] = true;
+                collapsed++;
+            } if (collapsed == 0) break; // Nothing else we can do without breaking the mesh
+        }
+
+        std::vector<uint32_t> result;
+        result.reserve(liveTriangles * 3);
+        for (size_t t = 0; t < removed.size(); t++) {
+            if (removed[t]) continue;
+            result.insert(result.end(), triangles.begin() + static_cast<std::ptrdiff_t>(3 * t),
+                                        triangles.begin() + static_cast<std::ptrdiff_t>(3 * t + 3));
+        } return result;
+    }
+
+    void MeshSimplifier::computeQuadrics() {
+        quadrics.assign(positions.size(), {});
+        for (size_t t = 0; t < removed.size(); t++) {
+            if (removed[t]) continue;
+            const uint32_t p0 = positionIndex[triangles[3 * t]];
+            const uint32_t p1 = positionIndex[triangles[3 * t + 1]];
+            const uint32_t p2 = positionIndex[triangles[3 * t + 2]];
+
+            const glm::dvec3 normal = glm::cross(positions[p1] - positions[p0], positions[p2] - positions[p0]);
+            const double length = glm::length(normal);
+            if (length <= 0.0) continue;
+
+            // Weighting by area means big triangles get to have more of a say than tiny slivers
+            const glm::dvec3 unitNormal = normal / length;
+            const Quadric quadric(unitNormal, -glm::dot(unitNormal, positions[p0]), length * 0.5);
+            quadrics[p0] += quadric;
+            quadrics[p1] += quadric;
+            quadrics[p2] += quadric;
+        }
+    }
+
+    void MeshSimplifier::lockBorders() {
+        // Edges that aren't shared by exactly two triangles are either borders or non-manifold, so we don't touch them
+        std::unordered_map<uint64_t, uint32_t> edgeCount;
+        edgeCount.reserve(liveTriangles * 3);
+        for (size_t t = 0; t < removed.size(); t++) {
+            if (removed[t]) continue;
+            for (size_t k = 0; k < 3; k++) {
+                const uint32_t a = positionIndex[triangles[3 * t + k]];
+                const uint32_t b = positionIndex[triangles[3 * t + (k + 1) % 3]];
+                edgeCount[static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b)]++;
+            }
+        }
+
+        locked.assign(positions.size(), false);
+        for (const auto &[edge, count] : edgeCount) {
+            if (count == 2) continue;
+            locked[static_cast<uint32_t>(edge >> 32)] = true;
+            locked[static_cast<uint32_t>(edge & 0xFFFFFFFF)] = true;
+        }
+    }
+
+    float MeshSimplifier::attributeDistance(const uint32_t a, const uint32_t b) const {
+        const Model::Vertex &vertexA = vertices[a];
+        const Model::Vertex &vertexB = vertices[b];
+        const glm::vec3 normal = vertexA.normal - vertexB.normal;
+        const glm::vec3 color = vertexA.color - vertexB.color;
+        const glm::vec2 texCoord = vertexA.texCoord - vertexB.texCoord;
+        return weights.normal * glm::dot(normal, normal) +
+               weights.color * glm::dot(color, color) +
+               weights.texCoord * glm::dot(texCoord, texCoord);
+    }
+
+    double MeshSimplifier::mapVertices(const uint32_t from,
+                                       const uint32_t to,
+                                       std::vector<std::pair<uint32_t, uint32_t>> &vertexMap) const {
+        vertexMap.clear();
+        const auto isMapped = [&vertexMap](uint32_t vertex) {
+            return std::ranges::any_of(vertexMap, [vertex](const auto &pair) { return pair.first == vertex; });
+        };
+
+        // Vertices on a triangle that contains the whole edge just slide along it, so their attributes stay continuous
+        std::vector<uint32_t> candidates;
+        for (const uint32_t t : positionTriangles[from]) {
+            if (removed[t]) continue;
+            uint32_t fromVertex = UINT32_MAX, toVertex = UINT32_MAX;
+            for (size_t k = 0; k < 3; k++) {
+                const uint32_t vertex = triangles[3 * t + k];
+                if (positionIndex[vertex] == from) fromVertex = vertex;
+                else if (positionIndex[vertex] == to) toVertex = vertex;
+            } if (toVertex == UINT32_MAX) continue;
+
+            if (!isMapped(fromVertex)) vertexMap.emplace_back(fromVertex, toVertex);
+        }
+
+        // Everything else becomes whichever vertex on the other end looks the most alike
+        for (const uint32_t t : positionTriangles[to]) {
+            if (removed[t]) continue;
+            for (size_t k = 0; k < 3; k++) {
+                const uint32_t vertex = triangles[3 * t + k];
+                if (positionIndex[vertex] == to && std::ranges::find(candidates, vertex) == candidates.end())
+                    candidates.push_back(vertex);
+            }
+        } if (candidates.empty()) return std::numeric_limits<double>::max();
+
+        for (const uint32_t t : positionTriangles[from]) {
+            if (removed[t]) continue;
+            uint32_t fromVertex = UINT32_MAX;
+            for (size_t k = 0; k < 3; k++)
+                if (positionIndex[triangles[3 * t + k]] == from) fromVertex = triangles[3 * t + k];
+            if (isMapped(fromVertex)) continue;
+
+            uint32_t best = candidates[0];
+            for (const uint32_t candidate : candidates)
+                if (attributeDistance(fromVertex, candidate) < attributeDistance(fromVertex, best)) best = candidate;
+            vertexMap.emplace_back(fromVertex, best);
+        }
+
+        double cost = 0.0;
+        for (const auto &[fromVertex, toVertex] : vertexMap) cost += attributeDistance(fromVertex, toVertex);
+        return cost;
+    }
+
+    double MeshSimplifier::collapseCost(const uint32_t from, const uint32_t to) const {
+        Quadric quadric = quadrics[from];
+        quadric += quadrics[to];
+        const double positional = std::max(0.0, quadric.evaluate(positions[to])); // Can go slightly negative
+
+        std::vector<std::pair<uint32_t, uint32_t>> vertexMap;
+        const double attribute = mapVertices(from, to, vertexMap);
+        if (attribute == std::numeric_limits<double>::max()) return attribute;
+
+        // Attributes changing matters more the further they get stretched, so we scale them by the edge length
+        const glm::dvec3 edge = positions[from] - positions[to];
+        return positional + attribute * glm::dot(edge, edge);
+    }
+
+    bool MeshSimplifier::isCollapseValid(const uint32_t from, const uint32_t to) const {
+        // The only positions connected to both ends should be the ones on the triangles we're about to remove,
+        // otherwise we'd be gluing together two parts of the mesh, and it would end up non-manifold
+        std::vector<uint32_t> fromNeighbours, toNeighbours;
+        size_t sharedTriangles = 0;
+        for (const uint32_t t : positionTriangles[from]) {
+            if (removed[t]) continue;
+            bool hasTo = false;
+            for (size_t k = 0; k < 3; k++) {
+                const uint32_t position = positionIndex[triangles[3 * t + k]];
+                if (position == to) hasTo = true;
+                else if (position != from && std::ranges::find(fromNeighbours, position) == fromNeighbours.end())
+                    fromNeighbours.push_back(position);
+            } if (hasTo) sharedTriangles++;
+        }
+        for (const uint32_t t : positionTriangles[to]) {
+            if (removed[t]) continue;
+            for (size_t k = 0; k < 3; k++) {
+                const uint32_t position = positionIndex[triangles[3 * t + k]];
+                if (position != to && position != from && std::ranges::find(toNeighbours, position) == toNeighbours.end())
+                    toNeighbours.push_back(position);
+            }
+        }
+        const auto commonNeighbours = std::ranges::count_if(fromNeighbours, [&toNeighbours](uint32_t position) {
+            return std::ranges::find(toNeighbours, position) != toNeighbours.end();
+        }); if (static_cast<size_t>(commonNeighbours) > sharedTriangles) return false;
+
+        // And none of the triangles that stay should flip over, or get squashed flat
+        for (const uint32_t t : positionTriangles[from]) {
+            if (removed[t]) continue;
+            glm::dvec3 before[3], after[3];
+            bool hasTo = false;
+            for (size_t k = 0; k < 3; k++) {
+                const uint32_t position = positionIndex[triangles[3 * t + k]];
+                hasTo |= position == to;
+                before[k] = positions[position];
+                after[k] = position == from ? positions[to] : positions[position];
+            } if (hasTo) continue; // This one is going away anyway
+
+            const glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+            const glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+            const double lengthAfter = glm::length(normalAfter);
+            if (lengthAfter <= 1e-12) return false;
+            if (glm::dot(normalBefore, normalAfter) < 0.2 * glm::length(normalBefore) * lengthAfter) return false;
+        } return true;
+    }
+
+    bool MeshSimplifier::collapse(const uint32_t from, const uint32_t to) {
+        if (!isCollapseValid(from, to)) return false;
+
+        std::vector<std::pair<uint32_t, uint32_t>> vertexMap;
+        mapVertices(from, to, vertexMap);
+
+        // Whatever was at the collapsed position is now off the surface by however far it is from the triangles that
+        // replaced the ones around it, on top of however far off it already was
+        double distance = 0.0;
+        for (const uint32_t t : positionTriangles[from]) {
+            if (removed[t]) continue;
+
+            bool hasTo = false;
+            for (size_t k = 0; k < 3; k++) hasTo |= positionIndex[triangles[3 * t + k]] == to;
+            if (hasTo) {
+                removed[t] = true;
+                liveTriangles--;
+                continue;
+            }
+
+            for (size_t k = 0; k < 3; k++) {
+                uint32_t &vertex = triangles[3 * t + k];
+                if (positionIndex[vertex] != from) continue;
+                const auto it = std::ranges::find_if(vertexMap, [vertex](const auto &pair) { return pair.first == vertex; });
+                assert(it != vertexMap.end() && "Every vertex at the collapsed position must have been mapped!");
+                vertex = it->second;
+            } positionTriangles[to].push_back(t);
+
+            const glm::dvec3 &p0 = positions[positionIndex[triangles[3 * t]]];
+            const glm::dvec3 normal = glm::cross(positions[positionIndex[triangles[3 * t + 1]]] - p0,
+                                                 positions[positionIndex[triangles[3 * t + 2]]] - p0);
+            const double length = glm::length(normal); // Never 0, isCollapseValid made sure of that
+            distance = std::max(distance, std::abs(glm::dot(positions[from] - p0, normal)) / length);
+        } positionTriangles[from].clear();
+
+        quadrics[to] += quadrics[from];
+        positionErrors[to] = std::max(positionErrors[to], positionErrors[from] + distance);
+        error = std::max(error, static_cast<float>(positionErrors[to]));
+        return true;
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef SIMPLIFIER_HPP
+#define SIMPLIFIER_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cassert>
+
+#include "model.hpp"
+
+// See "Surface Simplification Using Quadric Error Metrics", by Garland and Heckbert, for the original algorithm.
+namespace Engine {
+    // Simplifies a mesh by collapsing edges, picking the ones that change the surface the least first.
+    // We only ever do half-edge collapses (one vertex gets merged into another, which stays where it was), so we never
+    // have to create new vertices, and every LOD can share the same vertex buffer.
+    class MeshSimplifier {
+    public:
+        // How much we care about each attribute changing, compared to the position
+        struct AttributeWeights {
+            float normal = 0.5f;
+            float color = 0.25f;
+            float texCoord = 1.0f;
+        };
+
+        MeshSimplifier(const std::vector<Model::Vertex> &vertices,
+                       const std::vector<uint32_t> &indices,
+                       AttributeWeights weights = {});
+
+        // Keeps collapsing edges until we get to the target index count, or we run out of edges we can collapse.
+        // This is cumulative, so each call keeps going from wherever the previous one left off.
+        [[nodiscard]] std::vector<uint32_t> simplify(size_t targetIndexCount);
+
+        // How far the surface might have moved away from the original so far, relative to the radius of the mesh.
+        // That's a distance, unlike the collapse costs, which mix in the attributes, and are weighted by area.
+        [[nodiscard]] float getError() const { return error; }
+    private:
+        // Symmetric 4x4 matrix, so we only need 10 values
+        struct Quadric {
+            double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+            double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+            double c = 0.0;
+
+            Quadric() = default;
+            Quadric(glm::dvec3 normal, double distance, double weight);
+
+            Quadric& operator+=(const Quadric &other);
+            [[nodiscard]] double evaluate(glm::dvec3 point) const;
+        };
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+
+        const std::vector<Model::Vertex> &vertices;
+        AttributeWeights weights;
+
+        // We work with positions instead of vertices, so that attribute seams (like flat normals) don't split the mesh
+        std::vector<uint32_t> positionIndex; // Vertex to position
+        std::vector<glm::dvec3> positions; // Normalized to the bounds of the mesh, so errors don't depend on its size
+
+        std::vector<uint32_t> triangles; // Still indexes the original vertices
+        std::vector<bool> removed;
+        size_t liveTriangles = 0;
+
+        std::vector<std::vector<uint32_t>> positionTriangles;
+        std::vector<Quadric> quadrics;
+        std::vector<bool> locked; // Borders can't move, otherwise holes would open up
+        // The furthest any of the original positions that got collapsed into each one are from the surface around it
+        std::vector<double> positionErrors;
+
+        float error = 0.0f;
+
+        void computeQuadrics();
+        void lockBorders();
+
+        [[nodiscard]] float attributeDistance(uint32_t a, uint32_t b) const;
+        // Finds which vertex each of the vertices at the collapsed position should become, returning the cost of doing so
+        double mapVertices(uint32_t from, uint32_t to, std::vector<std::pair<uint32_t, uint32_t>> &vertexMap) const;
+        [[nodiscard]] double collapseCost(uint32_t from, uint32_t to) const;
+        [[nodiscard]] bool isCollapseValid(uint32_t from, uint32_t to) const;
+        bool collapse(uint32_t from, uint32_t to);
+    };
+}
+
+#endif
@@ -0,0 +1,65 @@
+#include <cstring>
+
+#include "model.hpp"
+#include "../mappedfile/mappedfile.hpp"
+#include "../vertexwelder/vertexwelder.hpp"
+#include "../workerpool/workerpool.hpp"
+
+namespace Engine {
+    namespace {
+        constexpr size_t HEADER_SIZE = 84; // 80 bytes nobody agrees on, and the triangle count
+        constexpr size_t TRIANGLE_SIZE = 50; // Normal, three corners, and two bytes of "attributes"
+        // About 19MB of corners at a time, no matter how big the file is
+        constexpr uint32_t BATCH_TRIANGLES = 128 * 1024;
+        constexpr uint32_t CHUNK_TRIANGLES = 4096;
+
+        // Triangles are 50 bytes, so nothing after the first one is aligned
+        glm::vec3 readVec3(const std::byte *data) {
+            float values[3];
+            std::memcpy(values, data, sizeof(values));
+            return {values[0], values[1], values[2]};
+        }
+    }
+
+    // The file's only ever read straight from the mapping, a batch of triangles at a time, so all that sticks around is
+    // what we weld them into
+    void Model::Builder::loadStl(const std::string &path, const uint32_t threadCount) {
+        ZoneScoped;
+        const MappedFile file(path);
+        if (!file.isOpen()) throw std::runtime_error("Failed to open " + path + "!");
+        if (file.getSize() < HEADER_SIZE) throw std::runtime_error("Failed to load " + path + ", it's too small!");
+
+        uint32_t triangleCount;
+        std::memcpy(&triangleCount, file.getData() + 80, sizeof(triangleCount));
+        // ASCII ones start with "solid", but so do plenty of binary ones, so the size is the only way to tell.
+        // Some exporters leave junk at the end, which is fine, as long as every triangle's there.
+        if (file.getSize() < HEADER_SIZE + triangleCount * TRIANGLE_SIZE)
+            throw std::runtime_error("Failed to load " + path + ", only binary STL files are supported!");
+
+        vertices.clear();
+        indices.clear();
+        indices.reserve(size_t{3} * triangleCount);
+
+        WorkerPool pool(std::max(2u, threadCount) - 1); // Our own, since the shared one might be the one running this
+        ParallelVertexWelder welder(pool, threadCount, weldEpsilon);
+        std::vector<Vertex> corners;
+        for (uint32_t first = 0; first < triangleCount; first += BATCH_TRIANGLES) {
+            const uint32_t count = std::min(BATCH_TRIANGLES, triangleCount - first);
+            const std::byte *batch = file.getData() + HEADER_SIZE + first * TRIANGLE_SIZE;
+            corners.resize(size_t{3} * count);
+            pool.parallelFor(count, CHUNK_TRIANGLES, [&](const uint32_t begin, const uint32_t end) {
+                for (uint32_t i = begin; i < end; i++) {
+                    // Plenty of exporters just write zeros for the normal, but the winding is always right, so the
+                    // normals come from that afterwards, and the corners get welded on their position alone
+                    const std::byte *triangle = batch + i * TRIANGLE_SIZE;
+                    for (size_t j = 0; j < 3; j++) {
+                        corners[3 * size_t{i} + j] = {readVec3(triangle + 12 * (j + 1)),
+                                                      glm::vec3{1.0f}, glm::vec3{0.0f}, glm::vec2{0.0f}};
+                    }
+                }
+            });
+            welder.weld(corners, indices);
+        } welder.finish(vertices, indices);
+        computeSmoothNormals(pool);
+    }
+}
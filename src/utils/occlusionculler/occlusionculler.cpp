@@ -0,0 +1,432 @@
+#include "occlusionculler.hpp"
+
+#include <bit>
+#include <cassert>
+#include <algorithm>
+#include <cstring>
+
+#include "../frameinfo/frameinfo.hpp"
+
+namespace Engine {
+    struct HiZDepthPushConstant {
+        glm::uvec2 renderExtent{};
+        glm::uvec2 pyramidExtent{};
+        uint32_t sampleCount = 1;
+    };
+
+    struct OcclusionCullPushConstant {
+        glm::mat4 viewProjection{1.0f};
+    };
+
+    namespace {
+        constexpr uint32_t PYRAMID_GROUP_SIZE = 8; // Has to match the hiz_*.comp shaders
+        constexpr uint32_t INSTANCE_GROUP_SIZE = 64; // Has to match the occlusion_*.comp shaders
+
+        uint32_t groupCount(const uint32_t size, const uint32_t groupSize) { return (size + groupSize - 1) / groupSize; }
+    }
+
+    OcclusionCuller::OcclusionCuller(Device &device, const uint32_t framesInFlight) : device(device),
+                                                                                     instanceCounts(framesInFlight, 0),
+                                                                                     hasResults(framesInFlight, false) {
+        createBuffers(framesInFlight);
+        createSampler();
+        createPipelines();
+    }
+    OcclusionCuller::~OcclusionCuller() {
+        destroyPyramid();
+        vkDestroySampler(device.device(), sampler, nullptr);
+        vkDestroyPipelineLayout(device.device(), depthPipelineLayout, nullptr);
+        vkDestroyPipelineLayout(device.device(), reducePipelineLayout, nullptr);
+        vkDestroyPipelineLayout(device.device(), cullPipelineLayout, nullptr);
+    }
+
+    void OcclusionCuller::beginFrame(const uint32_t frameIndex) {
+        this->frameIndex = frameIndex;
+        instanceCount = 0;
+        cullDescriptorSet = VK_NULL_HANDLE;
+
+        // By the time we get here, the renderer has waited for this frame's slot to be free, so the stats should be ready
+        auto *stats = static_cast<Stats*>(statsBuffers[frameIndex]->getMappedMemory());
+        if (hasResults[frameIndex]) {
+            testedInstances = instanceCounts[frameIndex];
+            occludedInstances = stats->occluded;
+            disoccludedInstances = stats->disoccluded;
+        }
+        *stats = {0, 0};
+        hasResults[frameIndex] = false;
+    }
+
+    bool OcclusionCuller::addInstance(const Entity::id_t id,
+                                      const glm::vec3 center,
+                                      const float radius,
+                                      const uint32_t firstCommand,
+                                      const uint32_t secondCommand,
+                                      const uint32_t commandCount) {
+        if (instanceCount == MAX_INSTANCES) return false;
+
+        auto *instances = static_cast<Instance*>(instanceBuffers[frameIndex]->getMappedMemory()) + 1; // Skip the count
+        instances[instanceCount++] = {glm::vec4(center, radius), id, firstCommand, secondCommand, commandCount};
+        return true;
+    }
+
+    void OcclusionCuller::prepare(const FrameInfo &frameInfo, const VkExtent2D extent) {
+        // The base of the pyramid is the biggest power of two that fits, so each texel covers at most 2x2 pixels
+        const VkExtent2D wantedExtent{std::bit_floor(extent.width), std::bit_floor(extent.height)};
+        if (wantedExtent.width != pyramidExtent.width || wantedExtent.height != pyramidExtent.height) {
+            vkDeviceWaitIdle(device.device()); // Only happens on resize, and the old one might still be in use
+            destroyPyramid();
+            createPyramid(wantedExtent);
+        }
+
+        VkDescriptorBufferInfo instanceInfo = instanceBuffers[frameIndex]->descriptorInfo();
+        VkDescriptorBufferInfo commandInfo{frameInfo.clusterCuller.getCommandBuffer(), 0, VK_WHOLE_SIZE};
+        VkDescriptorBufferInfo visibilityInfo = visibilityBuffer->descriptorInfo();
+        VkDescriptorImageInfo pyramidInfo{sampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL};
+        VkDescriptorBufferInfo statsInfo = statsBuffers[frameIndex]->descriptorInfo();
+        DescriptorWriter(*cullSetLayout, frameInfo.frameDescriptorPool)
+                .writeBuffer(0, &instanceInfo)
+                .writeBuffer(1, &commandInfo)
+                .writeBuffer(2, &visibilityInfo)
+                .writeImage(3, &pyramidInfo)
+                .writeBuffer(4, &statsInfo)
+                .build(cullDescriptorSet);
+
+        // Last frame's cull pass has to be done writing the visibility before we read it
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(frameInfo.commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             1, &barrier,
+                             0, nullptr,
+                             0, nullptr);
+
+        // We don't know how many instances there are yet, but cull() fills in the dispatch before the frame gets submitted
+        preparePipeline->bind(frameInfo.commandBuffer);
+        vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+                                VK_PIPELINE_BIND_POINT_COMPUTE,
+                                cullPipelineLayout,
+                                0,
+                                1,
+                                &cullDescriptorSet,
+                                0,
+                                nullptr);
+        vkCmdDispatchIndirect(frameInfo.commandBuffer, dispatchBuffers[frameIndex]->getBuffer(), 0);
+
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        vkCmdPipelineBarrier(frameInfo.commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                             0,
+                             1, &barrier,
+                             0, nullptr,
+                             0, nullptr);
+    }
+
+    void OcclusionCuller::cull(const FrameInfo &frameInfo, VkImageView depthImageView, const VkExtent2D renderExtent) {
+        assert(cullDescriptorSet != VK_NULL_HANDLE && "Cannot cull without preparing the frame first!");
+        const VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+        // Now we know how many instances there are, for both this and the prepare pass
+        *static_cast<uint32_t*>(instanceBuffers[frameIndex]->getMappedMemory()) = instanceCount;
+        *static_cast<VkDispatchIndirectCommand*>(dispatchBuffers[frameIndex]->getMappedMemory()) =
+            {groupCount(instanceCount, INSTANCE_GROUP_SIZE), 1, 1};
+        instanceCounts[frameIndex] = instanceCount;
+
+        // The last frame's cull pass might still be reading the pyramid, but we overwrite all of it, so the contents can go
+        VkImageMemoryBarrier pyramidBarrier{};
+        pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        pyramidBarrier.srcAccessMask = 0;
+        pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        pyramidBarrier.image = pyramid->getImage();
+        pyramidBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        pyramidBarrier.subresourceRange.baseMipLevel = 0;
+        pyramidBarrier.subresourceRange.levelCount = pyramid->getMipLevels();
+        pyramidBarrier.subresourceRange.baseArrayLayer = 0;
+        pyramidBarrier.subresourceRange.layerCount = 1;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &pyramidBarrier);
+
+        // The first level comes straight from the depth buffer, which might be multisampled
+        const VkSampleCountFlagBits sampleCount = device.getDesiredSampleCount();
+        if (sampleCount == VK_SAMPLE_COUNT_1_BIT) depthPipeline->bind(commandBuffer);
+        else multisampledDepthPipeline->bind(commandBuffer);
+
+        VkDescriptorImageInfo depthInfo{sampler, depthImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+        VkDescriptorImageInfo baseInfo{VK_NULL_HANDLE, pyramidMipViews[0], VK_IMAGE_LAYOUT_GENERAL};
+        VkDescriptorSet depthDescriptorSet;
+        DescriptorWriter(*depthSetLayout, frameInfo.frameDescriptorPool)
+                .writeImage(0, &depthInfo)
+                .writeImage(1, &baseInfo)
+                .build(depthDescriptorSet);
+        vkCmdBindDescriptorSets(commandBuffer,
+                                VK_PIPELINE_BIND_POINT_COMPUTE,
+                                depthPipelineLayout,
+                                0,
+                                1,
+                                &depthDescriptorSet,
+                                0,
+                                nullptr);
+
+        HiZDepthPushConstant depthPush{};
+        depthPush.renderExtent = {renderExtent.width, renderExtent.height};
+        depthPush.pyramidExtent = {pyramidExtent.width, pyramidExtent.height};
+        depthPush.sampleCount = static_cast<uint32_t>(sampleCount);
+        vkCmdPushConstants(commandBuffer,
+                           depthPipelineLayout,
+                           VK_SHADER_STAGE_COMPUTE_BIT,
+                           0,
+                           sizeof(HiZDepthPushConstant),
+                           &depthPush);
+        vkCmdDispatch(commandBuffer,
+                      groupCount(pyramidExtent.width, PYRAMID_GROUP_SIZE),
+                      groupCount(pyramidExtent.height, PYRAMID_GROUP_SIZE),
+                      1);
+
+        // Every other level comes from the one before it, so we have to wait for each one to be written first
+        pyramidBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        pyramidBarrier.subresourceRange.levelCount = 1;
+        reducePipeline->bind(commandBuffer);
+        for (uint32_t level = 1; level <= pyramid->getMipLevels(); level++) {
+            pyramidBarrier.subresourceRange.baseMipLevel = level - 1;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0,
+                                 0, nullptr,
+                                 0, nullptr,
+                                 1, &pyramidBarrier);
+            if (level == pyramid->getMipLevels()) break; // The last one only needed the barrier
+
+            VkDescriptorImageInfo sourceInfo{VK_NULL_HANDLE, pyramidMipViews[level - 1], VK_IMAGE_LAYOUT_GENERAL};
+            VkDescriptorImageInfo destinationInfo{VK_NULL_HANDLE, pyramidMipViews[level], VK_IMAGE_LAYOUT_GENERAL};
+            VkDescriptorSet reduceDescriptorSet;
+            DescriptorWriter(*reduceSetLayout, frameInfo.frameDescriptorPool)
+                    .writeImage(0, &sourceInfo)
+                    .writeImage(1, &destinationInfo)
+                    .build(reduceDescriptorSet);
+            vkCmdBindDescriptorSets(commandBuffer,
+                                    VK_PIPELINE_BIND_POINT_COMPUTE,
+                                    reducePipelineLayout,
+                                    0,
+                                    1,
+                                    &reduceDescriptorSet,
+                                    0,
+                                    nullptr);
+            vkCmdDispatch(commandBuffer,
+                          groupCount(std::max(1u, pyramidExtent.width >> level), PYRAMID_GROUP_SIZE),
+                          groupCount(std::max(1u, pyramidExtent.height >> level), PYRAMID_GROUP_SIZE),
+                          1);
+        }
+
+        cullPipeline->bind(commandBuffer);
+        vkCmdBindDescriptorSets(commandBuffer,
+                                VK_PIPELINE_BIND_POINT_COMPUTE,
+                                cullPipelineLayout,
+                                0,
+                                1,
+                                &cullDescriptorSet,
+                                0,
+                                nullptr);
+
+        OcclusionCullPushConstant cullPush{};
+        cullPush.viewProjection = frameInfo.camera.getProjectionMatrix() * frameInfo.camera.getViewMatrix();
+        vkCmdPushConstants(commandBuffer,
+                           cullPipelineLayout,
+                           VK_SHADER_STAGE_COMPUTE_BIT,
+                           0,
+                           sizeof(OcclusionCullPushConstant),
+                           &cullPush);
+        vkCmdDispatchIndirect(commandBuffer, dispatchBuffers[frameIndex]->getBuffer(), 0);
+
+        // The second phase draws need the new instance counts, and we read the stats back once the frame is done
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                             0,
+                             1, &barrier,
+                             0, nullptr,
+                             0, nullptr);
+        hasResults[frameIndex] = true;
+    }
+
+    void OcclusionCuller::createBuffers(const uint32_t framesInFlight) {
+        instanceBuffers.resize(framesInFlight);
+        dispatchBuffers.resize(framesInFlight);
+        statsBuffers.resize(framesInFlight);
+        for (uint32_t i = 0; i < framesInFlight; i++) {
+            // One extra, for the count
+            instanceBuffers[i] = std::make_unique<Buffer>(device,
+                                                          sizeof(Instance),
+                                                          MAX_INSTANCES + 1,
+                                                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            dispatchBuffers[i] = std::make_unique<Buffer>(device,
+                                                          sizeof(VkDispatchIndirectCommand),
+                                                          1,
+                                                          VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            statsBuffers[i] = std::make_unique<Buffer>(device,
+                                                       sizeof(Stats),
+                                                       1,
+                                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            instanceBuffers[i]->map();
+            dispatchBuffers[i]->map();
+            statsBuffers[i]->map();
+            std::memset(statsBuffers[i]->getMappedMemory(), 0, sizeof(Stats));
+        }
+
+        // Nothing is visible to begin with, so the first frame draws everything on the second phase
+        visibilityBuffer = std::make_unique<Buffer>(device,
+                                                    sizeof(uint32_t),
+                                                    MAX_ENTITIES,
+                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        vkCmdFillBuffer(commandBuffer, visibilityBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+        device.endSingleTimeCommands(commandBuffer);
+    }
+
+    void OcclusionCuller::createSampler() {
+        // We only ever use texelFetch, but sampled images still need a sampler
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.anisotropyEnable = VK_FALSE;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+        samplerInfo.unnormalizedCoordinates = VK_FALSE;
+        samplerInfo.compareEnable = VK_FALSE;
+        samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        samplerInfo.mipLodBias = 0.0f;
+
+        if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the depth pyramid sampler!");
+    }
+
+    void OcclusionCuller::createPipelines() {
+        depthSetLayout = DescriptorSetLayout::Builder(device)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT).build();
+        reduceSetLayout = DescriptorSetLayout::Builder(device)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT).build();
+        cullSetLayout = DescriptorSetLayout::Builder(device)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT).build();
+
+        depthPipelineLayout = createPipelineLayout(*depthSetLayout, sizeof(HiZDepthPushConstant));
+        reducePipelineLayout = createPipelineLayout(*reduceSetLayout, 0);
+        cullPipelineLayout = createPipelineLayout(*cullSetLayout, sizeof(OcclusionCullPushConstant));
+
+        depthPipeline = std::make_unique<ComputePipeline>(device,
+                                                          "../res/shaders/compiled/hiz_depth.comp.spv",
+                                                          depthPipelineLayout);
+        multisampledDepthPipeline = std::make_unique<ComputePipeline>(device,
+                                                                      "../res/shaders/compiled/hiz_depth_ms.comp.spv",
+                                                                      depthPipelineLayout);
+        reducePipeline = std::make_unique<ComputePipeline>(device,
+                                                           "../res/shaders/compiled/hiz_reduce.comp.spv",
+                                                           reducePipelineLayout);
+        preparePipeline = std::make_unique<ComputePipeline>(device,
+                                                            "../res/shaders/compiled/occlusion_prepare.comp.spv",
+                                                            cullPipelineLayout);
+        cullPipeline = std::make_unique<ComputePipeline>(device,
+                                                         "../res/shaders/compiled/occlusion_cull.comp.spv",
+                                                         cullPipelineLayout);
+    }
+
+    void OcclusionCuller::createPyramid(const VkExtent2D extent) {
+        pyramidExtent = extent;
+        pyramid = std::make_unique<Image>(device,
+                                          extent.width,
+                                          extent.height,
+                                          VK_SAMPLE_COUNT_1_BIT,
+                                          VK_FORMAT_R32_SFLOAT,
+                                          VK_IMAGE_TILING_OPTIMAL,
+                                          VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                          0); // All the way down to 1x1
+        pyramidView = pyramid->createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
+
+        // Each level gets written on its own, so they all need their own view
+        pyramidMipViews.resize(pyramid->getMipLevels());
+        for (uint32_t level = 0; level < pyramid->getMipLevels(); level++) {
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = pyramid->getImage();
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = VK_FORMAT_R32_SFLOAT;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseMipLevel = level;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device.device(), &viewInfo, nullptr, &pyramidMipViews[level]) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create a depth pyramid image view!");
+        }
+    }
+    void OcclusionCuller::destroyPyramid() {
+        for (const VkImageView view : pyramidMipViews) vkDestroyImageView(device.device(), view, nullptr);
+        pyramidMipViews.clear();
+        pyramid = nullptr; // Takes its view with it
+        pyramidView = VK_NULL_HANDLE;
+        pyramidExtent = {0, 0};
+    }
+
+    VkPipelineLayout OcclusionCuller::createPipelineLayout(const DescriptorSetLayout &setLayout,
+                                                           const uint32_t pushConstantSize) const {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = pushConstantSize;
+
+        const VkDescriptorSetLayout descriptorSetLayout = setLayout.getDescriptorSetLayout();
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+        pipelineLayoutInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+        VkPipelineLayout pipelineLayout;
+        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the pipeline layout!");
+        return pipelineLayout;
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef OCCLUSIONCULLER_HPP
+#define OCCLUSIONCULLER_HPP
+
+#include <vector>
+#include <memory>
+#include <limits>
+
+#include <vulkan/vulkan.h>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "../device/device.hpp"
+#include "../buffer/buffer.hpp"
+#include "../image/image.hpp"
+#include "../descriptors/descriptors.hpp"
+#include "../pipeline/pipeline.hpp"
+#include "../entity/entity.hpp"
+
+namespace Engine {
+    struct FrameInfo;
+
+    // Two phase occlusion culling, the same way most GPU driven renderers do it:
+    //  1. Draw whatever was visible last frame
+    //  2. Build a depth pyramid (each mip keeps the farthest depth of the one before it) out of what we just drew
+    //  3. Test every instance against the pyramid, and draw the ones that are visible now but weren't drawn before
+    // Everything happens on the GPU, by editing the instance count of the indirect draws the cluster culler writes, so
+    // we never have to wait for anything to come back. Visibility gets stored per entity, on a buffer shared by every frame.
+    class OcclusionCuller {
+    public:
+        static constexpr uint32_t MAX_INSTANCES = 16384; // Per frame
+        static constexpr uint32_t MAX_ENTITIES = std::numeric_limits<Entity::id_t>::max() + 1u; // One slot each
+
+        OcclusionCuller(Device &device, uint32_t framesInFlight);
+        ~OcclusionCuller();
+
+        OcclusionCuller(const OcclusionCuller &) = delete;
+        OcclusionCuller& operator=(const OcclusionCuller &) = delete;
+
+        // Has to be called once per frame, after the renderer has started the frame
+        void beginFrame(uint32_t frameIndex);
+
+        // Returns false if there's no space left for it, in which case it should always get drawn on the first phase
+        bool addInstance(Entity::id_t id,
+                         glm::vec3 center,
+                         float radius,
+                         uint32_t firstCommand,
+                         uint32_t secondCommand,
+                         uint32_t commandCount);
+
+        // Before the first phase, hides the first phase draws of whatever wasn't visible last frame
+        void prepare(const FrameInfo &frameInfo, VkExtent2D extent);
+        // Between both phases, outside of any render pass, builds the pyramid and decides what the second phase draws
+        void cull(const FrameInfo &frameInfo, VkImageView depthImageView, VkExtent2D renderExtent);
+
+        // These come from the last frame that finished, which is a few frames behind
+        [[nodiscard]] uint32_t getTestedInstances() const { return testedInstances; }
+        [[nodiscard]] uint32_t getOccludedInstances() const { return occludedInstances; }
+        [[nodiscard]] uint32_t getDisoccludedInstances() const { return disoccludedInstances; }
+    private:
+        // Has to match occlusion_cull.comp and occlusion_prepare.comp
+        struct Instance {
+            glm::vec4 sphere; // 16 bytes
+            uint32_t id; // 4 bytes
+            uint32_t firstCommand; // 4 bytes
+            uint32_t secondCommand; // 4 bytes
+            uint32_t commandCount; // 4 bytes
+        };
+        struct Stats {
+            uint32_t occluded;
+            uint32_t disoccluded;
+        };
+
+        Device &device;
+
+        // The instance count goes at the start of the buffer, and the instances after it, aligned like a vec4
+        std::vector<std::unique_ptr<Buffer>> instanceBuffers;
+        std::vector<std::unique_ptr<Buffer>> dispatchBuffers; // Both passes go through every instance
+        std::vector<std::unique_ptr<Buffer>> statsBuffers;
+        std::vector<uint32_t> instanceCounts; // Per frame, so we know how many got tested when the stats come back
+        std::vector<bool> hasResults;
+        std::unique_ptr<Buffer> visibilityBuffer;
+
+        uint32_t frameIndex = 0;
+        uint32_t instanceCount = 0;
+        VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE; // This frame's, shared by the prepare and cull passes
+
+        uint32_t testedInstances = 0;
+        uint32_t occludedInstances = 0;
+        uint32_t disoccludedInstances = 0;
+
+        // The pyramid is shared by every frame, like the depth it's built from
+        std::unique_ptr<Image> pyramid;
+        VkImageView pyramidView = VK_NULL_HANDLE;
+        std::vector<VkImageView> pyramidMipViews;
+        VkExtent2D pyramidExtent{0, 0};
+        VkSampler sampler = VK_NULL_HANDLE;
+
+        std::unique_ptr<DescriptorSetLayout> depthSetLayout;
+        std::unique_ptr<DescriptorSetLayout> reduceSetLayout;
+        std::unique_ptr<DescriptorSetLayout> cullSetLayout;
+        VkPipelineLayout depthPipelineLayout = VK_NULL_HANDLE;
+        VkPipelineLayout reducePipelineLayout = VK_NULL_HANDLE;
+        VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+
+        std::unique_ptr<ComputePipeline> depthPipeline;
+        std::unique_ptr<ComputePipeline> multisampledDepthPipeline;
+        std::unique_ptr<ComputePipeline> reducePipeline;
+        std::unique_ptr<ComputePipeline> preparePipeline;
+        std::unique_ptr<ComputePipeline> cullPipeline;
+
+        void createBuffers(uint32_t framesInFlight);
+        void createSampler();
+        void createPipelines();
+        void createPyramid(VkExtent2D extent);
+        void destroyPyramid();
+        [[nodiscard]] VkPipelineLayout createPipelineLayout(const DescriptorSetLayout &setLayout,
+                                                            uint32_t pushConstantSize) const;
+    };
+}
+
+#endif
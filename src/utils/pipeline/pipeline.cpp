@@ -225,4 +225,42 @@ namespace Engine {
     void Pipeline::setSampleCount(PipelineConfigInfo &configInfo, VkSampleCountFlagBits sampleCount) {
         configInfo.multisampleInfo.rasterizationSamples = sampleCount;
     }
+
+    ComputePipeline::ComputePipeline(Device &device,
+                                     const std::string &compFilepath,
+                                     VkPipelineLayout pipelineLayout) :
+                                     device(device) {
+        const std::vector<char> compCode = Pipeline::readFile(compFilepath);
+
+        VkShaderModuleCreateInfo moduleInfo{};
+        moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = compCode.size();
+        moduleInfo.pCode = reinterpret_cast<const uint32_t*>(compCode.data());
+        if (vkCreateShaderModule(device.device(), &moduleInfo, nullptr, &compShaderModule) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the shader module");
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = compShaderModule;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = pipelineLayout;
+
+        if (vkCreateComputePipelines(device.device(),
+                                     VK_NULL_HANDLE,
+                                     1,
+                                     &pipelineInfo,
+                                     nullptr,
+                                     &computePipeline) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the compute pipeline");
+    }
+    ComputePipeline::~ComputePipeline() {
+        vkDestroyShaderModule(device.device(), compShaderModule, nullptr);
+        vkDestroyPipeline(device.device(), computePipeline, nullptr);
+    }
+
+    void ComputePipeline::bind(VkCommandBuffer commandBuffer) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+    }
 }
\ No newline at end of file
@@ -51,20 +51,36 @@ namespace Engine {
         static void enableAlphaBlending(PipelineConfigInfo& configInfo);
         static void enableWireframe(PipelineConfigInfo& configInfo);
         static void setSampleCount(PipelineConfigInfo& configInfo, VkSampleCountFlagBits sampleCount);
+
+        static std::vector<char> readFile(const std::string& filepath);
     private:
         Device& device;
         VkPipeline graphicsPipeline;
         VkShaderModule vertShaderModule;
         VkShaderModule fragShaderModule;
 
-        static std::vector<char> readFile(const std::string& filepath);
-
         void createGraphicsPipeline(const std::string& vertFilepath,
                                     const std::string& fragFilepath,
                                     const PipelineConfigInfo& configInfo);
 
         void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
     };
+
+    // Way simpler than the graphics one, there's nothing to configure besides the layout
+    class ComputePipeline {
+    public:
+        ComputePipeline(Device &device, const std::string &compFilepath, VkPipelineLayout pipelineLayout);
+        ~ComputePipeline();
+
+        ComputePipeline(const ComputePipeline&) = delete;
+        ComputePipeline &operator=(const ComputePipeline&) = delete;
+
+        void bind(VkCommandBuffer commandBuffer);
+    private:
+        Device& device;
+        VkPipeline computePipeline;
+        VkShaderModule compShaderModule;
+    };
 }
 
 
@@ -1,21 +1,15 @@
 #include "cube.hpp"
 
-template<>
-struct std::hash<Engine::Model::Vertex> {
-    size_t operator()(Engine::Model::Vertex const &vertex) const noexcept {
-        size_t seed = 0;
-        hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.texCoord);
-        return seed;
-    }
-};
+#include "../../vertexwelder/vertexwelder.hpp"
 
 namespace Engine::Procedural {
     void Cube::generateModel() {
+        ZoneScoped;
         // Reserve space for the vertices and indices. This is done to avoid reallocations, which should give us better performance.
         uint32_t reserveSpace = 6 * resolution * resolution + 2;
         vertices.reserve(reserveSpace);
         indices.reserve(6 * reserveSpace);
-        std::unordered_map<Model::Vertex, uint32_t> uniqueVertices(reserveSpace);
+        VertexWelder welder(vertices, reserveSpace);
 
         // Precomputed values for the loops.
         float step = 1.0f / static_cast<float>(resolution);
@@ -58,35 +52,20 @@ namespace Engine::Procedural {
                 vertex4.texCoord = {x1Step,
                                     y1Step};
 
-                if (!uniqueVertices.contains(vertex1)) {
-                    uniqueVertices[vertex1] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex1);
-                }
-
-                if (!uniqueVertices.contains(vertex2)) {
-                    uniqueVertices[vertex2] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex2);
-                }
-
-                if (!uniqueVertices.contains(vertex3)) {
-                    uniqueVertices[vertex3] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex3);
-                }
-
-                if (!uniqueVertices.contains(vertex4)) {
-                    uniqueVertices[vertex4] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex4);
-                }
+                const uint32_t index1 = welder.weld(vertex1);
+                const uint32_t index2 = welder.weld(vertex2);
+                const uint32_t index3 = welder.weld(vertex3);
+                const uint32_t index4 = welder.weld(vertex4);
 
                 // Triangle 1
-                indices.push_back(uniqueVertices[vertex1]);
-                indices.push_back(uniqueVertices[vertex2]);
-                indices.push_back(uniqueVertices[vertex3]);
+                indices.push_back(index1);
+                indices.push_back(index2);
+                indices.push_back(index3);
 
                 // Triangle 2
-                indices.push_back(uniqueVertices[vertex2]);
-                indices.push_back(uniqueVertices[vertex4]);
-                indices.push_back(uniqueVertices[vertex3]);
+                indices.push_back(index2);
+                indices.push_back(index4);
+                indices.push_back(index3);
 
 
                 // Back face
@@ -118,35 +97,20 @@ namespace Engine::Procedural {
                 vertex4p.texCoord = {x1Step,
                                      y1Step};
 
-                if (!uniqueVertices.contains(vertex1p)) {
-                    uniqueVertices[vertex1p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex1p);
-                }
-
-                if (!uniqueVertices.contains(vertex2p)) {
-                    uniqueVertices[vertex2p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex2p);
-                }
-
-                if (!uniqueVertices.contains(vertex3p)) {
-                    uniqueVertices[vertex3p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex3p);
-                }
-
-                if (!uniqueVertices.contains(vertex4p)) {
-                    uniqueVertices[vertex4p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex4p);
-                }
+                const uint32_t index1p = welder.weld(vertex1p);
+                const uint32_t index2p = welder.weld(vertex2p);
+                const uint32_t index3p = welder.weld(vertex3p);
+                const uint32_t index4p = welder.weld(vertex4p);
 
                 // Triangle 1
-                indices.push_back(uniqueVertices[vertex1p]);
-                indices.push_back(uniqueVertices[vertex3p]);
-                indices.push_back(uniqueVertices[vertex2p]);
+                indices.push_back(index1p);
+                indices.push_back(index3p);
+                indices.push_back(index2p);
 
                 // Triangle 2
-                indices.push_back(uniqueVertices[vertex2p]);
-                indices.push_back(uniqueVertices[vertex3p]);
-                indices.push_back(uniqueVertices[vertex4p]);
+                indices.push_back(index2p);
+                indices.push_back(index3p);
+                indices.push_back(index4p);
             }
 
             // Top and bottom faces
@@ -183,35 +147,20 @@ namespace Engine::Procedural {
                 vertex4.texCoord = {x1Step,
                                     z1Step};
 
-                if (!uniqueVertices.contains(vertex1)) {
-                    uniqueVertices[vertex1] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex1);
-                }
-
-                if (!uniqueVertices.contains(vertex2)) {
-                    uniqueVertices[vertex2] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex2);
-                }
-
-                if (!uniqueVertices.contains(vertex3)) {
-                    uniqueVertices[vertex3] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex3);
-                }
-
-                if (!uniqueVertices.contains(vertex4)) {
-                    uniqueVertices[vertex4] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex4);
-                }
+                const uint32_t index1 = welder.weld(vertex1);
+                const uint32_t index2 = welder.weld(vertex2);
+                const uint32_t index3 = welder.weld(vertex3);
+                const uint32_t index4 = welder.weld(vertex4);
 
                 // Triangle 1
-                indices.push_back(uniqueVertices[vertex1]);
-                indices.push_back(uniqueVertices[vertex2]);
-                indices.push_back(uniqueVertices[vertex3]);
+                indices.push_back(index1);
+                indices.push_back(index2);
+                indices.push_back(index3);
 
                 // Triangle 2
-                indices.push_back(uniqueVertices[vertex3]);
-                indices.push_back(uniqueVertices[vertex2]);
-                indices.push_back(uniqueVertices[vertex4]);
+                indices.push_back(index3);
+                indices.push_back(index2);
+                indices.push_back(index4);
 
                 // Bottom face
                 Model::Vertex vertex1p{};
@@ -242,35 +191,20 @@ namespace Engine::Procedural {
                 vertex4p.texCoord = {x1Step,
                                      z1Step};
 
-                if (!uniqueVertices.contains(vertex1p)) {
-                    uniqueVertices[vertex1p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex1p);
-                }
-
-                if (!uniqueVertices.contains(vertex2p)) {
-                    uniqueVertices[vertex2p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex2p);
-                }
-
-                if (!uniqueVertices.contains(vertex3p)) {
-                    uniqueVertices[vertex3p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex3p);
-                }
-
-                if (!uniqueVertices.contains(vertex4p)) {
-                    uniqueVertices[vertex4p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex4p);
-                }
+                const uint32_t index1p = welder.weld(vertex1p);
+                const uint32_t index2p = welder.weld(vertex2p);
+                const uint32_t index3p = welder.weld(vertex3p);
+                const uint32_t index4p = welder.weld(vertex4p);
 
                 // Triangle 1
-                indices.push_back(uniqueVertices[vertex3p]);
-                indices.push_back(uniqueVertices[vertex2p]);
-                indices.push_back(uniqueVertices[vertex1p]);
+                indices.push_back(index3p);
+                indices.push_back(index2p);
+                indices.push_back(index1p);
 
                 // Triangle 2
-                indices.push_back(uniqueVertices[vertex4p]);
-                indices.push_back(uniqueVertices[vertex2p]);
-                indices.push_back(uniqueVertices[vertex3p]);
+                indices.push_back(index4p);
+                indices.push_back(index2p);
+                indices.push_back(index3p);
             }
         }
 
@@ -312,35 +246,20 @@ namespace Engine::Procedural {
                 vertex4.texCoord = {y1Step,
                                     z1Step};
 
-                if (!uniqueVertices.contains(vertex1)) {
-                    uniqueVertices[vertex1] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex1);
-                }
-
-                if (!uniqueVertices.contains(vertex2)) {
-                    uniqueVertices[vertex2] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex2);
-                }
-
-                if (!uniqueVertices.contains(vertex3)) {
-                    uniqueVertices[vertex3] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex3);
-                }
-
-                if (!uniqueVertices.contains(vertex4)) {
-                    uniqueVertices[vertex4] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex4);
-                }
+                const uint32_t index1 = welder.weld(vertex1);
+                const uint32_t index2 = welder.weld(vertex2);
+                const uint32_t index3 = welder.weld(vertex3);
+                const uint32_t index4 = welder.weld(vertex4);
 
                 // Triangle 1
-                indices.push_back(uniqueVertices[vertex1]);
-                indices.push_back(uniqueVertices[vertex2]);
-                indices.push_back(uniqueVertices[vertex3]);
+                indices.push_back(index1);
+                indices.push_back(index2);
+                indices.push_back(index3);
 
                 // Triangle 2
-                indices.push_back(uniqueVertices[vertex3]);
-                indices.push_back(uniqueVertices[vertex2]);
-                indices.push_back(uniqueVertices[vertex4]);
+                indices.push_back(index3);
+                indices.push_back(index2);
+                indices.push_back(index4);
 
                 // Right face
                 Model::Vertex vertex1p{};
@@ -371,35 +290,20 @@ namespace Engine::Procedural {
                 vertex4p.texCoord = {y1Step,
                                      z1Step};
 
-                if (!uniqueVertices.contains(vertex1p)) {
-                    uniqueVertices[vertex1p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex1p);
-                }
-
-                if (!uniqueVertices.contains(vertex2p)) {
-                    uniqueVertices[vertex2p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex2p);
-                }
-
-                if (!uniqueVertices.contains(vertex3p)) {
-                    uniqueVertices[vertex3p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex3p);
-                }
-
-                if (!uniqueVertices.contains(vertex4p)) {
-                    uniqueVertices[vertex4p] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex4p);
-                }
+                const uint32_t index1p = welder.weld(vertex1p);
+                const uint32_t index2p = welder.weld(vertex2p);
+                const uint32_t index3p = welder.weld(vertex3p);
+                const uint32_t index4p = welder.weld(vertex4p);
 
                 // Triangle 1
-                indices.push_back(uniqueVertices[vertex3p]);
-                indices.push_back(uniqueVertices[vertex2p]);
-                indices.push_back(uniqueVertices[vertex1p]);
+                indices.push_back(index3p);
+                indices.push_back(index2p);
+                indices.push_back(index1p);
 
                 // Triangle 2
-                indices.push_back(uniqueVertices[vertex4p]);
-                indices.push_back(uniqueVertices[vertex2p]);
-                indices.push_back(uniqueVertices[vertex3p]);
+                indices.push_back(index4p);
+                indices.push_back(index2p);
+                indices.push_back(index3p);
             }
         }
 
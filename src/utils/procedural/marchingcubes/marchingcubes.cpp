@@ -1,21 +1,15 @@
 #include "marchingcubes.hpp"
 
-template<>
-struct std::hash<Engine::Model::Vertex> {
-    size_t operator()(Engine::Model::Vertex const &vertex) const noexcept {
-        size_t seed = 0;
-        hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.texCoord);
-        return seed;
-    }
-};
+#include "../../vertexwelder/vertexwelder.hpp"
 
 namespace Engine::Procedural {
     void MarchingCubes::generateModel() {
+        ZoneScoped;
         // Reserve space for the vertices and indices. This is done to avoid reallocations, which should give us better performance.
         uint32_t reserveSpace = resolution * resolution * resolution;
         vertices.reserve(reserveSpace);
         indices.reserve(reserveSpace);
-        std::unordered_map<Model::Vertex, uint32_t> uniqueVertices(reserveSpace);
+        VertexWelder welder(vertices, reserveSpace);
 
         // Precomputed values for the loops.
         precision_t step = 2.0f / static_cast<precision_t>(resolution);
@@ -81,24 +75,13 @@ namespace Engine::Procedural {
                         vertex3.normal = normal;
                         vertex3.texCoord = { 0.0f, 0.0f };
 
-                        if (!uniqueVertices.contains(vertex1)) {
-                            uniqueVertices[vertex1] = static_cast<uint32_t>(vertices.size());
-                            vertices.push_back(vertex1);
-                        }
-
-                        if (!uniqueVertices.contains(vertex2)) {
-                            uniqueVertices[vertex2] = static_cast<uint32_t>(vertices.size());
-                            vertices.push_back(vertex2);
-                        }
-
-                        if (!uniqueVertices.contains(vertex3)) {
-                            uniqueVertices[vertex3] = static_cast<uint32_t>(vertices.size());
-                            vertices.push_back(vertex3);
-                        }
+                        const uint32_t index1 = welder.weld(vertex1);
+                        const uint32_t index2 = welder.weld(vertex2);
+                        const uint32_t index3 = welder.weld(vertex3);
 
-                        indices.push_back(uniqueVertices[vertex1]);
-                        indices.push_back(uniqueVertices[vertex2]);
-                        indices.push_back(uniqueVertices[vertex3]);
+                        indices.push_back(index1);
+                        indices.push_back(index2);
+                        indices.push_back(index3);
                     } delete[] triangles;
                 }
             }
@@ -3,6 +3,8 @@
 
 #include <cstdint>
 
+#include <tracy/Tracy.hpp>
+
 #include "../device/device.hpp"
 #include "../model/model.hpp"
 
@@ -24,7 +26,15 @@ namespace Engine::Procedural {
 
         virtual void generateModel() = 0;
 
-        [[nodiscard]] std::unique_ptr<Model> getModel() { return std::make_unique<Model>(device, builder); }
+        // Everything getModel does but the upload, so it can run on any thread, once generateModel has
+        [[nodiscard]] Model::Builder buildModel() {
+            builder.generateLODs(); // These can get pretty dense at higher resolutions
+            builder.buildMeshlets();
+            builder.optimize();
+            return std::move(builder);
+        }
+
+        [[nodiscard]] std::unique_ptr<Model> getModel() { return std::make_unique<Model>(device, buildModel()); }
     protected:
         Device &device;
 
@@ -1,22 +1,16 @@
 #include "terrain.hpp"
 
-template<>
-struct std::hash<Engine::Model::Vertex> {
-    size_t operator()(Engine::Model::Vertex const &vertex) const noexcept {
-        size_t seed = 0;
-        hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.texCoord);
-        return seed;
-    }
-};
+#include "../../vertexwelder/vertexwelder.hpp"
 
 namespace Engine::Procedural {
     void Terrain::generateModel() {
+        ZoneScoped;
         // Reserve space for the vertices and indices. This is done to avoid reallocations, hence more performance.
         uint32_t reserveSpace = (resolution + 1) * (resolution + 1);
         assert(values.size() == reserveSpace && "Cannot generate terrain with an incomplete value list!");
         vertices.reserve(reserveSpace);
         indices.reserve(6 * reserveSpace);
-        std::unordered_map<Model::Vertex, uint32_t> uniqueVertices(reserveSpace);
+        VertexWelder welder(vertices, reserveSpace);
 
         // Precomputed values for the loops.
         float step = 1.0f / static_cast<float>(resolution);
@@ -57,35 +51,20 @@ namespace Engine::Procedural {
                 vertex4.texCoord = {x1Step,
                                     z1Step};
 
-                if (!uniqueVertices.contains(vertex1)) {
-                    uniqueVertices[vertex1] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex1);
-                }
-
-                if (!uniqueVertices.contains(vertex2)) {
-                    uniqueVertices[vertex2] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex2);
-                }
-
-                if (!uniqueVertices.contains(vertex3)) {
-                    uniqueVertices[vertex3] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex3);
-                }
-
-                if (!uniqueVertices.contains(vertex4)) {
-                    uniqueVertices[vertex4] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex4);
-                }
+                const uint32_t index1 = welder.weld(vertex1);
+                const uint32_t index2 = welder.weld(vertex2);
+                const uint32_t index3 = welder.weld(vertex3);
+                const uint32_t index4 = welder.weld(vertex4);
 
                 // Triangle 1
-                indices.push_back(uniqueVertices[vertex1]);
-                indices.push_back(uniqueVertices[vertex2]);
-                indices.push_back(uniqueVertices[vertex3]);
+                indices.push_back(index1);
+                indices.push_back(index2);
+                indices.push_back(index3);
 
                 // Triangle 2
-                indices.push_back(uniqueVertices[vertex3]);
-                indices.push_back(uniqueVertices[vertex2]);
-                indices.push_back(uniqueVertices[vertex4]);
+                indices.push_back(index3);
+                indices.push_back(index2);
+                indices.push_back(index4);
             }
         }
 
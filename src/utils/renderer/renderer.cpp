@@ -1,21 +1,66 @@
 #include "renderer.hpp"
+#include "../uploadservice/uploadservice.hpp"
+#include "../geometryarena/geometryarena.hpp"
+
+#include <chrono>
+#include <limits>
 
 // TODO(Dory): Add error codes TO ALL CODE to make debugging easier and faster
 // That is gonna take a looong time...
 namespace Engine {
     Renderer::Renderer(Window &window, Device &device) : window(window), device(device) {
         recreateSwapChain();
+        createFrameTimeline();
         createCommandBuffers();
+        createTracyContext();
+        dynamicResolution = std::make_unique<DynamicResolution>(device, SwapChain::MAX_FRAMES_IN_FLIGHT);
     }
     void Renderer::del() {
+        if (tracyContext != nullptr) { TracyVkDestroy(tracyContext); }
+        tracyContext = nullptr;
+        dynamicResolution.reset();
         freeCommandBuffers();
         swapChain->del();
+        vkDestroySemaphore(device.device(), frameTimeline, nullptr);
+        frameTimeline = VK_NULL_HANDLE;
+    }
+
+    void Renderer::waitForFrame() {
+        ZoneScoped;
+        assert(!isFrameStarted && "Cannot wait for a frame in the middle of one!");
+
+        // The next frame can start once the one framesInFlight before it is done. Frames go through every slot in order,
+        // so the last one to use the next slot is even older than that, and it's done too.
+        const uint64_t nextFrame = frameNumber + 1;
+        if (nextFrame <= framesInFlight) return;
+        const uint64_t target = nextFrame - framesInFlight;
+        if (target <= waitedFrame) return;
+
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &frameTimeline;
+        waitInfo.pValues = &target;
+        if (vkWaitSemaphores(device.device(), &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS)
+            throw std::runtime_error("Failed to wait for a frame to finish!");
+        frameWaitTime += std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - startTime).count();
+        waitedFrame = target;
     }
 
     VkCommandBuffer Renderer::beginFrame () {
+        ZoneScoped;
         assert(!isFrameStarted && "Cannot start a frame before ending the previous one!");
 
-        auto result = swapChain->acquireNextImage(&currentImageIndex);
+        waitForFrame(); // Does nothing if we've already waited this frame
+        device.getGeometryArena().beginFrame(frameNumber + 1); // Some of the freed geometry might be free to reuse now
+        currentFrameIndex = static_cast<uint32_t>((frameNumber + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        auto result = swapChain->acquireNextImage(currentFrameIndex, &currentImageIndex);
+        acquireTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - startTime).count();
         if (result == VK_ERROR_OUT_OF_DATE_KHR) {
             recreateSwapChain();
             return nullptr;
@@ -32,23 +77,41 @@ namespace Engine {
         if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
             throw std::runtime_error("Failed to begin recording the command buffer!");
 
+        dynamicResolution->beginFrame(commandBuffer, currentFrameIndex);
+        const VkExtent2D extent = swapChain->getSwapChainExtent();
+        renderExtent = swapChain->supportsScaling() ? dynamicResolution->scaleExtent(extent) : extent;
+        // Nothing to upscale or post-process, so we can skip the scene image, and the blit out of it, altogether
+        renderingDirect = antiAliasing != AntiAliasing::FXAA &&
+                          renderExtent.width == extent.width && renderExtent.height == extent.height;
+
         return commandBuffer;
     }
     void Renderer::endFrame () {
+        ZoneScoped;
         assert(isFrameStarted && "Cannot end a frame before we have started one!");
 
         auto commandBuffer = getCurrentCommandBuffer();
+        dynamicResolution->endFrame(commandBuffer, currentFrameIndex);
+        TracyVkCollect(tracyContext, commandBuffer); // Has to be outside of any render pass
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
             throw std::runtime_error("Failed to record the command buffer!");
 
-        auto result = swapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+        // Anything loaded while recording this frame has to be on the GPU before it gets drawn
+        device.getUploadService().flush();
+
+        frameNumber++;
+        auto result = swapChain->submitCommandBuffers(&commandBuffer,
+                                                      currentFrameIndex,
+                                                      &currentImageIndex,
+                                                      frameTimeline,
+                                                      frameNumber);
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window.wasWindowResized()) {
             window.resetWindowResizedFlag();
             recreateSwapChain();
         } else if (result != VK_SUCCESS) throw std::runtime_error("Failed to present the swap chain image!");
 
         isFrameStarted = false;
-        currentFrameIndex = (currentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
+        frameWaitTime = 0.0f; // The next frame's waits start now
     }
 
     void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
@@ -57,11 +120,13 @@ namespace Engine {
 
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = swapChain->getRenderPass();
-        renderPassInfo.framebuffer = swapChain->getFrameBuffer(static_cast<uint32_t>(currentImageIndex));
+        renderPassInfo.renderPass = renderingDirect ? swapChain->getDirectRenderPass() : swapChain->getRenderPass();
+        renderPassInfo.framebuffer = renderingDirect ? swapChain->getDirectFrameBuffer(currentImageIndex) :
+                                                       swapChain->getFrameBuffer(currentImageIndex);
 
+        // We only render to the top-left corner of the scene image, and then stretch that into the swap chain image
         renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = swapChain->getSwapChainExtent();
+        renderPassInfo.renderArea.extent = renderExtent;
 
         std::array<VkClearValue, 2> clearValues{};
         clearValues[0].color = {{0.01f, 0.01f, 0.01f, 1.0f}};
@@ -69,6 +134,98 @@ namespace Engine {
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        setSceneViewport(commandBuffer);
+    }
+    void Renderer::suspendSwapChainRenderPass(VkCommandBuffer commandBuffer) const {
+        assert(isFrameStarted && "Cannot suspend the render pass outside of a frame!");
+        assert(occlusionCulling && "Cannot suspend the render pass without occlusion culling!");
+        assert(commandBuffer == getCurrentCommandBuffer() && "Cannot suspend the render pass on a command buffer from another frame!");
+        vkCmdEndRenderPass(commandBuffer);
+    }
+    void Renderer::resumeSwapChainRenderPass(VkCommandBuffer commandBuffer) const {
+        assert(isFrameStarted && "Cannot resume the render pass outside of a frame!");
+        assert(occlusionCulling && "Cannot resume the render pass without occlusion culling!");
+        assert(commandBuffer == getCurrentCommandBuffer() && "Cannot resume the render pass on a command buffer from another frame!");
+
+        // Everything gets loaded, so there's nothing to clear
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = renderingDirect ? swapChain->getDirectResumeRenderPass() :
+                                                      swapChain->getResumeRenderPass();
+        renderPassInfo.framebuffer = renderingDirect ? swapChain->getDirectFrameBuffer(currentImageIndex) :
+                                                       swapChain->getFrameBuffer(currentImageIndex);
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = renderExtent;
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        setSceneViewport(commandBuffer);
+    }
+    void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) const {
+        assert(isFrameStarted && "Cannot end the render pass outside of a frame!");
+        assert(commandBuffer == getCurrentCommandBuffer() && "Cannot end the render pass on a command buffer from another frame!");
+        vkCmdEndRenderPass(commandBuffer);
+
+        // The post-processing pass takes care of upscaling the scene by itself, and there's nothing to upscale when
+        // rendering directly
+        if (antiAliasing == AntiAliasing::FXAA || renderingDirect) return;
+
+        // The render pass leaves the scene image ready to be read, but we have to get the swap chain image ready ourselves
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED; // We overwrite all of it anyway
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = swapChain->getImage(currentImageIndex);
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+
+        // Upscale whatever we rendered into the whole swap chain image
+        const VkExtent2D extent = swapChain->getSwapChainExtent();
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = {0, 0, 0};
+        blit.srcOffsets[1] = {static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = 0;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.dstOffsets[0] = {0, 0, 0};
+        blit.dstOffsets[1] = {static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1};
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = 0;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+        vkCmdBlitImage(commandBuffer,
+                       swapChain->getSceneImage(currentImageIndex), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       swapChain->getImage(currentImageIndex), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       1, &blit,
+                       VK_FILTER_LINEAR);
+    }
+
+    void Renderer::beginUIRenderPass(VkCommandBuffer commandBuffer) const {
+        assert(isFrameStarted && "Cannot begin the UI render pass outside of a frame!");
+        assert(commandBuffer == getCurrentCommandBuffer() && "Cannot start the UI render pass on a command buffer from another frame!");
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = swapChain->getUIRenderPass();
+        renderPassInfo.framebuffer = swapChain->getUIFrameBuffer(currentImageIndex);
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = swapChain->getSwapChainExtent();
+
         vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
         VkViewport viewport{};
@@ -82,12 +239,79 @@ namespace Engine {
         vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
     }
-    void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) const {
-        assert(isFrameStarted && "Cannot end the render pass outside of a frame!");
-        assert(commandBuffer == getCurrentCommandBuffer() && "Cannot end the render pass on a command buffer from another frame!");
+    void Renderer::endUIRenderPass(VkCommandBuffer commandBuffer) const {
+        assert(isFrameStarted && "Cannot end the UI render pass outside of a frame!");
+        assert(commandBuffer == getCurrentCommandBuffer() && "Cannot end the UI render pass on a command buffer from another frame!");
         vkCmdEndRenderPass(commandBuffer);
     }
 
+    void Renderer::setAntiAliasing(AntiAliasing mode) {
+        assert(!isFrameStarted && "Cannot change the anti-aliasing mode in the middle of a frame!");
+        if (mode == antiAliasing) return;
+
+        antiAliasing = mode;
+        device.setDesiredSampleCount(getAntiAliasingSampleCount(mode));
+        recreateSwapChain();
+    }
+
+    void Renderer::setOcclusionCulling(bool enabled) {
+        assert(!isFrameStarted && "Cannot toggle occlusion culling in the middle of a frame!");
+        if (enabled == occlusionCulling) return;
+
+        occlusionCulling = enabled;
+        recreateSwapChain();
+    }
+
+    void Renderer::setFramesInFlight(const uint32_t count) {
+        assert(count >= SwapChain::MIN_FRAMES_IN_FLIGHT && count <= SwapChain::MAX_FRAMES_IN_FLIGHT &&
+               "Invalid number of frames in flight!");
+        framesInFlight = count; // Takes effect on the next wait, nothing else depends on it
+    }
+
+    void Renderer::setSceneViewport(VkCommandBuffer commandBuffer) const {
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(renderExtent.width);
+        viewport.height = static_cast<float>(renderExtent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        VkRect2D scissor{{0, 0}, renderExtent};
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    }
+
+    void Renderer::createFrameTimeline() {
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &frameTimeline) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the frame timeline semaphore!");
+    }
+
+    void Renderer::createTracyContext() {
+#ifdef TRACY_ENABLE
+        // Tracy records and submits a few commands of its own to calibrate, so it needs a command buffer to itself
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = device.getCommandPool();
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate the Tracy command buffer!");
+        tracyContext = TracyVkContext(device.physicalDevice(), device.device(), device.graphicsQueue(), commandBuffer);
+        vkFreeCommandBuffers(device.device(), device.getCommandPool(), 1, &commandBuffer);
+#endif
+    }
+
     void Renderer::createCommandBuffers() {
             commandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
 
@@ -107,10 +331,10 @@ namespace Engine {
             glfwWaitEvents();
         } vkDeviceWaitIdle(device.device());
 
-        if (swapChain == nullptr) swapChain = std::make_unique<SwapChain>(device, extent);
+        if (swapChain == nullptr) swapChain = std::make_unique<SwapChain>(device, extent, antiAliasing, occlusionCulling);
         else {
             std::shared_ptr<SwapChain> oldSwapChain = std::move(swapChain);
-            swapChain = std::make_unique<SwapChain>(device, extent, oldSwapChain);
+            swapChain = std::make_unique<SwapChain>(device, extent, antiAliasing, occlusionCulling, oldSwapChain);
             if(!oldSwapChain->compareSwapFormats(*swapChain))
                 throw std::runtime_error("Swap chain image/depth format or presentation mode has changed!");
         }
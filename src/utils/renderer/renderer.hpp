@@ -6,9 +6,14 @@
 #include <array>
 #include <cassert>
 
+#include <vulkan/vulkan.h>
+#include <tracy/Tracy.hpp>
+#include <tracy/TracyVulkan.hpp>
+
 #include "../window/window.hpp"
 #include "../device/device.hpp"
 #include "../swapchain/swapchain.hpp"
+#include "../dynamicresolution/dynamicresolution.hpp"
 
 namespace Engine {
     class Renderer {
@@ -22,6 +27,22 @@ namespace Engine {
         void del();
 
         [[nodiscard]] VkRenderPass getSwapChainRenderPass() const { return swapChain->getRenderPass(); }
+        [[nodiscard]] VkRenderPass getUIRenderPass() const { return swapChain->getUIRenderPass(); }
+        [[nodiscard]] DynamicResolution &getDynamicResolution() const { return *dynamicResolution; }
+        [[nodiscard]] TracyVkCtx getTracyContext() const { return tracyContext; } // Null when Tracy isn't enabled
+
+        // Recreates the swap chain, so every render system has to be rebuilt with the new render pass afterwards
+        void setAntiAliasing(AntiAliasing mode);
+        [[nodiscard]] AntiAliasing getAntiAliasing() const { return antiAliasing; }
+        // Same as above, the depth has to be stored and the scene render pass gets split in two
+        void setOcclusionCulling(bool enabled);
+        [[nodiscard]] bool isOcclusionCullingEnabled() const { return occlusionCulling; }
+        [[nodiscard]] VkDeviceSize getAttachmentMemory() const { return swapChain->getAttachmentMemory(); }
+        [[nodiscard]] VkDeviceSize estimateAttachmentMemory(AntiAliasing mode) const {
+            return SwapChain::estimateAttachmentMemory(swapChain->getSwapChainExtent(),
+                                                       std::min(getAntiAliasingSampleCount(mode), device.getMaxUsableSampleCount()),
+                                                       swapChain->imageCount());
+        }
         [[nodiscard]] bool isFrameInProgress() const { return isFrameStarted; }
 
         [[nodiscard]] VkCommandBuffer getCurrentCommandBuffer() const {
@@ -34,27 +55,72 @@ namespace Engine {
             return currentFrameIndex;
         }
 
+        // Blocks until the GPU is far enough behind for us to start another frame. beginFrame does this on its own, but
+        // with low latency on, calling it before sampling input means the input is as fresh as it can be.
+        void waitForFrame();
         [[nodiscard]] VkCommandBuffer beginFrame();
         void endFrame();
 
+        // Between 1 (no overlap between CPU and GPU at all, lowest latency) and SwapChain::MAX_FRAMES_IN_FLIGHT
+        void setFramesInFlight(uint32_t count);
+        [[nodiscard]] uint32_t getFramesInFlight() const { return framesInFlight; }
+        bool lowLatency = false; // Wait for the GPU before sampling input, instead of right before recording
+        // How long we spent blocked on the GPU (and the swap chain) last frame, in milliseconds
+        [[nodiscard]] float getFrameWaitTime() const { return frameWaitTime; }
+        [[nodiscard]] float getAcquireTime() const { return acquireTime; }
+
         void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
         [[nodiscard]] float getAspectRatio() const { return swapChain->extentAspectRatio(); }
+        [[nodiscard]] VkExtent2D getRenderExtent() const { return renderExtent; }
+        [[nodiscard]] bool supportsScaling() const { return swapChain->supportsScaling(); }
+        [[nodiscard]] VkExtent2D getSwapChainExtent() const { return swapChain->getSwapChainExtent(); }
+        [[nodiscard]] VkImageView getSceneImageView() const {
+            assert(isFrameStarted && "Cannot get the scene image outside of a frame!");
+            return swapChain->getSceneImageView(currentImageIndex);
+        }
+        [[nodiscard]] VkImageView getDepthImageView() const { return swapChain->getDepthImageView(); }
 
+        // With occlusion culling, the scene pass gets interrupted so the depth pyramid can be built from its depth
+        void suspendSwapChainRenderPass(VkCommandBuffer commandBuffer) const;
+        void resumeSwapChainRenderPass(VkCommandBuffer commandBuffer) const;
         void endSwapChainRenderPass(VkCommandBuffer commandBuffer) const;
+
+        // The UI pass draws on top of the upscaled scene, straight into the swap chain image, at native resolution
+        void beginUIRenderPass(VkCommandBuffer commandBuffer) const;
+        void endUIRenderPass(VkCommandBuffer commandBuffer) const;
     private:
         Window &window;
         Device &device;
         std::unique_ptr<SwapChain> swapChain;
         std::vector<VkCommandBuffer> commandBuffers;
+        std::unique_ptr<DynamicResolution> dynamicResolution;
+        VkExtent2D renderExtent{}; // The area of the scene image we render to this frame
+        bool renderingDirect = false; // Straight into the swap chain image instead, when it's the whole thing anyway
+        AntiAliasing antiAliasing = AntiAliasing::MSAA8x;
+        bool occlusionCulling = false;
+
+        // Every frame signals its number on here once the GPU is done with it, so waiting on a frame is just waiting
+        // for a value, and we never have to reset anything
+        VkSemaphore frameTimeline = VK_NULL_HANDLE;
+        uint64_t frameNumber = 0; // The last one we submitted, frames start at 1
+        uint64_t waitedFrame = 0; // Everything up to this one is known to be done
+        uint32_t framesInFlight = 3;
+        float frameWaitTime = 0.0f;
+        float acquireTime = 0.0f;
 
         uint32_t currentImageIndex = 0;
         uint32_t currentFrameIndex = 0;
         bool isFrameStarted = false;
 
+        TracyVkCtx tracyContext = nullptr;
+
+        void createFrameTimeline();
+        void createTracyContext();
         void createCommandBuffers();
         void freeCommandBuffers();
         void recreateSwapChain();
+        void setSceneViewport(VkCommandBuffer commandBuffer) const;
     };
 }
 
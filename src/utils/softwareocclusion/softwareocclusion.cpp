@@ -0,0 +1,229 @@
+#include "softwareocclusion.hpp"
+
+#include <cmath>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace Engine {
+    namespace {
+        constexpr uint32_t SETUP_CHUNK_SIZE = 256; // Triangles per task
+        constexpr float MIN_W = 1e-4f; // Anything closer than this gets thrown away, instead of clipped
+        constexpr float SUBPIXELS = 8.0f; // Small enough for everything on screen to fit in a float's mantissa
+    }
+
+    SoftwareOcclusionCuller::SoftwareOcclusionCuller(WorkerPool &workerPool) : workerPool(workerPool),
+                                                                              bins(TILES_Y),
+                                                                              depth(WIDTH * HEIGHT, 1.0f),
+                                                                              tileDepth(TILES_X * TILES_Y, 1.0f) {}
+
+    void SoftwareOcclusionCuller::beginFrame(const glm::mat4 &viewProjection) {
+        this->viewProjection = viewProjection;
+        clipVertices.clear();
+        clipIndices.clear();
+        triangles.clear();
+        rasterized = false;
+        testedObjects = 0;
+        occludedObjects = 0;
+    }
+
+    void SoftwareOcclusionCuller::addOccluder(const std::span<const glm::vec3> vertices,
+                                              const std::span<const uint32_t> indices,
+                                              const glm::mat4 &modelMatrix) {
+        const auto firstVertex = static_cast<uint32_t>(clipVertices.size());
+        const glm::mat4 transform = viewProjection * modelMatrix;
+        for (const glm::vec3 &vertex : vertices) clipVertices.push_back(transform * glm::vec4(vertex, 1.0f));
+        for (const uint32_t index : indices) clipIndices.push_back(firstVertex + index);
+    }
+
+    void SoftwareOcclusionCuller::rasterize() {
+        const auto startTime = std::chrono::high_resolution_clock::now();
+
+        triangles.resize(clipIndices.size() / 3);
+        workerPool.parallelFor(static_cast<uint32_t>(triangles.size()), SETUP_CHUNK_SIZE, [this](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                if (setupTriangle(clipVertices[clipIndices[3 * i]],
+                                  clipVertices[clipIndices[3 * i + 1]],
+                                  clipVertices[clipIndices[3 * i + 2]],
+                                  triangles[i])) continue;
+                triangles[i].minX = 0; // Nothing to draw
+                triangles[i].maxX = -1;
+            }
+        });
+
+        // Bin them by tile row, so each row only has to go through the triangles that actually touch it
+        for (std::vector<uint32_t> &bin : bins) bin.clear();
+        for (uint32_t i = 0; i < triangles.size(); i++) {
+            const Triangle &triangle = triangles[i];
+            if (triangle.minX > triangle.maxX) continue;
+            for (auto tileRow = static_cast<uint32_t>(triangle.minY) / TILE_HEIGHT;
+                 tileRow <= static_cast<uint32_t>(triangle.maxY) / TILE_HEIGHT;
+                 tileRow++) bins[tileRow].push_back(i);
+        }
+
+        // Each tile row only ever gets written by one thread, so there's no need for any locking
+        std::ranges::fill(depth, 1.0f);
+        workerPool.parallelFor(TILES_Y, 1, [this](uint32_t begin, uint32_t end) {
+            for (uint32_t tileRow = begin; tileRow < end; tileRow++) rasterizeBand(tileRow);
+        });
+        rasterized = true;
+
+        rasterizationTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - startTime).count();
+    }
+
+    bool SoftwareOcclusionCuller::isOccluded(const glm::vec3 center, const float radius) {
+        if (!enabled || !rasterized || triangles.empty()) return false;
+        testedObjects++;
+
+        // Project the corners of the box around the sphere, and find its nearest depth and the pixels it covers
+        glm::vec2 minBounds{std::numeric_limits<float>::max()};
+        glm::vec2 maxBounds{std::numeric_limits<float>::lowest()};
+        float nearestDepth = 1.0f;
+        for (uint32_t i = 0; i < 8; i++) {
+            const glm::vec3 corner = center + radius * glm::vec3{(i & 1) ? 1.0f : -1.0f,
+                                                                 (i & 2) ? 1.0f : -1.0f,
+                                                                 (i & 4) ? 1.0f : -1.0f};
+            const glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+            if (clip.w < MIN_W) return false; // Goes through the near plane, so we're probably inside of it
+
+            const glm::vec2 screen = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * glm::vec2(WIDTH, HEIGHT);
+            minBounds = glm::min(minBounds, screen);
+            maxBounds = glm::max(maxBounds, screen);
+            nearestDepth = std::min(nearestDepth, clip.z / clip.w);
+        }
+
+        // Off screen things are up to the frustum culling
+        if (maxBounds.x < 0.0f || maxBounds.y < 0.0f ||
+            minBounds.x >= static_cast<float>(WIDTH) || minBounds.y >= static_cast<float>(HEIGHT)) return false;
+
+        minBounds = glm::max(minBounds, glm::vec2{0.0f});
+        maxBounds = glm::min(maxBounds, glm::vec2{WIDTH - 1, HEIGHT - 1});
+        const uint32_t tileX0 = static_cast<uint32_t>(minBounds.x) / TILE_WIDTH;
+        const uint32_t tileY0 = static_cast<uint32_t>(minBounds.y) / TILE_HEIGHT;
+        const uint32_t tileX1 = static_cast<uint32_t>(maxBounds.x) / TILE_WIDTH;
+        const uint32_t tileY1 = static_cast<uint32_t>(maxBounds.y) / TILE_HEIGHT;
+        for (uint32_t tileY = tileY0; tileY <= tileY1; tileY++) {
+            for (uint32_t tileX = tileX0; tileX <= tileX1; tileX++)
+                if (tileDepth[tileY * TILES_X + tileX] > nearestDepth) return false; // Something behind us shows through
+        }
+
+        occludedObjects++;
+        return true;
+    }
+
+    bool SoftwareOcclusionCuller::setupTriangle(glm::vec4 v0, glm::vec4 v1, glm::vec4 v2, Triangle &triangle) const {
+        // Clipping the triangle would give us more occlusion, but dropping it is always safe
+        if (v0.w < MIN_W || v1.w < MIN_W || v2.w < MIN_W) return false;
+
+        const glm::vec3 p0 = glm::vec3(v0) / v0.w;
+        glm::vec3 p1 = glm::vec3(v1) / v1.w;
+        glm::vec3 p2 = glm::vec3(v2) / v2.w;
+        if (p0.z < 0.0f || p1.z < 0.0f || p2.z < 0.0f) return false; // Same for the near plane
+        if (p0.z > 1.0f && p1.z > 1.0f && p2.z > 1.0f) return false; // Past the far plane
+
+        // Snapping to a subpixel grid keeps the edge functions exact, so neighbouring triangles don't leave cracks
+        const glm::vec2 size{WIDTH, HEIGHT};
+        const glm::vec2 s0 = glm::round((glm::vec2(p0) * 0.5f + 0.5f) * size * SUBPIXELS) / SUBPIXELS;
+        glm::vec2 s1 = glm::round((glm::vec2(p1) * 0.5f + 0.5f) * size * SUBPIXELS) / SUBPIXELS;
+        glm::vec2 s2 = glm::round((glm::vec2(p2) * 0.5f + 0.5f) * size * SUBPIXELS) / SUBPIXELS;
+
+        // Occluders get drawn from both sides, so we just flip them around to always have the same winding
+        float area = (s1.x - s0.x) * (s2.y - s0.y) - (s2.x - s0.x) * (s1.y - s0.y);
+        if (std::abs(area) < 1e-6f) return false;
+        if (area < 0.0f) {
+            std::swap(p1, p2);
+            std::swap(s1, s2);
+            area = -area;
+        }
+
+        const glm::vec2 minBounds = glm::min(s0, glm::min(s1, s2));
+        const glm::vec2 maxBounds = glm::max(s0, glm::max(s1, s2));
+        triangle.minX = std::max(static_cast<int32_t>(std::ceil(minBounds.x - 0.5f)), 0);
+        triangle.minY = std::max(static_cast<int32_t>(std::ceil(minBounds.y - 0.5f)), 0);
+        triangle.maxX = std::min(static_cast<int32_t>(std::floor(maxBounds.x - 0.5f)), static_cast<int32_t>(WIDTH) - 1);
+        triangle.maxY = std::min(static_cast<int32_t>(std::floor(maxBounds.y - 0.5f)), static_cast<int32_t>(HEIGHT) - 1);
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return false;
+
+        // Edge i is the one across from vertex i, so its function is the barycentric weight of that vertex times the area
+        const glm::vec2 s[3] = {s0, s1, s2};
+        for (uint32_t i = 0; i < 3; i++) {
+            const glm::vec2 a = s[(i + 1) % 3];
+            const glm::vec2 b = s[(i + 2) % 3];
+            triangle.edgeA[i] = a.y - b.y;
+            triangle.edgeB[i] = b.x - a.x;
+            triangle.edgeC[i] = a.x * b.y - a.y * b.x;
+        }
+
+        // Depth is linear in screen space after the perspective divide, so it's just a plane
+        const float z[3] = {std::min(p0.z, 1.0f), std::min(p1.z, 1.0f), std::min(p2.z, 1.0f)};
+        triangle.depthA = 0.0f;
+        triangle.depthB = 0.0f;
+        triangle.depthC = 0.0f;
+        for (uint32_t i = 0; i < 3; i++) {
+            triangle.depthA += triangle.edgeA[i] * z[i] / area;
+            triangle.depthB += triangle.edgeB[i] * z[i] / area;
+            triangle.depthC += triangle.edgeC[i] * z[i] / area;
+        } return true;
+    }
+
+    void SoftwareOcclusionCuller::rasterizeBand(const uint32_t tileRow) {
+        const auto bandMinY = static_cast<int32_t>(tileRow * TILE_HEIGHT);
+        const auto bandMaxY = static_cast<int32_t>((tileRow + 1) * TILE_HEIGHT) - 1;
+        for (const uint32_t i : bins[tileRow]) {
+            const Triangle &triangle = triangles[i];
+            for (int32_t y = std::max(triangle.minY, bandMinY); y <= std::min(triangle.maxY, bandMaxY); y++)
+                rasterizeRow(triangle, depth.data() + static_cast<size_t>(y) * WIDTH, y);
+        }
+
+        // Keep the farthest depth of each tile, so the tests only have to look at one value per tile
+        for (uint32_t tileX = 0; tileX < TILES_X; tileX++) {
+            float farthest = 0.0f;
+            for (uint32_t y = tileRow * TILE_HEIGHT; y < (tileRow + 1) * TILE_HEIGHT; y++) {
+                const float *row = depth.data() + static_cast<size_t>(y) * WIDTH + tileX * TILE_WIDTH;
+                for (uint32_t x = 0; x < TILE_WIDTH; x++) farthest = std::max(farthest, row[x]);
+            } tileDepth[tileRow * TILES_X + tileX] = farthest;
+        }
+    }
+
+    void SoftwareOcclusionCuller::rasterizeRow(const Triangle &triangle, float *row, const int32_t y) {
+        const float centerY = static_cast<float>(y) + 0.5f;
+        const float rowEdge0 = triangle.edgeB[0] * centerY + triangle.edgeC[0];
+        const float rowEdge1 = triangle.edgeB[1] * centerY + triangle.edgeC[1];
+        const float rowEdge2 = triangle.edgeB[2] * centerY + triangle.edgeC[2];
+        const float rowDepth = triangle.depthB * centerY + triangle.depthC;
+
+        // Rows are a multiple of 8 pixels long, so starting on a multiple of 8 means we never go past the end
+        const int32_t startX = triangle.minX & ~static_cast<int32_t>(TILE_WIDTH - 1);
+#ifdef __AVX2__
+        const __m256 offsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        const __m256 zero = _mm256_setzero_ps();
+        for (int32_t x = startX; x <= triangle.maxX; x += static_cast<int32_t>(TILE_WIDTH)) {
+            const __m256 centerX = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), offsets);
+            const __m256 edge0 = _mm256_fmadd_ps(_mm256_set1_ps(triangle.edgeA[0]), centerX, _mm256_set1_ps(rowEdge0));
+            const __m256 edge1 = _mm256_fmadd_ps(_mm256_set1_ps(triangle.edgeA[1]), centerX, _mm256_set1_ps(rowEdge1));
+            const __m256 edge2 = _mm256_fmadd_ps(_mm256_set1_ps(triangle.edgeA[2]), centerX, _mm256_set1_ps(rowEdge2));
+            const __m256 inside = _mm256_and_ps(_mm256_cmp_ps(edge0, zero, _CMP_GE_OQ),
+                                                _mm256_and_ps(_mm256_cmp_ps(edge1, zero, _CMP_GE_OQ),
+                                                              _mm256_cmp_ps(edge2, zero, _CMP_GE_OQ)));
+            if (_mm256_testz_ps(inside, inside)) continue;
+
+            const __m256 triangleDepth = _mm256_fmadd_ps(_mm256_set1_ps(triangle.depthA), centerX, _mm256_set1_ps(rowDepth));
+            const __m256 current = _mm256_loadu_ps(row + x);
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_min_ps(current, triangleDepth), inside));
+        }
+#else
+        for (int32_t x = startX; x <= triangle.maxX; x++) {
+            const float centerX = static_cast<float>(x) + 0.5f;
+            if (triangle.edgeA[0] * centerX + rowEdge0 < 0.0f ||
+                triangle.edgeA[1] * centerX + rowEdge1 < 0.0f ||
+                triangle.edgeA[2] * centerX + rowEdge2 < 0.0f) continue;
+            row[x] = std::min(row[x], triangle.depthA * centerX + rowDepth);
+        }
+#endif
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef SOFTWAREOCCLUSION_HPP
+#define SOFTWAREOCCLUSION_HPP
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "../workerpool/workerpool.hpp"
+
+namespace Engine {
+    // Occlusion culling on the CPU, for when the GPU has better things to do with its time.
+    // A few big occluders get rasterised into a small depth buffer, on the worker pool, and everything else gets its
+    // bounds tested against the farthest depth of each tile they cover, before we record any draws for them.
+    // Unlike the GPU version, the results are for this frame, but it only knows about whatever we marked as an occluder.
+    // Doesn't touch Vulkan at all, so it can be used (and measured) without a GPU.
+    class SoftwareOcclusionCuller {
+    public:
+        static constexpr uint32_t WIDTH = 320;
+        static constexpr uint32_t HEIGHT = 192;
+        static constexpr uint32_t TILE_WIDTH = 8; // One AVX2 register worth of pixels
+        static constexpr uint32_t TILE_HEIGHT = 8;
+        static constexpr uint32_t TILES_X = WIDTH / TILE_WIDTH;
+        static constexpr uint32_t TILES_Y = HEIGHT / TILE_HEIGHT;
+
+        bool enabled = false;
+
+        explicit SoftwareOcclusionCuller(WorkerPool &workerPool);
+
+        SoftwareOcclusionCuller(const SoftwareOcclusionCuller &) = delete;
+        SoftwareOcclusionCuller& operator=(const SoftwareOcclusionCuller &) = delete;
+
+        // Throws away last frame's occluders
+        void beginFrame(const glm::mat4 &viewProjection);
+        // The geometry gets transformed right away, so it doesn't have to stay around
+        void addOccluder(std::span<const glm::vec3> vertices,
+                         std::span<const uint32_t> indices,
+                         const glm::mat4 &modelMatrix);
+        // Has to happen after every occluder has been added, and before testing anything
+        void rasterize();
+
+        // Conservative, anything we're not sure about is visible
+        [[nodiscard]] bool isOccluded(glm::vec3 center, float radius);
+
+        [[nodiscard]] const std::vector<float> &getDepth() const { return depth; }
+        [[nodiscard]] uint32_t getOccluderTriangles() const { return static_cast<uint32_t>(triangles.size()); }
+        [[nodiscard]] uint32_t getTestedObjects() const { return testedObjects; }
+        [[nodiscard]] uint32_t getOccludedObjects() const { return occludedObjects; }
+        [[nodiscard]] float getRasterizationTime() const { return rasterizationTime; } // In milliseconds
+    private:
+        // Everything in pixels, each edge function is positive on the inside
+        struct Triangle {
+            float edgeA[3];
+            float edgeB[3];
+            float edgeC[3];
+            float depthA; // depth = depthA * x + depthB * y + depthC
+            float depthB;
+            float depthC;
+            int32_t minX; // Pixels whose centers might be covered, inclusive
+            int32_t minY;
+            int32_t maxX;
+            int32_t maxY;
+        };
+
+        WorkerPool &workerPool;
+
+        glm::mat4 viewProjection{1.0f};
+        std::vector<glm::vec4> clipVertices; // Every occluder, one after the other
+        std::vector<uint32_t> clipIndices;
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> bins; // Triangles touching each tile row
+
+        std::vector<float> depth; // Nearest depth of each pixel, row by row
+        std::vector<float> tileDepth; // Farthest depth of each tile
+        bool rasterized = false;
+
+        uint32_t testedObjects = 0;
+        uint32_t occludedObjects = 0;
+        float rasterizationTime = 0.0f;
+
+        [[nodiscard]] bool setupTriangle(glm::vec4 v0, glm::vec4 v1, glm::vec4 v2, Triangle &triangle) const;
+        void rasterizeBand(uint32_t tileRow);
+        static void rasterizeRow(const Triangle &triangle, float *row, int32_t y);
+    };
+}
+
+#endif
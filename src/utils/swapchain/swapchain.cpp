@@ -3,11 +3,20 @@
 #include <utility>
 
 namespace Engine {
-    SwapChain::SwapChain(Device &deviceRef, VkExtent2D extent) : device{deviceRef}, windowExtent{extent} {
+    SwapChain::SwapChain(Device &deviceRef, VkExtent2D extent, AntiAliasing antiAliasing, bool occlusionCulling) :
+    device{deviceRef}, windowExtent{extent}, antiAliasing{antiAliasing}, occlusionCulling{occlusionCulling} {
         init();
     }
-    SwapChain::SwapChain(Device &deviceRef, VkExtent2D extent, std::shared_ptr<SwapChain> previous) :
-    device{deviceRef}, windowExtent{extent}, oldSwapChain{std::move(previous)} {
+    SwapChain::SwapChain(Device &deviceRef,
+                         VkExtent2D extent,
+                         AntiAliasing antiAliasing,
+                         bool occlusionCulling,
+                         std::shared_ptr<SwapChain> previous) :
+    device{deviceRef},
+    windowExtent{extent},
+    antiAliasing{antiAliasing},
+    occlusionCulling{occlusionCulling},
+    oldSwapChain{std::move(previous)} {
         init();
 
         oldSwapChain = nullptr; // Clean up, since we no longer need it, and we can free its memory.
@@ -15,11 +24,11 @@ namespace Engine {
     void SwapChain::del() {
         for (auto imageView : swapChainImageViews)
             vkDestroyImageView(device.device(), imageView, nullptr);
+        for (auto &image : offscreenImages) image->del();
 
-        for (size_t i = 0; i < imageCount(); i++) {
-            colorImages[i]->del();
-            depthImages[i]->del();
-        }
+        if (colorImage != nullptr) colorImage->del();
+        if (depthImage != nullptr) depthImage->del();
+        for (auto &image : sceneImages) image->del();
 
         if (swapChain != nullptr) {
             vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
@@ -28,70 +37,102 @@ namespace Engine {
 
         for (auto framebuffer : swapChainFramebuffers)
             vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+        for (auto framebuffer : directFramebuffers)
+            vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+        for (auto framebuffer : uiFramebuffers)
+            vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+        swapChainFramebuffers.clear();
+        directFramebuffers.clear();
+        uiFramebuffers.clear();
 
         vkDestroyRenderPass(device.device(), renderPass, nullptr);
+        vkDestroyRenderPass(device.device(), resumeRenderPass, nullptr);
+        vkDestroyRenderPass(device.device(), directRenderPass, nullptr);
+        vkDestroyRenderPass(device.device(), directResumeRenderPass, nullptr);
+        vkDestroyRenderPass(device.device(), uiRenderPass, nullptr);
+        renderPass = VK_NULL_HANDLE;
+        resumeRenderPass = VK_NULL_HANDLE;
+        directRenderPass = VK_NULL_HANDLE;
+        directResumeRenderPass = VK_NULL_HANDLE;
+        uiRenderPass = VK_NULL_HANDLE;
 
         // Cleanup synchronization objects
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
-            vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(device.device(), inFlightFences[i], nullptr);
-        }
+        for (VkSemaphore semaphore : imageAvailableSemaphores) vkDestroySemaphore(device.device(), semaphore, nullptr);
+        for (VkSemaphore semaphore : renderFinishedSemaphores) vkDestroySemaphore(device.device(), semaphore, nullptr);
+        imageAvailableSemaphores.clear();
+        renderFinishedSemaphores.clear();
     }
 
     void SwapChain::init() {
         createSwapChain();
         createImageViews();
         createRenderPass();
+        createUIRenderPass();
         createColorResources();
         createDepthResources();
+        createSceneResources();
         createFramebuffers();
         createSyncObjects();
     }
-    VkResult SwapChain::acquireNextImage(uint32_t *imageIndex) {
-        vkWaitForFences(device.device(),
-                        1,
-                        &inFlightFences[currentFrame],
-                        VK_TRUE,
-                        std::numeric_limits<uint64_t>::max());
+    VkResult SwapChain::acquireNextImage(const uint32_t frameIndex, uint32_t *imageIndex) {
+        // Frames always go through every slot in order, so each one just gets its own image
+        if (device.isHeadless()) {
+            *imageIndex = frameIndex % static_cast<uint32_t>(imageCount());
+            return VK_SUCCESS;
+        }
 
         return vkAcquireNextImageKHR(device.device(),
                                      swapChain,
                                      UINT64_MAX,
-                                     imageAvailableSemaphores[currentFrame], // must be a not signaled semaphore
+                                     imageAvailableSemaphores[frameIndex], // must be a not signaled semaphore
                                      VK_NULL_HANDLE,
                                      imageIndex);
     }
-    VkResult SwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, const uint32_t *imageIndex) {
-        if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE)
-            vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-        imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+    VkResult SwapChain::submitCommandBuffers(const VkCommandBuffer *buffers,
+                                             const uint32_t frameIndex,
+                                             const uint32_t *imageIndex,
+                                             VkSemaphore frameTimeline,
+                                             const uint64_t frameNumber) {
+        // When headless there's no image to wait for and nothing to present, so the timeline is all we need
+        const bool headless = device.isHeadless();
+        const uint32_t binarySemaphoreCount = headless ? 0 : 1;
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
+        VkSemaphore waitSemaphores[] = {headless ? VK_NULL_HANDLE : imageAvailableSemaphores[frameIndex]};
+        // The first time we touch the swap chain image is either when the scene gets blitted into it, or when the
+        // post-processing pass writes to it
+        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+        submitInfo.waitSemaphoreCount = binarySemaphoreCount;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
 
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = buffers;
 
-        VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-        submitInfo.signalSemaphoreCount = 1;
+        // Binary semaphores ignore their value, so only the timeline's matters
+        VkSemaphore signalSemaphores[] = {frameTimeline,
+                                          headless ? VK_NULL_HANDLE : renderFinishedSemaphores[*imageIndex]};
+        const uint64_t signalValues[] = {frameNumber, 0};
+        submitInfo.signalSemaphoreCount = 1 + binarySemaphoreCount;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
-        vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 1 + binarySemaphoreCount;
+        timelineInfo.pSignalSemaphoreValues = signalValues;
+        submitInfo.pNext = &timelineInfo;
+
+        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
             throw std::runtime_error("Failed to submit the draw command buffer!");
+        if (headless) return VK_SUCCESS;
 
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.pWaitSemaphores = &signalSemaphores[1]; // Just the binary one
 
         VkSwapchainKHR swapChains[] = {swapChain};
         presentInfo.swapchainCount = 1;
@@ -99,11 +140,15 @@ namespace Engine {
 
         presentInfo.pImageIndices = imageIndex;
 
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
         return vkQueuePresentKHR(device.presentQueue(), &presentInfo);
     }
 
     void SwapChain::createSwapChain() {
+        if (device.isHeadless()) {
+            createOffscreenImages();
+            return;
+        }
+
         SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -123,7 +168,10 @@ namespace Engine {
         createInfo.imageColorSpace = surfaceFormat.colorSpace;
         createInfo.imageExtent = extent;
         createInfo.imageArrayLayers = 1;
-        createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        // We blit the scene into it when it's scaled, but surfaces don't have to allow that, and then we don't scale
+        swapChainImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                              (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+        createInfo.imageUsage = swapChainImageUsage;
 
         QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
         uint32_t queueFamilyIndices[2] = {indices.graphicsFamily, indices.presentFamily};
@@ -160,6 +208,29 @@ namespace Engine {
         swapChainImageFormat = surfaceFormat.format;
         swapChainExtent = extent;
     }
+    void SwapChain::createOffscreenImages() {
+        // Same format we'd most likely get from a surface, so everything downstream behaves the same
+        swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+        swapChainExtent = windowExtent;
+
+        swapChainImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+        offscreenImages.resize(MAX_FRAMES_IN_FLIGHT);
+        swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < offscreenImages.size(); i++) {
+            offscreenImages[i] = std::make_unique<Image>(device,
+                                                         swapChainExtent.width,
+                                                         swapChainExtent.height,
+                                                         VK_SAMPLE_COUNT_1_BIT,
+                                                         swapChainImageFormat,
+                                                         VK_IMAGE_TILING_OPTIMAL,
+                                                         swapChainImageUsage |
+                                                         VK_IMAGE_USAGE_TRANSFER_SRC_BIT, // So it can be read back
+                                                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                         1);
+            swapChainImages[i] = offscreenImages[i]->getImage();
+        }
+    }
     void SwapChain::createImageViews() {
         swapChainImageViews.resize(imageCount());
         for (size_t i = 0; i < imageCount(); i++) {
@@ -179,35 +250,64 @@ namespace Engine {
         }
     }
     void SwapChain::createRenderPass() {
+        // With occlusion culling, the scene gets drawn in two halves, with the depth pyramid getting built in between,
+        // so the first one has to keep everything around, and the second one has to pick up where it left off
+        renderPass = createSceneRenderPass(occlusionCulling, false, false);
+        if (occlusionCulling) resumeRenderPass = createSceneRenderPass(false, true, false);
+
+        // The post-processing pass always needs the scene image, so it never renders straight into the swap chain
+        if (antiAliasing == AntiAliasing::FXAA) return;
+        if (occlusionCulling) directResumeRenderPass = createSceneRenderPass(false, true, true);
+        else directRenderPass = createSceneRenderPass(false, false, true);
+    }
+    VkRenderPass SwapChain::createSceneRenderPass(bool suspends, bool resumes, bool direct) {
+        // With a single sample there's nothing to resolve, so we just render straight into the scene image
+        const VkSampleCountFlagBits sampleCount = device.getDesiredSampleCount();
+        const bool multisampled = sampleCount != VK_SAMPLE_COUNT_1_BIT;
+
+        // The scene image either gets blitted into the swap chain image, or sampled by the post-processing pass. When
+        // rendering straight into the swap chain image, it's left the same way the blit would have left it, so the UI
+        // pass doesn't have to care which way the scene got there.
+        const bool postProcessed = antiAliasing == AntiAliasing::FXAA;
+        VkImageLayout sceneLayout = postProcessed ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL :
+                                                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        if (direct) sceneLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
         VkAttachmentDescription colorAttachment{};
         colorAttachment.format = getSwapChainImageFormat();
-        colorAttachment.samples = device.getDesiredSampleCount();
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.samples = sampleCount;
+        colorAttachment.loadOp = resumes ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        // The multisampled image gets resolved, so there's no need to ever write it back to memory
+        colorAttachment.storeOp = multisampled && !suspends ? VK_ATTACHMENT_STORE_OP_DONT_CARE :
+                                                              VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.initialLayout = resumes ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = multisampled || suspends ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : sceneLayout;
 
+        // When suspending, the depth gets read by the depth pyramid pass
         VkAttachmentDescription depthAttachment{};
         depthAttachment.format = findDepthFormat();
-        depthAttachment.samples = device.getDesiredSampleCount();
-        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.samples = sampleCount;
+        depthAttachment.loadOp = resumes ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = suspends ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.initialLayout = resumes ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = suspends ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL :
+                                                 VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+        // Render passes with different resolve attachments aren't compatible, so the first half resolves too, even if
+        // the result gets thrown away
         VkAttachmentDescription colorAttachmentResolve{};
         colorAttachmentResolve.format = swapChainImageFormat;
         colorAttachmentResolve.samples = VK_SAMPLE_COUNT_1_BIT;
         colorAttachmentResolve.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachmentResolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachmentResolve.storeOp = suspends ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachmentResolve.finalLayout = suspends ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : sceneLayout;
 
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;
@@ -226,8 +326,9 @@ namespace Engine {
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments = &colorAttachmentRef;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
-        subpass.pResolveAttachments = &colorAttachmentResolveRef;
+        subpass.pResolveAttachments = multisampled ? &colorAttachmentResolveRef : nullptr;
 
+        // The depth is shared by every frame, so we also have to wait for the last depth pyramid pass to stop reading it
         VkSubpassDependency dependency{};
         dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
         dependency.dstSubpass = 0;
@@ -235,91 +336,237 @@ namespace Engine {
         dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
         dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
         dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        if (occlusionCulling) dependency.srcStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        if (resumes) dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                                                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+
+        // Make sure the scene image is written before we blit or sample it, or the depth before we build the pyramid
+        VkSubpassDependency outputDependency{};
+        outputDependency.srcSubpass = 0;
+        outputDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        outputDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        outputDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        outputDependency.dstStageMask = postProcessed ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+        outputDependency.dstAccessMask = postProcessed ? VK_ACCESS_SHADER_READ_BIT : VK_ACCESS_TRANSFER_READ_BIT;
+        if (direct) {
+            outputDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            outputDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        } if (suspends) {
+            outputDependency.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            outputDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            outputDependency.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            outputDependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        }
 
+        std::array<VkSubpassDependency, 2> dependencies {dependency, outputDependency};
         std::array<VkAttachmentDescription, 3> attachments {colorAttachment, depthAttachment, colorAttachmentResolve};
         VkRenderPassCreateInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.attachmentCount = multisampled ? 3 : 2;
         renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        VkRenderPass scenePass;
+        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &scenePass) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the render pass!");
+        return scenePass;
+    }
+    void SwapChain::createUIRenderPass() {
+        // When post-processing, the fullscreen pass overwrites the whole image, so there's nothing to load
+        const bool postProcessed = antiAliasing == AntiAliasing::FXAA;
+
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = swapChainImageFormat;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = postProcessed ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_LOAD; // Keep the upscaled scene
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = postProcessed ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        // Presenting needs the swap chain extension, which we don't have when headless
+        colorAttachment.finalLayout = device.isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL :
+                                                            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        VkAttachmentReference colorAttachmentRef{};
+        colorAttachmentRef.attachment = 0;
+        colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+
+        // Wait for the blit (or the scene pass, or the image acquisition) to be done before drawing on top of it
+        VkSubpassDependency dependency{};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstSubpass = 0;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = 1;
+        renderPassInfo.pAttachments = &colorAttachment;
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
         renderPassInfo.dependencyCount = 1;
         renderPassInfo.pDependencies = &dependency;
 
-        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
-            throw std::runtime_error("Failed to create the render pass!");
+        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &uiRenderPass) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the UI render pass!");
     }
     void SwapChain::createFramebuffers() {
-        swapChainFramebuffers.resize(imageCount());
-        for (size_t i = 0; i < imageCount(); i++) {
-            std::array<VkImageView, 3> attachments { // !!! ORDER MATTERS HERE !!!
-                    colorImageViews[i],
-                    depthImageViews[i],
-                    swapChainImageViews[i]
-            };
+        // The scene ones either end up in the scene image, or straight in the swap chain image, whichever are there
+        const auto createSceneFramebuffer = [this](VkRenderPass scenePass, VkImageView target) {
+            // !!! ORDER MATTERS HERE !!!
+            // Without MSAA, the target takes the place of the color attachment and there's no resolve
+            std::vector<VkImageView> attachments;
+            if (colorImage == nullptr) attachments = {target, depthImageView};
+            else attachments = {colorImageView, depthImageView, target};
 
             VkFramebufferCreateInfo framebufferInfo{};
             framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebufferInfo.renderPass = renderPass;
+            framebufferInfo.renderPass = scenePass;
             framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
             framebufferInfo.pAttachments = attachments.data();
             framebufferInfo.width = swapChainExtent.width;
             framebufferInfo.height = swapChainExtent.height;
             framebufferInfo.layers = 1;
 
-            if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS)
+            VkFramebuffer framebuffer;
+            if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
                 throw std::runtime_error("Failed to create a framebuffer!");
+            return framebuffer;
+        };
+        for (size_t i = 0; i < sceneImageViews.size(); i++)
+            swapChainFramebuffers.push_back(createSceneFramebuffer(renderPass, sceneImageViews[i]));
+        if (antiAliasing != AntiAliasing::FXAA)
+            for (size_t i = 0; i < imageCount(); i++)
+                directFramebuffers.push_back(createSceneFramebuffer(getDirectRenderPass(), swapChainImageViews[i]));
+
+        uiFramebuffers.resize(imageCount());
+        for (size_t i = 0; i < imageCount(); i++) {
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = uiRenderPass;
+            framebufferInfo.attachmentCount = 1;
+            framebufferInfo.pAttachments = &swapChainImageViews[i];
+            framebufferInfo.width = swapChainExtent.width;
+            framebufferInfo.height = swapChainExtent.height;
+            framebufferInfo.layers = 1;
+
+            if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &uiFramebuffers[i]) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create a UI framebuffer!");
         }
     }
     void SwapChain::createColorResources() {
-        colorImages.resize(imageCount());
-        colorImageViews.resize(imageCount());
-        for (size_t i = 0; i < imageCount(); i++) {
-            colorImages[i] = std::make_unique<Image>(device,
-                                                     swapChainExtent.width,
-                                                     swapChainExtent.height,
-                                                     device.getDesiredSampleCount(),
-                                                     swapChainImageFormat,
-                                                     VK_IMAGE_TILING_OPTIMAL,
-                                                     VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-            colorImageViews[i] = colorImages[i]->createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
-        }
+        if (device.getDesiredSampleCount() == VK_SAMPLE_COUNT_1_BIT) return; // We render straight into the scene image
+
+        // The multisampled color only lives for the duration of the render pass (it gets resolved into the scene image),
+        // and frames get executed in order on the graphics queue, so every framebuffer can share the same one.
+        // With occlusion culling it has to survive between both halves of the scene, so it can't be transient then.
+        colorImage = std::make_unique<Image>(device,
+                                             swapChainExtent.width,
+                                             swapChainExtent.height,
+                                             device.getDesiredSampleCount(),
+                                             swapChainImageFormat,
+                                             VK_IMAGE_TILING_OPTIMAL,
+                                             occlusionCulling ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT :
+                                                                VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT |
+                                                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                             occlusionCulling ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT :
+                                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                                                VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+                                             1);
+        colorImageView = colorImage->createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
     }
     void SwapChain::createDepthResources() {
         swapChainDepthFormat = findDepthFormat();
 
-        depthImages.resize(imageCount());
-        depthImageViews.resize(imageCount());
+        // Same as above, a single image is enough. Unless we're building a depth pyramid out of it, we never store the
+        // depth either, so it can be transient.
+        depthImage = std::make_unique<Image>(device,
+                                             swapChainExtent.width,
+                                             swapChainExtent.height,
+                                             device.getDesiredSampleCount(),
+                                             swapChainDepthFormat,
+                                             VK_IMAGE_TILING_OPTIMAL,
+                                             occlusionCulling ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                                                VK_IMAGE_USAGE_SAMPLED_BIT :
+                                                                VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT |
+                                                                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                             occlusionCulling ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT :
+                                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                                                VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+                                             1);
+        depthImageView = depthImage->createImageView(VK_IMAGE_ASPECT_DEPTH_BIT);
+    }
+    void SwapChain::createSceneResources() {
+        // These are always allocated at the full swap chain extent, dynamic resolution just renders to a smaller area of
+        // them, so we don't have to recreate anything when the scale changes
+        // They share the swap chain's format, and get upscaled into it with a linear blit, which isn't guaranteed, so
+        // without it we just render straight into the swap chain image at full size, like we used to
+        constexpr VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                                                      VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                                      VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        scalable = (swapChainImageUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0 &&
+                   (device.getFormatProperties(swapChainImageFormat).optimalTilingFeatures & blitFeatures) == blitFeatures;
+        if (!scalable && antiAliasing != AntiAliasing::FXAA) return;
+
+        sceneImages.resize(imageCount());
+        sceneImageViews.resize(imageCount());
         for (size_t i = 0; i < imageCount(); i++) {
-            depthImages[i] = std::make_unique<Image>(device,
+            sceneImages[i] = std::make_unique<Image>(device,
                                                      swapChainExtent.width,
                                                      swapChainExtent.height,
-                                                     device.getDesiredSampleCount(),
-                                                     swapChainDepthFormat,
+                                                     VK_SAMPLE_COUNT_1_BIT,
+                                                     swapChainImageFormat,
                                                      VK_IMAGE_TILING_OPTIMAL,
-                                                     VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
-            depthImageViews[i] = depthImages[i]->createImageView(VK_IMAGE_ASPECT_DEPTH_BIT);
+                                                     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                                     VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                                                     VK_IMAGE_USAGE_SAMPLED_BIT,
+                                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                     1);
+            sceneImageViews[i] = sceneImages[i]->createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
         }
     }
+    VkDeviceSize SwapChain::getAttachmentMemory() const {
+        VkDeviceSize total = 0;
+        if (colorImage != nullptr) total += colorImage->getMemorySize();
+        if (depthImage != nullptr) total += depthImage->getMemorySize();
+        for (const auto &image : sceneImages) total += image->getMemorySize();
+        return total;
+    }
+    VkDeviceSize SwapChain::estimateAttachmentMemory(VkExtent2D extent,
+                                                     VkSampleCountFlagBits sampleCount,
+                                                     size_t imageCount) {
+        // Just a rough estimate, assuming 4 bytes per sample for both color and depth, and no padding. The transient
+        // attachments are shared, so only the scene images scale with the swap chain image count.
+        const VkDeviceSize pixels = static_cast<VkDeviceSize>(extent.width) * extent.height;
+        const auto samples = static_cast<VkDeviceSize>(sampleCount);
+        VkDeviceSize total = pixels * 4 * samples + pixels * 4 * imageCount; // Depth + scene images
+        if (sampleCount != VK_SAMPLE_COUNT_1_BIT) total += pixels * 4 * samples; // Multisampled color
+        return total;
+    }
     void SwapChain::createSyncObjects() {
+        if (device.isHeadless()) return; // The timeline is enough, see submitCommandBuffers
         imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+        renderFinishedSemaphores.resize(imageCount());
 
         VkSemaphoreCreateInfo semaphoreInfo{};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        VkFenceCreateInfo fenceInfo{};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+        for (VkSemaphore &semaphore : imageAvailableSemaphores)
+            if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
                 throw std::runtime_error("Failed to create the synchronization objects for a frame!");
-        }
+        for (VkSemaphore &semaphore : renderFinishedSemaphores)
+            if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create the synchronization objects for an image!");
     }
 
     VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats) {
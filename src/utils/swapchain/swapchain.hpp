@@ -12,14 +12,22 @@
 #include "../device/device.hpp"
 
 #include "../image/image.hpp"
+#include "../antialiasing/antialiasing.hpp"
 
 namespace Engine {
     class SwapChain {
     public:
-        static constexpr int MAX_FRAMES_IN_FLIGHT = 3; // Min. 2
-
-        SwapChain(Device &deviceRef, VkExtent2D windowExtent);
-        SwapChain(Device &deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous);
+        // How many frames the CPU is allowed to get ahead of the GPU can be changed at runtime (see Renderer), but every
+        // per frame resource gets allocated for the worst case, and frames always go through all of them in order
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+        static constexpr uint32_t MIN_FRAMES_IN_FLIGHT = 1;
+
+        SwapChain(Device &deviceRef, VkExtent2D windowExtent, AntiAliasing antiAliasing, bool occlusionCulling);
+        SwapChain(Device &deviceRef,
+                  VkExtent2D windowExtent,
+                  AntiAliasing antiAliasing,
+                  bool occlusionCulling,
+                  std::shared_ptr<SwapChain> previous);
         ~SwapChain() { del(); }
 
         SwapChain(const SwapChain &) = delete;
@@ -29,12 +37,31 @@ namespace Engine {
 
         [[nodiscard]] VkFramebuffer getFrameBuffer(uint32_t index) const { return swapChainFramebuffers[index]; }
         [[nodiscard]] VkRenderPass getRenderPass() const { return renderPass; }
+        // Only there with occlusion culling, picks up the scene where the first render pass left it
+        [[nodiscard]] VkRenderPass getResumeRenderPass() const { return resumeRenderPass; }
+        // Same as the two above, but the scene ends up straight in the swap chain image, for when there's nothing to
+        // scale or post-process. The first half of an occlusion culled scene doesn't care where it ends up, so that
+        // one's shared.
+        [[nodiscard]] VkFramebuffer getDirectFrameBuffer(uint32_t index) const { return directFramebuffers[index]; }
+        [[nodiscard]] VkRenderPass getDirectRenderPass() const {
+            return occlusionCulling ? renderPass : directRenderPass;
+        }
+        [[nodiscard]] VkRenderPass getDirectResumeRenderPass() const { return directResumeRenderPass; }
+        [[nodiscard]] VkFramebuffer getUIFrameBuffer(uint32_t index) const { return uiFramebuffers[index]; }
+        [[nodiscard]] VkRenderPass getUIRenderPass() const { return uiRenderPass; }
+        [[nodiscard]] VkImage getImage(uint32_t index) const { return swapChainImages[index]; }
         [[nodiscard]] VkImageView getImageView(uint32_t index) const { return swapChainImageViews[index]; }
+        [[nodiscard]] VkImage getSceneImage(uint32_t index) const { return sceneImages[index]->getImage(); }
+        [[nodiscard]] VkImageView getSceneImageView(uint32_t index) const { return sceneImageViews[index]; }
+        [[nodiscard]] VkImageView getDepthImageView() const { return depthImageView; }
         [[nodiscard]] size_t imageCount() const { return swapChainImages.size(); }
         [[nodiscard]] VkFormat getSwapChainImageFormat() const { return swapChainImageFormat; }
         [[nodiscard]] VkExtent2D getSwapChainExtent() const { return swapChainExtent; }
         [[nodiscard]] uint32_t width() const { return swapChainExtent.width; }
         [[nodiscard]] uint32_t height() const { return swapChainExtent.height; }
+        // Whether the scene can be rendered smaller and blitted into the swap chain image, not every format (or surface)
+        // allows it, and then it always gets rendered at full size
+        [[nodiscard]] bool supportsScaling() const { return scalable; }
 
         [[nodiscard]] bool compareSwapFormats(const SwapChain &other) const {
             return swapChainImageFormat == other.swapChainImageFormat &&
@@ -48,42 +75,75 @@ namespace Engine {
         }
         [[nodiscard]] VkFormat findDepthFormat();
 
-        [[nodiscard]] VkResult acquireNextImage(uint32_t *imageIndex);
-        [[nodiscard]] VkResult submitCommandBuffers(const VkCommandBuffer *buffers, const uint32_t *imageIndex);
+        // Actual size of all the color, depth and scene images, as reported by the driver
+        [[nodiscard]] VkDeviceSize getAttachmentMemory() const;
+        [[nodiscard]] static VkDeviceSize estimateAttachmentMemory(VkExtent2D extent,
+                                                                   VkSampleCountFlagBits sampleCount,
+                                                                   size_t imageCount);
+
+        // Doesn't wait for anything but the image itself, the renderer makes sure the frame's resources are free first
+        [[nodiscard]] VkResult acquireNextImage(uint32_t frameIndex, uint32_t *imageIndex);
+        // Signals frameTimeline with frameNumber once the GPU is done with the frame
+        [[nodiscard]] VkResult submitCommandBuffers(const VkCommandBuffer *buffers,
+                                                    uint32_t frameIndex,
+                                                    const uint32_t *imageIndex,
+                                                    VkSemaphore frameTimeline,
+                                                    uint64_t frameNumber);
 
     private:
         VkFormat swapChainImageFormat;
         VkFormat swapChainDepthFormat;
         VkExtent2D swapChainExtent;
+        VkImageUsageFlags swapChainImageUsage = 0;
+        bool scalable = false;
 
         std::vector<VkFramebuffer> swapChainFramebuffers;
-        VkRenderPass renderPass;
-
-        std::vector<std::unique_ptr<Image>> colorImages;
-        std::vector<VkImageView> colorImageViews;
-        std::vector<std::unique_ptr<Image>> depthImages;
-        std::vector<VkImageView> depthImageViews;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkRenderPass resumeRenderPass = VK_NULL_HANDLE;
+        std::vector<VkFramebuffer> directFramebuffers; // Only there without post-processing
+        VkRenderPass directRenderPass = VK_NULL_HANDLE;
+        VkRenderPass directResumeRenderPass = VK_NULL_HANDLE;
+
+        // The UI gets drawn straight into the swap chain images, at native resolution, after the scene is upscaled
+        std::vector<VkFramebuffer> uiFramebuffers;
+        VkRenderPass uiRenderPass = VK_NULL_HANDLE;
+
+        // Transient, so they're shared by all the framebuffers
+        std::unique_ptr<Image> colorImage; // Only used with MSAA
+        VkImageView colorImageView = VK_NULL_HANDLE;
+        std::unique_ptr<Image> depthImage;
+        VkImageView depthImageView = VK_NULL_HANDLE;
+        // Where the scene gets resolved to, before being upscaled, not there if it can't be scaled or post-processed
+        std::vector<std::unique_ptr<Image>> sceneImages;
+        std::vector<VkImageView> sceneImageViews;
         std::vector<VkImage> swapChainImages;
         std::vector<VkImageView> swapChainImageViews;
+        std::vector<std::unique_ptr<Image>> offscreenImages; // What swapChainImages point to when headless
 
         Device &device;
         VkExtent2D windowExtent;
+        AntiAliasing antiAliasing;
+        bool occlusionCulling; // The depth has to be kept around and sampled, and the scene gets split in two passes
 
-        VkSwapchainKHR swapChain;
+        VkSwapchainKHR swapChain = VK_NULL_HANDLE;
         std::shared_ptr<SwapChain> oldSwapChain;
 
-        std::vector<VkSemaphore> imageAvailableSemaphores;
-        std::vector<VkSemaphore> renderFinishedSemaphores;
-        std::vector<VkFence> inFlightFences;
-        std::vector<VkFence> imagesInFlight;
-        size_t currentFrame = 0;
+        // The presentation engine only understands binary semaphores, so these stay around next to the timeline
+        std::vector<VkSemaphore> imageAvailableSemaphores; // One per frame in flight
+        std::vector<VkSemaphore> renderFinishedSemaphores; // One per image, since presenting might take a while
 
         void init();
         void createSwapChain();
+        void createOffscreenImages();
         void createImageViews();
         void createColorResources();
         void createDepthResources();
+        void createSceneResources();
         void createRenderPass();
+        // suspends keeps everything around for a later pass, resumes picks up from an earlier one, and direct ends up in
+        // the swap chain image instead of the scene image
+        VkRenderPass createSceneRenderPass(bool suspends, bool resumes, bool direct);
+        void createUIRenderPass();
         void createFramebuffers();
         void createSyncObjects();
 
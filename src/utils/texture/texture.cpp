@@ -1,8 +1,16 @@
 #include "texture.hpp"
+#include "../uploadservice/uploadservice.hpp"
 
 namespace Engine {
-    Texture::Texture(Device &device, const char *texturePath) : device(device), texturePath(texturePath) {
-        createTextureImage();
+    Texture::Texture(Device &device, const char *texturePath) :
+                     Texture(device, createTextureImage(device, texturePath)) {}
+    Texture::Texture(Device &device, const Pixels &pixels) :
+                     Texture(device, pixels.width, pixels.height, pixels.data.get()) {}
+    Texture::Texture(Device &device, const uint32_t width, const uint32_t height, const void *pixels) :
+                     Texture(device, createTextureImage(device, width, height, pixels)) {}
+    Texture::Texture(Device &device, const Ktx2File &file) : Texture(device, createTextureImage(device, file)) {}
+    Texture::Texture(Device &device, std::unique_ptr<Image> image) : device(device), textureImage(std::move(image)) {
+        ZoneScoped;
         textureImageView = textureImage->createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
         createTextureSampler();
     }
@@ -12,46 +20,81 @@ namespace Engine {
         vkDestroyImageView(device.device(), textureImageView, nullptr);
     };
 
-    void Texture::createTextureImage () {
+    Texture::Pixels Texture::loadPixels(const char *texturePath) {
+        ZoneScoped;
+        ZoneText(texturePath, std::strlen(texturePath));
         int texWidth, texHeight, texChannels;
-        stbi_uc *pixels = stbi_load(texturePath,
-                                    &texWidth,
-                                    &texHeight,
-                                    &texChannels,
-                                    STBI_rgb_alpha);
-        const VkDeviceSize imageSize = 4 * static_cast<VkDeviceSize>(texWidth) * static_cast<VkDeviceSize>(texHeight);
+        Pixels pixels{};
+        pixels.data.reset(stbi_load(texturePath,
+                                     &texWidth,
+                                     &texHeight,
+                                     &texChannels,
+                                     STBI_rgb_alpha));
+        if (!pixels.data) throw std::runtime_error("Failed to load the texture image!");
 
-        if (!pixels) throw std::runtime_error("Failed to load the texture image!");
+        pixels.width = static_cast<uint32_t>(texWidth);
+        pixels.height = static_cast<uint32_t>(texHeight);
+        return pixels;
+    }
 
-        Buffer stagingBuffer {
-                device,
-                imageSize,
-                1,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    Texture::Prepared Texture::prepareTextureFromFile(const std::string &path) {
+        if (Ktx2File::isKtx2(path)) {
+            return [file = std::make_unique<Ktx2File>(path)](Device &device) {
+                return std::make_unique<Texture>(device, *file);
+            };
+        } return [pixels = loadPixels(path.c_str())](Device &device) {
+            return std::make_unique<Texture>(device, pixels);
         };
+    }
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer(pixels, imageSize);
-
-        stbi_image_free(pixels);
+    std::unique_ptr<Image> Texture::createTextureImage(Device &device, const char *texturePath) {
+        if (Ktx2File::isKtx2(texturePath)) return createTextureImage(device, Ktx2File(texturePath));
+        const Pixels pixels = loadPixels(texturePath);
+        return createTextureImage(device, pixels.width, pixels.height, pixels.data.get());
+    }
 
-        textureImage = std::make_unique<Image>(
+    std::unique_ptr<Image> Texture::createTextureImage(Device &device,
+                                                       const uint32_t width,
+                                                       const uint32_t height,
+                                                       const void *pixels) {
+        const VkDeviceSize imageSize = 4 * static_cast<VkDeviceSize>(width) * static_cast<VkDeviceSize>(height);
+        auto textureImage = std::make_unique<Image>(
                 device,
-                static_cast<uint32_t>(texWidth),
-                static_cast<uint32_t>(texHeight),
+                width,
+                height,
                 VK_SAMPLE_COUNT_1_BIT,
                 VK_FORMAT_R8G8B8A8_SRGB,
                 VK_IMAGE_TILING_OPTIMAL,
                 VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-        textureImage->transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED,
-                                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        textureImage->copyBufferToImage(stagingBuffer.getBuffer());
-        textureImage->transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED,
-                                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        textureImage->copyBufferToImage(stagingBuffer.getBuffer());
-        textureImage->generateMipmaps();
-        stagingBuffer.unmap();
+
+        // The pixels get copied into the staging ring right away, and the mips get generated along with the copy
+        device.getUploadService().uploadImage(*textureImage, pixels, imageSize);
+        return textureImage;
+    }
+
+    std::unique_ptr<Image> Texture::createTextureImage(Device &device, const Ktx2File &file) {
+        // Pretty much everything on desktop has it, and pretty much nothing else does
+        if (!device.supportsTextureCompressionBC())
+            throw std::runtime_error("Failed to create the texture image, BC textures aren't supported!");
+
+        // No blits, so it doesn't need to be a transfer source, and the format doesn't need to support them either
+        auto textureImage = std::make_unique<Image>(
+                device,
+                file.getWidth(),
+                file.getHeight(),
+                VK_SAMPLE_COUNT_1_BIT,
+                file.getFormat(),
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                file.getMipLevels());
+
+        // Straight from the mapped file into the staging ring, and from there into every mip level with one copy
+        device.getUploadService().uploadImage(*textureImage,
+                                              file.getData().data(),
+                                              file.getData().size(),
+                                              file.getMipOffsets());
+        return textureImage;
     }
 
     void Texture::createTextureSampler() {
@@ -2,9 +2,12 @@
 #define TEXTURE_HPP
 
 #include <stb_image.h>
+#include <tracy/Tracy.hpp>
 
 #include <stdexcept>
 #include <memory>
+#include <string>
+#include <functional>
 
 #include <vulkan/vulkan_core.h>
 #include <vulkan/vulkan.h>
@@ -12,11 +15,28 @@
 #include "../device/device.hpp"
 #include "../buffer/buffer.hpp"
 #include "../image/image.hpp"
+#include "../ktx2/ktx2.hpp"
 
 namespace Engine {
     class Texture {
     public:
+        // Decoded RGBA8 pixels, which is all of loading a texture that doesn't need the GPU, so it can happen anywhere
+        struct Pixels {
+            std::unique_ptr<stbi_uc, void (*)(void *)> data{nullptr, stbi_image_free};
+            uint32_t width = 0;
+            uint32_t height = 0;
+        };
+
+        // What's left of loading a texture once the file's been read, which is just creating it
+        using Prepared = std::move_only_function<std::unique_ptr<Texture>(Device &device)>;
+
+        // Picks the format from the extension, .ktx2 files go through Ktx2File, and anything else through stb_image
         Texture(Device &device, const char* texturePath);
+        Texture(Device &device, const Pixels &pixels);
+        // The pixels get copied right away, and the mips generated from them, so they don't have to stick around
+        Texture(Device &device, uint32_t width, uint32_t height, const void *pixels);
+        // Stays compressed on the GPU, with the file's own mips, all copied at once. Throws if the GPU can't sample it.
+        Texture(Device &device, const Ktx2File &file);
         ~Texture();
 
         Texture(const Texture &) = delete;
@@ -25,15 +45,28 @@ namespace Engine {
         Texture& operator=(Texture &&) = delete;
 
         [[nodiscard]] VkDescriptorImageInfo getDescriptorImageInfo() const;
+        [[nodiscard]] VkDeviceSize getMemorySize() const { return textureImage->getMemorySize(); }
+
+        // Safe to call from any thread, throws if the file can't be read
+        [[nodiscard]] static Pixels loadPixels(const char *texturePath);
+        // Everything but the upload, for either kind of file, same as the constructor, so it's safe to call from any
+        // thread, as long as what it returns gets called on the main one
+        [[nodiscard]] static Prepared prepareTextureFromFile(const std::string &path);
     private:
         Device &device;
         std::unique_ptr<Image> textureImage;
         VkImageView textureImageView;
         VkSampler textureSampler;
 
-        const char* texturePath;
+        // Where all the other constructors end up, once their image's been created and its upload recorded
+        Texture(Device &device, std::unique_ptr<Image> image);
 
-        void createTextureImage();
+        [[nodiscard]] static std::unique_ptr<Image> createTextureImage(Device &device, const char *texturePath);
+        [[nodiscard]] static std::unique_ptr<Image> createTextureImage(Device &device,
+                                                                       uint32_t width,
+                                                                       uint32_t height,
+                                                                       const void *pixels);
+        [[nodiscard]] static std::unique_ptr<Image> createTextureImage(Device &device, const Ktx2File &file);
         void createTextureSampler();
     };
 }
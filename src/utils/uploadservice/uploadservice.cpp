@@ -0,0 +1,376 @@
+#include "uploadservice.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace Engine {
+    UploadService::UploadService(Device &device) : device(device) {
+        const QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
+        graphicsFamily = indices.graphicsFamily;
+        transferFamily = indices.transferFamily;
+        transferQueue = device.transferQueue();
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = graphicsFamily;
+        if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &graphicsCommandPool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the upload command pool!");
+        if (hasDedicatedTransferQueue()) {
+            poolInfo.queueFamilyIndex = transferFamily;
+            if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create the transfer command pool!");
+        }
+
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+        if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the upload timeline semaphore!");
+
+        alignment = std::max(alignment, device.properties.limits.optimalBufferCopyOffsetAlignment);
+        staging = std::make_unique<Buffer>(device,
+                                           STAGING_SIZE,
+                                           1,
+                                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        staging->map(); // And it stays that way
+    }
+    UploadService::~UploadService() {
+        // Whatever hasn't been flushed just gets thrown away along with the pools
+        waitForValue(lastSubmittedValue);
+        staging.reset();
+        vkDestroySemaphore(device.device(), timeline, nullptr);
+        if (transferCommandPool != VK_NULL_HANDLE) vkDestroyCommandPool(device.device(), transferCommandPool, nullptr);
+        vkDestroyCommandPool(device.device(), graphicsCommandPool, nullptr);
+    }
+
+    uint64_t UploadService::uploadBuffer(VkBuffer buffer, const void *data, VkDeviceSize size, VkDeviceSize offset) {
+        assert(size > 0 && "Cannot upload an empty buffer!");
+        const auto [stagingBuffer, stagingOffset] = stage(data, size);
+        Batch &batch = getBatch();
+
+        const VkBufferCopy region{stagingOffset, offset, size};
+        vkCmdCopyBuffer(batch.transferCommandBuffer, stagingBuffer, buffer, 1, &region);
+
+        if (hasDedicatedTransferQueue()) {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.srcQueueFamilyIndex = transferFamily;
+            barrier.dstQueueFamilyIndex = graphicsFamily;
+            barrier.buffer = buffer;
+            barrier.offset = offset;
+            barrier.size = size;
+            releaseBufferBarriers.push_back(barrier);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+            acquireBufferBarriers.push_back(barrier);
+        }
+
+        uploadedBytes += size;
+        return batch.value;
+    }
+
+    uint64_t UploadService::uploadImage(Image &image,
+                                        const void *data,
+                                        VkDeviceSize size,
+                                        std::span<const VkDeviceSize> mipOffsets) {
+        assert(size > 0 && "Cannot upload an empty image!");
+        const bool pregenerated = !mipOffsets.empty();
+        const auto [stagingBuffer, stagingOffset] = stage(data, size);
+        Batch &batch = getBatch();
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image.getImage();
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, image.getMipLevels(), 0, 1};
+        vkCmdPipelineBarrier(batch.transferCommandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+        if (pregenerated) {
+            std::vector<VkDeviceSize> offsets(mipOffsets.begin(), mipOffsets.end());
+            for (VkDeviceSize &offset : offsets) offset += stagingOffset;
+            image.recordCopyMipsFromBuffer(batch.transferCommandBuffer, stagingBuffer, offsets);
+        } else image.recordCopyFromBuffer(batch.transferCommandBuffer, stagingBuffer, stagingOffset);
+
+        if (hasDedicatedTransferQueue()) {
+            // Without mips to generate, it's ready to be sampled as soon as it's acquired, otherwise the layout stays
+            // the same, and the mip generation on the other side takes it from here
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = pregenerated ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                             : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = transferFamily;
+            barrier.dstQueueFamilyIndex = graphicsFamily;
+            releaseImageBarriers.push_back(barrier);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = pregenerated ? VK_ACCESS_SHADER_READ_BIT
+                                                 : VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+            acquireImageBarriers.push_back(barrier);
+            if (!pregenerated) pendingMipmaps.push_back(&image);
+        } else if (pregenerated) {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            vkCmdPipelineBarrier(batch.graphicsCommandBuffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 0,
+                                 0, nullptr,
+                                 0, nullptr,
+                                 1, &barrier);
+        } else image.recordGenerateMipmaps(batch.graphicsCommandBuffer);
+
+        uploadedBytes += size;
+        return batch.value;
+    }
+
+    uint64_t UploadService::flush() {
+        ZoneScoped;
+        if (!current) return lastSubmittedValue;
+        Batch &batch = *current;
+
+        if (hasDedicatedTransferQueue()) {
+            vkCmdPipelineBarrier(batch.transferCommandBuffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                 0,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(releaseBufferBarriers.size()), releaseBufferBarriers.data(),
+                                 static_cast<uint32_t>(releaseImageBarriers.size()), releaseImageBarriers.data());
+            if (vkEndCommandBuffer(batch.transferCommandBuffer) != VK_SUCCESS)
+                throw std::runtime_error("Failed to record the transfer command buffer!");
+
+            // The semaphore wait covers every stage, so this chains right after it
+            vkCmdPipelineBarrier(batch.graphicsCommandBuffer,
+                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                 0,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(acquireBufferBarriers.size()), acquireBufferBarriers.data(),
+                                 static_cast<uint32_t>(acquireImageBarriers.size()), acquireImageBarriers.data());
+            for (const Image *image : pendingMipmaps) image->recordGenerateMipmaps(batch.graphicsCommandBuffer);
+        }
+
+        // Anything submitted to the graphics queue after this is in the barrier's second scope, frames included
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        vkCmdPipelineBarrier(batch.graphicsCommandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                             0,
+                             1, &barrier,
+                             0, nullptr,
+                             0, nullptr);
+        if (vkEndCommandBuffer(batch.graphicsCommandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record the upload command buffer!");
+
+        // With two queues, the transfer half signals one value, and the graphics half waits on it and signals the next
+        const uint64_t transferValue = batch.value - 1;
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &timeline;
+
+        if (hasDedicatedTransferQueue()) {
+            timelineInfo.signalSemaphoreValueCount = 1;
+            timelineInfo.pSignalSemaphoreValues = &transferValue;
+            submitInfo.pCommandBuffers = &batch.transferCommandBuffer;
+            if (vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+                throw std::runtime_error("Failed to submit the transfer command buffer!");
+
+            constexpr VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            timelineInfo.waitSemaphoreValueCount = 1;
+            timelineInfo.pWaitSemaphoreValues = &transferValue;
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = &timeline;
+            submitInfo.pWaitDstStageMask = &waitStage;
+        }
+
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &batch.value;
+        submitInfo.pCommandBuffers = &batch.graphicsCommandBuffer;
+        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+            throw std::runtime_error("Failed to submit the upload command buffer!");
+
+        batch.ringEnd = head;
+        lastSubmittedValue = batch.value;
+        submittedBatches++;
+        inFlight.push_back(std::move(current));
+
+        releaseBufferBarriers.clear();
+        acquireBufferBarriers.clear();
+        releaseImageBarriers.clear();
+        acquireImageBarriers.clear();
+        pendingMipmaps.clear();
+        return lastSubmittedValue;
+    }
+
+    void UploadService::wait(const uint64_t value) {
+        if (value > lastSubmittedValue) flush();
+        assert(value <= lastSubmittedValue && "Cannot wait for an upload that was never recorded!");
+        waitForValue(value);
+        retireBatches(false);
+    }
+
+    bool UploadService::isComplete(const uint64_t value) const {
+        return value <= lastSubmittedValue && value <= getCompletedValue();
+    }
+
+    UploadService::Batch &UploadService::getBatch() {
+        if (current) return *current;
+
+        if (!freeBatches.empty()) {
+            current = std::move(freeBatches.back());
+            freeBatches.pop_back();
+            vkResetCommandBuffer(current->graphicsCommandBuffer, 0);
+            if (hasDedicatedTransferQueue()) vkResetCommandBuffer(current->transferCommandBuffer, 0);
+        } else {
+            current = std::make_unique<Batch>();
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandPool = graphicsCommandPool;
+            allocInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(device.device(), &allocInfo, &current->graphicsCommandBuffer) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate the upload command buffer!");
+            current->transferCommandBuffer = current->graphicsCommandBuffer;
+
+            if (hasDedicatedTransferQueue()) {
+                allocInfo.commandPool = transferCommandPool;
+                if (vkAllocateCommandBuffers(device.device(), &allocInfo, &current->transferCommandBuffer) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to allocate the transfer command buffer!");
+            }
+        }
+
+        // Every batch takes two values, so the transfer half has one of its own, even if it doesn't use it
+        nextValue += 2;
+        current->value = nextValue - 1;
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(current->graphicsCommandBuffer, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("Failed to begin recording the upload command buffer!");
+        if (hasDedicatedTransferQueue() && vkBeginCommandBuffer(current->transferCommandBuffer, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("Failed to begin recording the transfer command buffer!");
+        return *current;
+    }
+
+    std::pair<VkBuffer, VkDeviceSize> UploadService::stage(const void *data, const VkDeviceSize size) {
+        retireBatches(false);
+
+        // Making the ring big enough for these would waste a lot of memory the rest of the time
+        if (size > STAGING_SIZE) {
+            auto buffer = std::make_unique<Buffer>(device,
+                                                   size,
+                                                   1,
+                                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            buffer->map();
+            std::memcpy(buffer->getMappedMemory(), data, size);
+            const VkBuffer handle = buffer->getBuffer();
+            getBatch().ownStaging.push_back(std::move(buffer));
+            return {handle, 0};
+        }
+
+        VkDeviceSize offset = 0;
+        while (!tryAllocate(size, offset)) {
+            if (inFlight.empty()) flush(); // Only the current batch is in the way, so it has to go first
+            else retireBatches(true);
+        }
+
+        std::memcpy(static_cast<uint8_t*>(staging->getMappedMemory()) + offset, data, size);
+        return {staging->getBuffer(), offset};
+    }
+
+    bool UploadService::tryAllocate(VkDeviceSize size, VkDeviceSize &offset) {
+        size = (size + alignment - 1) / alignment * alignment;
+        if (!current && inFlight.empty()) head = tail = 0; // Nothing's using the ring, so start over
+
+        // The head never catches up to the tail, so the two of them being equal always means the ring is empty
+        if (head >= tail) {
+            if (head + size <= STAGING_SIZE) {
+                offset = head;
+                head += size;
+                return true;
+            } if (size < tail) { // Whatever's left at the end goes to waste, until the tail gets past it
+                offset = 0;
+                head = size;
+                return true;
+            } return false;
+        }
+
+        if (head + size >= tail) return false;
+        offset = head;
+        head += size;
+        return true;
+    }
+
+    void UploadService::retireBatches(bool waitForOldest) {
+        const uint64_t completed = getCompletedValue();
+        while (!inFlight.empty()) {
+            Batch &batch = *inFlight.front();
+            if (batch.value > completed) {
+                if (!waitForOldest) break;
+                waitForValue(batch.value);
+                waitForOldest = false;
+            }
+
+            tail = batch.ringEnd;
+            batch.ownStaging.clear();
+            freeBatches.push_back(std::move(inFlight.front()));
+            inFlight.pop_front();
+        }
+    }
+
+    uint64_t UploadService::getCompletedValue() const {
+        uint64_t value = 0;
+        if (vkGetSemaphoreCounterValue(device.device(), timeline, &value) != VK_SUCCESS)
+            throw std::runtime_error("Failed to get the upload timeline value!");
+        return value;
+    }
+
+    void UploadService::waitForValue(const uint64_t value) const {
+        if (value == 0) return;
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &timeline;
+        waitInfo.pValues = &value;
+        if (vkWaitSemaphores(device.device(), &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS)
+            throw std::runtime_error("Failed to wait for the uploads to finish!");
+    }
+}
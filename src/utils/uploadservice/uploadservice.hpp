@@ -0,0 +1,108 @@
+#ifndef UPLOADSERVICE_HPP
+#define UPLOADSERVICE_HPP
+
+#include <span>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+#include <tracy/Tracy.hpp>
+
+#include "../device/device.hpp"
+#include "../buffer/buffer.hpp"
+#include "../image/image.hpp"
+
+namespace Engine {
+    // Gets data into device local buffers and images without stalling on every single copy.
+    // Everything goes through one big, persistently mapped staging ring, and the copies get batched into a single
+    // submission on the transfer queue (a dedicated one, if the GPU has it), which signals a timeline semaphore once
+    // it's done. Nothing waits on the CPU unless the ring runs out of space, or someone asks for it with wait().
+    // The renderer flushes whatever's been batched before submitting each frame, and since the last part of every batch
+    // runs on the graphics queue, with a barrier at the end, anything submitted after it can use the results right away.
+    // Not thread safe (yet), since flushing submits to the graphics queue, which the renderer uses too.
+    class UploadService {
+    public:
+        static constexpr VkDeviceSize STAGING_SIZE = 32 * 1024 * 1024; // Anything bigger gets a staging buffer of its own
+
+        explicit UploadService(Device &device);
+        ~UploadService();
+
+        UploadService(const UploadService &) = delete;
+        UploadService& operator=(const UploadService &) = delete;
+
+        // The data gets copied right away, so it doesn't have to outlive the call.
+        // Each of these returns the timeline value the upload will be done at, once flushed.
+        uint64_t uploadBuffer(VkBuffer buffer, const void *data, VkDeviceSize size, VkDeviceSize offset = 0);
+        // Fills the first mip level, generates the rest, and leaves the whole image ready to be sampled.
+        // With mipOffsets, every level's already in the data instead (mipOffsets[level] bytes in, each aligned to the
+        // texel block size), so they all get copied at once, and nothing gets generated.
+        // The image has to stay alive until then, same as any other resource the GPU is using.
+        uint64_t uploadImage(Image &image,
+                             const void *data,
+                             VkDeviceSize size,
+                             std::span<const VkDeviceSize> mipOffsets = {});
+
+        // Submits everything batched so far, returns the value it'll be done at (or the last one, if there was nothing)
+        uint64_t flush();
+        // Flushes first, if needed
+        void wait(uint64_t value);
+        void waitIdle() { wait(flush()); }
+        [[nodiscard]] bool isComplete(uint64_t value) const;
+
+        [[nodiscard]] bool hasDedicatedTransferQueue() const { return transferFamily != graphicsFamily; }
+        [[nodiscard]] VkDeviceSize getUploadedBytes() const { return uploadedBytes; }
+        [[nodiscard]] uint32_t getSubmittedBatches() const { return submittedBatches; }
+    private:
+        // Everything recorded between two flushes
+        struct Batch {
+            VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE; // Same as the graphics one, without a transfer queue
+            VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+            uint64_t value = 0; // Timeline value it signals at the end
+            VkDeviceSize ringEnd = 0; // Where the ring's head was when it got submitted
+            std::vector<std::unique_ptr<Buffer>> ownStaging; // For the uploads too big for the ring
+        };
+
+        Device &device;
+
+        uint32_t graphicsFamily;
+        uint32_t transferFamily;
+        VkQueue transferQueue;
+        VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+        VkCommandPool graphicsCommandPool = VK_NULL_HANDLE;
+
+        VkSemaphore timeline = VK_NULL_HANDLE;
+        uint64_t nextValue = 1;
+        uint64_t lastSubmittedValue = 0;
+
+        std::unique_ptr<Buffer> staging;
+        VkDeviceSize alignment = 16; // Enough for any texel block, including compressed ones
+        VkDeviceSize head = 0; // Where the next allocation goes
+        VkDeviceSize tail = 0; // Where the oldest one still in use starts
+
+        std::unique_ptr<Batch> current; // Null until something gets recorded
+        std::deque<std::unique_ptr<Batch>> inFlight; // Oldest first
+        std::vector<std::unique_ptr<Batch>> freeBatches;
+
+        // Ownership transfers between the two queues, only needed with a dedicated transfer queue
+        std::vector<VkBufferMemoryBarrier> releaseBufferBarriers;
+        std::vector<VkBufferMemoryBarrier> acquireBufferBarriers;
+        std::vector<VkImageMemoryBarrier> releaseImageBarriers;
+        std::vector<VkImageMemoryBarrier> acquireImageBarriers;
+        std::vector<Image*> pendingMipmaps; // Blits need the graphics queue, so these wait until they've been acquired
+
+        VkDeviceSize uploadedBytes = 0;
+        uint32_t submittedBatches = 0;
+
+        Batch &getBatch();
+        // Copies the data into staging memory, returns the buffer it went into and where
+        std::pair<VkBuffer, VkDeviceSize> stage(const void *data, VkDeviceSize size);
+        [[nodiscard]] bool tryAllocate(VkDeviceSize size, VkDeviceSize &offset);
+        void retireBatches(bool waitForOldest);
+        [[nodiscard]] uint64_t getCompletedValue() const;
+        void waitForValue(uint64_t value) const;
+    };
+}
+
+#endif
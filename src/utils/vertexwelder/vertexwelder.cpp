@@ -0,0 +1,291 @@
+#include "vertexwelder.hpp"
+
+#include <bit>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cassert>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Engine {
+    namespace {
+        constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15;
+
+        // Small enough that every thread gets a few chunks, so one slow chunk doesn't hold everyone up
+        constexpr uint32_t CHUNKS_PER_THREAD = 4;
+        constexpr uint32_t MIN_CHUNK_SIZE = 4096;
+
+        // Adding zero turns -0 into 0, which compares equal to it, so it has to hash the same too
+        uint32_t getBits(const float value) { return std::bit_cast<uint32_t>(value + 0.0f); }
+
+        uint64_t mix(const uint64_t hash, const uint32_t value) { return (hash ^ value) * MULTIPLIER; }
+
+        // So every bit of the input gets a say in both the tag and the group
+        uint64_t finish(uint64_t hash) {
+            hash ^= hash >> 32;
+            hash *= 0xbf58476d1ce4e5b9;
+            return hash ^ hash >> 29;
+        }
+
+        uint64_t hashAttributes(uint64_t hash, const Model::Vertex &vertex) {
+            hash = mix(hash, getBits(vertex.color.x));
+            hash = mix(hash, getBits(vertex.color.y));
+            hash = mix(hash, getBits(vertex.color.z));
+            hash = mix(hash, getBits(vertex.normal.x));
+            hash = mix(hash, getBits(vertex.normal.y));
+            hash = mix(hash, getBits(vertex.normal.z));
+            hash = mix(hash, getBits(vertex.texCoord.x));
+            return mix(hash, getBits(vertex.texCoord.y));
+        }
+
+        uint8_t getTag(const uint64_t hash) { return static_cast<uint8_t>(hash & 0x7f); }
+
+        // One bit per slot in the group whose control byte is the given one
+        uint32_t matchGroup(const uint8_t *group, const uint8_t value) {
+#ifdef __SSE2__
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+            const __m128i equal = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(value)));
+            return static_cast<uint32_t>(_mm_movemask_epi8(equal));
+#else
+            uint32_t mask = 0;
+            for (uint32_t i = 0; i < VertexWelder::GROUP_SIZE; i++)
+                mask |= static_cast<uint32_t>(group[i] == value) << i;
+            return mask;
+#endif
+        }
+    }
+
+    VertexWelder::VertexWelder(std::vector<Model::Vertex> &vertices, const size_t expectedVertices, const float epsilon)
+        : vertices(vertices), epsilon(epsilon), cellSize(2.0f * epsilon) {
+        assert(epsilon >= 0.0f && "The weld epsilon can't be negative!");
+
+        // Enough groups to stay under 7/8 full with everything we expect in there
+        const size_t slotsNeeded = std::max(expectedVertices, vertices.size()) * 8 / 7 + 1;
+        grow(std::bit_ceil((slotsNeeded + GROUP_SIZE - 1) / GROUP_SIZE));
+    }
+
+    uint32_t VertexWelder::weld(const Model::Vertex &vertex) {
+        const uint64_t hash = hashKey(vertex);
+        const uint32_t existing = epsilon > 0.0f ? findNear(vertex) : find(vertex, hash);
+        if (existing != NO_VERTEX) return existing;
+
+        if ((size + 1) * 8 > control.size() * 7) grow(2 * (groupMask + 1));
+        const auto index = static_cast<uint32_t>(vertices.size());
+        vertices.push_back(vertex);
+        insert(index, hash);
+        return index;
+    }
+
+    uint64_t VertexWelder::hash(const Model::Vertex &vertex) {
+        uint64_t hash = mix(0, getBits(vertex.position.x));
+        hash = mix(hash, getBits(vertex.position.y));
+        hash = mix(hash, getBits(vertex.position.z));
+        return finish(hashAttributes(hash, vertex));
+    }
+
+    uint64_t VertexWelder::hashKey(const Model::Vertex &vertex) const {
+        return epsilon > 0.0f ? hashCell(vertex, getCell(vertex.position)) : hash(vertex);
+    }
+
+    // Everything but the position has to match exactly, so the cell stands in for it
+    uint64_t VertexWelder::hashCell(const Model::Vertex &vertex, const glm::ivec3 &cell) const {
+        uint64_t hash = mix(0, static_cast<uint32_t>(cell.x));
+        hash = mix(hash, static_cast<uint32_t>(cell.y));
+        hash = mix(hash, static_cast<uint32_t>(cell.z));
+        return finish(hashAttributes(hash, vertex));
+    }
+
+    glm::ivec3 VertexWelder::getCell(const glm::vec3 &position) const {
+        return glm::ivec3(glm::floor(position / cellSize));
+    }
+
+    bool VertexWelder::matches(const Model::Vertex &a, const Model::Vertex &b) const {
+        if (epsilon == 0.0f) return a == b;
+        return glm::all(glm::lessThanEqual(glm::abs(a.position - b.position), glm::vec3{epsilon})) &&
+               a.color == b.color &&
+               a.normal == b.normal &&
+               a.texCoord == b.texCoord;
+    }
+
+    template<typename Visit>
+    void VertexWelder::probe(const uint64_t hash, Visit &&visit) const {
+        const uint8_t tag = getTag(hash);
+        size_t group = (hash >> 7) & groupMask;
+        // Triangular steps, which visit every group once when there's a power of two of them
+        for (size_t step = 1; ; step++) {
+            const uint8_t *controls = control.data() + group * GROUP_SIZE;
+            for (uint32_t mask = matchGroup(controls, tag); mask != 0; mask &= mask - 1)
+                if (visit(slots[group * GROUP_SIZE + static_cast<size_t>(std::countr_zero(mask))])) return;
+            if (matchGroup(controls, EMPTY) != 0) return; // Anything with this hash would've gone in here
+            group = (group + step) & groupMask;
+        }
+    }
+
+    uint32_t VertexWelder::find(const Model::Vertex &vertex, const uint64_t hash) const {
+        uint32_t found = NO_VERTEX;
+        probe(hash, [&](const uint32_t index) {
+            if (!matches(vertices[index], vertex)) return false;
+            found = index;
+            return true;
+        });
+        return found;
+    }
+
+    // Anything within epsilon is in the cell the position's in, or the one next to it on any axis, but only ever on the
+    // side that's closest, so that's at most 8 cells to look in. There can be more than one vertex close enough, so
+    // the earliest one wins, which doesn't depend on the order we look in.
+    uint32_t VertexWelder::findNear(const Model::Vertex &vertex) const {
+        const glm::ivec3 low = getCell(vertex.position - epsilon);
+        const glm::ivec3 high = getCell(vertex.position + epsilon);
+
+        uint32_t best = NO_VERTEX;
+        for (int32_t x = low.x; x <= high.x; x++) for (int32_t y = low.y; y <= high.y; y++)
+            for (int32_t z = low.z; z <= high.z; z++) {
+                probe(hashCell(vertex, {x, y, z}), [&](const uint32_t index) {
+                    if (index < best && matches(vertices[index], vertex)) best = index;
+                    return false;
+                });
+            } return best;
+    }
+
+    void VertexWelder::insert(const uint32_t index, const uint64_t hash) {
+        size_t group = (hash >> 7) & groupMask;
+        for (size_t step = 1; ; step++) {
+            if (const uint32_t empty = matchGroup(control.data() + group * GROUP_SIZE, EMPTY); empty != 0) {
+                const size_t slot = group * GROUP_SIZE + static_cast<size_t>(std::countr_zero(empty));
+                control[slot] = getTag(hash);
+                slots[slot] = index;
+                size++;
+                return;
+            } group = (group + step) & groupMask;
+        }
+    }
+
+    // Nothing ever gets removed, so the table only needs to be rebuilt from the vertices
+    void VertexWelder::grow(const size_t groupCount) {
+        control.assign(groupCount * GROUP_SIZE, EMPTY);
+        slots.assign(groupCount * GROUP_SIZE, 0);
+        groupMask = groupCount - 1;
+        size = 0;
+        for (uint32_t i = 0; i < vertices.size(); i++) insert(i, hashKey(vertices[i]));
+    }
+
+    ParallelVertexWelder::ParallelVertexWelder(WorkerPool &workerPool,
+                                               const uint32_t partitionCount,
+                                               const float epsilon)
+        : workerPool(workerPool), partitionCount(partitionCount), epsilon(epsilon), partitionVertices(partitionCount) {
+        assert(partitionCount > 0 && "Need at least one partition to weld into!");
+        assert(epsilon >= 0.0f && "The weld epsilon can't be negative!");
+        // The partitions never get resized, so the welders can hold on to their vectors
+        welders.reserve(partitionCount);
+        for (std::vector<Model::Vertex> &vertices : partitionVertices)
+            welders.push_back(std::make_unique<VertexWelder>(vertices));
+    }
+
+    // Same three steps as the OBJ loader, but the indices keep which partition their vertex is in, in the low part,
+    // instead of numbering everything in order, which would need every corner to stick around until the end
+    void ParallelVertexWelder::weld(const std::span<const Model::Vertex> corners, std::vector<uint32_t> &indices) {
+        ZoneScoped;
+        assert(!welders.empty() && "Can't weld anything else after finishing!");
+        if (corners.empty()) return;
+        if (indices.size() + corners.size() > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("Failed to weld vertices, there are too many corners!");
+
+        const auto cornerCount = static_cast<uint32_t>(corners.size());
+        const uint32_t threadCount = workerPool.getThreadCount() + 1;
+        const uint32_t chunkSize = std::max(MIN_CHUNK_SIZE,
+                                            (cornerCount + threadCount * CHUNKS_PER_THREAD - 1) /
+                                            (threadCount * CHUNKS_PER_THREAD));
+        const uint32_t chunkCount = (cornerCount + chunkSize - 1) / chunkSize;
+
+        hashes.resize(cornerCount);
+        workerPool.parallelFor(cornerCount, chunkSize, [&](const uint32_t begin, const uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) hashes[i] = VertexWelder::hash(corners[i]);
+        });
+
+        offsets.assign(size_t{chunkCount} * partitionCount, 0);
+        workerPool.parallelFor(chunkCount, 1, [&](const uint32_t chunk, uint32_t) {
+            const uint32_t end = std::min(cornerCount, (chunk + 1) * chunkSize);
+            for (uint32_t i = chunk * chunkSize; i < end; i++)
+                offsets[size_t{chunk} * partitionCount + VertexWelder::getPartition(hashes[i], partitionCount)]++;
+        });
+
+        // Checked up front, worst case every corner is a new vertex, since throwing from the workers isn't much fun
+        const uint32_t maxVertices = std::numeric_limits<uint32_t>::max() / partitionCount;
+        partitionStarts.assign(partitionCount + 1, 0);
+        uint32_t total = 0;
+        for (uint32_t partition = 0; partition < partitionCount; partition++) {
+            partitionStarts[partition] = total;
+            for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+                const uint32_t count = offsets[size_t{chunk} * partitionCount + partition];
+                offsets[size_t{chunk} * partitionCount + partition] = total;
+                total += count;
+            } if (partitionVertices[partition].size() + (total - partitionStarts[partition]) > maxVertices)
+                throw std::runtime_error("Failed to weld vertices, there are too many of them!");
+        } partitionStarts[partitionCount] = total;
+
+        partitioned.resize(cornerCount);
+        workerPool.parallelFor(chunkCount, 1, [&](const uint32_t chunk, uint32_t) {
+            const uint32_t end = std::min(cornerCount, (chunk + 1) * chunkSize);
+            for (uint32_t i = chunk * chunkSize; i < end; i++) {
+                const uint32_t partition = VertexWelder::getPartition(hashes[i], partitionCount);
+                partitioned[offsets[size_t{chunk} * partitionCount + partition]++] = i;
+            }
+        });
+
+        const size_t first = indices.size();
+        indices.resize(first + cornerCount);
+        workerPool.parallelFor(partitionCount, 1, [&](const uint32_t partition, uint32_t) {
+            VertexWelder &welder = *welders[partition];
+            for (uint32_t i = partitionStarts[partition]; i < partitionStarts[partition + 1]; i++) {
+                const uint32_t corner = partitioned[i];
+                indices[first + corner] = welder.weld(corners[corner]) * partitionCount + partition;
+            }
+        });
+    }
+
+    void ParallelVertexWelder::finish(std::vector<Model::Vertex> &vertices, std::vector<uint32_t> &indices) {
+        ZoneScoped;
+        welders.clear(); // They point into the partitions, which are about to go away
+
+        std::vector<uint32_t> bases(partitionCount);
+        size_t total = 0;
+        for (uint32_t partition = 0; partition < partitionCount; partition++) {
+            bases[partition] = static_cast<uint32_t>(total);
+            total += partitionVertices[partition].size();
+        }
+
+        vertices.resize(total);
+        workerPool.parallelFor(partitionCount, 1, [&](const uint32_t partition, uint32_t) {
+            std::ranges::copy(partitionVertices[partition], vertices.begin() + bases[partition]);
+            partitionVertices[partition] = {};
+        });
+
+        // Close enough could be in any partition, so that's left until they're all together. By now there's only one of
+        // each exact vertex, so it's a lot less to go through than the corners were.
+        std::vector<uint32_t> remap;
+        if (epsilon > 0.0f) {
+            std::vector<Model::Vertex> welded;
+            VertexWelder welder(welded, vertices.size(), epsilon);
+            remap.resize(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++) remap[i] = welder.weld(vertices[i]);
+            vertices = std::move(welded);
+        }
+
+        const auto indexCount = static_cast<uint32_t>(indices.size());
+        const uint32_t threadCount = workerPool.getThreadCount() + 1;
+        const uint32_t chunkSize = std::max(MIN_CHUNK_SIZE,
+                                            (indexCount + threadCount * CHUNKS_PER_THREAD - 1) /
+                                            (threadCount * CHUNKS_PER_THREAD));
+        workerPool.parallelFor(indexCount, chunkSize, [&](const uint32_t begin, const uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                indices[i] = bases[indices[i] % partitionCount] + indices[i] / partitionCount;
+                if (!remap.empty()) indices[i] = remap[indices[i]];
+            }
+        });
+    }
+}
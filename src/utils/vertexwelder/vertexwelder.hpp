@@ -0,0 +1,102 @@
+#ifndef VERTEXWELDER_HPP
+#define VERTEXWELDER_HPP
+
+#include <span>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "../model/model.hpp"
+#include "../workerpool/workerpool.hpp"
+
+namespace Engine {
+    // Merges vertices as they get added, handing back the index of the first one that was the same, which is what every
+    // mesh builder needs. It's a flat, open addressing table (like Abseil's Swiss tables): each slot has a control byte
+    // with 7 bits of its hash, and those get checked GROUP_SIZE at a time (with SSE2, when we have it), so a lookup
+    // almost never has to compare a vertex that isn't the one it's looking for. The table only keeps indices, the
+    // vertices themselves live in the vector it's given.
+    // With an epsilon, positions that are within epsilon of each other (on every axis) weld too, as long as everything
+    // else is exactly the same, since exporters love writing the same corner slightly differently every time.
+    class VertexWelder {
+    public:
+        static constexpr uint32_t GROUP_SIZE = 16;
+
+        // Anything already in vertices gets added as is, without welding it
+        explicit VertexWelder(std::vector<Model::Vertex> &vertices, size_t expectedVertices = 0, float epsilon = 0.0f);
+
+        VertexWelder(const VertexWelder &) = delete;
+        VertexWelder &operator=(const VertexWelder &) = delete;
+
+        // Index of the vertex, which gets added to the end of the vector if there's nothing like it yet
+        uint32_t weld(const Model::Vertex &vertex);
+
+        // Works straight on the bits, so it's a lot cheaper than hashing every float on its own. Vertices that compare
+        // equal always get the same hash, negative zeros included.
+        [[nodiscard]] static uint64_t hash(const Model::Vertex &vertex);
+        // Which of partitionCount welders a vertex with this hash goes to, when splitting the work between threads.
+        // The table also uses the hash, so this makes sure they don't end up picking the same bits.
+        [[nodiscard]] static uint32_t getPartition(const uint64_t hash, const uint32_t partitionCount) {
+            return static_cast<uint32_t>(((hash * 0x9e3779b97f4a7c15) >> 40) % partitionCount);
+        }
+    private:
+        static constexpr uint8_t EMPTY = 0x80; // Tags only use the low 7 bits, so this can't be one
+        static constexpr uint32_t NO_VERTEX = ~0u;
+
+        std::vector<Model::Vertex> &vertices;
+        std::vector<uint8_t> control;
+        std::vector<uint32_t> slots;
+        size_t groupMask = 0;
+        size_t size = 0;
+        float epsilon;
+        float cellSize; // Twice the epsilon, so anything close enough to a position is at most one cell over
+
+        [[nodiscard]] uint64_t hashKey(const Model::Vertex &vertex) const;
+        [[nodiscard]] uint64_t hashCell(const Model::Vertex &vertex, const glm::ivec3 &cell) const;
+        [[nodiscard]] glm::ivec3 getCell(const glm::vec3 &position) const;
+        [[nodiscard]] bool matches(const Model::Vertex &a, const Model::Vertex &b) const;
+
+        // Goes through every vertex whose tag matches the hash's, until visit returns true, or there can't be any more
+        template<typename Visit>
+        void probe(uint64_t hash, Visit &&visit) const;
+        // NO_VERTEX if there's none
+        [[nodiscard]] uint32_t find(const Model::Vertex &vertex, uint64_t hash) const;
+        [[nodiscard]] uint32_t findNear(const Model::Vertex &vertex) const;
+        void insert(uint32_t index, uint64_t hash);
+        void grow(size_t groupCount);
+    };
+
+    // Welds huge meshes a batch of corners at a time, on a worker pool, so nothing but the welded vertices and indices
+    // has to stay around for the whole mesh. The corners get split between partitions by their hash, each with a
+    // welder of its own, so the threads never have to talk to each other. The vertices end up grouped by partition
+    // instead of in order, which Builder::optimize puts back in order anyway.
+    // With an epsilon, the exact matches get welded as usual, and then finish welds whatever's left within epsilon of
+    // each other, the same way VertexWelder does, since those could be in different partitions.
+    class ParallelVertexWelder {
+    public:
+        ParallelVertexWelder(WorkerPool &workerPool, uint32_t partitionCount, float epsilon = 0.0f);
+
+        ParallelVertexWelder(const ParallelVertexWelder &) = delete;
+        ParallelVertexWelder &operator=(const ParallelVertexWelder &) = delete;
+
+        // Adds an index for every corner to indices, which only mean anything after finish
+        void weld(std::span<const Model::Vertex> corners, std::vector<uint32_t> &indices);
+        // Puts the vertices of every partition one after the other, and points the indices at them, so indices can't
+        // have anything weld didn't put in there. Only once, after the last batch.
+        void finish(std::vector<Model::Vertex> &vertices, std::vector<uint32_t> &indices);
+    private:
+        WorkerPool &workerPool;
+        uint32_t partitionCount;
+        float epsilon;
+
+        std::vector<std::vector<Model::Vertex>> partitionVertices;
+        std::vector<std::unique_ptr<VertexWelder>> welders;
+
+        // Only for the current batch, but kept around so every batch doesn't have to allocate them again
+        std::vector<uint64_t> hashes;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> partitionStarts;
+        std::vector<uint32_t> partitioned;
+    };
+}
+
+#endif
@@ -2,12 +2,13 @@
 #include "window.hpp"
 
 namespace Engine {
-    Window::Window(int width, int height, const char* title) :
-            width(width), height(height), window_title(title) {
-        init();
+    Window::Window(int width, int height, const char* title, bool headless) :
+            width(width), height(height), window_title(title), headless(headless) {
+        if (!headless) init();
     }
 
     Window::~Window() {
+        if (headless) return;
         glfwDestroyWindow(window);
         glfwTerminate();
     }
@@ -28,9 +29,10 @@ namespace Engine {
         glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
     }
 
-    bool Window::shouldClose () const { return glfwWindowShouldClose(window); }
+    bool Window::shouldClose () const { return !headless && glfwWindowShouldClose(window); }
 
     void Window::createWindowSurface(VkInstance instance, VkSurfaceKHR* surface) {
+        assert(!headless && "Cannot create a surface for a headless window!");
         if (glfwCreateWindowSurface(instance, window, nullptr, surface) != VK_SUCCESS)
             throw std::runtime_error("Failed to create the window surface!");
     }
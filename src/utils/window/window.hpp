@@ -10,7 +10,9 @@
 namespace Engine {
     class Window {
     public:
-        Window(int width, int height, const char* title);
+        // A headless window doesn't touch GLFW at all, it just remembers its size, so we can render offscreen on machines
+        // without a display
+        Window(int width, int height, const char* title, bool headless = false);
         ~Window();
 
         Window(const Window&) = delete;
@@ -23,6 +25,7 @@ namespace Engine {
         [[nodiscard]] bool wasWindowResized() const { return framebufferResized; }
         void resetWindowResizedFlag() { framebufferResized = false; }
         [[nodiscard]] GLFWwindow* getWindow() const { return window; }
+        [[nodiscard]] bool isHeadless() const { return headless; }
 
         void createWindowSurface(VkInstance instance, VkSurfaceKHR* surface);
     private:
@@ -30,8 +33,9 @@ namespace Engine {
         bool framebufferResized = false;
 
         const char *window_title = "Vulkan test window";
+        bool headless = false;
 
-        GLFWwindow *window;
+        GLFWwindow *window = nullptr;
 
         void init();
         static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
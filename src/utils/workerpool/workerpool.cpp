@@ -0,0 +1,46 @@
+#include "workerpool.hpp"
+
+#include <cassert>
+
+namespace Engine {
+    WorkerPool::WorkerPool(const uint32_t threadCount) {
+        assert(threadCount > 0 && "A worker pool needs at least one thread!");
+        threads.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++) threads.emplace_back([this] { work(); });
+    }
+    WorkerPool::~WorkerPool() {
+        {
+            std::scoped_lock lock(mutex);
+            stopping = true;
+        } condition.notify_all();
+        threads.clear(); // jthreads join on destruction, after finishing whatever is left on the queue
+    }
+
+    void WorkerPool::parallelFor(const uint32_t count,
+                                 const uint32_t chunkSize,
+                                 const std::function<void(uint32_t, uint32_t)> &body) {
+        assert(chunkSize > 0 && "Cannot split the work into empty chunks!");
+        if (count == 0) return;
+
+        std::vector<std::future<void>> futures;
+        futures.reserve(count / chunkSize);
+        for (uint32_t begin = chunkSize; begin < count; begin += chunkSize)
+            futures.push_back(submit([&body, begin, end = std::min(begin + chunkSize, count)] { body(begin, end); }));
+
+        body(0, std::min(chunkSize, count));
+        for (std::future<void> &future : futures) future.get(); // Rethrows anything the workers threw
+    }
+
+    void WorkerPool::work() {
+        while (true) {
+            std::move_only_function<void()> task;
+            {
+                std::unique_lock lock(mutex);
+                condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return; // Only happens when stopping
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            } task();
+        }
+    }
+}
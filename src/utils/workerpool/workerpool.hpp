@@ -0,0 +1,54 @@
+#ifndef WORKERPOOL_HPP
+#define WORKERPOOL_HPP
+
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <type_traits>
+
+namespace Engine {
+    // A bunch of threads that pick up tasks from a shared queue, so we don't have to spin up new threads every time
+    // we want to do something in parallel
+    class WorkerPool {
+    public:
+        // Leave one thread for the main one, which also helps out on parallelFor
+        explicit WorkerPool(uint32_t threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool& operator=(const WorkerPool &) = delete;
+
+        template<typename F>
+        std::future<std::invoke_result_t<F>> submit(F &&task) {
+            std::packaged_task<std::invoke_result_t<F>()> packagedTask(std::forward<F>(task));
+            std::future<std::invoke_result_t<F>> future = packagedTask.get_future();
+            {
+                std::scoped_lock lock(mutex);
+                tasks.emplace_back(std::move(packagedTask));
+            } condition.notify_one();
+            return future;
+        }
+
+        // Splits [0, count) into chunks of at most chunkSize, and runs body(begin, end) on each of them.
+        // The calling thread takes a chunk too, and this only returns once they're all done.
+        void parallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t, uint32_t)> &body);
+
+        [[nodiscard]] uint32_t getThreadCount() const { return static_cast<uint32_t>(threads.size()); }
+    private:
+        std::vector<std::jthread> threads;
+        std::deque<std::move_only_function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+
+        void work();
+    };
+}
+
+#endif
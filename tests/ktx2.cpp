@@ -0,0 +1,222 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/utils/ktx2/ktx2.hpp"
+
+// Checks the KTX2 parser against files written on the spot, both ones it should take, and every way we know of to
+// break one, which it has to turn down with an exception instead of handing out something past the end of the file.
+// Usage: Game_Engine_test_ktx2
+namespace {
+    using Engine::Ktx2File;
+
+    constexpr uint8_t IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    uint32_t failures = 0;
+
+    void check(const bool condition, const std::string &what) {
+        if (condition) return;
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+
+    // What goes in the header, plus a few ways to mess up the levels after the fact
+    struct Options {
+        VkFormat format = VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        uint32_t blockSize = 8;
+        uint32_t typeSize = 1;
+        uint32_t width = 100;
+        uint32_t height = 60;
+        uint32_t depth = 0;
+        uint32_t layerCount = 0;
+        uint32_t faceCount = 1;
+        uint32_t levelCount = 7;
+        uint32_t supercompression = 0;
+        uint64_t lengthError = 0; // Added to the length of the second level
+        uint64_t offsetError = 0; // Added to the offset of the second level
+        size_t truncate = 0; // Bytes cut off the end
+    };
+
+    template<typename T>
+    void append(std::vector<std::byte> &bytes, const T value) {
+        const auto *data = reinterpret_cast<const std::byte *>(&value);
+        bytes.insert(bytes.end(), data, data + sizeof(T));
+    }
+
+    // The levels go in smallest first, each padded to the block size, like the spec wants, and every byte of a level
+    // is its number, so it's easy to tell which one an offset really points at
+    std::vector<std::byte> build(const Options &options) {
+        const uint32_t levels = std::max(1u, options.levelCount);
+        std::vector<uint64_t> lengths(levels);
+        for (uint32_t level = 0; level < levels; level++) {
+            const uint64_t blocksWide = (std::max(1u, options.width >> level) + 3) / 4;
+            const uint64_t blocksHigh = (std::max(1u, options.height >> level) + 3) / 4;
+            lengths[level] = blocksWide * blocksHigh * options.blockSize;
+        }
+
+        std::vector<uint64_t> offsets(levels);
+        uint64_t end = 80 + uint64_t{24} * levels;
+        for (uint32_t level = levels; level-- > 0;) {
+            end = (end + options.blockSize - 1) / options.blockSize * options.blockSize;
+            offsets[level] = end;
+            end += lengths[level];
+        }
+
+        std::vector<std::byte> bytes(reinterpret_cast<const std::byte *>(IDENTIFIER),
+                                     reinterpret_cast<const std::byte *>(IDENTIFIER) + sizeof(IDENTIFIER));
+        for (const uint32_t value : {static_cast<uint32_t>(options.format), options.typeSize, options.width,
+                                     options.height, options.depth, options.layerCount, options.faceCount,
+                                     options.levelCount, options.supercompression})
+            append(bytes, value);
+        for (uint32_t i = 0; i < 4; i++) append(bytes, uint32_t{0}); // No data format descriptor, or key/values
+        for (uint32_t i = 0; i < 2; i++) append(bytes, uint64_t{0}); // No supercompression global data
+
+        for (uint32_t level = 0; level < levels; level++) {
+            append(bytes, offsets[level] + (level == 1 ? options.offsetError : 0));
+            append(bytes, lengths[level] + (level == 1 ? options.lengthError : 0));
+            append(bytes, lengths[level]);
+        }
+        bytes.resize(end, std::byte{0});
+        for (uint32_t level = 0; level < levels; level++)
+            std::fill_n(bytes.begin() + static_cast<std::ptrdiff_t>(offsets[level]), lengths[level],
+                        static_cast<std::byte>(level));
+        bytes.resize(bytes.size() - std::min(options.truncate, bytes.size()));
+        return bytes;
+    }
+
+    std::filesystem::path write(const std::filesystem::path &directory,
+                                const std::string &name,
+                                const std::vector<std::byte> &bytes) {
+        const std::filesystem::path path = directory / name;
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!file) throw std::runtime_error("Failed to write " + path.string() + "!");
+        return path;
+    }
+
+    void testValid(const std::filesystem::path &directory) {
+        {
+            const Ktx2File file(write(directory, "bc1.ktx2", build({})));
+            check(file.getFormat() == VK_FORMAT_BC1_RGB_UNORM_BLOCK, "The format comes from the header");
+            check(file.getWidth() == 100 && file.getHeight() == 60, "So does the size");
+            check(file.getMipLevels() == 7, "Every level gets read");
+
+            bool aligned = true;
+            bool right = true;
+            for (uint32_t level = 0; level < file.getMipLevels(); level++) {
+                const VkDeviceSize offset = file.getMipOffsets()[level];
+                aligned &= offset % 8 == 0;
+                right &= offset < file.getData().size() && file.getData()[offset] == static_cast<std::byte>(level);
+            }
+            check(aligned, "Every level starts on a block");
+            check(right, "Every offset points at its own level");
+            check(file.getMipOffsets().back() == 0, "The smallest level comes first in the file");
+            check(file.getData().size() == file.getMipOffsets()[0] + 25 * 15 * 8,
+                  "The data ends with the largest level");
+        }
+
+        {
+            Options options;
+            options.format = VK_FORMAT_BC7_SRGB_BLOCK;
+            options.blockSize = 16;
+            options.width = options.height = 256;
+            options.levelCount = 9;
+            const Ktx2File file(write(directory, "bc7.KTX2", build(options)));
+            check(file.getFormat() == VK_FORMAT_BC7_SRGB_BLOCK && file.getMipLevels() == 9, "BC7 with all its mips");
+            check(std::ranges::all_of(file.getMipOffsets(), [](const VkDeviceSize offset) { return offset % 16 == 0; }),
+                  "BC7 levels start on a block");
+        }
+
+        {
+            Options options;
+            options.levelCount = 0;
+            const Ktx2File file(write(directory, "nolevels.ktx2", build(options)));
+            check(file.getMipLevels() == 1, "No level count means just the one level, since we can't make the rest");
+        }
+
+        {
+            Options options;
+            options.width = options.height = 1;
+            options.levelCount = 1;
+            const Ktx2File file(write(directory, "tiny.ktx2", build(options)));
+            check(file.getData().size() == 8, "Anything smaller than a block still takes a whole block");
+        }
+
+        check(Ktx2File::isKtx2("a/b/texture.ktx2") && Ktx2File::isKtx2("TEXTURE.KTX2"), "The extension's picked up");
+        check(!Ktx2File::isKtx2("texture.jpg") && !Ktx2File::isKtx2("ktx2"), "And nothing else is");
+    }
+
+    void testMalformed(const std::filesystem::path &directory) {
+        const auto fails = [&directory](const std::string &what, const std::vector<std::byte> &bytes) {
+            const std::filesystem::path path = write(directory, "malformed.ktx2", bytes);
+            try {
+                const Ktx2File file(path);
+            } catch (const std::runtime_error &) {
+                return;
+            } check(false, "Turns down " + what);
+        };
+        const auto with = [](auto change) {
+            Options options;
+            change(options);
+            return build(options);
+        };
+
+        fails("an empty file", {});
+        fails("a file too small for the header", std::vector<std::byte>(40, std::byte{0xAB}));
+        std::vector<std::byte> identifier = build({});
+        identifier[5] = std::byte{'1'};
+        fails("a KTX1 identifier", identifier);
+
+        fails("supercompressed files", with([](Options &o) { o.supercompression = 1; }));
+        fails("formats that aren't block compressed", with([](Options &o) { o.format = VK_FORMAT_R8G8B8A8_UNORM; }));
+        fails("block compressed formats we don't take", with([](Options &o) { o.format = VK_FORMAT_BC4_UNORM_BLOCK; }));
+        fails("a type size that isn't 1", with([](Options &o) { o.typeSize = 4; }));
+        fails("3D textures", with([](Options &o) { o.depth = 4; }));
+        fails("texture arrays", with([](Options &o) { o.layerCount = 2; }));
+        fails("cube maps", with([](Options &o) { o.faceCount = 6; }));
+        fails("a width of 0", with([](Options &o) { o.width = 0; }));
+        fails("a height of 0", with([](Options &o) { o.height = 0; }));
+        fails("more levels than the size allows", with([](Options &o) { o.width = o.height = 64; o.levelCount = 8; }));
+
+        fails("a level index cut short", with([](Options &o) { o.truncate = build(o).size() - 100; }));
+        fails("a level that's too long", with([](Options &o) { o.lengthError = 1; }));
+        fails("a level that's too short", with([](Options &o) { o.lengthError = ~uint64_t{0}; }));
+        fails("a level cut short", with([](Options &o) { o.truncate = 5; }));
+        fails("a level that isn't aligned", with([](Options &o) { o.offsetError = 4; }));
+        fails("a level past the end", with([](Options &o) { o.offsetError = 1 << 20; }));
+        // Moved up by the size of the largest level (which is the last one), so it starts inside, but doesn't end there
+        fails("a level running past the end", with([](Options &o) { o.offsetError = 25 * 15 * 8 + 8; }));
+
+        std::filesystem::remove(directory / "malformed.ktx2");
+        bool missing = false;
+        try {
+            const Ktx2File file(directory / "missing.ktx2");
+        } catch (const std::runtime_error &) {
+            missing = true;
+        } check(missing, "Throws for a file that isn't there");
+    }
+}
+
+int main(const int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        std::cerr << "Unknown argument: " << argv[i] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "Game_Engine_test_ktx2";
+    std::filesystem::create_directories(directory);
+    testValid(directory);
+    testMalformed(directory);
+    std::filesystem::remove_all(directory);
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed" << std::endl;
+        return EXIT_FAILURE;
+    } std::cout << "All checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
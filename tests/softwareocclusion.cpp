@@ -0,0 +1,218 @@
+#include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/utils/softwareocclusion/softwareocclusion.hpp"
+
+// Checks the software occlusion culler against scenes simple enough to know the right answer for, and times the
+// rasteriser on a lot of small triangles. Everything goes in with an identity view projection, so the occluders are
+// already in normalised device coordinates, and the depth of each pixel is easy to work out by hand.
+// Usage: Game_Engine_test_softwareocclusion [--iterations N]
+namespace {
+    using Engine::SoftwareOcclusionCuller;
+
+    uint32_t failures = 0;
+
+    void check(const bool condition, const std::string &what) {
+        if (condition) return;
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+
+    // Two triangles from (x0, y0) to (x1, y1), at a depth that goes from depth0 on the left to depth1 on the right
+    void addQuad(SoftwareOcclusionCuller &culler,
+                 const float x0, const float y0, const float x1, const float y1,
+                 const float depth0, const float depth1) {
+        const std::vector<glm::vec3> vertices{{x0, y0, depth0}, {x1, y0, depth1}, {x1, y1, depth1}, {x0, y1, depth0}};
+        const std::vector<uint32_t> indices{0, 1, 2, 0, 2, 3};
+        culler.addOccluder(vertices, indices, glm::mat4{1.0f});
+    }
+
+    float pixelDepth(const SoftwareOcclusionCuller &culler, const uint32_t x, const uint32_t y) {
+        return culler.getDepth()[y * SoftwareOcclusionCuller::WIDTH + x];
+    }
+
+    // Where the center of a pixel is, in normalised device coordinates
+    float pixelCenterX(const uint32_t x) {
+        return (static_cast<float>(x) + 0.5f) / static_cast<float>(SoftwareOcclusionCuller::WIDTH) * 2.0f - 1.0f;
+    }
+
+    void testEmpty(Engine::WorkerPool &workerPool) {
+        SoftwareOcclusionCuller culler{workerPool};
+        culler.enabled = true;
+        culler.beginFrame(glm::mat4{1.0f});
+        culler.rasterize();
+
+        bool cleared = true;
+        for (const float depth : culler.getDepth()) cleared &= depth == 1.0f;
+        check(cleared, "Nothing to draw leaves the depth buffer at the far plane");
+        check(!culler.isOccluded({0.0f, 0.0f, 0.5f}, 0.1f), "Nothing gets occluded without any occluders");
+    }
+
+    void testCoverage(Engine::WorkerPool &workerPool) {
+        SoftwareOcclusionCuller culler{workerPool};
+        culler.beginFrame(glm::mat4{1.0f});
+        addQuad(culler, -1.0f, -1.0f, 1.0f, 1.0f, 0.25f, 0.25f);
+        culler.rasterize();
+
+        // The two triangles share a diagonal, which mustn't leave a crack
+        uint32_t uncovered = 0;
+        for (const float depth : culler.getDepth()) uncovered += std::abs(depth - 0.25f) > 1e-6f;
+        check(uncovered == 0, "A full screen quad covers every pixel (" + std::to_string(uncovered) + " missed)");
+        check(culler.getOccluderTriangles() == 2, "Both triangles of the quad get set up");
+
+        // Only the pixels whose centers are inside get touched, so half the screen is exactly half the pixels
+        culler.beginFrame(glm::mat4{1.0f});
+        addQuad(culler, -1.0f, -1.0f, 0.0f, 1.0f, 0.5f, 0.5f);
+        culler.rasterize();
+
+        uint32_t covered = 0;
+        bool leftOnly = true;
+        for (uint32_t y = 0; y < SoftwareOcclusionCuller::HEIGHT; y++) {
+            for (uint32_t x = 0; x < SoftwareOcclusionCuller::WIDTH; x++) {
+                const bool inside = pixelDepth(culler, x, y) < 1.0f;
+                covered += inside;
+                leftOnly &= inside == (x < SoftwareOcclusionCuller::WIDTH / 2);
+            }
+        }
+        check(leftOnly, "A quad over the left half only covers the left half");
+        check(covered == SoftwareOcclusionCuller::WIDTH * SoftwareOcclusionCuller::HEIGHT / 2,
+              "A quad over the left half covers half the pixels (" + std::to_string(covered) + ")");
+    }
+
+    void testDepth(Engine::WorkerPool &workerPool) {
+        SoftwareOcclusionCuller culler{workerPool};
+        culler.beginFrame(glm::mat4{1.0f});
+        addQuad(culler, -1.0f, -1.0f, 1.0f, 1.0f, 0.2f, 0.8f);
+        culler.rasterize();
+
+        // Slanted along x, so every pixel's depth is a straight line between the two sides
+        float worst = 0.0f;
+        for (uint32_t y = 0; y < SoftwareOcclusionCuller::HEIGHT; y++) {
+            for (uint32_t x = 0; x < SoftwareOcclusionCuller::WIDTH; x++) {
+                const float expected = 0.2f + 0.3f * (pixelCenterX(x) + 1.0f);
+                worst = std::max(worst, std::abs(pixelDepth(culler, x, y) - expected));
+            }
+        } check(worst < 1e-4f, "Depth gets interpolated across a slanted quad (off by " + std::to_string(worst) + ")");
+
+        // The nearest one wins, whichever order they're drawn in
+        culler.beginFrame(glm::mat4{1.0f});
+        addQuad(culler, -1.0f, -1.0f, 1.0f, 1.0f, 0.3f, 0.3f);
+        addQuad(culler, -1.0f, -1.0f, 1.0f, 1.0f, 0.6f, 0.6f);
+        addQuad(culler, -1.0f, -1.0f, 1.0f, 1.0f, 0.4f, 0.4f);
+        culler.rasterize();
+
+        bool nearest = true;
+        for (const float depth : culler.getDepth()) nearest &= std::abs(depth - 0.3f) < 1e-6f;
+        check(nearest, "Overlapping occluders keep the nearest depth");
+
+        // Anything that goes through the near plane gets dropped, instead of covering the screen
+        culler.beginFrame(glm::mat4{1.0f});
+        addQuad(culler, -1.0f, -1.0f, 1.0f, 1.0f, -0.5f, 0.5f);
+        culler.rasterize();
+
+        bool dropped = true;
+        for (const float depth : culler.getDepth()) dropped &= depth == 1.0f;
+        check(dropped, "Occluders behind the near plane get dropped");
+    }
+
+    void testOcclusion(Engine::WorkerPool &workerPool) {
+        SoftwareOcclusionCuller culler{workerPool};
+        culler.beginFrame(glm::mat4{1.0f});
+        addQuad(culler, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f, 0.5f);
+        culler.rasterize();
+
+        // Disabled, it never culls anything
+        check(!culler.isOccluded({0.0f, 0.0f, 0.8f}, 0.1f), "Nothing gets occluded while disabled");
+
+        culler.enabled = true;
+        check(culler.isOccluded({0.0f, 0.0f, 0.8f}, 0.1f), "Something right behind the occluder is occluded");
+        check(!culler.isOccluded({0.0f, 0.0f, 0.2f}, 0.1f), "Something in front of the occluder is visible");
+        check(!culler.isOccluded({0.0f, 0.0f, 0.5f}, 0.1f), "Something going through the occluder is visible");
+        check(!culler.isOccluded({0.45f, 0.0f, 0.8f}, 0.1f), "Something sticking out from behind it is visible");
+        check(!culler.isOccluded({0.8f, 0.8f, 0.8f}, 0.1f), "Something next to the occluder is visible");
+        check(!culler.isOccluded({3.0f, 0.0f, 0.8f}, 0.1f), "Something off screen is left to the frustum culling");
+        check(!culler.isOccluded({0.0f, 0.0f, 0.05f}, 0.1f), "Something reaching past the near plane is visible");
+        check(culler.getTestedObjects() == 7, "Every enabled test gets counted");
+        check(culler.getOccludedObjects() == 1, "Only the occluded ones get counted as such");
+
+        // A new frame throws the occluders away
+        culler.beginFrame(glm::mat4{1.0f});
+        check(!culler.isOccluded({0.0f, 0.0f, 0.8f}, 0.1f), "Nothing is occluded before rasterising");
+        culler.rasterize();
+        check(!culler.isOccluded({0.0f, 0.0f, 0.8f}, 0.1f), "Last frame's occluders are gone");
+    }
+
+    // A grid of quads, split into triangles a few pixels across, which is the worst case for the setup
+    void addGrid(SoftwareOcclusionCuller &culler, const uint32_t side) {
+        std::vector<glm::vec3> vertices;
+        std::vector<uint32_t> indices;
+        for (uint32_t y = 0; y <= side; y++) {
+            for (uint32_t x = 0; x <= side; x++) {
+                const float u = static_cast<float>(x) / static_cast<float>(side);
+                const float v = static_cast<float>(y) / static_cast<float>(side);
+                vertices.emplace_back(u * 2.0f - 1.0f, v * 2.0f - 1.0f, 0.1f + 0.8f * u * v);
+            }
+        }
+        for (uint32_t y = 0; y < side; y++) {
+            for (uint32_t x = 0; x < side; x++) {
+                const uint32_t corner = y * (side + 1) + x;
+                indices.insert(indices.end(), {corner, corner + 1, corner + side + 2,
+                                               corner, corner + side + 2, corner + side + 1});
+            }
+        } culler.addOccluder(vertices, indices, glm::mat4{1.0f});
+    }
+
+    void testThreads(Engine::WorkerPool &workerPool) {
+        // Splitting the work up differently can't change the result
+        Engine::WorkerPool serialPool{1};
+        SoftwareOcclusionCuller serial{serialPool}, parallel{workerPool};
+        for (SoftwareOcclusionCuller *culler : {&serial, &parallel}) {
+            culler->beginFrame(glm::mat4{1.0f});
+            addGrid(*culler, 64);
+            culler->rasterize();
+        } check(serial.getDepth() == parallel.getDepth(), "The depth buffer doesn't depend on the thread count");
+    }
+
+    void benchmark(Engine::WorkerPool &workerPool, const uint32_t iterations) {
+        SoftwareOcclusionCuller culler{workerPool};
+        double total = 0.0;
+        for (uint32_t i = 0; i < iterations; i++) {
+            culler.beginFrame(glm::mat4{1.0f});
+            addGrid(culler, 128);
+            culler.rasterize();
+            total += static_cast<double>(culler.getRasterizationTime());
+        }
+        std::cout << "Rasterised " << culler.getOccluderTriangles() << " triangles on " << workerPool.getThreadCount() + 1
+                  << " threads in " << total / iterations << " ms on average" << std::endl;
+    }
+}
+
+int main(const int argc, char *argv[]) {
+    uint32_t iterations = 100;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--iterations" && i + 1 < argc) {
+            iterations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    Engine::WorkerPool workerPool;
+    testEmpty(workerPool);
+    testCoverage(workerPool);
+    testDepth(workerPool);
+    testOcclusion(workerPool);
+    testThreads(workerPool);
+    if (iterations > 0) benchmark(workerPool, iterations);
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed" << std::endl;
+        return EXIT_FAILURE;
+    } std::cout << "All checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}